@@ -0,0 +1,113 @@
+/**
+  *  \file afl/async/streamobject.cpp
+  *  \brief Class afl::async::StreamObject
+  *
+  *  Scheduling and locking is implemented by StreamWorker.
+  */
+
+#include "afl/async/streamobject.hpp"
+#include "afl/async/controller.hpp"
+#include "afl/async/receiveoperation.hpp"
+#include "afl/async/sendoperation.hpp"
+
+afl::async::StreamObject::StreamObject(afl::base::Ref<afl::io::Stream> stream)
+    : m_stream(stream),
+      m_ownWorker(new StreamWorker(1)),
+      m_worker(*m_ownWorker),
+      m_pending(),
+      m_current(0),
+      m_queued(false),
+      m_running(false),
+      m_numWaiters(0),
+      m_idle(0)
+{ }
+
+afl::async::StreamObject::StreamObject(afl::base::Ref<afl::io::Stream> stream, StreamWorker& worker)
+    : m_stream(stream),
+      m_ownWorker(),
+      m_worker(worker),
+      m_pending(),
+      m_current(0),
+      m_queued(false),
+      m_running(false),
+      m_numWaiters(0),
+      m_idle(0)
+{ }
+
+afl::async::StreamObject::~StreamObject()
+{
+    m_worker.detach(*this);
+}
+
+bool
+afl::async::StreamObject::send(Controller& ctl, SendOperation& op, afl::sys::Timeout_t timeout)
+{
+    sendAsync(ctl, op);
+    if (!ctl.wait(op, timeout)) {
+        cancel(ctl, op);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+void
+afl::async::StreamObject::sendAsync(Controller& ctl, SendOperation& op)
+{
+    m_worker.startOperation(*this, ctl, op);
+}
+
+bool
+afl::async::StreamObject::receive(Controller& ctl, ReceiveOperation& op, afl::sys::Timeout_t timeout)
+{
+    receiveAsync(ctl, op);
+    if (!ctl.wait(op, timeout)) {
+        cancel(ctl, op);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+void
+afl::async::StreamObject::receiveAsync(Controller& ctl, ReceiveOperation& op)
+{
+    m_worker.startOperation(*this, ctl, op);
+}
+
+void
+afl::async::StreamObject::cancel(Controller& ctl, Operation& op)
+{
+    // After this, the operation is neither pending nor being performed.
+    m_worker.cancelOperation(*this, op);
+    ctl.revertPost(op);
+}
+
+String_t
+afl::async::StreamObject::getName()
+{
+    return m_stream->getName();
+}
+
+void
+afl::async::StreamObject::performOperation(Operation& op)
+{
+    try {
+        if (SendOperation* tx = dynamic_cast<SendOperation*>(&op)) {
+            while (!tx->isCompleted()) {
+                size_t n = m_stream->write(tx->getUnsentBytes());
+                if (n == 0) {
+                    break;
+                }
+                tx->addSentBytes(n);
+            }
+        } else if (ReceiveOperation* rx = dynamic_cast<ReceiveOperation*>(&op)) {
+            rx->addReceivedBytes(m_stream->read(rx->getUnreceivedBytes()));
+        } else {
+            // Cannot happen; all operations have been started through sendAsync or receiveAsync.
+        }
+    }
+    catch (...) {
+        // Report as a short transfer; there is nobody to receive the exception.
+    }
+}
@@ -0,0 +1,82 @@
+/**
+  *  \file afl/async/streamobject.hpp
+  *  \brief Class afl::async::StreamObject
+  */
+#ifndef AFL_AFL_ASYNC_STREAMOBJECT_HPP
+#define AFL_AFL_ASYNC_STREAMOBJECT_HPP
+
+#include <memory>
+#include "afl/async/communicationobject.hpp"
+#include "afl/async/operationlist.hpp"
+#include "afl/async/streamworker.hpp"
+#include "afl/base/ref.hpp"
+#include "afl/base/uncopyable.hpp"
+#include "afl/io/stream.hpp"
+#include "afl/sys/semaphore.hpp"
+
+namespace afl { namespace async {
+
+    /** Stream Communication Object.
+        Adapts a Stream (synchronous read/write, e.g. a file) to the CommunicationObject interface
+        (asynchronous send/receive using a Controller).
+        This is the opposite of CommunicationStream.
+
+        Operations are executed by a StreamWorker's threads in the order they were started;
+        send() writes, receive() reads at the current stream position.
+        Multiple StreamObject instances can share a StreamWorker, so that the number of threads does not grow with the number of files.
+        On Linux, operations on files are performed using io_uring if the kernel supports it (see StreamWorker).
+        This allows an event loop to perform file I/O without blocking,
+        by waiting for the completion of file and network operations on the same Controller.
+
+        A transfer that hits end of file or an error completes with fewer bytes than requested (possibly zero),
+        the same way a closed network connection is reported.
+
+        While a StreamObject exists, the Stream must not be used directly. */
+    class StreamObject : public CommunicationObject,
+                         private afl::base::Uncopyable
+    {
+     public:
+        /** Constructor.
+            Creates a private StreamWorker with a single thread.
+            \param stream Stream to operate on */
+        explicit StreamObject(afl::base::Ref<afl::io::Stream> stream);
+
+        /** Constructor.
+            \param stream Stream to operate on
+            \param worker StreamWorker to perform the operations. Must outlive the StreamObject. */
+        StreamObject(afl::base::Ref<afl::io::Stream> stream, StreamWorker& worker);
+
+        /** Destructor.
+            All operations must have completed or been cancelled. */
+        ~StreamObject();
+
+        // CommunicationObject:
+        virtual bool send(Controller& ctl, SendOperation& op, afl::sys::Timeout_t timeout = afl::sys::INFINITE_TIMEOUT);
+        virtual void sendAsync(Controller& ctl, SendOperation& op);
+        virtual bool receive(Controller& ctl, ReceiveOperation& op, afl::sys::Timeout_t timeout = afl::sys::INFINITE_TIMEOUT);
+        virtual void receiveAsync(Controller& ctl, ReceiveOperation& op);
+        virtual void cancel(Controller& ctl, Operation& op);
+        virtual String_t getName();
+
+     private:
+        friend class StreamWorker;
+
+        void performOperation(Operation& op);
+
+        // Integration:
+        afl::base::Ref<afl::io::Stream> m_stream;
+        std::auto_ptr<StreamWorker> m_ownWorker;
+        StreamWorker& m_worker;
+
+        // Scheduling state, protected by the StreamWorker's mutex:
+        OperationList<Operation> m_pending;  ///< Operations not yet started.
+        Operation* m_current;                ///< Operation being performed or reported.
+        bool m_queued;                       ///< true if this object is in the StreamWorker's queue.
+        bool m_running;                      ///< true if a thread is working on this object.
+        size_t m_numWaiters;                 ///< Number of threads waiting for m_idle.
+        afl::sys::Semaphore m_idle;          ///< Posted when a thread has finished working on this object.
+    };
+
+} }
+
+#endif
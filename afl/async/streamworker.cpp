@@ -0,0 +1,361 @@
+/**
+  *  \file afl/async/streamworker.cpp
+  *  \brief Class afl::async::StreamWorker
+  *
+  *  Scheduling:
+  *  - a StreamObject is in m_ready (m_queued) if it has pending operations and no thread is working on it.
+  *  - a thread takes a StreamObject from m_ready, performs its first operation (m_running, m_current),
+  *    notifies the operation, and then requeues the StreamObject if it has more operations.
+  *    Thus, operations of one StreamObject are never performed in parallel.
+  *  - m_current is reset only after the notification has been sent.
+  *    cancel() and detach() wait for this using the StreamObject's m_idle semaphore,
+  *    so a cancelled operation cannot be reported after cancel() returned.
+  *
+  *  With a Ring, schedule() submits the first operation of a StreamObject to the kernel instead of queueing it,
+  *  using the StreamObject's address as tag. The StreamObject is m_running while the submission is outstanding.
+  *  The ring thread (runRing) receives the completion, resubmits partial writes, and then reports and releases
+  *  the StreamObject just like a worker thread would. Operations the Ring cannot handle go to m_ready.
+  */
+
+#include "afl/async/streamworker.hpp"
+#include "afl/async/notifier.hpp"
+#include "afl/async/operation.hpp"
+#include "afl/async/receiveoperation.hpp"
+#include "afl/async/sendoperation.hpp"
+#include "afl/async/streamobject.hpp"
+#include "afl/base/stoppable.hpp"
+#include "afl/sys/mutexguard.hpp"
+#include "arch/streamworker.hpp"
+
+namespace {
+    /* Size of ring */
+    const uint32_t RING_SIZE = 64;
+
+    /* Tags for ring submissions that are not StreamObject operations */
+    const uint64_t WAKE_TAG = 0;
+    const uint64_t CANCEL_TAG = 1;
+}
+
+class afl::async::StreamWorker::Runner : public afl::base::Stoppable {
+ public:
+    typedef void (StreamWorker::*Function_t)();
+    Runner(StreamWorker& parent, Function_t fn)
+        : m_parent(parent),
+          m_function(fn)
+        { }
+    virtual void run()
+        { (m_parent.*m_function)(); }
+    virtual void stop()
+        {
+            // StreamWorker's destructor stops all threads at once before joining them.
+        }
+
+ private:
+    StreamWorker& m_parent;
+    Function_t m_function;
+};
+
+afl::async::StreamWorker::StreamWorker(size_t numThreads)
+    : m_mutex(),
+      m_ready(),
+      m_wake(0),
+      m_stop(false),
+      m_numThreads(numThreads == 0 ? 1 : numThreads),
+      m_threadsStarted(false),
+      m_ring(new Ring()),
+      m_numRingOperations(0),
+      m_runners(),
+      m_threads()
+{
+    if (m_ring->init(RING_SIZE)) {
+        Runner* r = m_runners.pushBackNew(new Runner(*this, &StreamWorker::runRing));
+        m_threads.pushBackNew(new afl::sys::Thread("StreamWorker.Ring", *r))->start();
+    } else {
+        m_ring.reset();
+        afl::sys::MutexGuard g(m_mutex);
+        startThreads();
+    }
+}
+
+afl::async::StreamWorker::~StreamWorker()
+{
+    {
+        afl::sys::MutexGuard g(m_mutex);
+        m_stop = true;
+        if (m_ring.get() != 0) {
+            m_ring->submitNop(WAKE_TAG);
+        }
+    }
+    for (size_t i = 0, n = m_threads.size(); i < n; ++i) {
+        m_wake.post();
+    }
+    m_threads.clear();
+}
+
+/** Start an operation (StreamObject::sendAsync, StreamObject::receiveAsync). */
+void
+afl::async::StreamWorker::startOperation(StreamObject& obj, Controller& ctl, Operation& op)
+{
+    afl::sys::MutexGuard g(m_mutex);
+    op.setController(&ctl);
+    obj.m_pending.pushBack(&op);
+    schedule(obj);
+}
+
+/** Cancel an operation (StreamObject::cancel).
+    If the operation is pending, removes it; if it is being performed, waits until it has been reported. */
+void
+afl::async::StreamWorker::cancelOperation(StreamObject& obj, Operation& op)
+{
+    bool wait;
+    {
+        afl::sys::MutexGuard g(m_mutex);
+        wait = !obj.m_pending.remove(&op) && obj.m_current == &op;
+        if (wait) {
+            ++obj.m_numWaiters;
+
+            // If the operation is on the ring, try to abort it (e.g. a read from a pipe that has no data).
+            // If it is not, or has already completed, this has no effect.
+            if (m_ring.get() != 0 && m_numRingOperations < RING_SIZE - 1
+                && m_ring->submitCancel(reinterpret_cast<uintptr_t>(&obj), CANCEL_TAG))
+            {
+                ++m_numRingOperations;
+            }
+        }
+    }
+    if (wait) {
+        obj.m_idle.wait();
+
+        // Worker posts m_idle while holding m_mutex; make sure it is done.
+        afl::sys::MutexGuard g(m_mutex);
+    }
+}
+
+/** Detach a StreamObject that is being destroyed.
+    Removes it from the queue, and waits until no thread is working on it. */
+void
+afl::async::StreamWorker::detach(StreamObject& obj)
+{
+    while (1) {
+        {
+            afl::sys::MutexGuard g(m_mutex);
+            if (obj.m_queued) {
+                m_ready.remove(&obj);
+                obj.m_queued = false;
+            }
+            if (!obj.m_running) {
+                break;
+            }
+            ++obj.m_numWaiters;
+        }
+        obj.m_idle.wait();
+    }
+}
+
+/** Queue a StreamObject for processing if it is not already queued or being processed.
+    \pre m_mutex is held */
+void
+afl::async::StreamWorker::schedule(StreamObject& obj)
+{
+    if (!obj.m_queued && !obj.m_running && !obj.m_pending.empty()) {
+        if (m_ring.get() != 0 && startRingOperation(obj)) {
+            // Operation is being performed by the kernel
+        } else {
+            startThreads();
+            m_ready.push_back(&obj);
+            obj.m_queued = true;
+            m_wake.post();
+        }
+    }
+}
+
+/** Start the first pending operation of a StreamObject on the ring.
+    \pre m_mutex is held, m_ring is set, obj is neither queued nor running
+    \return true if operation was started */
+bool
+afl::async::StreamWorker::startRingOperation(StreamObject& obj)
+{
+    // Set state before submitting; the completion can arrive immediately.
+    Operation* op = obj.m_pending.front();
+    if (op == 0) {
+        return false;
+    }
+    obj.m_running = true;
+    obj.m_current = op;
+    if (!submitRingOperation(obj, *op)) {
+        obj.m_running = false;
+        obj.m_current = 0;
+        return false;
+    }
+    obj.m_pending.extractFront();
+    return true;
+}
+
+/** Submit (the remainder of) an operation to the ring.
+    \pre m_mutex is held, m_ring is set
+    \return true if submitted */
+bool
+afl::async::StreamWorker::submitRingOperation(StreamObject& obj, Operation& op)
+{
+    // Keep one entry free for WAKE_TAG
+    if (m_numRingOperations >= RING_SIZE - 1) {
+        return false;
+    }
+
+    const uint64_t tag = reinterpret_cast<uintptr_t>(&obj);
+    bool ok = false;
+    if (SendOperation* tx = dynamic_cast<SendOperation*>(&op)) {
+        ok = m_ring->submitWrite(*obj.m_stream, tx->getUnsentBytes(), tag);
+    } else if (ReceiveOperation* rx = dynamic_cast<ReceiveOperation*>(&op)) {
+        ok = m_ring->submitRead(*obj.m_stream, rx->getUnreceivedBytes(), tag);
+    } else {
+        // Cannot happen; let performOperation() deal with it
+    }
+    if (ok) {
+        ++m_numRingOperations;
+    }
+    return ok;
+}
+
+/** Start threads for m_ready if not already done.
+    \pre m_mutex is held */
+void
+afl::async::StreamWorker::startThreads()
+{
+    if (!m_threadsStarted) {
+        m_threadsStarted = true;
+        for (size_t i = 0; i < m_numThreads; ++i) {
+            Runner* r = m_runners.pushBackNew(new Runner(*this, &StreamWorker::runWorker));
+            m_threads.pushBackNew(new afl::sys::Thread("StreamWorker", *r))->start();
+        }
+    }
+}
+
+/** Release a StreamObject after its operation has been reported.
+    Schedules its next operation, and wakes cancel() and detach().
+    \pre m_mutex is held */
+void
+afl::async::StreamWorker::release(StreamObject& obj)
+{
+    obj.m_current = 0;
+    obj.m_running = false;
+    schedule(obj);
+    while (obj.m_numWaiters > 0) {
+        --obj.m_numWaiters;
+        obj.m_idle.post();
+    }
+}
+
+/** Worker thread main loop. */
+void
+afl::async::StreamWorker::runWorker()
+{
+    while (1) {
+        // Wait for something to happen
+        m_wake.wait();
+
+        StreamObject* obj;
+        Operation* op;
+        {
+            afl::sys::MutexGuard g(m_mutex);
+            if (m_stop) {
+                break;
+            }
+            if (m_ready.empty()) {
+                // StreamObject has been detached
+                continue;
+            }
+            obj = m_ready.front();
+            m_ready.pop_front();
+            obj->m_queued = false;
+
+            op = obj->m_pending.extractFront();
+            if (op == 0) {
+                // All operations have been cancelled
+                continue;
+            }
+            obj->m_running = true;
+            obj->m_current = op;
+        }
+
+        // Perform operation. Notify without holding m_mutex; the notifier may call back into us.
+        obj->performOperation(*op);
+        op->getNotifier().notify(*op);
+
+        // Release the StreamObject
+        afl::sys::MutexGuard g(m_mutex);
+        release(*obj);
+    }
+}
+
+/** Ring thread main loop. */
+void
+afl::async::StreamWorker::runRing()
+{
+    while (1) {
+        uint64_t tag;
+        int32_t result;
+        m_ring->wait(tag, result);
+
+        if (tag == WAKE_TAG) {
+            afl::sys::MutexGuard g(m_mutex);
+            if (m_stop) {
+                break;
+            }
+            continue;
+        }
+        if (tag == CANCEL_TAG) {
+            afl::sys::MutexGuard g(m_mutex);
+            --m_numRingOperations;
+            continue;
+        }
+
+        // The StreamObject stays m_running until we release it, so m_current remains valid after we read it.
+        StreamObject* obj = reinterpret_cast<StreamObject*>(static_cast<uintptr_t>(tag));
+        Operation* op;
+        {
+            afl::sys::MutexGuard g(m_mutex);
+            op = obj->m_current;
+        }
+
+        // Account transfer. Errors are reported as short transfer, like performOperation() does.
+        bool done = true;
+        if (SendOperation* tx = dynamic_cast<SendOperation*>(op)) {
+            if (result > 0) {
+                tx->addSentBytes(size_t(result));
+                done = tx->isCompleted();
+            }
+        } else if (ReceiveOperation* rx = dynamic_cast<ReceiveOperation*>(op)) {
+            if (result > 0) {
+                rx->addReceivedBytes(size_t(result));
+            }
+        } else {
+            // Cannot happen
+        }
+
+        bool sync = false;
+        {
+            afl::sys::MutexGuard g(m_mutex);
+            --m_numRingOperations;
+
+            // Continue a partial write, unless someone is waiting for the operation to be cancelled.
+            if (!done && obj->m_numWaiters == 0) {
+                if (submitRingOperation(*obj, *op)) {
+                    continue;
+                }
+                sync = true;
+            }
+        }
+
+        // Ring is full; finish the write synchronously.
+        if (sync) {
+            obj->performOperation(*op);
+        }
+
+        // Notify without holding m_mutex; the notifier may call back into us.
+        op->getNotifier().notify(*op);
+
+        afl::sys::MutexGuard g(m_mutex);
+        release(*obj);
+    }
+}
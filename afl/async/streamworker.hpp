@@ -0,0 +1,76 @@
+/**
+  *  \file afl/async/streamworker.hpp
+  *  \brief Class afl::async::StreamWorker
+  */
+#ifndef AFL_AFL_ASYNC_STREAMWORKER_HPP
+#define AFL_AFL_ASYNC_STREAMWORKER_HPP
+
+#include <list>
+#include <memory>
+#include "afl/base/uncopyable.hpp"
+#include "afl/container/ptrvector.hpp"
+#include "afl/sys/mutex.hpp"
+#include "afl/sys/semaphore.hpp"
+#include "afl/sys/thread.hpp"
+
+namespace afl { namespace async {
+
+    class Controller;
+    class Operation;
+    class StreamObject;
+
+    /** Worker threads for StreamObject.
+        Performs the operations of any number of StreamObject instances using a fixed number of threads.
+        Operations of one StreamObject are performed one at a time, in the order they were started;
+        operations of different StreamObject instances run in parallel if there are multiple threads.
+
+        If the operating system provides an asynchronous I/O facility (io_uring on Linux),
+        transfers on files are handed to the kernel and completed by a single thread, regardless of the number of threads.
+        Other streams, or all streams if the facility is not available, are served by the threads,
+        which are started when first needed.
+
+        A StreamWorker must outlive all StreamObject instances using it. */
+    class StreamWorker : private afl::base::Uncopyable {
+     public:
+        /** Constructor.
+            \param numThreads Number of threads (at least 1) */
+        explicit StreamWorker(size_t numThreads = 1);
+
+        /** Destructor.
+            Stops the threads. */
+        ~StreamWorker();
+
+     private:
+        friend class StreamObject;
+        class Runner;
+        class Ring;
+
+        void startOperation(StreamObject& obj, Controller& ctl, Operation& op);
+        void cancelOperation(StreamObject& obj, Operation& op);
+        void detach(StreamObject& obj);
+        void schedule(StreamObject& obj);
+        bool startRingOperation(StreamObject& obj);
+        bool submitRingOperation(StreamObject& obj, Operation& op);
+        void startThreads();
+        void release(StreamObject& obj);
+        void runWorker();
+        void runRing();
+
+        afl::sys::Mutex m_mutex;             ///< Protects all of the following, and the StreamObject's scheduling state.
+        std::list<StreamObject*> m_ready;    ///< StreamObjects that have pending operations and are not being worked on.
+        afl::sys::Semaphore m_wake;
+        bool m_stop;
+        size_t m_numThreads;                 ///< Number of threads to start for m_ready.
+        bool m_threadsStarted;               ///< true if threads for m_ready have been started.
+
+        std::auto_ptr<Ring> m_ring;          ///< Asynchronous I/O; null if not available.
+        size_t m_numRingOperations;          ///< Number of submissions to m_ring that have not yet completed.
+
+        // Threads: must be last
+        afl::container::PtrVector<Runner> m_runners;
+        afl::container::PtrVector<afl::sys::Thread> m_threads;
+    };
+
+} }
+
+#endif
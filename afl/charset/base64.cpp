@@ -3,22 +3,277 @@
   *  \brief Class afl::charset::Base64
   */
 
-#include <cassert>
+#include <algorithm>
 #include <cstring>
 #include "afl/charset/base64.hpp"
+#include "afl/charset/transcoder.hpp"
+#include "arch/base64accel.hpp"
 
 namespace {
     const uint8_t g_base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-    uint32_t b64Value(uint8_t c)
+    /* Value of each character; characters not in the alphabet count as 0 */
+    const uint8_t g_base64Values[256] = {
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 62,  0,  0,  0, 63,
+        52, 53, 54, 55, 56, 57, 58, 59, 60, 61,  0,  0,  0,  0,  0,  0,
+         0,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,  0,  0,  0,  0,  0,
+         0, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    };
+
+    /* Encode groups of 3 bytes into 4 characters each */
+    void encodeGroups(const uint8_t* in, size_t numGroups, uint8_t* out)
     {
-        const uint8_t* p = (const uint8_t*) std::memchr(g_base64Alphabet, c, sizeof(g_base64Alphabet)-1);
-        if (p != 0) {
-            return uint8_t(p - g_base64Alphabet);
-        } else {
+        size_t done;
+        if (encodeBase64Accel(in, numGroups, out, done)) {
+            in += 3*done;
+            out += 4*done;
+            numGroups -= done;
+        }
+        while (numGroups > 0) {
+            const uint32_t value = 65536 * in[0] + 256 * in[1] + in[2];
+            out[0] = g_base64Alphabet[(value >> 18) & 63];
+            out[1] = g_base64Alphabet[(value >> 12) & 63];
+            out[2] = g_base64Alphabet[(value >> 6) & 63];
+            out[3] = g_base64Alphabet[value & 63];
+            in += 3;
+            out += 4;
+            --numGroups;
+        }
+    }
+
+    /* Encode final 1 or 2 bytes into 4 characters, with padding */
+    void encodeTail(const uint8_t* in, size_t n, uint8_t* out)
+    {
+        const uint32_t value = 65536 * in[0] + (n > 1 ? 256 * in[1] : 0);
+        out[0] = g_base64Alphabet[(value >> 18) & 63];
+        out[1] = g_base64Alphabet[(value >> 12) & 63];
+        out[2] = (n > 1 ? g_base64Alphabet[(value >> 6) & 63] : '=');
+        out[3] = '=';
+    }
+
+    /* Decode groups of 4 characters into 3 bytes each */
+    void decodeGroups(const uint8_t* in, size_t numGroups, uint8_t* out)
+    {
+        size_t done;
+        if (decodeBase64Accel(in, numGroups, out, done)) {
+            in += 4*done;
+            out += 3*done;
+            numGroups -= done;
+        }
+        while (numGroups > 0) {
+            const uint32_t value = (uint32_t(g_base64Values[in[0]]) << 18)
+                + (uint32_t(g_base64Values[in[1]]) << 12)
+                + (uint32_t(g_base64Values[in[2]]) << 6)
+                + g_base64Values[in[3]];
+            out[0] = uint8_t(value >> 16);
+            out[1] = uint8_t(value >> 8);
+            out[2] = uint8_t(value);
+            in += 4;
+            out += 3;
+            --numGroups;
+        }
+    }
+
+    /* Decode final 2 or 3 characters into 1 or 2 bytes; returns number of bytes. A single character produces nothing. */
+    size_t decodeTail(const uint8_t* in, size_t n, uint8_t* out)
+    {
+        if (n < 2) {
             return 0;
         }
+        const uint32_t value = (uint32_t(g_base64Values[in[0]]) << 18)
+            + (uint32_t(g_base64Values[in[1]]) << 12)
+            + (n > 2 ? uint32_t(g_base64Values[in[2]]) << 6 : 0);
+        out[0] = uint8_t(value >> 16);
+        if (n > 2) {
+            out[1] = uint8_t(value >> 8);
+        }
+        return n - 1;
     }
+
+    /* Output buffer for a Transcoder: output that did not fit into the caller's buffer */
+    class PendingOutput {
+     public:
+        PendingOutput()
+            : m_pos(0), m_size(0)
+            { }
+
+        /* Deliver pending output. Returns true if everything was delivered. */
+        bool drain(uint8_t*& out, uint8_t* outEnd)
+            {
+                const size_t now = std::min(m_size - m_pos, size_t(outEnd - out));
+                std::memcpy(out, m_data + m_pos, now);
+                out += now;
+                m_pos += now;
+                if (m_pos == m_size) {
+                    m_pos = m_size = 0;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+
+        /* Get space to add n bytes of output. */
+        uint8_t* add(size_t n)
+            {
+                std::memmove(m_data, m_data + m_pos, m_size - m_pos);
+                m_size -= m_pos;
+                m_pos = 0;
+                uint8_t* result = m_data + m_size;
+                m_size += n;
+                return result;
+            }
+
+     private:
+        uint8_t m_data[8];
+        size_t m_pos;
+        size_t m_size;
+    };
+
+    /* Streaming encoder */
+    class Encoder : public afl::charset::Transcoder {
+     public:
+        Encoder()
+            : m_inputSize(0), m_output()
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                while (m_output.drain(o, outEnd)) {
+                    // Whole groups directly into caller's buffer
+                    if (m_inputSize == 0) {
+                        const size_t numGroups = std::min(n / 3, size_t(outEnd - o) / 4);
+                        encodeGroups(p, numGroups, o);
+                        p += 3*numGroups;
+                        n -= 3*numGroups;
+                        o += 4*numGroups;
+                    }
+
+                    // Collect a group bytewise
+                    while (m_inputSize < 3 && n > 0) {
+                        m_input[m_inputSize++] = *p++;
+                        --n;
+                    }
+                    if (m_inputSize < 3) {
+                        break;
+                    }
+                    encodeGroups(m_input, 1, m_output.add(4));
+                    m_inputSize = 0;
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            {
+                if (m_inputSize != 0) {
+                    encodeTail(m_input, m_inputSize, m_output.add(4));
+                    m_inputSize = 0;
+                }
+            }
+
+     private:
+        uint8_t m_input[3];
+        size_t m_inputSize;
+        PendingOutput m_output;
+    };
+
+    /* Streaming decoder.
+       To produce the same result as Base64::decode(), '=' can only be dropped at the end;
+       elsewhere, it counts as a character of value 0. */
+    class Decoder : public afl::charset::Transcoder {
+     public:
+        Decoder()
+            : m_inputSize(0), m_numEquals(0), m_output()
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                while (m_output.drain(o, outEnd)) {
+                    // Whole groups directly into caller's buffer, up to the next '='
+                    if (m_inputSize == 0 && m_numEquals == 0) {
+                        size_t numGroups = std::min(n / 4, size_t(outEnd - o) / 3);
+                        const void* eq = (numGroups != 0 ? std::memchr(p, '=', 4*numGroups) : 0);
+                        if (eq != 0) {
+                            numGroups = size_t(static_cast<const uint8_t*>(eq) - p) / 4;
+                        }
+                        decodeGroups(p, numGroups, o);
+                        p += 4*numGroups;
+                        n -= 4*numGroups;
+                        o += 3*numGroups;
+                    }
+
+                    // Process a character
+                    if (n == 0) {
+                        break;
+                    }
+                    if (*p == '=') {
+                        ++m_numEquals;
+                        ++p;
+                        --n;
+                    } else if (m_numEquals != 0) {
+                        // Not at end, so '=' is a regular character
+                        --m_numEquals;
+                        addCharacter('=');
+                    } else {
+                        addCharacter(*p++);
+                        --n;
+                    }
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            {
+                // Trailing '=' are ignored
+                uint8_t tail[2];
+                const size_t n = decodeTail(m_input, m_inputSize, tail);
+                std::memcpy(m_output.add(n), tail, n);
+                m_inputSize = 0;
+                m_numEquals = 0;
+            }
+
+     private:
+        uint8_t m_input[4];
+        size_t m_inputSize;
+        size_t m_numEquals;
+        PendingOutput m_output;
+
+        void addCharacter(uint8_t ch)
+            {
+                m_input[m_inputSize++] = ch;
+                if (m_inputSize == 4) {
+                    decodeGroups(m_input, 1, m_output.add(3));
+                    m_inputSize = 0;
+                }
+            }
+    };
 }
 
 afl::charset::Base64::~Base64()
@@ -27,39 +282,16 @@ afl::charset::Base64::~Base64()
 afl::base::GrowableBytes_t
 afl::charset::Base64::encode(afl::string::ConstStringMemory_t in)
 {
-    // Create result
-    afl::base::GrowableBytes_t result;
-    result.reserve((in.size() + 2) / 3 * 4);
-
-    // Convert triplets
-    typedef const char Triplet_t[3];
-    while (Triplet_t* p3 = in.eatN<3>()) {
-        uint32_t value = 65536 * uint8_t((*p3)[0]) + 256 * uint8_t((*p3)[1]) + uint8_t((*p3)[2]);
-        result.append(g_base64Alphabet[(value >> 18) & 63]);
-        result.append(g_base64Alphabet[(value >> 12) & 63]);
-        result.append(g_base64Alphabet[(value >> 6) & 63]);
-        result.append(g_base64Alphabet[(value) & 63]);
-    }
+    const uint8_t* p = in.toBytes().unsafeData();
+    const size_t numGroups = in.size() / 3;
+    const size_t remainder = in.size() % 3;
 
-    // Convert remainder
-    if (const char* p1 = in.eat()) {
-        if (const char* p2 = in.eat()) {
-            // Two characters
-            uint32_t value = 65536 * uint8_t(*p1) + 256 * uint8_t(*p2);
-            result.append(g_base64Alphabet[(value >> 18) & 63]);
-            result.append(g_base64Alphabet[(value >> 12) & 63]);
-            result.append(g_base64Alphabet[(value >> 6) & 63]);
-            result.append('=');
-        } else {
-            // One character
-            uint32_t value = 65536 * uint8_t(*p1);
-            result.append(g_base64Alphabet[(value >> 18) & 63]);
-            result.append(g_base64Alphabet[(value >> 12) & 63]);
-            result.append('=');
-            result.append('=');
-        }
+    afl::base::GrowableBytes_t result;
+    result.resize((in.size() + 2) / 3 * 4);
+    encodeGroups(p, numGroups, result.unsafeData());
+    if (remainder != 0) {
+        encodeTail(p + 3*numGroups, remainder, result.unsafeData() + 4*numGroups);
     }
-    assert(in.empty());
     return result;
 }
 
@@ -72,33 +304,28 @@ afl::charset::Base64::decode(afl::base::ConstBytes_t in)
     }
 
     // Build result
-    String_t result;
-    result.reserve(in.size() * 3 / 4 + 1);
-    while (!in.empty()) {
-        uint32_t value = 0;
-        if (const uint8_t* pch = in.eat()) {
-            // First character (6 bits)
-            value += b64Value(*pch) << 18;
-        }
-        if (const uint8_t* pch = in.eat()) {
-            // Second character (12 bits, enough for one result character)
-            value += b64Value(*pch) << 12;
-            result += char((value >> 16) & 255);
-        }
-        if (const uint8_t* pch = in.eat()) {
-            // Third character (18 bits, enough for two result characters)
-            value += b64Value(*pch) << 6;
-            result += char((value >> 8) & 255);
-        }
-        if (const uint8_t* pch = in.eat()) {
-            // Fourth character (24 bits, enough for three result characters)
-            value += b64Value(*pch);
-            result += char(value & 255);
-        }
-    }
+    const uint8_t* p = in.unsafeData();
+    const size_t numGroups = in.size() / 4;
+    String_t result(3*numGroups + 2, '\0');
+    uint8_t* out = reinterpret_cast<uint8_t*>(&result[0]);
+    decodeGroups(p, numGroups, out);
+    const size_t tail = decodeTail(p + 4*numGroups, in.size() % 4, out + 3*numGroups);
+    result.erase(3*numGroups + tail);
     return result;
 }
 
+afl::charset::Transcoder*
+afl::charset::Base64::createEncoder() const
+{
+    return new Encoder();
+}
+
+afl::charset::Transcoder*
+afl::charset::Base64::createDecoder() const
+{
+    return new Decoder();
+}
+
 afl::charset::Base64*
 afl::charset::Base64::clone() const
 {
@@ -12,12 +12,18 @@ namespace afl { namespace charset {
     /** Base-64 Encoding.
         This is not strictly speaking a character set, but fits the interface.
         It encodes an input string (which is not restricted to UTF-8, and can be binary) into Base-64,
-        or decodes the same. */
+        or decodes the same.
+
+        Bulk conversion uses SSSE3/AVX2 where available.
+        The streaming encoder and decoder produce the same result as encode() and decode()
+        for any division of the input; they do not insert or expect line breaks. */
     class Base64 : public Charset {
      public:
         virtual ~Base64();
         virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in);
         virtual String_t decode(afl::base::ConstBytes_t in);
+        virtual Transcoder* createEncoder() const;
+        virtual Transcoder* createDecoder() const;
         virtual Base64* clone() const;
     };
 
@@ -0,0 +1,67 @@
+/**
+  *  \file afl/charset/charset.cpp
+  *  \brief Base class afl::charset::Charset
+  */
+
+#include <memory>
+#include "afl/charset/charset.hpp"
+#include "afl/charset/transcoder.hpp"
+
+namespace {
+    /* Fallback Transcoder: collect all input, convert upon flush() */
+    class BufferedTranscoder : public afl::charset::Transcoder {
+     public:
+        BufferedTranscoder(afl::charset::Charset* cs, bool encode)
+            : m_charset(cs),
+              m_encode(encode),
+              m_input(),
+              m_output(),
+              m_outputPos(0)
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                // Deliver pending output
+                const size_t n = out.copyFrom(afl::base::ConstBytes_t(m_output).subrange(m_outputPos)).size();
+                m_outputPos += n;
+                out.trim(n);
+                if (m_outputPos >= m_output.size()) {
+                    m_output.clear();
+                    m_outputPos = 0;
+                }
+
+                // Accept input
+                m_input.append(in);
+                in.reset();
+            }
+
+        virtual void flush()
+            {
+                if (m_encode) {
+                    m_output.append(m_charset->encode(afl::string::ConstStringMemory_t::unsafeCreate(reinterpret_cast<const char*>(m_input.unsafeData()), m_input.size())));
+                } else {
+                    m_output.append(afl::string::toBytes(m_charset->decode(m_input)));
+                }
+                m_input.clear();
+            }
+
+     private:
+        std::auto_ptr<afl::charset::Charset> m_charset;
+        bool m_encode;
+        afl::base::GrowableBytes_t m_input;
+        afl::base::GrowableBytes_t m_output;
+        size_t m_outputPos;
+    };
+}
+
+afl::charset::Transcoder*
+afl::charset::Charset::createEncoder() const
+{
+    return new BufferedTranscoder(clone(), true);
+}
+
+afl::charset::Transcoder*
+afl::charset::Charset::createDecoder() const
+{
+    return new BufferedTranscoder(clone(), false);
+}
@@ -12,6 +12,8 @@
 
 namespace afl { namespace charset {
 
+    class Transcoder;
+
     /** Character set encoder/decoder.
         This is the base class for logic for encoding UTF-8 into a specific character set
         used on an external interface, or decoding it back. */
@@ -28,6 +30,18 @@ namespace afl { namespace charset {
             \param in Input bytes in class-specific charset
             \return Result, UTF-8 */
         virtual String_t decode(afl::base::ConstBytes_t in) = 0;
+
+        /** Create streaming encoder.
+            The encoder converts UTF-8 into this charset, like encode(), but accepts input in arbitrary pieces.
+            The default implementation collects all input and converts it using encode() upon flush().
+            \return Newly-allocated Transcoder. It does not refer to this Charset object and can outlive it. */
+        virtual Transcoder* createEncoder() const;
+
+        /** Create streaming decoder.
+            The decoder converts this charset into UTF-8, like decode(), but accepts input in arbitrary pieces.
+            The default implementation collects all input and converts it using decode() upon flush().
+            \return Newly-allocated Transcoder. It does not refer to this Charset object and can outlive it. */
+        virtual Transcoder* createDecoder() const;
     };
 
 } }
@@ -3,12 +3,299 @@
   *  \brief Class afl::charset::CodepageCharset
   */
 
+#include <algorithm>
+#include <cstring>
 #include "afl/charset/codepagecharset.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/charset/utf8.hpp"
 #include "afl/charset/codepage.hpp"
 #include "afl/charset/utf8reader.hpp"
 #include "afl/base/countof.hpp"
 
+namespace {
+    /* Hash function for encoder table */
+    inline size_t hashCharacter(afl::charset::Unichar_t ch, size_t size)
+    {
+        return ((ch * 0x9E3779B1U) >> 16) & (size - 1);
+    }
+
+    /* Decode a well-formed 2- or 3-byte UTF-8 sequence.
+       This is the common case when encoding into a codepage.
+       Returns number of bytes consumed, 0 if the sequence is not well-formed or needs special treatment;
+       in this case, the caller must use Utf8Reader. */
+    inline size_t decodeSimple(const uint8_t* p, size_t n, afl::charset::Unichar_t& ch)
+    {
+        if (n >= 2 && p[0] >= 0xC2 && p[0] < 0xE0 && (p[1] & 0xC0) == 0x80) {
+            ch = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+            return 2;
+        }
+        if (n >= 3 && p[0] >= 0xE0 && p[0] < 0xF0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+            ch = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            if (ch >= 0x800
+                && (ch < afl::charset::UNICODE_HIGH_SURROGATE_MIN || ch > afl::charset::UNICODE_LOW_SURROGATE_MAX)
+                && ch < 0xFFFE)
+            {
+                return 3;
+            }
+        }
+        return 0;
+    }
+
+    /* Decode one character from UTF-8.
+       Returns number of bytes consumed (nonzero if n is nonzero). */
+    inline size_t decodeCharacter(const uint8_t* p, size_t n, afl::charset::Unichar_t& ch)
+    {
+        size_t size = decodeSimple(p, n, ch);
+        if (size == 0) {
+            afl::charset::Utf8Reader rdr(afl::base::ConstBytes_t::unsafeCreate(p, n), 0);
+            ch = rdr.eat();
+            size = n - rdr.getRemainder().size();
+        }
+        return size;
+    }
+
+    /* Maximum length of a sequence examined by Utf8Reader (lead byte 0xFE plus six continuation bytes). */
+    const size_t MAX_SEQUENCE = 7;
+
+    /* Get length of a sequence introduced by the given byte, as examined by Utf8Reader. */
+    inline size_t getSequenceLength(uint8_t lead)
+    {
+        return lead < 0xC0 ? 1
+            : lead < 0xE0 ? 2
+            : lead < 0xF0 ? 3
+            : lead < 0xF8 ? 4
+            : lead < 0xFC ? 5
+            : lead < 0xFE ? 6
+            : lead < 0xFF ? 7
+            : 1;
+    }
+
+    /* Check for incomplete sequence.
+       Returns true if the given bytes are a valid prefix of a UTF-8 sequence that continues after them,
+       i.e. decoding them would produce a different result if more bytes were available. */
+    bool isIncomplete(const uint8_t* p, size_t n)
+    {
+        if (n == 0 || n >= getSequenceLength(p[0])) {
+            return false;
+        }
+        for (size_t i = 1; i < n; ++i) {
+            if (!afl::charset::Utf8::isContinuationByte(p[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/*
+ *  Encoder
+ */
+
+class afl::charset::CodepageCharset::Encoder : public Transcoder {
+ public:
+    explicit Encoder(const CodepageCharset& cs);
+    virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+    virtual void flush();
+
+ private:
+    const CodepageCharset m_charset;  ///< Copy of charset; Transcoder can outlive the original.
+    uint8_t m_pending[MAX_SEQUENCE];  ///< Incomplete UTF-8 sequence from previous call.
+    size_t m_pendingSize;             ///< Number of bytes in m_pending.
+    bool m_flushing;                  ///< flush() called, decode m_pending even if incomplete.
+};
+
+afl::charset::CodepageCharset::Encoder::Encoder(const CodepageCharset& cs)
+    : m_charset(cs),
+      m_pendingSize(0),
+      m_flushing(false)
+{ }
+
+void
+afl::charset::CodepageCharset::Encoder::transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    // Every character produces at most one byte, so we can stop as soon as the output is full.
+    const uint8_t* p = in.unsafeData();
+    size_t n = in.size();
+    uint8_t* const outBegin = out.unsafeData();
+    uint8_t* const outEnd = outBegin + out.size();
+    uint8_t* o = outBegin;
+
+    // Complete a pending sequence
+    while (m_pendingSize != 0 && o != outEnd) {
+        while (n > 0 && isIncomplete(m_pending, m_pendingSize)) {
+            m_pending[m_pendingSize++] = *p++;
+            --n;
+        }
+        if (!m_flushing && isIncomplete(m_pending, m_pendingSize)) {
+            break;
+        }
+
+        // This may be an ASCII character following an invalid sequence.
+        Unichar_t ch;
+        const size_t size = decodeCharacter(m_pending, m_pendingSize, ch);
+        if (ch < 0x80) {
+            *o++ = uint8_t(ch);
+        } else if (const uint8_t b = m_charset.findCharacter(ch)) {
+            *o++ = b;
+        }
+        m_pendingSize -= size;
+        std::memmove(m_pending, m_pending + size, m_pendingSize);
+    }
+    if (m_pendingSize == 0) {
+        m_flushing = false;
+    }
+
+    // Regular input
+    while (m_pendingSize == 0 && n > 0 && o != outEnd) {
+        // ASCII. Just copy.
+        const size_t ascii = std::min(Utf8::findNonAscii(afl::base::ConstBytes_t::unsafeCreate(p, n)), size_t(outEnd - o));
+        std::memcpy(o, p, ascii);
+        o += ascii;
+        p += ascii;
+        n -= ascii;
+
+        // Non-ASCII. Parse characters, but keep an incomplete sequence at the end for next time.
+        while (n > 0 && o != outEnd && *p >= 0x80) {
+            Unichar_t ch;
+            size_t size = decodeSimple(p, n, ch);
+            if (size == 0) {
+                if (isIncomplete(p, n)) {
+                    std::memcpy(m_pending, p, n);
+                    m_pendingSize = n;
+                    p += n;
+                    n = 0;
+                    break;
+                }
+                size = decodeCharacter(p, n, ch);
+            }
+            if (const uint8_t b = m_charset.findCharacter(ch)) {
+                *o++ = b;
+            }
+            p += size;
+            n -= size;
+        }
+    }
+
+    in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+    out.trim(size_t(o - outBegin));
+}
+
+void
+afl::charset::CodepageCharset::Encoder::flush()
+{
+    m_flushing = (m_pendingSize != 0);
+}
+
+
+/*
+ *  Decoder
+ */
+
+class afl::charset::CodepageCharset::Decoder : public Transcoder {
+ public:
+    explicit Decoder(const CodepageCharset& cs);
+    virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+    virtual void flush();
+
+ private:
+    const CodepageCharset m_charset;  ///< Copy of charset; Transcoder can outlive the original.
+    uint8_t m_pending[4];             ///< Remainder of a character that did not fit into the output buffer.
+    size_t m_pendingPos;              ///< Position of next byte to output from m_pending.
+    size_t m_pendingSize;             ///< Number of bytes in m_pending.
+};
+
+afl::charset::CodepageCharset::Decoder::Decoder(const CodepageCharset& cs)
+    : m_charset(cs),
+      m_pendingPos(0),
+      m_pendingSize(0)
+{ }
+
+void
+afl::charset::CodepageCharset::Decoder::transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    const uint8_t* p = in.unsafeData();
+    size_t n = in.size();
+    uint8_t* const outBegin = out.unsafeData();
+    uint8_t* const outEnd = outBegin + out.size();
+    uint8_t* o = outBegin;
+
+    // Pending output
+    while (m_pendingPos < m_pendingSize && o != outEnd) {
+        *o++ = m_pending[m_pendingPos++];
+    }
+
+    // Regular input
+    while (m_pendingPos == m_pendingSize && n > 0 && o != outEnd) {
+        // ASCII. Just copy.
+        const size_t ascii = std::min(Utf8::findNonAscii(afl::base::ConstBytes_t::unsafeCreate(p, n)), size_t(outEnd - o));
+        std::memcpy(o, p, ascii);
+        o += ascii;
+        p += ascii;
+        n -= ascii;
+
+        // Non-ASCII: copy pre-encoded character; keep what does not fit.
+        while (n > 0 && o != outEnd && *p >= 0x80) {
+            const uint8_t* enc = m_charset.m_decodeTable[*p - 0x80];
+            const size_t size = enc[3];
+            const size_t now = std::min(size, size_t(outEnd - o));
+            std::memcpy(o, enc, now);
+            o += now;
+            ++p;
+            --n;
+            if (now < size) {
+                std::memcpy(m_pending, enc + now, size - now);
+                m_pendingPos = 0;
+                m_pendingSize = size - now;
+            }
+        }
+    }
+
+    in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+    out.trim(size_t(o - outBegin));
+}
+
+void
+afl::charset::CodepageCharset::Decoder::flush()
+{
+    // Decoder does not keep incomplete input.
+}
+
+
+/*
+ *  CodepageCharset
+ */
+
+afl::charset::CodepageCharset::CodepageCharset(const Codepage& cp)
+    : Charset(),
+      m_codepage(cp)
+{
+    afl::base::Memory<uint32_t>(m_encodeTable).fill(0);
+
+    Utf8 u8(0);
+    for (size_t i = 0; i < countof(m_codepage.m_characters); ++i) {
+        const Unichar_t ch = m_codepage.m_characters[i];
+
+        // Encoder. ASCII is never encoded through the table.
+        // If a character appears multiple times, the first one wins.
+        if (ch >= 0x80) {
+            size_t pos = hashCharacter(ch, countof(m_encodeTable));
+            while (m_encodeTable[pos] != 0 && (m_encodeTable[pos] >> 8) != ch) {
+                pos = (pos + 1) & (countof(m_encodeTable) - 1);
+            }
+            if (m_encodeTable[pos] == 0) {
+                m_encodeTable[pos] = (ch << 8) + uint32_t(0x80 + i);
+            }
+        }
+
+        // Decoder
+        String_t tmp;
+        u8.append(tmp, ch);
+        afl::base::Bytes_t(m_decodeTable[i]).fill(0);
+        afl::base::Bytes_t(m_decodeTable[i]).copyFrom(afl::string::toBytes(tmp));
+        m_decodeTable[i][3] = uint8_t(tmp.size());
+    }
+}
+
 afl::charset::CodepageCharset::~CodepageCharset()
 { }
 
@@ -16,52 +303,104 @@ afl::charset::CodepageCharset::~CodepageCharset()
 afl::base::GrowableBytes_t
 afl::charset::CodepageCharset::encode(afl::string::ConstStringMemory_t in)
 {
-    // Result
+    // Result. Can never be longer than the input.
     afl::base::GrowableBytes_t result;
+    result.resize(in.size());
+    uint8_t* out = result.unsafeData();
+
+    const uint8_t* p = in.toBytes().unsafeData();
+    size_t n = in.size();
+    while (n > 0) {
+        // ASCII. Just copy.
+        const size_t ascii = Utf8::findNonAscii(afl::base::ConstBytes_t::unsafeCreate(p, n));
+        if (ascii != 0) {
+            std::memcpy(out, p, ascii);
+            out += ascii;
+            p += ascii;
+            n -= ascii;
+        }
+
+        // Non-ASCII. Parse characters.
+        while (n > 0 && *p >= 0x80) {
+            Unichar_t ch;
+            const size_t size = decodeCharacter(p, n, ch);
+            p += size;
+            n -= size;
 
-    Utf8Reader rdr(in.toBytes(), 0);
-    while (rdr.hasMore()) {
-        Unichar_t ch = rdr.eat();
-        if (ch < 0x80) {
-            // ASCII. Just append.
-            result.append(uint8_t(ch));
-        } else {
             // Try to find the character in the codepage.
             // If we don't find any, drop it.
-            for (size_t i = 0; i < countof(m_codepage.m_characters); ++i) {
-                if (m_codepage.m_characters[i] == ch) {
-                    result.append(uint8_t(0x80 + i));
-                    break;
-                }
+            if (const uint8_t b = findCharacter(ch)) {
+                *out++ = b;
             }
         }
     }
 
+    result.trim(size_t(out - result.unsafeData()));
     return result;
 }
 
 String_t
 afl::charset::CodepageCharset::decode(afl::base::ConstBytes_t in)
 {
-    // Temporaries
-    String_t result;
-    Utf8 u8(0);
+    // Result. Every byte produces at most three; reserve one extra so we can always copy a whole table entry.
+    const uint8_t* p = in.unsafeData();
+    const size_t n = in.size();
+    String_t result(3*n + 1, '\0');
+    char* const begin = &result[0];
+    char* out = begin;
 
-    // Parse as bytes
-    while (const uint8_t* pch = in.eat()) {
-        const uint8_t ch = *pch;
-        if (ch < 0x80) {
-            u8.append(result, ch);
-        } else {
-            u8.append(result, m_codepage.m_characters[ch - 0x80]);
+    size_t i = 0;
+    while (i < n) {
+        // ASCII. Just copy.
+        const size_t ascii = Utf8::findNonAscii(in.subrange(i));
+        if (ascii != 0) {
+            std::memcpy(out, p + i, ascii);
+            out += ascii;
+            i += ascii;
+        }
+
+        // Non-ASCII: copy pre-encoded character
+        while (i < n && p[i] >= 0x80) {
+            const uint8_t* enc = m_decodeTable[p[i] - 0x80];
+            std::memcpy(out, enc, 4);
+            out += enc[3];
+            ++i;
         }
     }
 
+    result.erase(size_t(out - begin));
     return result;
 }
 
+afl::charset::Transcoder*
+afl::charset::CodepageCharset::createEncoder() const
+{
+    return new Encoder(*this);
+}
+
+afl::charset::Transcoder*
+afl::charset::CodepageCharset::createDecoder() const
+{
+    return new Decoder(*this);
+}
+
 afl::charset::CodepageCharset*
 afl::charset::CodepageCharset::clone() const
 {
-    return new CodepageCharset(m_codepage);
+    return new CodepageCharset(*this);
+}
+
+uint8_t
+afl::charset::CodepageCharset::findCharacter(Unichar_t ch) const
+{
+    if (ch <= 0xFFFF) {
+        size_t pos = hashCharacter(ch, countof(m_encodeTable));
+        while (m_encodeTable[pos] != 0) {
+            if ((m_encodeTable[pos] >> 8) == ch) {
+                return uint8_t(m_encodeTable[pos]);
+            }
+            pos = (pos + 1) & (countof(m_encodeTable) - 1);
+        }
+    }
+    return 0;
 }
@@ -6,6 +6,7 @@
 #define AFL_AFL_CHARSET_CODEPAGECHARSET_HPP
 
 #include "afl/charset/charset.hpp"
+#include "afl/charset/unicode.hpp"
 
 namespace afl { namespace charset {
 
@@ -13,7 +14,14 @@ namespace afl { namespace charset {
 
     /** Codepage Charset implementation.
         Translates to and from UTF-8 using a codepage.
-        Characters that cannot be encoded in the codepage are discarded when encoding. */
+        Characters that cannot be encoded in the codepage are discarded when encoding.
+
+        The constructor prepares lookup tables for both directions (hashed reverse map for encoding,
+        pre-encoded UTF-8 for decoding), so conversion does not need to search the codepage.
+        Runs of ASCII characters are copied as a whole.
+
+        The streaming encoder and decoder use the same tables;
+        the encoder keeps UTF-8 sequences that are split across input buffers. */
     class CodepageCharset : public Charset {
      public:
         /** Constructor.
@@ -30,12 +38,28 @@ namespace afl { namespace charset {
         // Charset:
         virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in);
         virtual String_t decode(afl::base::ConstBytes_t in);
+        virtual Transcoder* createEncoder() const;
+        virtual Transcoder* createDecoder() const;
 
         // Clonable:
         virtual CodepageCharset* clone() const;
 
      private:
         const Codepage& m_codepage;
+
+        /** Encoder table. Hash table (linear probing) with entries (Unicode << 8) + byte; 0 if unused. */
+        uint32_t m_encodeTable[256];
+
+        /** Decoder table. For each byte, the UTF-8 encoding (up to three bytes, zero-padded) and its length (last element). */
+        uint8_t m_decodeTable[128][4];
+
+        /** Look up a character in the encoder table.
+            \param ch Unicode character, non-ASCII
+            \return codepage byte; 0 if the character cannot be encoded */
+        uint8_t findCharacter(Unichar_t ch) const;
+
+        class Encoder;
+        class Decoder;
     };
 
 } }
@@ -43,11 +67,6 @@ namespace afl { namespace charset {
 
 /******************************** Inlines ********************************/
 
-inline afl::charset::CodepageCharset::CodepageCharset(const Codepage& cp)
-    : Charset(),
-      m_codepage(cp)
-{ }
-
 inline const afl::charset::Codepage& afl::charset::CodepageCharset::get() const
 {
     return m_codepage;
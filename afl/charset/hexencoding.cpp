@@ -3,9 +3,109 @@
   *  \brief Class afl::charset::HexEncoding
   */
 
+#include <cstring>
 #include "afl/charset/hexencoding.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/string/hex.hpp"
 
+namespace {
+    /* Streaming encoder */
+    class Encoder : public afl::charset::Transcoder {
+     public:
+        Encoder(const char (&digits)[16])
+            : m_pending(0), m_hasPending(false)
+            { std::memcpy(m_digits, digits, sizeof(m_digits)); }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                // Second digit of previous byte
+                if (m_hasPending && o != outEnd) {
+                    *o++ = m_pending;
+                    m_hasPending = false;
+                }
+
+                // Whole bytes
+                if (!m_hasPending) {
+                    while (n > 0 && outEnd - o >= 2) {
+                        o[0] = static_cast<uint8_t>(m_digits[*p >> 4]);
+                        o[1] = static_cast<uint8_t>(m_digits[*p & 15]);
+                        o += 2;
+                        ++p;
+                        --n;
+                    }
+
+                    // Half a byte
+                    if (n > 0 && o != outEnd) {
+                        *o++ = static_cast<uint8_t>(m_digits[*p >> 4]);
+                        m_pending = static_cast<uint8_t>(m_digits[*p & 15]);
+                        m_hasPending = true;
+                        ++p;
+                        --n;
+                    }
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            { }
+
+     private:
+        char m_digits[16];
+        uint8_t m_pending;
+        bool m_hasPending;
+    };
+
+    /* Streaming decoder. Same rules as HexEncoding::decode(). */
+    class Decoder : public afl::charset::Transcoder {
+     public:
+        Decoder()
+            : m_high(-1)
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                while (n > 0 && o != outEnd) {
+                    const int value = afl::string::getHexDigitValue(static_cast<char>(*p));
+                    if (m_high < 0) {
+                        // First digit; skip invalid
+                        m_high = value;
+                    } else {
+                        // Second digit; drop pair if invalid
+                        if (value >= 0) {
+                            *o++ = uint8_t(16*m_high + value);
+                        }
+                        m_high = -1;
+                    }
+                    ++p;
+                    --n;
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            { m_high = -1; }
+
+     private:
+        int m_high;
+    };
+}
+
 afl::charset::HexEncoding::HexEncoding()
     : m_digits(afl::string::HEX_DIGITS_UPPER)
 { }
@@ -21,11 +121,13 @@ afl::base::GrowableBytes_t
 afl::charset::HexEncoding::encode(afl::string::ConstStringMemory_t in)
 {
     afl::base::GrowableBytes_t result;
-    result.reserve(in.size()*2);
+    result.resize(in.size()*2);
+    uint8_t* out = result.unsafeData();
     while (const char* p = in.eat()) {
         uint8_t i = static_cast<uint8_t>(*p);
-        result.append(static_cast<uint8_t>(m_digits[i >> 4]));
-        result.append(static_cast<uint8_t>(m_digits[i & 15]));
+        out[0] = static_cast<uint8_t>(m_digits[i >> 4]);
+        out[1] = static_cast<uint8_t>(m_digits[i & 15]);
+        out += 2;
     }
     return result;
 }
@@ -33,21 +135,37 @@ afl::charset::HexEncoding::encode(afl::string::ConstStringMemory_t in)
 String_t
 afl::charset::HexEncoding::decode(afl::base::ConstBytes_t in)
 {
-    String_t result;
+    // Result is at most half the input; reserve one extra so we can always take the address of the first element
+    String_t result(in.size() / 2 + 1, '\0');
+    char* const begin = &result[0];
+    char* out = begin;
     while (const uint8_t* p = in.eat()) {
         int a = afl::string::getHexDigitValue(static_cast<char>(*p));
         if (a >= 0) {
             if (const uint8_t* q = in.eat()) {
                 int b = afl::string::getHexDigitValue(static_cast<char>(*q));
                 if (b >= 0) {
-                    result += char(16*a + b);
+                    *out++ = char(16*a + b);
                 }
             }
         }
     }
+    result.erase(size_t(out - begin));
     return result;
 }
 
+afl::charset::Transcoder*
+afl::charset::HexEncoding::createEncoder() const
+{
+    return new Encoder(m_digits);
+}
+
+afl::charset::Transcoder*
+afl::charset::HexEncoding::createDecoder() const
+{
+    return new Decoder();
+}
+
 afl::charset::HexEncoding*
 afl::charset::HexEncoding::clone() const
 {
@@ -12,7 +12,9 @@ namespace afl { namespace charset {
     /** Hex Encoding.
         This is not strictly speaking a character set, but fits the interface.
         It encodes an input string (which is not restricted to UTF-8) into hex encoding (two hex digits per byte),
-        or decodes the same. */
+        or decodes the same.
+
+        Invalid digits are skipped when decoding; the streaming decoder follows the same rules. */
     class HexEncoding : public Charset {
      public:
         HexEncoding();
@@ -20,6 +22,8 @@ namespace afl { namespace charset {
         virtual ~HexEncoding();
         virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in);
         virtual String_t decode(afl::base::ConstBytes_t in);
+        virtual Transcoder* createEncoder() const;
+        virtual Transcoder* createDecoder() const;
         virtual HexEncoding* clone() const;
 
      private:
@@ -3,33 +3,209 @@
   *  \brief Class afl::charset::QuotedPrintable
   */
 
+#include <cstring>
 #include "afl/charset/quotedprintable.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/string/hex.hpp"
 
+namespace {
+    /* Check whether a byte needs to be encoded */
+    inline bool needEncoding(uint8_t u)
+    {
+        return u >= 0x80 || u < 0x20 || u == '=';
+    }
+
+    /* Get length of initial run of bytes that need no encoding */
+    size_t getPlainRunLength(const uint8_t* p, size_t n)
+    {
+        size_t i = 0;
+        while (i < n && !needEncoding(p[i])) {
+            ++i;
+        }
+        return i;
+    }
+
+    /* Encode one byte as "=XX" */
+    inline void encodeByte(uint8_t u, uint8_t* out)
+    {
+        out[0] = '=';
+        out[1] = static_cast<uint8_t>(afl::string::HEX_DIGITS_UPPER[u >> 4]);
+        out[2] = static_cast<uint8_t>(afl::string::HEX_DIGITS_UPPER[u & 15]);
+    }
+
+    /* Streaming encoder */
+    class Encoder : public afl::charset::Transcoder {
+     public:
+        Encoder()
+            : m_pendingPos(0), m_pendingSize(0)
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                // Remainder of previous escape
+                while (m_pendingPos < m_pendingSize && o != outEnd) {
+                    *o++ = m_pending[m_pendingPos++];
+                }
+
+                while (m_pendingPos == m_pendingSize && n > 0 && o != outEnd) {
+                    if (needEncoding(*p)) {
+                        encodeByte(*p, m_pending);
+                        m_pendingPos = 0;
+                        m_pendingSize = 3;
+                        while (m_pendingPos < m_pendingSize && o != outEnd) {
+                            *o++ = m_pending[m_pendingPos++];
+                        }
+                        ++p;
+                        --n;
+                    } else {
+                        const size_t now = getPlainRunLength(p, std::min(n, size_t(outEnd - o)));
+                        std::memcpy(o, p, now);
+                        o += now;
+                        p += now;
+                        n -= now;
+                    }
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            { }
+
+     private:
+        uint8_t m_pending[3];
+        size_t m_pendingPos;
+        size_t m_pendingSize;
+    };
+
+    /* Streaming decoder. Same rules as QuotedPrintable::decode(). */
+    class Decoder : public afl::charset::Transcoder {
+     public:
+        Decoder()
+            : m_escapeSize(0), m_pendingPos(0), m_pendingSize(0)
+            { }
+
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                const uint8_t* p = in.unsafeData();
+                size_t n = in.size();
+                uint8_t* const outBegin = out.unsafeData();
+                uint8_t* const outEnd = outBegin + out.size();
+                uint8_t* o = outBegin;
+
+                while (drain(o, outEnd) && n > 0) {
+                    if (m_escapeSize != 0) {
+                        // Collecting an escape
+                        m_escape[m_escapeSize++] = *p++;
+                        --n;
+                        if (m_escapeSize == 3) {
+                            const int a = afl::string::getHexDigitValue(static_cast<char>(m_escape[1]));
+                            const int b = afl::string::getHexDigitValue(static_cast<char>(m_escape[2]));
+                            if (a >= 0 && b >= 0) {
+                                m_pending[0] = uint8_t(16*a + b);
+                                m_pendingSize = 1;
+                            } else {
+                                std::memcpy(m_pending, m_escape, 3);
+                                m_pendingSize = 3;
+                            }
+                            m_pendingPos = 0;
+                            m_escapeSize = 0;
+                        }
+                    } else if (*p == '=') {
+                        // Start an escape
+                        m_escape[0] = *p++;
+                        m_escapeSize = 1;
+                        --n;
+                    } else {
+                        // Copy plain text
+                        const void* eq = std::memchr(p, '=', std::min(n, size_t(outEnd - o)));
+                        const size_t now = (eq != 0 ? size_t(static_cast<const uint8_t*>(eq) - p) : std::min(n, size_t(outEnd - o)));
+                        std::memcpy(o, p, now);
+                        o += now;
+                        p += now;
+                        n -= now;
+                    }
+                }
+
+                in = afl::base::ConstBytes_t::unsafeCreate(p, n);
+                out.trim(size_t(o - outBegin));
+            }
+
+        virtual void flush()
+            {
+                // Incomplete escape at end is copied literally
+                std::memmove(m_pending, m_pending + m_pendingPos, m_pendingSize - m_pendingPos);
+                m_pendingSize -= m_pendingPos;
+                m_pendingPos = 0;
+                std::memcpy(m_pending + m_pendingSize, m_escape, m_escapeSize);
+                m_pendingSize += m_escapeSize;
+                m_escapeSize = 0;
+            }
+
+     private:
+        uint8_t m_escape[3];
+        size_t m_escapeSize;
+        uint8_t m_pending[6];
+        size_t m_pendingPos;
+        size_t m_pendingSize;
+
+        bool drain(uint8_t*& o, uint8_t* outEnd)
+            {
+                while (m_pendingPos < m_pendingSize && o != outEnd) {
+                    *o++ = m_pending[m_pendingPos++];
+                }
+                return m_pendingPos == m_pendingSize && o != outEnd;
+            }
+    };
+}
+
 afl::charset::QuotedPrintable::~QuotedPrintable()
 { }
 
 afl::base::GrowableBytes_t
 afl::charset::QuotedPrintable::encode(afl::string::ConstStringMemory_t in)
 {
+    // Result is at most three times the input
+    const uint8_t* p = in.toBytes().unsafeData();
+    size_t n = in.size();
     afl::base::GrowableBytes_t result;
-    while (const char* pc = in.eat()) {
-        uint8_t u = uint8_t(*pc);
-        if (u >= 0x80 || u < 0x20 || u == '=') {
-            result.append('=');
-            result.append(static_cast<uint8_t>(afl::string::HEX_DIGITS_UPPER[u >> 4]));
-            result.append(static_cast<uint8_t>(afl::string::HEX_DIGITS_UPPER[u & 15]));
-        } else {
-            result.append(u);
+    result.resize(3*n);
+    uint8_t* const begin = result.unsafeData();
+    uint8_t* out = begin;
+    while (n > 0) {
+        // Plain run
+        const size_t now = getPlainRunLength(p, n);
+        std::memcpy(out, p, now);
+        out += now;
+        p += now;
+        n -= now;
+
+        // Escapes
+        while (n > 0 && needEncoding(*p)) {
+            encodeByte(*p, out);
+            out += 3;
+            ++p;
+            --n;
         }
     }
+    result.trim(size_t(out - begin));
     return result;
 }
 
 String_t
 afl::charset::QuotedPrintable::decode(afl::base::ConstBytes_t in)
 {
-    String_t result;
+    // Result is at most as long as the input; reserve one extra so we can always take the address of the first element
+    String_t result(in.size() + 1, '\0');
+    char* const begin = &result[0];
+    char* out = begin;
     while (const uint8_t* pc = in.eat()) {
         typedef const uint8_t TwoBytes_t[2];
         TwoBytes_t* p2;
@@ -37,19 +213,32 @@ afl::charset::QuotedPrintable::decode(afl::base::ConstBytes_t in)
             int a = afl::string::getHexDigitValue(static_cast<char>((*p2)[0]));
             int b = afl::string::getHexDigitValue(static_cast<char>((*p2)[1]));
             if (a >= 0 && b >= 0) {
-                result += char(16*a + b);
+                *out++ = char(16*a + b);
             } else {
-                result += static_cast<char>(*pc);
-                result += static_cast<char>((*p2)[0]);
-                result += static_cast<char>((*p2)[1]);
+                *out++ = static_cast<char>(*pc);
+                *out++ = static_cast<char>((*p2)[0]);
+                *out++ = static_cast<char>((*p2)[1]);
             }
         } else {
-            result += static_cast<char>(*pc);
+            *out++ = static_cast<char>(*pc);
         }
     }
+    result.erase(size_t(out - begin));
     return result;
 }
 
+afl::charset::Transcoder*
+afl::charset::QuotedPrintable::createEncoder() const
+{
+    return new Encoder();
+}
+
+afl::charset::Transcoder*
+afl::charset::QuotedPrintable::createDecoder() const
+{
+    return new Decoder();
+}
+
 afl::charset::QuotedPrintable*
 afl::charset::QuotedPrintable::clone() const
 {
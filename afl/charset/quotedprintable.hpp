@@ -12,12 +12,18 @@ namespace afl { namespace charset {
     /** Quoted-Printable Character Encoding.
         This is not strictly speaking a character set, but fits the interface.
         It encodes an input string (which is not restricted to UTF-8) into quoted-printable encoding,
-        or decodes the same. */
+        or decodes the same.
+
+        The encoder does not insert soft line breaks.
+        The streaming encoder and decoder produce the same result as encode() and decode()
+        for any division of the input. */
     class QuotedPrintable : public Charset {
      public:
         virtual ~QuotedPrintable();
         virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in);
         virtual String_t decode(afl::base::ConstBytes_t in);
+        virtual Transcoder* createEncoder() const;
+        virtual Transcoder* createDecoder() const;
         virtual QuotedPrintable* clone() const;
     };
 
@@ -0,0 +1,42 @@
+/**
+  *  \file afl/charset/transcoder.hpp
+  *  \brief Interface afl::charset::Transcoder
+  */
+#ifndef AFL_AFL_CHARSET_TRANSCODER_HPP
+#define AFL_AFL_CHARSET_TRANSCODER_HPP
+
+#include "afl/base/deletable.hpp"
+#include "afl/base/memory.hpp"
+
+namespace afl { namespace charset {
+
+    /** Streaming character set converter.
+        Converts a byte stream from one encoding into another, in pieces of arbitrary size.
+        Unlike Charset::encode() and Charset::decode(), the input can be split anywhere,
+        including in the middle of a multi-byte sequence; the Transcoder keeps the required state.
+        Output is produced into a caller-provided buffer.
+
+        Transcoders are created using Charset::createEncoder() and Charset::createDecoder().
+        To use a Transcoder as an afl::io::Transform, use afl::io::CharsetTransform. */
+    class Transcoder : public afl::base::Deletable {
+     public:
+        /** Convert data.
+            Converts as much input data as possible, producing as much output data as possible.
+            This function follows the same rules as afl::io::Transform::transform():
+            it either consumes all input data, or completely fills the output buffer;
+            when called with nonempty input and nonempty output, it makes progress.
+
+            \param in [in/out] On input, all input data. On return, contains unprocessed input data.
+            \param out [in/out] On input, space for output data. On return, contains produced output data. */
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out) = 0;
+
+        /** Signal end of input.
+            Pending incomplete input is converted as if the input ended here.
+            Call transcode() with an empty input buffer to obtain the remaining output.
+            Once all output has been retrieved, the Transcoder can be used for a new input stream. */
+        virtual void flush() = 0;
+    };
+
+} }
+
+#endif
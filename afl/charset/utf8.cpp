@@ -3,8 +3,11 @@
   *  \brief Class afl::charset::Utf8
   */
 
+#include <algorithm>
+#include <cstring>
 #include "afl/charset/utf8.hpp"
 #include "afl/charset/utf8reader.hpp"
+#include "arch/utf8accel.hpp"
 
 namespace {
     void appendOne(String_t& out, afl::charset::Unichar_t ch)
@@ -35,6 +38,324 @@ namespace {
             out.append(1, char(0x80 + ((ch >> (6*extraBytes)) & 0x3F)));
         }
     }
+
+    /*
+     *  Bulk Processing
+     */
+
+    /* Chunk size for bulk processing.
+       A chunk that is not plain (see below) is decoded rune by rune;
+       this limits the amount of text affected by an error. */
+    const size_t CHUNK_SIZE = 256;
+
+    size_t findNonAsciiByte(const uint8_t* p, size_t n)
+    {
+        size_t result;
+        if (findNonAsciiAccel(p, n, result)) {
+            return result;
+        }
+
+        // Portable version: eight bytes at a time
+        size_t i = 0;
+        while (n - i >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if ((word & 0x8080808080808080ULL) != 0) {
+                break;
+            }
+            i += 8;
+        }
+        while (i < n && p[i] < 0x80) {
+            ++i;
+        }
+        return i;
+    }
+
+    size_t countContinuationBytes(const uint8_t* p, size_t n)
+    {
+        size_t result;
+        if (countContinuationBytesAccel(p, n, result)) {
+            return result;
+        }
+
+        result = 0;
+        for (size_t i = 0; i < n; ++i) {
+            result += afl::charset::Utf8::isContinuationByte(p[i]);
+        }
+        return result;
+    }
+
+    /* Check UTF-8.
+       valid: set to true if buffer is well-formed UTF-8 (RFC 3629).
+       suspect: set to true if buffer contains a non-character or error character (may have false positives). */
+    void checkUtf8(const uint8_t* p, size_t n, bool& valid, bool& suspect)
+    {
+        if (checkUtf8Accel(p, n, valid, suspect)) {
+            return;
+        }
+
+        // Portable version
+        valid = false;
+        suspect = false;
+        size_t i = 0;
+        while (i < n) {
+            const uint8_t lead = p[i];
+            if (lead < 0x80) {
+                ++i;
+                continue;
+            }
+
+            // Determine length and permitted range of second byte
+            size_t len;
+            uint8_t min = 0x80, max = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF) {
+                len = 2;
+            } else if (lead >= 0xE0 && lead <= 0xEF) {
+                len = 3;
+                if (lead == 0xE0) { min = 0xA0; }            // overlong
+                if (lead == 0xED) { max = 0x9F; }            // surrogates
+            } else if (lead >= 0xF0 && lead <= 0xF4) {
+                len = 4;
+                if (lead == 0xF0) { min = 0x90; }            // overlong
+                if (lead == 0xF4) { max = 0x8F; }            // above UNICODE_MAX
+            } else {
+                return;
+            }
+            if (n - i < len || p[i+1] < min || p[i+1] > max) {
+                return;
+            }
+
+            afl::charset::Unichar_t ch = lead & (0x7F >> len);
+            for (size_t j = 1; j < len; ++j) {
+                if (!afl::charset::Utf8::isContinuationByte(p[i+j])) {
+                    return;
+                }
+                ch = (ch << 6) | (p[i+j] & 0x3F);
+            }
+            if ((ch & 0xFFFF) >= 0xFFFE || afl::charset::isErrorCharacter(ch)) {
+                suspect = true;
+            }
+            i += len;
+        }
+        valid = true;
+    }
+
+    /* Check whether a chunk is plain.
+       A plain chunk is well-formed, and contains no characters whose decoding depends on flags.
+       It can therefore be processed without Utf8Reader. */
+    bool isPlain(const uint8_t* p, size_t n)
+    {
+        bool valid, suspect;
+        checkUtf8(p, n, valid, suspect);
+        return valid && !suspect;
+    }
+
+    /* Process runes.
+       Splits the text into plain parts which are passed to the handler as a whole (handlePlain(ptr, size)),
+       and runes decoded by Utf8Reader (handleRune(ch, size)).
+       Handler functions return false to stop. */
+    template<typename Handler>
+    void processRunes(afl::base::ConstBytes_t text, uint32_t flags, Handler& h)
+    {
+        const uint8_t* p = text.unsafeData();
+        const size_t n = text.size();
+        size_t pos = 0;
+        while (pos < n) {
+            // ASCII is always plain
+            const size_t ascii = findNonAsciiByte(p + pos, n - pos);
+            if (ascii != 0) {
+                if (!h.handlePlain(p + pos, ascii)) {
+                    return;
+                }
+                pos += ascii;
+                if (pos >= n) {
+                    break;
+                }
+            }
+
+            // Chunk, ending at a rune boundary
+            size_t end = std::min(n, pos + CHUNK_SIZE);
+            while (end > pos && end < n && afl::charset::Utf8::isContinuationByte(p[end])) {
+                --end;
+            }
+
+            if (end > pos && isPlain(p + pos, end - pos)) {
+                if (!h.handlePlain(p + pos, end - pos)) {
+                    return;
+                }
+                pos = end;
+            } else {
+                // Decode until we have consumed this chunk
+                afl::charset::Utf8Reader rdr(text.subrange(pos), flags);
+                const size_t limit = std::max(end, pos + 1);
+                while (pos < limit) {
+                    const afl::charset::Unichar_t ch = rdr.eat();
+                    const size_t next = n - rdr.getRemainder().size();
+                    if (!h.handleRune(ch, next - pos)) {
+                        return;
+                    }
+                    pos = next;
+                }
+            }
+        }
+    }
+
+    /* Decode a plain part. Returns updated output pointer. */
+    template<typename T>
+    T* decodePlain(const uint8_t* p, size_t n, T* out)
+    {
+        size_t i = 0;
+        while (i < n) {
+            const uint8_t lead = p[i];
+            afl::charset::Unichar_t ch;
+            if (lead < 0x80) {
+                ch = lead;
+                i += 1;
+            } else if (lead < 0xE0) {
+                ch = ((lead & 0x1FU) << 6) | (p[i+1] & 0x3FU);
+                i += 2;
+            } else if (lead < 0xF0) {
+                ch = ((lead & 0x0FU) << 12) | ((p[i+1] & 0x3FU) << 6) | (p[i+2] & 0x3FU);
+                i += 3;
+            } else {
+                ch = ((lead & 0x07U) << 18) | ((p[i+1] & 0x3FU) << 12) | ((p[i+2] & 0x3FU) << 6) | (p[i+3] & 0x3FU);
+                i += 4;
+                if (sizeof(T) == 2) {
+                    // Surrogate pair (plain text never contains characters above UNICODE_MAX)
+                    ch -= 0x10000;
+                    *out++ = T(afl::charset::UNICODE_HIGH_SURROGATE_MIN + (ch >> 10));
+                    ch = afl::charset::UNICODE_LOW_SURROGATE_MIN + (ch & 0x3FF);
+                }
+            }
+            *out++ = T(ch);
+        }
+        return out;
+    }
+
+    /* Handler: count runes */
+    class RuneCounter {
+     public:
+        RuneCounter()
+            : m_count(0)
+            { }
+        bool handlePlain(const uint8_t* p, size_t n)
+            {
+                m_count += n - countContinuationBytes(p, n);
+                return true;
+            }
+        bool handleRune(afl::charset::Unichar_t /*ch*/, size_t /*n*/)
+            {
+                ++m_count;
+                return true;
+            }
+        size_t get() const
+            { return m_count; }
+     private:
+        size_t m_count;
+    };
+
+    /* Handler: skip a number of runes, count bytes */
+    class RuneSkipper {
+     public:
+        RuneSkipper(size_t numRunes)
+            : m_remaining(numRunes), m_bytes(0)
+            { }
+        bool handlePlain(const uint8_t* p, size_t n)
+            {
+                const size_t numRunes = n - countContinuationBytes(p, n);
+                if (numRunes <= m_remaining) {
+                    m_remaining -= numRunes;
+                    m_bytes += n;
+                } else {
+                    size_t i = 0;
+                    while (m_remaining > 0) {
+                        ++i;
+                        while (i < n && afl::charset::Utf8::isContinuationByte(p[i])) {
+                            ++i;
+                        }
+                        --m_remaining;
+                    }
+                    m_bytes += i;
+                }
+                return m_remaining > 0;
+            }
+        bool handleRune(afl::charset::Unichar_t /*ch*/, size_t n)
+            {
+                m_bytes += n;
+                --m_remaining;
+                return m_remaining > 0;
+            }
+        size_t get() const
+            { return m_bytes; }
+     private:
+        size_t m_remaining;
+        size_t m_bytes;
+    };
+
+    /* Handler: count runes that start before a byte position */
+    class RunePositionCounter {
+     public:
+        RunePositionCounter(size_t bytePos)
+            : m_remaining(bytePos), m_count(0)
+            { }
+        bool handlePlain(const uint8_t* p, size_t n)
+            {
+                const size_t now = std::min(n, m_remaining);
+                m_count += now - countContinuationBytes(p, now);
+                m_remaining -= now;
+                return m_remaining > 0;
+            }
+        bool handleRune(afl::charset::Unichar_t /*ch*/, size_t n)
+            {
+                ++m_count;
+                m_remaining -= std::min(n, m_remaining);
+                return m_remaining > 0;
+            }
+        size_t get() const
+            { return m_count; }
+     private:
+        size_t m_remaining;
+        size_t m_count;
+    };
+
+    /* Handler: decode */
+    template<typename T>
+    class RuneDecoder {
+     public:
+        RuneDecoder(afl::base::GrowableMemory<T>& out, size_t maxSize)
+            : m_out(out), m_start(out.size())
+            {
+                // Each byte produces at most one output element
+                out.resize(m_start + maxSize);
+                m_ptr = out.unsafeData() + m_start;
+            }
+        ~RuneDecoder()
+            { m_out.trim(size_t(m_ptr - m_out.unsafeData())); }
+        bool handlePlain(const uint8_t* p, size_t n)
+            {
+                m_ptr = decodePlain(p, n, m_ptr);
+                return true;
+            }
+        bool handleRune(afl::charset::Unichar_t ch, size_t /*n*/)
+            {
+                if (sizeof(T) == 2 && ch > 0xFFFF) {
+                    if (ch <= afl::charset::UNICODE_MAX) {
+                        // Surrogate pair. Cannot overflow: such a character takes 4 bytes.
+                        ch -= 0x10000;
+                        *m_ptr++ = T(afl::charset::UNICODE_HIGH_SURROGATE_MIN + (ch >> 10));
+                        ch = afl::charset::UNICODE_LOW_SURROGATE_MIN + (ch & 0x3FF);
+                    } else {
+                        ch = 0xFFFD;
+                    }
+                }
+                *m_ptr++ = T(ch);
+                return true;
+            }
+     private:
+        afl::base::GrowableMemory<T>& m_out;
+        size_t m_start;
+        T* m_ptr;
+    };
 }
 
 
@@ -79,7 +400,9 @@ afl::charset::Utf8::length(const String_t& text) const
 size_t
 afl::charset::Utf8::length(Bytes_t text) const
 {
-    return Utf8Reader(text, m_flags).count();
+    RuneCounter counter;
+    processRunes(text, m_flags, counter);
+    return counter.get();
 }
 
 // Get substring.
@@ -101,24 +424,15 @@ afl::charset::Utf8::Bytes_t
 afl::charset::Utf8::substrMemory(Bytes_t text, size_t index, size_t count) const
 {
     // Skip over initial portion
-    Utf8Reader rdr(text, m_flags);
-    while (rdr.hasMore() && index != 0) {
-        rdr.eat();
-        --index;
-    }
+    Bytes_t tail(text.subrange(charToBytePos(text, index)));
 
     // Produce result
-    Bytes_t tail(rdr.getRemainder());
     if (count >= tail.size()) {
         // User wants the whole remaining string
         return tail;
     } else {
         // User wants possibly less than the whole string
-        while (rdr.hasMore() && count != 0) {
-            rdr.eat();
-            --count;
-        }
-        return tail.split(tail.size() - rdr.getRemainder().size());
+        return tail.split(charToBytePos(tail, count));
     }
 }
 
@@ -134,14 +448,10 @@ afl::charset::Unichar_t
 afl::charset::Utf8::charAt(Bytes_t text, size_t index) const
 {
     // Skip over initial portion
-    Utf8Reader rdr(text, m_flags);
-    while (rdr.hasMore() && index != 0) {
-        rdr.eat();
-        --index;
-    }
+    Utf8Reader rdr(text.subrange(charToBytePos(text, index)), m_flags);
 
     // Check bounds
-    if (index == 0 && rdr.hasMore()) {
+    if (rdr.hasMore()) {
         return rdr.eat();
     } else {
         return 0;
@@ -161,17 +471,14 @@ afl::charset::Utf8::byteToCharPos(Bytes_t text, size_t bytePos) const
 {
     if (bytePos >= text.size()) {
         // We cannot possibly reach this position. Just count the characters.
-        return Utf8Reader(text, m_flags).count();
+        return length(text);
+    } else if (bytePos == 0) {
+        return 0;
     } else {
         // Count characters until we have consumed bytePos bytes.
-        Utf8Reader rdr(text, m_flags);
-        size_t total = text.size();
-        size_t result = 0;
-        while (total - rdr.getRemainder().size() < bytePos) {
-            rdr.eat();
-            ++result;
-        }
-        return result;
+        RunePositionCounter counter(bytePos);
+        processRunes(text, m_flags, counter);
+        return counter.get();
     }
 }
 
@@ -189,18 +496,48 @@ afl::charset::Utf8::charToBytePos(Bytes_t text, size_t charPos) const
     if (charPos >= text.size()) {
         // We cannot possibly have more characters in this string than it has bytes.
         return text.size();
+    } else if (charPos == 0) {
+        return 0;
     } else {
         // Skip charPos characters.
-        Utf8Reader rdr(text, m_flags);
-        size_t total = text.size();
-        while (charPos != 0) {
-            rdr.eat();
-            --charPos;
-        }
-        return total - rdr.getRemainder().size();
+        RuneSkipper skipper(charPos);
+        processRunes(text, m_flags, skipper);
+        return skipper.get();
     }
 }
 
+// Decode to UTF-32.
+void
+afl::charset::Utf8::decodeUtf32(Bytes_t text, afl::base::GrowableMemory<Unichar_t>& out) const
+{
+    RuneDecoder<Unichar_t> decoder(out, text.size());
+    processRunes(text, m_flags, decoder);
+}
+
+// Decode to UTF-16.
+void
+afl::charset::Utf8::decodeUtf16(Bytes_t text, afl::base::GrowableMemory<uint16_t>& out) const
+{
+    RuneDecoder<uint16_t> decoder(out, text.size());
+    processRunes(text, m_flags, decoder);
+}
+
+// Check for well-formed UTF-8.
+bool
+afl::charset::Utf8::isValid(Bytes_t text)
+{
+    bool valid, suspect;
+    checkUtf8(text.unsafeData(), text.size(), valid, suspect);
+    return valid;
+}
+
+// Find first non-ASCII byte.
+size_t
+afl::charset::Utf8::findNonAscii(Bytes_t text)
+{
+    return findNonAsciiByte(text.unsafeData(), text.size());
+}
+
 // Check for continuation byte.
 bool
 afl::charset::Utf8::isContinuationByte(uint8_t byte)
@@ -6,6 +6,7 @@
 #define AFL_AFL_CHARSET_UTF8_HPP
 
 #include "afl/string/string.hpp"
+#include "afl/base/growablememory.hpp"
 #include "afl/charset/unicode.hpp"
 
 namespace afl { namespace charset {
@@ -33,7 +34,13 @@ namespace afl { namespace charset {
                foo(u8.charAt(s, i));              // WRONG!
            }                                      // WRONG!
         </pre>
-        This code is O(n^2). Use Utf8Reader instead. */
+        This code is O(n^2). Use Utf8Reader instead.
+
+        Functions that process a whole string (length(), substr(), byteToCharPos(), decodeUtf32(), etc.)
+        use vectorized code where available: chunks of well-formed UTF-8 are processed in bulk,
+        and only chunks containing invalid sequences or characters affected by flags
+        (non-characters, error characters) are decoded one by one.
+        Results are the same as decoding the string using Utf8Reader. */
     class Utf8 {
      public:
         /*
@@ -173,6 +180,33 @@ namespace afl { namespace charset {
             \return Number of bytes that make up the first charPos characters. Number of bytes in text if there are fewer characters in the text. */
         size_t charToBytePos(Bytes_t text, size_t charPos) const;
 
+        /** Decode to UTF-32.
+            Appends all characters of the text to \c out;
+            same result as repeatedly calling Utf8Reader::eat().
+            \param text [in] String to work on
+            \param out [in/out] Result */
+        void decodeUtf32(Bytes_t text, afl::base::GrowableMemory<Unichar_t>& out) const;
+
+        /** Decode to UTF-16.
+            Appends all characters of the text to \c out.
+            Characters outside the BMP are converted into surrogate pairs;
+            characters above UNICODE_MAX (which can be produced when AllowNonCharacters is set) are replaced by U+FFFD.
+            \param text [in] String to work on
+            \param out [in/out] Result */
+        void decodeUtf16(Bytes_t text, afl::base::GrowableMemory<uint16_t>& out) const;
+
+        /** Check for well-formed UTF-8.
+            This checks the RFC 3629 definition of UTF-8, independent of any flags:
+            no overlong sequences, no surrogates, no characters above UNICODE_MAX, no truncated sequences.
+            \param text [in] String to work on
+            \return true if text is well-formed */
+        static bool isValid(Bytes_t text);
+
+        /** Find first non-ASCII byte.
+            \param text [in] String to work on
+            \return Position of first byte that is 0x80 or above; text.size() if there is none */
+        static size_t findNonAscii(Bytes_t text);
+
         /** Check for continuation byte.
             \param byte Byte to check
             \retval false Not a continuation byte. This byte can probably start an UTF-8 rune.
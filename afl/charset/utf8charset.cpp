@@ -4,6 +4,21 @@
   */
 
 #include "afl/charset/utf8charset.hpp"
+#include "afl/charset/transcoder.hpp"
+
+namespace {
+    /* Transcoder that copies its input unchanged */
+    class CopyTranscoder : public afl::charset::Transcoder {
+     public:
+        virtual void transcode(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                out.trim(out.copyFrom(in).size());
+                in.split(out.size());
+            }
+        virtual void flush()
+            { }
+    };
+}
 
 afl::charset::Utf8Charset::~Utf8Charset()
 { }
@@ -22,6 +37,18 @@ afl::charset::Utf8Charset::decode(afl::base::ConstBytes_t in)
     return afl::string::fromBytes(in);
 }
 
+afl::charset::Transcoder*
+afl::charset::Utf8Charset::createEncoder() const
+{
+    return new CopyTranscoder();
+}
+
+afl::charset::Transcoder*
+afl::charset::Utf8Charset::createDecoder() const
+{
+    return new CopyTranscoder();
+}
+
 afl::charset::Utf8Charset*
 afl::charset::Utf8Charset::clone() const
 {
@@ -11,7 +11,8 @@ namespace afl { namespace charset {
 
     /** UTF-8 Charset implementation.
         This implements the interface of Charset for UTF-8 input.
-        Since output is UTF-8 as well, this class effectively does nothing. */
+        Since output is UTF-8 as well, this class effectively does nothing;
+        its streaming encoder and decoder copy the data unchanged. */
     class Utf8Charset : public Charset {
      public:
         /** Constructor. */
@@ -23,6 +24,8 @@ namespace afl { namespace charset {
         // Charset:
         virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in);
         virtual String_t decode(afl::base::ConstBytes_t in);
+        virtual Transcoder* createEncoder() const;
+        virtual Transcoder* createDecoder() const;
 
         // Clonable:
         virtual Utf8Charset* clone() const;
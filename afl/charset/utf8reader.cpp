@@ -21,6 +21,22 @@ afl::charset::Utf8Reader::Utf8Reader(afl::base::ConstBytes_t data, uint32_t flag
 afl::charset::Unichar_t
 afl::charset::Utf8Reader::eat()
 {
+    // Fast path for ASCII and two-byte runes; these are not affected by flags
+    if (const uint8_t* p = m_data.at(0)) {
+        if (*p < 0x80) {
+            m_data.split(1);
+            return *p;
+        }
+        if (*p >= 0xC2 && *p < 0xE0) {
+            const uint8_t* q = m_data.at(1);
+            if (q != 0 && Utf8::isContinuationByte(*q)) {
+                const Unichar_t result = ((*p & 0x1FU) << 6) | (*q & 0x3FU);
+                m_data.split(2);
+                return result;
+            }
+        }
+    }
+
     // Parse a character
     Character first;
     parse(m_data, first);
@@ -81,13 +97,7 @@ afl::charset::Utf8Reader::hasMore() const
 size_t
 afl::charset::Utf8Reader::count() const
 {
-    Utf8Reader me(*this);
-    size_t n = 0;
-    while (me.hasMore()) {
-        me.eat();
-        ++n;
-    }
-    return n;
+    return Utf8(m_flags).length(m_data);
 }
 
 afl::base::ConstBytes_t
@@ -3,10 +3,19 @@
   *  \brief Class afl::checksums::Adler32
   */
 
+#include <algorithm>
 #include "afl/checksums/adler32.hpp"
+#include "arch/adler32accel.hpp"
 
 namespace {
     const uint32_t BASE = 65521;
+
+    /* Maximum number of bytes to process before reducing modulo BASE.
+       Assuming we always add 0xFF, after n bytes,
+         s1' = s1 + n*0xFF
+         s2' = s2 + n*s1 + (n*(n+1))/2 * 0xFF
+       which overflows at n=5553 (same value as zlib's NMAX). */
+    const size_t MAX_BLOCK = 5552;
 }
 
 afl::checksums::Adler32::Adler32()
@@ -18,25 +27,44 @@ afl::checksums::Adler32::~Adler32()
 uint32_t
 afl::checksums::Adler32::add(Memory_t data, uint32_t prev) const
 {
-    uint32_t s1 = (prev & 0xFFFF);
-    uint32_t s2 = (prev >> 16);
-    uint32_t counter = 0;
-    while (const uint8_t* p = data.eat()) {
+    uint32_t s1 = (prev & 0xFFFF) % BASE;
+    uint32_t s2 = (prev >> 16) % BASE;
+    const uint8_t* p = data.unsafeData();
+    size_t n = data.size();
+    while (n > 0) {
         // The most expensive operation in Adler32 is the division which should normally be done after each byte.
         // Since we're effectively computing everything modulo BASE, we can defer division as long as we don't overflow.
-        // Assuming we always add 0xFF. This means after n bytes,
-        //   s1' = s1 + n*0xFF                           // overflows at around n=2^24
-        //   s2' = s2 + n*s1 + (n*(n-1))/2 * 0xFF        // overflows at around n=5550
-        if (++counter > 5500) {
-            s1 %= BASE;
-            s2 %= BASE;
-            counter = 0;
+        size_t k = std::min(n, MAX_BLOCK);
+        n -= k;
+
+        // Whole 32-byte chunks using vector instructions, if available.
+        if (k >= 32 && addAdler32Accel(s1, s2, p, k / 32)) {
+            p += k & ~size_t(31);
+            k &= 31;
+        }
+
+        // Unrolled loop. This makes the loop overhead disappear;
+        // in benchmarks, it performed better than a vectorizable dot-product formulation.
+        while (k >= 8) {
+            s1 += p[0]; s2 += s1;
+            s1 += p[1]; s2 += s1;
+            s1 += p[2]; s2 += s1;
+            s1 += p[3]; s2 += s1;
+            s1 += p[4]; s2 += s1;
+            s1 += p[5]; s2 += s1;
+            s1 += p[6]; s2 += s1;
+            s1 += p[7]; s2 += s1;
+            p += 8;
+            k -= 8;
+        }
+        while (k > 0) {
+            s1 += *p++;
+            s2 += s1;
+            --k;
         }
-        s1 += *p;
-        s2 += s1;
+        s1 %= BASE;
+        s2 %= BASE;
     }
-    s1 %= BASE;
-    s2 %= BASE;
     return (s2 << 16) | s1;
 }
 
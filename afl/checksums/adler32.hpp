@@ -12,6 +12,8 @@ namespace afl { namespace checksums {
     /** Adler-32 checksum.
         This implements the checksum as specified in RFC 1950 section 8.2.
 
+        Blocks of 32 bytes and more use SSSE3 or AVX2 instructions if the CPU supports them.
+
         Note that unlike most other checksums, Adler32 should start at 1, not 0. */
     class Adler32 : public Checksum {
      public:
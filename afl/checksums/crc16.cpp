@@ -16,11 +16,30 @@ afl::checksums::CRC16::~CRC16()
 uint16_t
 afl::checksums::CRC16::add(Memory_t data, uint16_t prev) const
 {
-    uint16_t accum = prev;
-    while (const uint8_t* p = data.eat()) {
-        accum = uint16_t(m_table[(*p ^ accum) & 255] ^ (accum >> 8));
+    // Slicing-by-8: combine accumulator with first two bytes of a group, and look up each byte in the table
+    // accounting for the number of bytes following it.
+    uint32_t accum = prev;
+    const uint8_t* p = data.unsafeData();
+    size_t n = data.size();
+    while (n >= 8) {
+        const uint32_t x = accum ^ (p[0] | (uint32_t(p[1]) << 8));
+        accum = uint32_t(m_table[7][x & 255]
+                         ^ m_table[6][x >> 8]
+                         ^ m_table[5][p[2]]
+                         ^ m_table[4][p[3]]
+                         ^ m_table[3][p[4]]
+                         ^ m_table[2][p[5]]
+                         ^ m_table[1][p[6]]
+                         ^ m_table[0][p[7]]);
+        p += 8;
+        n -= 8;
     }
-    return accum;
+    while (n > 0) {
+        accum = m_table[0][(*p ^ accum) & 255] ^ (accum >> 8);
+        ++p;
+        --n;
+    }
+    return uint16_t(accum);
 }
 
 size_t
@@ -57,6 +76,12 @@ afl::checksums::CRC16::init(uint16_t poly)
         for (int bit = 0; bit < 8; ++bit) {
             n = uint16_t((n & 1) ? poly ^ (n >> 1) : (n >> 1));
         }
-        m_table[i] = n;
+        m_table[0][i] = n;
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (uint16_t i = 0; i < 256; ++i) {
+            const uint16_t prev = m_table[k-1][i];
+            m_table[k][i] = uint16_t(m_table[0][prev & 255] ^ (prev >> 8));
+        }
     }
 }
@@ -11,11 +11,13 @@ namespace afl { namespace checksums {
 
     /** Cyclic redundancy check, 16 bits (CRC-16).
         This implements a big-endian CRC-16.
-        It is characterized by a polynomial specified as a uint16_t. */
+        It is characterized by a polynomial specified as a uint16_t.
+
+        Data is processed eight bytes at a time using eight lookup tables ("slicing-by-8"). */
     class CRC16 : public Checksum {
      public:
         /** Constructor.
-            Constructing the CRC16 object will compute a helper table and therefore is expensive.
+            Constructing the CRC16 object will compute helper tables (4k) and therefore is expensive.
             Re-use CRC16 objects if possible.
             Also see getDefaultInstance().
 
@@ -43,8 +45,9 @@ namespace afl { namespace checksums {
             \param poly Polynomial */
         void init(uint16_t poly);
 
-        /** Helper table. */
-        uint16_t m_table[256];
+        /** Helper tables.
+            m_table[0] is the classic bytewise table; m_table[k] advances a byte through k additional zero bytes. */
+        uint16_t m_table[8][256];
     };
 
 } }
@@ -1,9 +1,32 @@
 /**
   *  \file afl/checksums/crc32.cpp
   *  \brief Class afl::checksums::CRC32
+  *
+  *  This uses the "slicing-by-16" algorithm: for each group of sixteen bytes,
+  *  the accumulator is combined with the first four bytes, and each byte is looked up in a separate table
+  *  that accounts for the number of bytes following it in the group.
+  *  This removes the byte-to-byte dependency of the classic algorithm.
+  *
+  *  Polynomials are represented like CRCs: bit 31 is x^0, bit 0 is x^31.
+  *  combine() uses the fact that appending n zero bytes to a message multiplies its CRC by x^(8n) (modulo poly),
+  *  which can be computed in O(log n) multiplications using the precomputed powers x^(2^k).
+  *
+  *  For the zlib polynomial, large blocks are processed by an accelerated kernel if the CPU supports it.
   */
 
 #include "afl/checksums/crc32.hpp"
+#include "afl/bits/uint32le.hpp"
+#include "arch/crc32accel.hpp"
+
+namespace {
+    /* zlib polynomial: x^32 + x^26 + x^23 + x^22 + x^16 + x^12 + x^11 + x^10 + x^8 + x^7 + x^5 + x^4 + x^2 + x + 1 */
+    const uint32_t ZLIB_POLY = 0xEDB88320;
+
+    inline uint32_t load32(const uint8_t* p)
+    {
+        return afl::bits::UInt32LE::unpack(*reinterpret_cast<const afl::bits::UInt32LE::Bytes_t*>(p));
+    }
+}
 
 afl::checksums::CRC32::CRC32(uint32_t poly)
 {
@@ -17,8 +40,40 @@ uint32_t
 afl::checksums::CRC32::add(Memory_t data, uint32_t prev) const
 {
     uint32_t accum = ~prev;
-    while (const uint8_t* p = data.eat()) {
-        accum = m_table[(*p ^ accum) & 255] ^ (accum >> 8);
+    const uint8_t* p = data.unsafeData();
+    size_t n = data.size();
+    if (n >= 64 && m_poly == ZLIB_POLY && addCRC32Accel(accum, p, n / 16)) {
+        p += n & ~size_t(15);
+        n &= 15;
+    }
+    while (n >= 16) {
+        const uint32_t w0 = accum ^ load32(p);
+        const uint32_t w1 = load32(p + 4);
+        const uint32_t w2 = load32(p + 8);
+        const uint32_t w3 = load32(p + 12);
+        accum = m_table[15][w0 & 255]
+            ^ m_table[14][(w0 >> 8) & 255]
+            ^ m_table[13][(w0 >> 16) & 255]
+            ^ m_table[12][w0 >> 24]
+            ^ m_table[11][w1 & 255]
+            ^ m_table[10][(w1 >> 8) & 255]
+            ^ m_table[9][(w1 >> 16) & 255]
+            ^ m_table[8][w1 >> 24]
+            ^ m_table[7][w2 & 255]
+            ^ m_table[6][(w2 >> 8) & 255]
+            ^ m_table[5][(w2 >> 16) & 255]
+            ^ m_table[4][w2 >> 24]
+            ^ m_table[3][w3 & 255]
+            ^ m_table[2][(w3 >> 8) & 255]
+            ^ m_table[1][(w3 >> 16) & 255]
+            ^ m_table[0][w3 >> 24];
+        p += 16;
+        n -= 16;
+    }
+    while (n > 0) {
+        accum = m_table[0][(*p ^ accum) & 255] ^ (accum >> 8);
+        ++p;
+        --n;
     }
     return ~accum;
 }
@@ -29,11 +84,28 @@ afl::checksums::CRC32::bits() const
     return 32;
 }
 
+uint32_t
+afl::checksums::CRC32::combine(uint32_t first, uint32_t second, uint64_t secondLength) const
+{
+    // Compute x^(8*secondLength) mod poly: start with x^0, and multiply by x^(2^k) for each bit k in 8*secondLength.
+    uint32_t factor = 0x80000000;
+    uint32_t power = m_powers[3];
+    int k = 3;
+    while (secondLength != 0) {
+        if ((secondLength & 1) != 0) {
+            factor = multiply(power, factor);
+        }
+        secondLength >>= 1;
+        ++k;
+        power = (k < 32 ? m_powers[k] : multiply(power, power));
+    }
+    return multiply(factor, first) ^ second;
+}
+
 afl::checksums::CRC32&
 afl::checksums::CRC32::getDefaultInstance()
 {
-    /* zlib polynomial: x^32 + x^26 + x^23 + x^22 + x^16 + x^12 + x^11 + x^10 + x^8 + x^7 + x^5 + x^4 + x^2 + x + 1 */
-    static CRC32 defaultInstance(0xEDB88320);
+    static CRC32 defaultInstance(ZLIB_POLY);
     return defaultInstance;
 }
 
@@ -52,11 +124,37 @@ afl::checksums::CRC32::bitsImpl() const
 void
 afl::checksums::CRC32::init(uint32_t poly)
 {
+    m_poly = poly;
     for (uint32_t i = 0; i < 256; ++i) {
         uint32_t n = i;
         for (int bit = 0; bit < 8; ++bit) {
             n = (n & 1) ? poly ^ (n >> 1) : (n >> 1);
         }
-        m_table[i] = n;
+        m_table[0][i] = n;
+    }
+    for (int k = 1; k < 16; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            const uint32_t prev = m_table[k-1][i];
+            m_table[k][i] = m_table[0][prev & 255] ^ (prev >> 8);
+        }
+    }
+
+    // x^1, x^2, x^4, ...
+    m_powers[0] = 0x40000000;
+    for (int k = 1; k < 32; ++k) {
+        m_powers[k] = multiply(m_powers[k-1], m_powers[k-1]);
+    }
+}
+
+uint32_t
+afl::checksums::CRC32::multiply(uint32_t a, uint32_t b) const
+{
+    uint32_t result = 0;
+    for (uint32_t m = 0x80000000; m != 0; m >>= 1) {
+        if ((a & m) != 0) {
+            result ^= b;
+        }
+        b = (b & 1) ? (b >> 1) ^ m_poly : (b >> 1);
     }
+    return result;
 }
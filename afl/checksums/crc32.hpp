@@ -11,11 +11,15 @@ namespace afl { namespace checksums {
 
     /** Cyclic redundancy check, 32 bits (CRC-32).
         This implements a big-endian CRC-32, as used in zlib, bzip2, and many others.
-        It is characterized by a polynomial specified as a uint32_t. */
+        It is characterized by a polynomial specified as a uint32_t.
+
+        Data is processed sixteen bytes at a time using sixteen lookup tables ("slicing-by-16").
+        For the zlib polynomial, large blocks use carry-less multiplication (PCLMULQDQ) if the CPU supports it.
+        Checksums of separately-processed parts of a data stream can be merged using combine(). */
     class CRC32 : public Checksum {
      public:
         /** Constructor.
-            Constructing the CRC32 object will compute a helper table and therefore is expensive.
+            Constructing the CRC32 object will compute helper tables (16k) and therefore is expensive.
             Re-use CRC32 objects if possible.
             Also see getDefaultInstance().
 
@@ -30,6 +34,17 @@ namespace afl { namespace checksums {
         uint32_t add(Memory_t data, uint32_t prev) const;
         size_t bits() const;
 
+        /** Combine checksums.
+            Given the checksums of two consecutive pieces of data, each computed starting with 0,
+            computes the checksum of the concatenated data.
+            That is, combine(add(A, 0), add(B, 0), B.size()) == add(B, add(A, 0)).
+            This allows computing the checksum of a large block in parallel.
+            \param first        Checksum of first part
+            \param second       Checksum of second part
+            \param secondLength Length of second part in bytes
+            \return checksum of concatenation */
+        uint32_t combine(uint32_t first, uint32_t second, uint64_t secondLength) const;
+
         /** Get default instance.
             The default instance uses the zlib/bzip2 polynomial. */
         static CRC32& getDefaultInstance();
@@ -43,8 +58,20 @@ namespace afl { namespace checksums {
             \param poly Polynomial */
         void init(uint32_t poly);
 
-        /** Helper table. */
-        uint32_t m_table[256];
+        /** Multiply two polynomials modulo the CRC polynomial.
+            \param a,b Polynomials, in the same representation as a CRC
+            \return a*b mod poly */
+        uint32_t multiply(uint32_t a, uint32_t b) const;
+
+        /** Polynomial. */
+        uint32_t m_poly;
+
+        /** Helper tables.
+            m_table[0] is the classic bytewise table; m_table[k] advances a byte through k additional zero bytes. */
+        uint32_t m_table[16][256];
+
+        /** Powers of x: m_powers[k] = x^(2^k) mod poly. */
+        uint32_t m_powers[32];
     };
 
 } }
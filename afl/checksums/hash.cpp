@@ -3,12 +3,125 @@
   *  \brief Class afl::checksums::Hash
   */
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
 #include "afl/checksums/hash.hpp"
-#include "afl/base/staticassert.hpp"
-#include "afl/except/unsupportedexception.hpp"
+#include "afl/base/stoppable.hpp"
 #include "afl/bits/uint32be.hpp"
+#include "afl/checksums/hmac.hpp"
+#include "afl/container/ptrvector.hpp"
+#include "afl/except/unsupportedexception.hpp"
 #include "afl/string/hex.hpp"
+#include "afl/sys/thread.hpp"
+
+namespace {
+    /* Pseudo-random function for PBKDF2: HMAC with precomputed key, and a working hash of our own */
+    class KeyedPRF {
+     public:
+        KeyedPRF(const afl::checksums::HMAC& hmac)
+            : m_hmac(hmac), m_work(hmac.createWorkHash())
+            { }
+        size_t getHashSize() const
+            { return m_hmac.getHashSize(); }
+        afl::base::Bytes_t compute(afl::base::ConstBytes_t data, afl::base::Bytes_t out)
+            { return m_hmac.compute(data, out, *m_work); }
+     private:
+        const afl::checksums::HMAC& m_hmac;
+        std::auto_ptr<afl::checksums::Hash> m_work;
+    };
+
+    /* Pseudo-random function for PBKDF2: Hash::computeHMAC(), for hashes that cannot be cloned */
+    class SimplePRF {
+     public:
+        SimplePRF(afl::checksums::Hash& hash, afl::base::ConstBytes_t key)
+            : m_hash(hash), m_key(key)
+            { }
+        size_t getHashSize() const
+            { return m_hash.getHashSize(); }
+        afl::base::Bytes_t compute(afl::base::ConstBytes_t data, afl::base::Bytes_t out)
+            {
+                m_hash.computeHMAC(m_key, data);
+                return m_hash.getHash(out);
+            }
+     private:
+        afl::checksums::Hash& m_hash;
+        afl::base::ConstBytes_t m_key;
+    };
+
+    /* Compute one block of PBKDF2 output (T_i)
+       \param prf           Pseudo-random function (HMAC keyed with password)
+       \param out           [out] Output; up to prf.getHashSize() bytes
+       \param salt          Salt (at most MAX_BLOCK_SIZE bytes)
+       \param numIterations Number of iterations
+       \param index         Block index (i), starting at 1 */
+    template<typename PRF>
+    void computePBKDF2Block(PRF& prf, afl::base::Bytes_t out, afl::base::ConstBytes_t salt, uint32_t numIterations, uint32_t index)
+    {
+        using afl::checksums::Hash;
+
+        // Append index to salt
+        uint8_t saltAndIndexBuffer[Hash::MAX_BLOCK_SIZE + 4];
+        afl::base::Bytes_t saltAndIndex(saltAndIndexBuffer);
+        saltAndIndex.trim(salt.size() + 4);
+        saltAndIndex.copyFrom(salt);
+        afl::bits::UInt32BE::pack(*saltAndIndex.subrange(salt.size()).eatN<4>(), index);
+
+        // Compute initial iteration and save as prev ('U_1')
+        uint8_t prevBuffer[Hash::MAX_HASH_SIZE];
+        afl::base::Bytes_t prev = prf.compute(saltAndIndex, prevBuffer);
+
+        // Save U_1 in accumulator
+        uint8_t accBuffer[Hash::MAX_HASH_SIZE];
+        afl::base::Bytes_t(accBuffer).copyFrom(prev);
+
+        // Compute following iterations
+        for (uint32_t i = 1; i < numIterations; ++i) {
+            // Compute 'U_i+1 = PRF(password, U_i)'
+            uint8_t nextBuffer[Hash::MAX_HASH_SIZE];
+            afl::base::ConstBytes_t next = prf.compute(prev, nextBuffer);
+
+            // Set 'acc ^= U_i+1' and new 'U_i' for next iteration
+            assert(next.size() == prev.size());
+            for (size_t i = 0, n = next.size(); i < n; ++i) {
+                accBuffer[i] ^= nextBuffer[i];
+                prevBuffer[i] = nextBuffer[i];
+            }
+        }
+
+        // Store result
+        out.copyFrom(accBuffer);
+    }
+
+    /* Compute a share of the blocks of PBKDF2 output: every step'th block, starting at start. */
+    template<typename PRF>
+    void computePBKDF2Blocks(PRF& prf, afl::base::Bytes_t out, afl::base::ConstBytes_t salt, uint32_t numIterations, size_t start, size_t step)
+    {
+        const size_t blockSize = prf.getHashSize();
+        for (size_t i = start; i * blockSize < out.size(); i += step) {
+            computePBKDF2Block(prf, out.subrange(i * blockSize, blockSize), salt, numIterations, uint32_t(i+1));
+        }
+    }
+
+    /* Worker thread for PBKDF2 */
+    class PBKDF2Worker : public afl::base::Stoppable {
+     public:
+        PBKDF2Worker(const afl::checksums::HMAC& hmac, afl::base::Bytes_t out, afl::base::ConstBytes_t salt, uint32_t numIterations, size_t start, size_t step)
+            : m_prf(hmac), m_out(out), m_salt(salt), m_numIterations(numIterations), m_start(start), m_step(step)
+            { }
+        virtual void run()
+            { computePBKDF2Blocks(m_prf, m_out, m_salt, m_numIterations, m_start, m_step); }
+        virtual void stop()
+            { }
+     private:
+        KeyedPRF m_prf;
+        afl::base::Bytes_t m_out;
+        afl::base::ConstBytes_t m_salt;
+        uint32_t m_numIterations;
+        size_t m_start;
+        size_t m_step;
+    };
+}
 
 // Maximum size
 const size_t afl::checksums::Hash::MAX_HASH_SIZE;
@@ -65,53 +178,59 @@ afl::checksums::Hash::computeHMAC(ConstBytes_t key, ConstBytes_t data)
 
 // Compute PBKDF2
 void
-afl::checksums::Hash::computePBKDF2(Bytes_t out, ConstBytes_t password, ConstBytes_t salt, uint32_t numIterations)
+afl::checksums::Hash::computePBKDF2(Bytes_t out, ConstBytes_t password, ConstBytes_t salt, uint32_t numIterations, size_t numThreads)
 {
-    // Make room for salt/count
-    uint8_t saltAndIndexBuffer[MAX_BLOCK_SIZE + 4];
-    Bytes_t saltAndIndex(saltAndIndexBuffer);
-    saltAndIndex.trim(salt.size() + 4);
-    saltAndIndex.copyFrom(salt);
-    afl::bits::UInt32BE::Bytes_t* pIndex = saltAndIndex.subrange(salt.size()).eatN<4>();
-    if (!pIndex) {
+    if (salt.size() > MAX_BLOCK_SIZE) {
         throw afl::except::UnsupportedException("pbkdf2");
     }
 
-    // Compute blocks of output (T_i) until no more room.
-    uint32_t index = 0;
-    while (!out.empty()) {
-        // Append index to salt
-        ++index;
-        afl::bits::UInt32BE::pack(*pIndex, index);
-
-        // Compute initial iteration and save as prev ('U_1')
-        computeHMAC(password, saltAndIndex);
-        uint8_t prevBuffer[MAX_HASH_SIZE];
-        Bytes_t prev = getHash(prevBuffer);
+    // Compute blocks of output (T_i); each thread computes every n'th block.
+    // The calling thread is one of them; start additional threads only if there is more than one block.
+    const size_t blockSize = getHashSize();
+    const size_t numBlocks = (out.size() + blockSize - 1) / blockSize;
+    size_t numWorkers = std::min(numThreads, numBlocks);
+    if (numWorkers > 0) {
+        --numWorkers;
+    }
 
-        // Save U_1 in accumulator
-        uint8_t accBuffer[MAX_HASH_SIZE];
-        Bytes_t(accBuffer).copyFrom(prev);
+    // Pseudo-random function, keyed once for all blocks and iterations.
+    // Hashes that cannot be cloned use computeHMAC() for every iteration, in the calling thread.
+    std::auto_ptr<HMAC> hmac;
+    std::auto_ptr<PBKDF2Worker> self;
+    try {
+        hmac.reset(new HMAC(*this, password));
+        self.reset(new PBKDF2Worker(*hmac, out, salt, numIterations, 0, numWorkers+1));
+    }
+    catch (afl::except::UnsupportedException&) {
+        SimplePRF prf(*this, password);
+        computePBKDF2Blocks(prf, out, salt, numIterations, 0, 1);
+        return;
+    }
 
-        // Compute following iterations
-        for (uint32_t i = 1; i < numIterations; ++i) {
-            // Compute 'U_i+1 = PRF(password, U_i)'
-            computeHMAC(password, prev);
-            uint8_t nextBuffer[MAX_HASH_SIZE];
-            ConstBytes_t next = getHash(nextBuffer);
+    afl::container::PtrVector<PBKDF2Worker> workers;
+    afl::container::PtrVector<afl::sys::Thread> threads;
+    for (size_t i = 0; i < numWorkers; ++i) {
+        PBKDF2Worker* w = workers.pushBackNew(new PBKDF2Worker(*hmac, out, salt, numIterations, i+1, numWorkers+1));
+        threads.pushBackNew(new afl::sys::Thread("PBKDF2", *w))->start();
+    }
+    self->run();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->join();
+    }
+}
 
-            // Set 'acc ^= U_i+1' and new 'U_i' for next iteration
-            assert(next.size() == prev.size());
-            for (size_t i = 0, n = next.size(); i < n; ++i) {
-                accBuffer[i] ^= nextBuffer[i];
-                prevBuffer[i] = nextBuffer[i];
-            }
-        }
+// Clone
+afl::checksums::Hash*
+afl::checksums::Hash::clone() const
+{
+    throw afl::except::UnsupportedException("clone");
+}
 
-        // Store result
-        assert(prev.size() != 0);
-        out.split(prev.size()).copyFrom(accBuffer);
-    }
+// Copy state
+void
+afl::checksums::Hash::assign(const Hash& /*other*/)
+{
+    throw afl::except::UnsupportedException("assign");
 }
 
 // Get as hex string
@@ -101,6 +101,26 @@ namespace afl { namespace checksums {
             \return Buffer containing the hash (a subrange of %data, possibly truncated). */
         virtual Bytes_t getHash(Bytes_t data) const = 0;
 
+        /** Clone this hash.
+            Creates a new hash object of the same type, with the same state.
+            Adding data to either object does not affect the other.
+            This allows precomputing a common prefix (see HMAC).
+
+            The default implementation throws; all hashes provided by this library implement it.
+            \return newly-allocated hash
+            \throw afl::except::UnsupportedException if this hash cannot be cloned */
+        virtual Hash* clone() const;
+
+        /** Copy state of another hash.
+            Makes this hash's state identical to %other's, without allocating memory.
+            This allows repeatedly resetting a working object to a precomputed prefix (see HMAC).
+
+            The default implementation throws; all hashes provided by this library implement it.
+            \param other Hash of the same type
+            \throw afl::except::UnsupportedException if this hash does not support copying state,
+            or %other has a different type */
+        virtual void assign(const Hash& other);
+
 
         /*
          *  Concrete methods
@@ -128,8 +148,13 @@ namespace afl { namespace checksums {
 
         /** Compute PBKDF2 (Password-Based Key Derivation Function Two).
             This is a standardized generic mechanism to create a password hash or key from password and salt.
-            It uses the current hash's HMAC (computeHMAC()) as pseudo-random function.
+            It uses the current hash's HMAC (see class HMAC) as pseudo-random function.
             It can generate arbitrarily large password hashes ((2**32-1) * getHashSize(), actually).
+            Each getHashSize() bytes of output are computed independently,
+            so these can be distributed to multiple threads.
+
+            This hash object's state is not modified, unless the hash does not support clone() and assign().
+            Such hashes use computeHMAC() on this object, in the calling thread only.
 
             Specification reference: RFC 2898, RFC 6070.
 
@@ -138,11 +163,12 @@ namespace afl { namespace checksums {
             \param password [in] Password.
             \param salt [in] Salt. This implementation supports at most MAX_BLOCK_SIZE bytes in a salt.
             \param numIterations [in] Number of iterations, system parameter.
+            \param numThreads [in] Maximum number of threads to use, including the calling thread.
 
             \todo PBKDF2 would allow larger block sizes than MAX_BLOCK_SIZE.
             One way around that limitation would be to regularily hash salt/iteration if they get too large,
             because that's what HMAC will do anyway. */
-        void computePBKDF2(Bytes_t out, ConstBytes_t password, ConstBytes_t salt, uint32_t numIterations);
+        void computePBKDF2(Bytes_t out, ConstBytes_t password, ConstBytes_t salt, uint32_t numIterations, size_t numThreads = 1);
 
         /** Get hash as hex string.
             This format is conventionally used to pass hashes around.
@@ -0,0 +1,94 @@
+/**
+  *  \file afl/checksums/hmac.cpp
+  *  \brief Class afl::checksums::HMAC
+  */
+
+#include "afl/checksums/hmac.hpp"
+#include "afl/except/unsupportedexception.hpp"
+
+afl::checksums::HMAC::HMAC(const Hash& hash, ConstBytes_t key)
+    : m_inner(hash.clone()),
+      m_outer()
+{
+    uint8_t k_ipad[Hash::MAX_BLOCK_SIZE];
+    uint8_t k_opad[Hash::MAX_BLOCK_SIZE];
+    uint8_t tmp[Hash::MAX_HASH_SIZE];
+
+    // HMAC only works for hashes of up to 64 bytes
+    const size_t hashSize = hash.getHashSize();
+    const size_t blockSize = hash.getBlockSize();
+    if (hashSize > Hash::MAX_HASH_SIZE || blockSize > Hash::MAX_BLOCK_SIZE || hashSize > blockSize) {
+        throw afl::except::UnsupportedException("hmac");
+    }
+
+    // If key is longer than block size, replace it by hash
+    if (key.size() > blockSize) {
+        m_inner->clear();
+        m_inner->add(key);
+        key = m_inner->getHash(tmp);
+    }
+
+    // Prepare k_ipad, k_opad
+    Bytes_t(k_ipad).fill(0);
+    Bytes_t(k_ipad).copyFrom(key);
+    Bytes_t(k_opad).copyFrom(k_ipad);
+    for (size_t i = 0; i < sizeof(k_ipad); ++i) {
+        k_ipad[i] ^= 0x36;
+        k_opad[i] ^= 0x5C;
+    }
+
+    // Keyed states
+    m_inner->clear();
+    m_outer.reset(m_inner->clone());
+    m_inner->add(Bytes_t(k_ipad).trim(blockSize));
+    m_outer->add(Bytes_t(k_opad).trim(blockSize));
+}
+
+afl::checksums::HMAC::~HMAC()
+{ }
+
+afl::checksums::HMAC::Bytes_t
+afl::checksums::HMAC::compute(ConstBytes_t data, Bytes_t out) const
+{
+    uint8_t tmp[Hash::MAX_HASH_SIZE];
+
+    // Perform inner hash
+    std::auto_ptr<Hash> h(m_inner->clone());
+    h->add(data);
+    ConstBytes_t digest = h->getHash(tmp);
+
+    // Perform outer hash
+    h.reset(m_outer->clone());
+    h->add(digest);
+    return h->getHash(out);
+}
+
+afl::checksums::HMAC::Bytes_t
+afl::checksums::HMAC::compute(ConstBytes_t data, Bytes_t out, Hash& work) const
+{
+    uint8_t tmp[Hash::MAX_HASH_SIZE];
+
+    // Perform inner hash
+    work.assign(*m_inner);
+    work.add(data);
+    ConstBytes_t digest = work.getHash(tmp);
+
+    // Perform outer hash
+    work.assign(*m_outer);
+    work.add(digest);
+    return work.getHash(out);
+}
+
+afl::checksums::Hash*
+afl::checksums::HMAC::createWorkHash() const
+{
+    std::auto_ptr<Hash> h(m_inner->clone());
+    h->assign(*m_outer);
+    return h.release();
+}
+
+size_t
+afl::checksums::HMAC::getHashSize() const
+{
+    return m_outer->getHashSize();
+}
@@ -0,0 +1,71 @@
+/**
+  *  \file afl/checksums/hmac.hpp
+  *  \brief Class afl::checksums::HMAC
+  */
+#ifndef AFL_AFL_CHECKSUMS_HMAC_HPP
+#define AFL_AFL_CHECKSUMS_HMAC_HPP
+
+#include <memory>
+#include "afl/base/uncopyable.hpp"
+#include "afl/checksums/hash.hpp"
+
+namespace afl { namespace checksums {
+
+    /** HMAC with precomputed key.
+        Hash::computeHMAC() hashes the padded key twice for every message,
+        which is as expensive as the message itself for short messages.
+        This class does that once, in the constructor, and keeps the keyed inner and outer hash states.
+        compute() then only needs to hash the message and the inner digest.
+        This is useful when computing many HMACs with the same key, as PBKDF2 does.
+
+        compute() does not modify the object and can therefore be called from multiple threads at once.
+
+        Specification reference: RFC 2104. */
+    class HMAC : public afl::base::Uncopyable {
+     public:
+        typedef Hash::ConstBytes_t ConstBytes_t;
+        typedef Hash::Bytes_t Bytes_t;
+
+        /** Constructor.
+            \param hash Hash function to use. The object's state is not used or modified.
+            \param key  Secret key
+            \throw afl::except::UnsupportedException if the hash function is not supported (see Hash::computeHMAC())
+            or cannot be cloned (see Hash::clone()) */
+        HMAC(const Hash& hash, ConstBytes_t key);
+
+        /** Destructor. */
+        ~HMAC();
+
+        /** Compute HMAC.
+            \param data Data to sign
+            \param out  Buffer for the HMAC, should be getHashSize() bytes or more
+            \return Buffer containing the HMAC (a subrange of %out, possibly truncated; see Hash::getHash()) */
+        Bytes_t compute(ConstBytes_t data, Bytes_t out) const;
+
+        /** Compute HMAC, using a working hash.
+            Unlike compute(ConstBytes_t,Bytes_t), this does not allocate memory,
+            which makes a difference for many short messages, as in PBKDF2.
+            Each thread needs its own working hash.
+            \param data Data to sign
+            \param out  Buffer for the HMAC, should be getHashSize() bytes or more
+            \param work Working hash, created by createWorkHash(). Its state is overwritten.
+            \return Buffer containing the HMAC (a subrange of %out, possibly truncated; see Hash::getHash()) */
+        Bytes_t compute(ConstBytes_t data, Bytes_t out, Hash& work) const;
+
+        /** Create working hash for compute(ConstBytes_t,Bytes_t,Hash&).
+            \return newly-allocated hash
+            \throw afl::except::UnsupportedException if the hash function does not support Hash::assign() */
+        Hash* createWorkHash() const;
+
+        /** Get size of HMAC in bytes.
+            \return size (same as hash function's Hash::getHashSize()) */
+        size_t getHashSize() const;
+
+     private:
+        std::auto_ptr<Hash> m_inner;
+        std::auto_ptr<Hash> m_outer;
+    };
+
+} }
+
+#endif
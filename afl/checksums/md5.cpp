@@ -28,11 +28,13 @@
   */
 
 #include <cstdlib>
+#include <typeinfo>
 #include "afl/checksums/md5.hpp"
 #include "afl/bits/pack.hpp"
 #include "afl/bits/uint32le.hpp"
 #include "afl/bits/rotate.hpp"
 #include "afl/bits/uint64le.hpp"
+#include "afl/except/unsupportedexception.hpp"
 
 const size_t afl::checksums::MD5::HASH_SIZE;
 
@@ -195,6 +197,21 @@ afl::checksums::MD5::getHash(Bytes_t data) const
     return data.copyFrom(digest);
 }
 
+afl::checksums::MD5*
+afl::checksums::MD5::clone() const
+{
+    return new MD5(*this);
+}
+
+void
+afl::checksums::MD5::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    *this = static_cast<const MD5&>(other);
+}
+
 // MD5 basic transformation.
 void
 afl::checksums::MD5::transform(State_t& state, const Block_t& block)
@@ -0,0 +1,397 @@
+/**
+  *  \file afl/checksums/parallelhasher.cpp
+  *  \brief Class afl::checksums::ParallelHasher
+  *
+  *  The stream is cut into chunks. A ring of jobs, one chunk each, is processed by the workers;
+  *  the calling thread retires jobs in order, and resubmits each retired job for the chunk one ring-size ahead.
+  *
+  *  Locking: m_queueMutex protects m_queue and m_stop.
+  *  A Job is owned by the calling thread except between being queued and having its done semaphore posted.
+  */
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include "afl/checksums/parallelhasher.hpp"
+#include "afl/base/growablememory.hpp"
+#include "afl/base/ptr.hpp"
+#include "afl/base/stoppable.hpp"
+#include "afl/container/ptrvector.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/sys/mutex.hpp"
+#include "afl/sys/mutexguard.hpp"
+#include "afl/sys/semaphore.hpp"
+#include "afl/sys/thread.hpp"
+
+using afl::io::Stream;
+
+namespace {
+    /* Node of a tree hash under construction */
+    struct Node {
+        uint8_t digest[afl::checksums::Hash::MAX_HASH_SIZE];
+        size_t size;
+        uint64_t numLeaves;
+    };
+
+    /* Merge the two topmost nodes of the stack into one */
+    void mergeNodes(afl::checksums::Hash& hash, std::vector<Node>& stack)
+    {
+        static const uint8_t NODE_PREFIX[] = { 1 };
+        Node& left = stack[stack.size()-2];
+        const Node& right = stack.back();
+        hash.clear();
+        hash.add(NODE_PREFIX);
+        hash.add(afl::base::ConstBytes_t::unsafeCreate(left.digest, left.size));
+        hash.add(afl::base::ConstBytes_t::unsafeCreate(right.digest, right.size));
+        left.size = hash.getHash(left.digest).size();
+        left.numLeaves += right.numLeaves;
+        stack.pop_back();
+    }
+}
+
+/*
+ *  Engine
+ */
+
+class afl::checksums::ParallelHasher::Engine {
+ public:
+    enum Mode {
+        ReadOnly,               ///< Only read chunks.
+        LeafHash,               ///< Compute tree hash leaf (digest).
+        Checksum                ///< Compute CRC32 (check).
+    };
+
+    struct Job {
+        uint64_t index;
+        afl::base::GrowableBytes_t data;
+        uint8_t digest[Hash::MAX_HASH_SIZE];
+        size_t digestSize;
+        uint32_t check;
+        String_t error;
+        afl::sys::Semaphore done;
+
+        Job()
+            : index(0), data(), digestSize(0), check(0), error(), done(0)
+            { }
+    };
+
+    Engine(Stream& in, size_t numThreads, size_t chunkSize, Mode mode, const Hash* pHash, const CRC32* pCRC);
+    ~Engine();
+
+    const Job* getNext();
+
+ private:
+    class Worker;
+
+    // Calling thread:
+    Stream& m_in;
+    const bool m_seekable;
+    const Stream::FileSize_t m_start;
+    const size_t m_chunkSize;
+    const Mode m_mode;
+    const CRC32* const m_pCRC;
+    std::auto_ptr<Hash> m_hash;                     ///< Hash for use by calling thread if there are no workers.
+    afl::container::PtrVector<Job> m_jobs;          ///< Ring of jobs; chunk i is processed by job i % size.
+    uint64_t m_nextIndex;                           ///< Index of next chunk to retire.
+    Job* m_current;                                 ///< Job returned by getNext(), to be resubmitted.
+    bool m_end;
+
+    // Shared with workers:
+    afl::sys::Mutex m_queueMutex;
+    std::deque<Job*> m_queue;
+    afl::sys::Semaphore m_wake;
+    bool m_stop;
+
+    // Threads: must be last
+    afl::container::PtrVector<Worker> m_workers;
+    afl::container::PtrVector<afl::sys::Thread> m_threads;
+
+    void submitJob(Job& job, uint64_t index);
+    void processJob(Job& job, Stream* pStream, Hash* pHash);
+    void runWorker(Worker& w);
+};
+
+class afl::checksums::ParallelHasher::Engine::Worker : public afl::base::Stoppable {
+ public:
+    Worker(Engine& parent, afl::base::Ptr<Stream> stream, Hash* pHash)
+        : m_parent(parent), m_stream(stream), m_hash(pHash)
+        { }
+    virtual void run()
+        { m_parent.runWorker(*this); }
+    virtual void stop()
+        {
+            // Engine's destructor stops all workers at once before joining them.
+        }
+
+    Stream* getStream()
+        { return m_stream.get(); }
+    Hash* getHash()
+        { return m_hash.get(); }
+
+ private:
+    Engine& m_parent;
+    afl::base::Ptr<Stream> m_stream;
+    std::auto_ptr<Hash> m_hash;
+};
+
+afl::checksums::ParallelHasher::Engine::Engine(Stream& in, size_t numThreads, size_t chunkSize, Mode mode, const Hash* pHash, const CRC32* pCRC)
+    : m_in(in),
+      m_seekable(in.hasCapabilities(Stream::CanSeek)),
+      m_start(in.getPos()),
+      m_chunkSize(chunkSize),
+      m_mode(mode),
+      m_pCRC(pCRC),
+      m_hash(),
+      m_jobs(),
+      m_nextIndex(0),
+      m_current(0),
+      m_end(false),
+      m_queueMutex(),
+      m_queue(),
+      m_wake(0),
+      m_stop(false),
+      m_workers(),
+      m_threads()
+{
+    // Workers, each with its own stream and hash
+    for (size_t i = 0; i < numThreads; ++i) {
+        afl::base::Ptr<Stream> stream;
+        if (m_seekable) {
+            stream = in.createChild().asPtr();
+        }
+        Worker* w = m_workers.pushBackNew(new Worker(*this, stream, pHash != 0 ? pHash->clone() : 0));
+        m_threads.pushBackNew(new afl::sys::Thread("ParallelHasher", *w))->start();
+    }
+    if (numThreads == 0 && pHash != 0) {
+        m_hash.reset(pHash->clone());
+    }
+
+    // Jobs
+    const size_t numJobs = (numThreads == 0 ? 1 : 2*numThreads);
+    for (size_t i = 0; i < numJobs; ++i) {
+        submitJob(*m_jobs.pushBackNew(new Job()), i);
+    }
+}
+
+afl::checksums::ParallelHasher::Engine::~Engine()
+{
+    {
+        afl::sys::MutexGuard g(m_queueMutex);
+        m_stop = true;
+    }
+    for (size_t i = 0, n = m_threads.size(); i < n; ++i) {
+        m_wake.post();
+    }
+    m_threads.clear();
+}
+
+/** Get next chunk, in order.
+    \return Job describing the chunk; valid until the next call. Null at end of stream.
+    \throw afl::except::FileProblemException on read error */
+const afl::checksums::ParallelHasher::Engine::Job*
+afl::checksums::ParallelHasher::Engine::getNext()
+{
+    // Resubmit previous job for the next chunk it is responsible for
+    if (m_current != 0) {
+        Job& prev = *m_current;
+        m_current = 0;
+        if (!m_end) {
+            submitJob(prev, prev.index + m_jobs.size());
+        }
+    }
+    if (m_end) {
+        return 0;
+    }
+
+    // Wait for next job
+    Job& job = *m_jobs[size_t(m_nextIndex % m_jobs.size())];
+    job.done.wait();
+    if (!job.error.empty()) {
+        m_end = true;
+        throw afl::except::FileProblemException(m_in, job.error);
+    }
+    ++m_nextIndex;
+    if (job.data.size() < m_chunkSize) {
+        m_end = true;
+    }
+    m_current = &job;
+    return &job;
+}
+
+/** Submit a job.
+    If the stream is not seekable, reads the chunk now; chunks are submitted in order.
+    \param job   Job
+    \param index Chunk index */
+void
+afl::checksums::ParallelHasher::Engine::submitJob(Job& job, uint64_t index)
+{
+    job.index = index;
+    job.error.clear();
+    if (!m_seekable) {
+        try {
+            size_t got = 0;
+            job.data.resize(m_chunkSize);
+            while (got < m_chunkSize) {
+                size_t n = m_in.read(job.data.subrange(got));
+                if (n == 0) {
+                    break;
+                }
+                got += n;
+            }
+            job.data.resize(got);
+        }
+        catch (std::exception& e) {
+            job.error = e.what();
+        }
+    }
+
+    if (m_threads.empty()) {
+        processJob(job, m_seekable ? &m_in : 0, m_hash.get());
+    } else {
+        {
+            afl::sys::MutexGuard g(m_queueMutex);
+            m_queue.push_back(&job);
+        }
+        m_wake.post();
+    }
+}
+
+/** Process a job.
+    Runs in a worker thread, or in the calling thread if there are no workers.
+    \param job     Job
+    \param pStream Stream to read the chunk from; null if it has already been read
+    \param pHash   Hash to compute leaf hash with (LeafHash mode) */
+void
+afl::checksums::ParallelHasher::Engine::processJob(Job& job, Stream* pStream, Hash* pHash)
+{
+    if (job.error.empty()) {
+        try {
+            // Read
+            if (pStream != 0) {
+                size_t got = 0;
+                job.data.resize(m_chunkSize);
+                while (got < m_chunkSize) {
+                    size_t n = pStream->readAt(m_start + job.index * m_chunkSize + got, job.data.subrange(got));
+                    if (n == 0) {
+                        break;
+                    }
+                    got += n;
+                }
+                job.data.resize(got);
+            }
+
+            // Compute
+            switch (m_mode) {
+             case ReadOnly:
+                break;
+
+             case LeafHash: {
+                static const uint8_t LEAF_PREFIX[] = { 0 };
+                pHash->clear();
+                pHash->add(LEAF_PREFIX);
+                pHash->add(job.data);
+                job.digestSize = pHash->getHash(job.digest).size();
+                break;
+             }
+
+             case Checksum:
+                job.check = m_pCRC->add(job.data, 0);
+                break;
+            }
+        }
+        catch (std::exception& e) {
+            job.error = e.what();
+        }
+    }
+    job.done.post();
+}
+
+/** Worker thread main loop. */
+void
+afl::checksums::ParallelHasher::Engine::runWorker(Worker& w)
+{
+    while (1) {
+        m_wake.wait();
+        Job* job;
+        {
+            afl::sys::MutexGuard g(m_queueMutex);
+            if (m_stop) {
+                break;
+            }
+            job = m_queue.front();
+            m_queue.pop_front();
+        }
+        processJob(*job, w.getStream(), w.getHash());
+    }
+}
+
+
+/*
+ *  ParallelHasher
+ */
+
+const size_t afl::checksums::ParallelHasher::DEFAULT_CHUNK_SIZE;
+
+afl::checksums::ParallelHasher::ParallelHasher(size_t numThreads, size_t chunkSize)
+    : m_numThreads(numThreads),
+      m_chunkSize(chunkSize == 0 ? DEFAULT_CHUNK_SIZE : chunkSize)
+{ }
+
+afl::checksums::ParallelHasher::~ParallelHasher()
+{ }
+
+void
+afl::checksums::ParallelHasher::computeHash(Hash& hash, afl::io::Stream& in)
+{
+    Engine e(in, m_numThreads, m_chunkSize, Engine::ReadOnly, 0, 0);
+    hash.clear();
+    while (const Engine::Job* job = e.getNext()) {
+        hash.add(job->data);
+    }
+}
+
+afl::checksums::Hash::Bytes_t
+afl::checksums::ParallelHasher::computeTreeHash(const Hash& hash, afl::io::Stream& in, Hash::Bytes_t out)
+{
+    Engine e(in, m_numThreads, m_chunkSize, Engine::LeafHash, &hash, 0);
+    std::auto_ptr<Hash> h(hash.clone());
+
+    // Stack of complete subtrees, sizes decreasing from bottom to top
+    std::vector<Node> stack;
+    while (const Engine::Job* job = e.getNext()) {
+        if (job->data.empty()) {
+            if (job->index == 0) {
+                // Empty stream
+                h->clear();
+                return h->getHash(out);
+            }
+            break;
+        }
+
+        Node n;
+        afl::base::Bytes_t(n.digest).copyFrom(afl::base::ConstBytes_t::unsafeCreate(job->digest, job->digestSize));
+        n.size = job->digestSize;
+        n.numLeaves = 1;
+        stack.push_back(n);
+        while (stack.size() >= 2 && stack[stack.size()-2].numLeaves == stack.back().numLeaves) {
+            mergeNodes(*h, stack);
+        }
+    }
+
+    // Merge remaining subtrees from right to left
+    while (stack.size() >= 2) {
+        mergeNodes(*h, stack);
+    }
+    return out.copyFrom(afl::base::ConstBytes_t::unsafeCreate(stack.back().digest, stack.back().size));
+}
+
+uint32_t
+afl::checksums::ParallelHasher::computeCRC32(const CRC32& crc, afl::io::Stream& in, uint32_t prev)
+{
+    Engine e(in, m_numThreads, m_chunkSize, Engine::Checksum, 0, &crc);
+    uint32_t result = prev;
+    while (const Engine::Job* job = e.getNext()) {
+        result = crc.combine(result, job->check, job->data.size());
+    }
+    return result;
+}
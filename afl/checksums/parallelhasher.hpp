@@ -0,0 +1,82 @@
+/**
+  *  \file afl/checksums/parallelhasher.hpp
+  *  \brief Class afl::checksums::ParallelHasher
+  */
+#ifndef AFL_AFL_CHECKSUMS_PARALLELHASHER_HPP
+#define AFL_AFL_CHECKSUMS_PARALLELHASHER_HPP
+
+#include "afl/base/uncopyable.hpp"
+#include "afl/checksums/crc32.hpp"
+#include "afl/checksums/hash.hpp"
+#include "afl/io/stream.hpp"
+
+namespace afl { namespace checksums {
+
+    /** Parallel hashing of streams.
+        Processes a stream (from its current position to the end) in chunks, using a pool of worker threads.
+
+        If the stream is seekable, each worker reads its chunks itself, using large positional reads (Stream::readAt())
+        through its own child stream. For operating-system files, this allows reads to proceed in parallel.
+        Otherwise, the calling thread reads the chunks in order, and workers only compute.
+
+        Three modes are offered:
+        - computeHash() computes a regular hash. Because a hash must see its input in order,
+          only reading is parallel (read-ahead); hashing happens in the calling thread.
+        - computeTreeHash() computes a tree hash where each chunk is hashed independently, in parallel.
+          This produces a different result than computeHash().
+        - computeCRC32() computes a CRC32 of each chunk in parallel, and merges them using CRC32::combine().
+          This produces the same result as a sequential computation.
+
+        At most two chunks per worker are in memory at any time. */
+    class ParallelHasher : public afl::base::Uncopyable {
+     public:
+        /** Default chunk size. */
+        static const size_t DEFAULT_CHUNK_SIZE = 1024*1024;
+
+        /** Constructor.
+            \param numThreads Number of worker threads. 0 means to do all work in the calling thread.
+            \param chunkSize  Chunk size in bytes. This is also the leaf size for computeTreeHash(). */
+        explicit ParallelHasher(size_t numThreads, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+        /** Destructor. */
+        ~ParallelHasher();
+
+        /** Compute hash.
+            Produces the same result as adding the stream's content to the hash.
+            \param hash [in/out] Hash. Will be cleared; receives the stream content. Use Hash::getHash() to obtain the result.
+            \param in   [in] Stream
+            \throw afl::except::FileProblemException on read error */
+        void computeHash(Hash& hash, afl::io::Stream& in);
+
+        /** Compute tree hash.
+            Computes a Merkle tree hash as defined in RFC 6962 section 2.1,
+            using the chunks as leaves and the given hash function:
+            - a leaf's hash is H(0x00 || chunk)
+            - an inner node's hash is H(0x01 || left || right), where left is the largest possible complete subtree
+            - an empty stream's hash is H("")
+            \param hash [in] Hash function. The object's state is not used or modified.
+            \param in   [in] Stream
+            \param out  [out] Buffer for the result, should be hash.getHashSize() bytes or more
+            \return Buffer containing the result (a subrange of %out, possibly truncated; see Hash::getHash())
+            \throw afl::except::FileProblemException on read error */
+        Hash::Bytes_t computeTreeHash(const Hash& hash, afl::io::Stream& in, Hash::Bytes_t out);
+
+        /** Compute CRC32.
+            Produces the same result as crc.add(content, prev).
+            \param crc  [in] CRC32 instance
+            \param in   [in] Stream
+            \param prev [in] Previous value
+            \return new value
+            \throw afl::except::FileProblemException on read error */
+        uint32_t computeCRC32(const CRC32& crc, afl::io::Stream& in, uint32_t prev = 0);
+
+     private:
+        class Engine;
+
+        const size_t m_numThreads;
+        const size_t m_chunkSize;
+    };
+
+} }
+
+#endif
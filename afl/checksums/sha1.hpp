@@ -27,6 +27,8 @@ namespace afl { namespace checksums {
         virtual size_t getHashSize() const;
         virtual size_t getBlockSize() const;
         virtual Bytes_t getHash(Bytes_t data) const;
+        virtual SHA1* clone() const;
+        virtual void assign(const Hash& other);
 
         static const size_t HASH_SIZE = 20;
 
@@ -3,9 +3,11 @@
   *  \brief Class afl::checksums::SHA224
   */
 
+#include <typeinfo>
 #include "afl/checksums/sha224.hpp"
 #include "afl/bits/uint32be.hpp"
 #include "afl/bits/pack.hpp"
+#include "afl/except/unsupportedexception.hpp"
 
 namespace {
     const uint32_t INIT[] = {
@@ -63,3 +65,18 @@ afl::checksums::SHA224::getHash(Bytes_t data) const
     afl::bits::packArray<afl::bits::UInt32BE>(data.trim(HASH_SIZE), copy.getState());
     return data;
 }
+
+afl::checksums::SHA224*
+afl::checksums::SHA224::clone() const
+{
+    return new SHA224(*this);
+}
+
+void
+afl::checksums::SHA224::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    m_state.assign(static_cast<const SHA224&>(other).m_state);
+}
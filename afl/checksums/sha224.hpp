@@ -28,6 +28,8 @@ namespace afl { namespace checksums {
         virtual size_t getHashSize() const;
         virtual size_t getBlockSize() const;
         virtual Bytes_t getHash(Bytes_t data) const;
+        virtual SHA224* clone() const;
+        virtual void assign(const Hash& other);
 
         static const size_t HASH_SIZE = 28;   /* 224 bits = 7x 32 bits = 7x 4 bytes */
 
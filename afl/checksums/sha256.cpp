@@ -3,9 +3,11 @@
   *  \brief Class afl::checksums::SHA256
   */
 
+#include <typeinfo>
 #include "afl/checksums/sha256.hpp"
 #include "afl/bits/uint32be.hpp"
 #include "afl/bits/pack.hpp"
+#include "afl/except/unsupportedexception.hpp"
 
 namespace {
     const uint32_t INIT[] = {
@@ -63,3 +65,36 @@ afl::checksums::SHA256::getHash(Bytes_t data) const
     afl::bits::packArray<afl::bits::UInt32BE>(data.trim(HASH_SIZE), copy.getState());
     return data;
 }
+
+afl::checksums::SHA256*
+afl::checksums::SHA256::clone() const
+{
+    return new SHA256(*this);
+}
+
+void
+afl::checksums::SHA256::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    m_state.assign(static_cast<const SHA256&>(other).m_state);
+}
+
+void
+afl::checksums::SHA256::addMultiple(afl::base::Memory<SHA256*const> hashes, afl::base::Memory<const ConstBytes_t> data)
+{
+    // Process in groups, to avoid allocating a list of all cores
+    while (!hashes.empty() && !data.empty()) {
+        SHA2Core<SHA2_32>* cores[SHA2_32::MAX_LANES];
+        size_t n = 0;
+        while (n < SHA2_32::MAX_LANES && n < data.size()) {
+            if (SHA256*const* p = hashes.eat()) {
+                cores[n++] = &(*p)->m_state;
+            } else {
+                break;
+            }
+        }
+        SHA2Core<SHA2_32>::addMultiple(cores, data.split(n).unsafeData(), n);
+    }
+}
@@ -28,6 +28,17 @@ namespace afl { namespace checksums {
         virtual size_t getHashSize() const;
         virtual size_t getBlockSize() const;
         virtual Bytes_t getHash(Bytes_t data) const;
+        virtual SHA256* clone() const;
+        virtual void assign(const Hash& other);
+
+        /** Add data to several hashes.
+            Equivalent to calling hashes[i]->add(data[i]) for each i.
+            On CPUs without SHA extensions but with AVX2, up to eight messages are processed in parallel,
+            which is considerably faster than processing them one after another.
+            This works best if all data have the same size.
+            \param hashes Hashes
+            \param data   Data to add, one entry for each hash. Size must be the same as hashes.size(). */
+        static void addMultiple(afl::base::Memory<SHA256*const> hashes, afl::base::Memory<const ConstBytes_t> data);
 
         static const size_t HASH_SIZE = 32;   /* 256 bits = 8x 32 bits = 8x 4 bytes */
 
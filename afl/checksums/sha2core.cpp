@@ -4,6 +4,9 @@
   */
 
 #include "afl/checksums/sha2core.hpp"
+#include "arch/shaaccel.hpp"
+
+const size_t afl::checksums::SHA2_32::MAX_LANES;
 
 const afl::checksums::SHA2_32::Word_t afl::checksums::SHA2_32::ks[] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
@@ -46,3 +49,21 @@ const afl::checksums::SHA2_64::Word_t afl::checksums::SHA2_64::ks[] = {
     0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
     0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
 };
+
+bool
+afl::checksums::SHA2_32::accelerate(Word_t (&hs)[8], const uint8_t* buf, size_t numBlocks)
+{
+    return processSHA256Blocks(hs, buf, numBlocks, ks);
+}
+
+bool
+afl::checksums::SHA2_32::accelerateMultiple(Word_t* const* hs, const uint8_t* const* bufs, size_t numLanes, size_t numBlocks)
+{
+    return processSHA256BlocksMulti(hs, bufs, numLanes, numBlocks, ks);
+}
+
+bool
+afl::checksums::SHA2_64::accelerate(Word_t (&hs)[8], const uint8_t* buf, size_t numBlocks)
+{
+    return processSHA512Blocks(hs, buf, numBlocks, ks);
+}
@@ -3,9 +3,11 @@
   *  \brief Class afl::checksums::SHA384
   */
 
+#include <typeinfo>
 #include "afl/checksums/sha384.hpp"
 #include "afl/bits/uint64be.hpp"
 #include "afl/bits/pack.hpp"
+#include "afl/except/unsupportedexception.hpp"
 
 namespace {
     const uint64_t INIT[] = {
@@ -63,3 +65,18 @@ afl::checksums::SHA384::getHash(Bytes_t data) const
     afl::bits::packArray<afl::bits::UInt64BE>(data.trim(HASH_SIZE), copy.getState());
     return data;
 }
+
+afl::checksums::SHA384*
+afl::checksums::SHA384::clone() const
+{
+    return new SHA384(*this);
+}
+
+void
+afl::checksums::SHA384::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    m_state.assign(static_cast<const SHA384&>(other).m_state);
+}
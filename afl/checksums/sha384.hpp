@@ -28,6 +28,8 @@ namespace afl { namespace checksums {
         virtual size_t getHashSize() const;
         virtual size_t getBlockSize() const;
         virtual Bytes_t getHash(Bytes_t data) const;
+        virtual SHA384* clone() const;
+        virtual void assign(const Hash& other);
 
         static const size_t HASH_SIZE = 48;   /* 384 bits = 6x 64 bits = 6x 8 bytes */
 
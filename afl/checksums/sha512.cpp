@@ -3,9 +3,11 @@
   *  \brief Class afl::checksums::SHA512
   */
 
+#include <typeinfo>
 #include "afl/checksums/sha512.hpp"
 #include "afl/bits/uint64be.hpp"
 #include "afl/bits/pack.hpp"
+#include "afl/except/unsupportedexception.hpp"
 
 namespace {
     const uint64_t INIT[] = {
@@ -63,3 +65,18 @@ afl::checksums::SHA512::getHash(Bytes_t data) const
     afl::bits::packArray<afl::bits::UInt64BE>(data.trim(HASH_SIZE), copy.getState());
     return data;
 }
+
+afl::checksums::SHA512*
+afl::checksums::SHA512::clone() const
+{
+    return new SHA512(*this);
+}
+
+void
+afl::checksums::SHA512::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    m_state.assign(static_cast<const SHA512&>(other).m_state);
+}
@@ -0,0 +1,222 @@
+/**
+  *  \file afl/checksums/xxhash64.cpp
+  *  \brief Class afl::checksums::XXHash64
+  */
+
+#include <algorithm>
+#include <cstring>
+#include <typeinfo>
+#include "afl/checksums/xxhash64.hpp"
+#include "afl/bits/rotate.hpp"
+#include "afl/bits/uint32le.hpp"
+#include "afl/bits/uint64le.hpp"
+#include "afl/bits/uint64be.hpp"
+#include "afl/except/unsupportedexception.hpp"
+
+namespace {
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    const size_t BLOCK_SIZE = afl::checksums::XXHash64::BLOCK_SIZE;
+
+    /* Read little-endian words from unaligned memory */
+    inline uint64_t read64(const uint8_t* p)
+    {
+        return afl::bits::UInt64LE::unpack(*reinterpret_cast<const afl::bits::UInt64LE::Bytes_t*>(p));
+    }
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        return afl::bits::UInt32LE::unpack(*reinterpret_cast<const afl::bits::UInt32LE::Bytes_t*>(p));
+    }
+
+    /* Mix one input word into an accumulator */
+    inline uint64_t mixRound(uint64_t acc, uint64_t input)
+    {
+        return afl::bits::rotateLeft64(acc + input * PRIME2, 31) * PRIME1;
+    }
+
+    /* Merge an accumulator into the result */
+    inline uint64_t mergeRound(uint64_t h, uint64_t acc)
+    {
+        return (h ^ mixRound(0, acc)) * PRIME1 + PRIME4;
+    }
+
+    /* Initialize accumulators */
+    void initState(uint64_t (&state)[4], uint64_t seed)
+    {
+        state[0] = seed + PRIME1 + PRIME2;
+        state[1] = seed + PRIME2;
+        state[2] = seed;
+        state[3] = seed - PRIME1;
+    }
+
+    /* Process a sequence of whole blocks. Returns pointer after the last block. */
+    const uint8_t* processBlocks(uint64_t (&state)[4], const uint8_t* p, size_t numBlocks)
+    {
+        // Keep the accumulators in local variables so the compiler can keep them in registers
+        uint64_t v1 = state[0], v2 = state[1], v3 = state[2], v4 = state[3];
+        while (numBlocks > 0) {
+            v1 = mixRound(v1, read64(p));
+            v2 = mixRound(v2, read64(p+8));
+            v3 = mixRound(v3, read64(p+16));
+            v4 = mixRound(v4, read64(p+24));
+            p += BLOCK_SIZE;
+            --numBlocks;
+        }
+        state[0] = v1; state[1] = v2; state[2] = v3; state[3] = v4;
+        return p;
+    }
+
+    /* Compute final value from accumulators, total length, and remaining (less than BLOCK_SIZE) bytes */
+    uint64_t finish(const uint64_t (&state)[4], uint64_t seed, uint64_t length, const uint8_t* p, size_t remain)
+    {
+        uint64_t h;
+        if (length >= BLOCK_SIZE) {
+            h = afl::bits::rotateLeft64(state[0], 1)
+                + afl::bits::rotateLeft64(state[1], 7)
+                + afl::bits::rotateLeft64(state[2], 12)
+                + afl::bits::rotateLeft64(state[3], 18);
+            h = mergeRound(h, state[0]);
+            h = mergeRound(h, state[1]);
+            h = mergeRound(h, state[2]);
+            h = mergeRound(h, state[3]);
+        } else {
+            h = seed + PRIME5;
+        }
+        h += length;
+
+        // Tail
+        while (remain >= 8) {
+            h ^= mixRound(0, read64(p));
+            h = afl::bits::rotateLeft64(h, 27) * PRIME1 + PRIME4;
+            p += 8;
+            remain -= 8;
+        }
+        if (remain >= 4) {
+            h ^= read32(p) * PRIME1;
+            h = afl::bits::rotateLeft64(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+            remain -= 4;
+        }
+        while (remain > 0) {
+            h ^= *p * PRIME5;
+            h = afl::bits::rotateLeft64(h, 11) * PRIME1;
+            ++p;
+            --remain;
+        }
+
+        // Avalanche
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+}
+
+const size_t afl::checksums::XXHash64::HASH_SIZE;
+const size_t afl::checksums::XXHash64::BLOCK_SIZE;
+
+afl::checksums::XXHash64::XXHash64(uint64_t seed)
+    : m_seed(seed)
+{
+    XXHash64::clear();
+}
+
+afl::checksums::XXHash64::~XXHash64()
+{ }
+
+void
+afl::checksums::XXHash64::clear()
+{
+    initState(m_state, m_seed);
+    m_length = 0;
+    m_bufferFill = 0;
+}
+
+void
+afl::checksums::XXHash64::add(ConstBytes_t data)
+{
+    const uint8_t* p = data.unsafeData();
+    size_t n = data.size();
+    m_length += n;
+
+    // Complete a partial block
+    if (m_bufferFill != 0 && n != 0) {
+        size_t now = std::min(n, BLOCK_SIZE - m_bufferFill);
+        std::memcpy(m_buffer + m_bufferFill, p, now);
+        m_bufferFill += now;
+        p += now;
+        n -= now;
+        if (m_bufferFill < BLOCK_SIZE) {
+            return;
+        }
+        processBlocks(m_state, m_buffer, 1);
+        m_bufferFill = 0;
+    }
+
+    // Process whole blocks directly
+    p = processBlocks(m_state, p, n / BLOCK_SIZE);
+    n %= BLOCK_SIZE;
+
+    // Keep the rest
+    if (n != 0) {
+        std::memcpy(m_buffer, p, n);
+        m_bufferFill = n;
+    }
+}
+
+size_t
+afl::checksums::XXHash64::getHashSize() const
+{
+    return HASH_SIZE;
+}
+
+size_t
+afl::checksums::XXHash64::getBlockSize() const
+{
+    return BLOCK_SIZE;
+}
+
+afl::checksums::Hash::Bytes_t
+afl::checksums::XXHash64::getHash(Bytes_t data) const
+{
+    afl::bits::UInt64BE::Bytes_t bytes;
+    afl::bits::UInt64BE::pack(bytes, getValue());
+    return data.trim(HASH_SIZE).copyFrom(bytes);
+}
+
+afl::checksums::XXHash64*
+afl::checksums::XXHash64::clone() const
+{
+    return new XXHash64(*this);
+}
+
+void
+afl::checksums::XXHash64::assign(const Hash& other)
+{
+    if (typeid(other) != typeid(*this)) {
+        throw afl::except::UnsupportedException("assign");
+    }
+    *this = static_cast<const XXHash64&>(other);
+}
+
+uint64_t
+afl::checksums::XXHash64::getValue() const
+{
+    return finish(m_state, m_seed, m_length, m_buffer, m_bufferFill);
+}
+
+uint64_t
+afl::checksums::XXHash64::compute(ConstBytes_t data, uint64_t seed)
+{
+    uint64_t state[4];
+    initState(state, seed);
+    const uint8_t* p = processBlocks(state, data.unsafeData(), data.size() / BLOCK_SIZE);
+    return finish(state, seed, data.size(), p, data.size() % BLOCK_SIZE);
+}
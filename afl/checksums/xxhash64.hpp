@@ -0,0 +1,66 @@
+/**
+  *  \file afl/checksums/xxhash64.hpp
+  *  \brief Class afl::checksums::XXHash64
+  */
+#ifndef AFL_AFL_CHECKSUMS_XXHASH64_HPP
+#define AFL_AFL_CHECKSUMS_XXHASH64_HPP
+
+#include "afl/checksums/hash.hpp"
+
+namespace afl { namespace checksums {
+
+    /** XXH64 non-cryptographic hash.
+        XXH64 takes an arbitrary number of bytes and a 64-bit seed and produces a 64-bit hash.
+        It is much faster than the cryptographic hashes and has good distribution,
+        making it suitable for hash tables, deduplication and integrity checks against accidental damage.
+
+        It is NOT suitable to protect against deliberate manipulation.
+        If hash table keys come from an untrusted source, use a secret or random seed
+        to make it harder to construct colliding keys.
+
+        The Hash interface produces the canonical (big-endian) representation of the hash value.
+        Use getValue() or compute() to obtain the value as an integer.
+
+        Specification reference: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md */
+    class XXHash64 : public Hash {
+     public:
+        /** Constructor. Makes a blank hash.
+            \param seed Seed */
+        explicit XXHash64(uint64_t seed = 0);
+
+        /** Destructor. */
+        ~XXHash64();
+
+        // Hash:
+        virtual void clear();
+        virtual void add(ConstBytes_t data);
+        virtual size_t getHashSize() const;
+        virtual size_t getBlockSize() const;
+        virtual Bytes_t getHash(Bytes_t data) const;
+        virtual XXHash64* clone() const;
+        virtual void assign(const Hash& other);
+
+        /** Get hash value.
+            \return hash value of data added so far */
+        uint64_t getValue() const;
+
+        /** Compute hash value of a block of data (one-shot).
+            \param data Data
+            \param seed Seed
+            \return hash value; same as XXHash64(seed).add(data).getValue() */
+        static uint64_t compute(ConstBytes_t data, uint64_t seed = 0);
+
+        static const size_t HASH_SIZE = 8;    /* 64 bits */
+        static const size_t BLOCK_SIZE = 32;  /* 4 lanes x 64 bits */
+
+     private:
+        uint64_t m_seed;
+        uint64_t m_state[4];
+        uint64_t m_length;
+        uint8_t m_buffer[BLOCK_SIZE];
+        size_t m_bufferFill;
+    };
+
+} }
+
+#endif
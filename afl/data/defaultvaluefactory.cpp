@@ -55,6 +55,16 @@ afl::data::DefaultValueFactory::createHash(NameMap& keys, Segment& values)
     return new HashValue(pHash);
 }
 
+afl::data::Value*
+afl::data::DefaultValueFactory::createHash(const afl::base::Ref<const NameMap>& keys, Segment& values)
+{
+    // Create hash
+    afl::base::Ref<Hash> pHash(Hash::create(keys, values));
+
+    // Create object
+    return new HashValue(pHash);
+}
+
 afl::data::Value*
 afl::data::DefaultValueFactory::createVector(Segment& values)
 {
@@ -21,6 +21,7 @@ namespace afl { namespace data {
         virtual Value* createFloat(double fv);
         virtual Value* createBoolean(bool bv);
         virtual Value* createHash(NameMap& keys, Segment& values);
+        virtual Value* createHash(const afl::base::Ref<const NameMap>& keys, Segment& values);
         virtual Value* createVector(Segment& values);
         virtual Value* createError(const String_t& source, const String_t& str);
         virtual Value* createNull();
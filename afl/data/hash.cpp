@@ -15,14 +15,23 @@ afl::data::Hash::Ref_t
 afl::data::Hash::create(NameMap& keys, Segment& values)
 {
     Ref_t hash = *new Hash();
-    hash->m_keys.swap(keys);
+    hash->modifyKeys().swap(keys);
+    hash->m_values.swap(values);
+    return *hash;
+}
+
+afl::data::Hash::Ref_t
+afl::data::Hash::create(const SharedKeys_t& keys, Segment& values)
+{
+    Ref_t hash = *new Hash();
+    hash->m_keys.reset(*keys);
     hash->m_values.swap(values);
     return *hash;
 }
 
 inline
 afl::data::Hash::Hash()
-    : m_keys(),
+    : m_keys(*new NameMap()),
       m_values()
 { }
 
@@ -40,7 +49,10 @@ afl::data::Hash::setNew(const String_t& key, Value* value)
 {
     NameMap::Index_t index;
     try {
-        index = m_keys.addMaybe(key);
+        index = m_keys->getIndexByName(key);
+        if (index == NameMap::nil) {
+            index = modifyKeys().add(key);
+        }
     }
     catch (...) {
         delete value;
@@ -53,13 +65,13 @@ afl::data::Hash::setNew(const String_t& key, Value* value)
 afl::data::Value*
 afl::data::Hash::get(const String_t& key) const
 {
-    return m_values[m_keys.getIndexByName(key)];
+    return m_values[m_keys->getIndexByName(key)];
 }
 
 bool
 afl::data::Hash::getIndexByKey(const NameQuery& key, Index_t& index) const
 {
-    Index_t i = m_keys.getIndexByName(key);
+    Index_t i = m_keys->getIndexByName(key);
     if (i != NameMap::nil) {
         index = i;
         return true;
@@ -88,6 +100,12 @@ afl::data::Hash::getValueByIndex(Index_t index) const
 
 const afl::data::NameMap&
 afl::data::Hash::getKeys() const
+{
+    return *m_keys;
+}
+
+afl::data::Hash::SharedKeys_t
+afl::data::Hash::getSharedKeys() const
 {
     return m_keys;
 }
@@ -97,3 +115,15 @@ afl::data::Hash::getValues() const
 {
     return m_values;
 }
+
+afl::data::NameMap&
+afl::data::Hash::modifyKeys()
+{
+    if (m_keys->refCounter() > 1) {
+        m_keys.reset(*new NameMap(*m_keys));
+    }
+
+    // We are the only user of the NameMap, so we can modify it.
+    // All NameMap instances we refer to have been allocated non-const.
+    return const_cast<NameMap&>(*m_keys);
+}
@@ -20,7 +20,12 @@ namespace afl { namespace data {
 
         There are two ways to access a hash:
         - key-based (you pass in a string key)
-        - index-based (you pass in an index you have previously obtained from a string) */
+        - index-based (you pass in an index you have previously obtained from a string)
+
+        The keys are stored in a NameMap that can be shared between multiple Hash instances
+        (e.g. the elements of an array of records, which all have the same keys).
+        This saves memory, and allows to look up an index using getIndexByKey() once for all hashes sharing that NameMap.
+        A shared NameMap is copied as soon as a Hash needs to add a key (copy-on-write). */
     class Hash : public afl::base::RefCounted {
      public:
         /** Reference type. */
@@ -29,6 +34,9 @@ namespace afl { namespace data {
         /** Index type. */
         typedef NameMap::Index_t Index_t;
 
+        /** Shared key schema type. */
+        typedef afl::base::Ref<const NameMap> SharedKeys_t;
+
         /** Constructor.
             Makes an empty mapping.
             This is a function to make sure all Hash instances are heap-allocated,
@@ -45,6 +53,15 @@ namespace afl { namespace data {
             \return new instance, never null */
         static Ref_t create(NameMap& keys, Segment& values);
 
+        /** Constructor.
+            Makes a populated mapping that shares its keys with other users.
+            This is a function to make sure all Hash instances are heap-allocated,
+            which is required for safe usage in HashValue.
+            \param keys Keys. Will be shared, not modified.
+            \param values Values. Will be modified (emptied), Hash takes ownership of contained values.
+            \return new instance, never null */
+        static Ref_t create(const SharedKeys_t& keys, Segment& values);
+
         /** Destructor. */
         ~Hash();
 
@@ -97,6 +114,11 @@ namespace afl { namespace data {
             \return keys */
         const NameMap& getKeys() const;
 
+        /** Get shared NameMap containing all the keys.
+            The result can be used to create further Hash instances with the same keys.
+            \return keys */
+        SharedKeys_t getSharedKeys() const;
+
         /** Get Segment containing all the values.
             \return values */
         const Segment& getValues() const;
@@ -111,7 +133,11 @@ namespace afl { namespace data {
             (Hash is implicitly uncopyable because the PtrVector contained in the Segment is uncopyable.) */
         Hash(const Hash& other);
 
-        NameMap m_keys;
+        /** Access keys for modification.
+            Makes a private copy if the keys are shared. */
+        NameMap& modifyKeys();
+
+        SharedKeys_t m_keys;
         Segment m_values;
     };
 
@@ -7,9 +7,14 @@
 
 const afl::data::NameMap::Index_t afl::data::NameMap::nil;
 
+namespace {
+    /* Initial hash table size. Must be a power of two. */
+    const size_t INITIAL_HASH_SIZE = 8;
+}
+
 afl::data::NameMap::NameMap()
     : m_names(),
-      m_hashFirst(NameQuery::HASH_MAX, nil),
+      m_hashFirst(),
       m_hashNext()
 { }
 
@@ -19,7 +24,11 @@ afl::data::NameMap::~NameMap()
 afl::data::NameMap::Index_t
 afl::data::NameMap::getIndexByName(const NameQuery& name) const
 {
-    Index_t i = m_hashFirst[name.getHashCode()];
+    if (m_hashFirst.empty()) {
+        return nil;
+    }
+
+    Index_t i = m_hashFirst[name.getFullHashCode() & (m_hashFirst.size()-1)];
     while (i != nil && !name.match(m_names[i])) {
         i = m_hashNext[i];
     }
@@ -29,8 +38,13 @@ afl::data::NameMap::getIndexByName(const NameQuery& name) const
 afl::data::NameMap::Index_t
 afl::data::NameMap::add(const Name_t& name)
 {
-    const size_t h = NameQuery(name).getHashCode();
+    // Grow hash table to keep chains short
     const Index_t slot = static_cast<Index_t>(m_names.size());
+    if (slot >= m_hashFirst.size()) {
+        rehash(m_hashFirst.empty() ? INITIAL_HASH_SIZE : 2*m_hashFirst.size());
+    }
+
+    const size_t h = NameQuery(name).getFullHashCode() & (m_hashFirst.size()-1);
     m_names.push_back(name);
     m_hashNext.push_back(m_hashFirst[h]);
     m_hashFirst[h] = slot;
@@ -54,3 +68,15 @@ afl::data::NameMap::swap(NameMap& other)
     m_hashFirst.swap(other.m_hashFirst);
     m_hashNext.swap(other.m_hashNext);
 }
+
+void
+afl::data::NameMap::rehash(size_t newSize)
+{
+    // Re-insert all names in index order, so later duplicates still shadow earlier ones
+    m_hashFirst.assign(newSize, nil);
+    for (Index_t i = 0, n = m_names.size(); i < n; ++i) {
+        const size_t h = NameQuery(m_names[i]).getFullHashCode() & (newSize-1);
+        m_hashNext[i] = m_hashFirst[h];
+        m_hashFirst[h] = i;
+    }
+}
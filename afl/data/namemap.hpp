@@ -5,6 +5,7 @@
 #ifndef AFL_AFL_DATA_NAMEMAP_HPP
 #define AFL_AFL_DATA_NAMEMAP_HPP
 
+#include "afl/base/refcounted.hpp"
 #include "afl/base/types.hpp"
 #include "afl/string/string.hpp"
 #include "afl/data/namequery.hpp"
@@ -12,8 +13,15 @@
 namespace afl { namespace data {
 
     /** A Mapping of Names to Indexes.
-        Provides a quick mapping in both directions. */
-    class NameMap {
+        Provides a quick mapping in both directions.
+
+        A NameMap can be used as a local object, or be heap-allocated and shared between multiple users
+        (e.g. between Hash instances that have the same set of keys) using afl::base::Ref<const NameMap>.
+        A shared NameMap must not be modified; users that need to modify it must make a copy.
+
+        Lookup uses a chained hash table whose size is a power of two.
+        It grows with the number of names, so lookup stays fast for large maps. */
+    class NameMap : public afl::base::RefCounted {
      public:
         /** Type for names: string. */
         typedef String_t Name_t;
@@ -66,6 +74,8 @@ namespace afl { namespace data {
         void swap(NameMap& other);
 
      private:
+        void rehash(size_t newSize);
+
         std::vector<Name_t> m_names;
         std::vector<Index_t> m_hashFirst;
         std::vector<Index_t> m_hashNext;
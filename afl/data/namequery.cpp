@@ -4,30 +4,29 @@
   */
 
 #include "afl/data/namequery.hpp"
+#include "afl/checksums/xxhash64.hpp"
+#include "arch/randomseed.hpp"
 
 const size_t afl::data::NameQuery::HASH_MAX;
 
 namespace {
+    /* Seed for name hashing.
+       Names come from untrusted sources (e.g. JSON object keys).
+       With a fixed seed, an attacker could prepare many names with the same hash and make NameMap lookups slow.
+       Therefore, choose the seed randomly, once per process.
+       All NameQuery objects must use the same seed because their hash is used for any NameMap. */
+    uint64_t getHashSeed()
+    {
+        static const uint64_t seed = getRandomSeed();
+        return seed;
+    }
+
     /*
-     *  Hashing using a simple off-the-hat hash function
+     *  Hashing using XXHash64. On 32-bit platforms, this takes the lower half.
      */
-    static uint16_t hash(const afl::string::ConstStringMemory_t& name)
+    size_t hash(const afl::string::ConstStringMemory_t& name)
     {
-        // Caching the string data helps the compiler generate a tighter inner loop.
-        // (about 2% percent total speed on my computer)
-        const size_t size = name.size();
-        const char*const data = name.unsafeData();
-
-        size_t h = size;
-        size_t limit = size;
-        if (limit > 5) {
-            limit = 5;
-        }
-        for (size_t i = 0; i < limit; ++i) {
-            h += uint8_t(data[i]);
-            h += uint8_t(data[size-i-1]);
-        }
-        return h % afl::data::NameQuery::HASH_MAX;
+        return static_cast<size_t>(afl::checksums::XXHash64::compute(name.toBytes(), getHashSeed()));
     }
 }
 
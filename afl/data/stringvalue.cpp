@@ -14,6 +14,16 @@ afl::data::StringValue::StringValue(const String_t& value)
 afl::data::StringValue::~StringValue()
 { }
 
+void
+afl::data::StringValue::setValue(afl::string::ConstStringMemory_t value)
+{
+    if (value.empty()) {
+        m_value.clear();
+    } else {
+        m_value.assign(value.unsafeData(), value.size());
+    }
+}
+
 void
 afl::data::StringValue::visit(Visitor& visitor) const
 {
@@ -23,6 +23,11 @@ namespace afl { namespace data {
             \return String value */
         const String_t& getValue() const;
 
+        /** Set value.
+            This modifies the value in-place, re-using the existing storage where possible.
+            \param value New value */
+        void setValue(afl::string::ConstStringMemory_t value);
+
         virtual void visit(Visitor& visitor) const;
 
         virtual StringValue* clone() const;
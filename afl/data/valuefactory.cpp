@@ -0,0 +1,14 @@
+/**
+  *  \file afl/data/valuefactory.cpp
+  *  \brief Interface afl::data::ValueFactory
+  */
+
+#include "afl/data/valuefactory.hpp"
+#include "afl/data/namemap.hpp"
+
+afl::data::Value*
+afl::data::ValueFactory::createHash(const afl::base::Ref<const NameMap>& keys, Segment& values)
+{
+    NameMap copy(*keys);
+    return createHash(copy, values);
+}
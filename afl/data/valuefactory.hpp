@@ -6,6 +6,7 @@
 #define AFL_AFL_DATA_VALUEFACTORY_HPP
 
 #include "afl/base/deletable.hpp"
+#include "afl/base/ref.hpp"
 #include "afl/base/types.hpp"
 #include "afl/string/string.hpp"
 
@@ -48,6 +49,15 @@ namespace afl { namespace data {
             \return value */
         virtual Value* createHash(NameMap& keys, Segment& values) = 0;
 
+        /** Create hash value with shared keys.
+            Deserializers use this to create multiple hashes with the same keys
+            (e.g. the elements of an array of records).
+            The default implementation copies the keys and calls createHash(NameMap&, Segment&).
+            \param keys Keys (shared between multiple hashes, must not be modified)
+            \param values Values (can be modified, i.e. swapped)
+            \return value */
+        virtual Value* createHash(const afl::base::Ref<const NameMap>& keys, Segment& values);
+
         /** Create vector value.
             \param values Values (can be modified, i.e. swapped)
             \return value */
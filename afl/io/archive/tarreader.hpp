@@ -21,7 +21,8 @@ namespace afl { namespace io { namespace archive {
         - directory structure is removed unless you provide the KeepPaths option.
         - it supports reading .tar.gz (or any other unseekable/transform-based stream) and its content directly,
           but only if you request each file's content immediately after receiving the DirectoryEntry.
-          Seekable (uncompressed) files are not restricted. */
+          Seekable (uncompressed) files are not restricted.
+          To access a .tar.gz file in arbitrary order, wrap it in an InflateStream instead of a TransformReaderStream. */
     class TarReader : public Directory {
      public:
         /** Constructor.
@@ -0,0 +1,200 @@
+/**
+  *  \file afl/io/archive/tarwriter.cpp
+  *  \brief Class afl::io::archive::TarWriter
+  */
+
+#include <cstring>
+#include "afl/io/archive/tarwriter.hpp"
+#include "afl/base/growablememory.hpp"
+#include "afl/base/staticassert.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/except/filetooshortexception.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/transformdatasink.hpp"
+#include "afl/string/messages.hpp"
+
+using afl::io::Stream;
+
+namespace {
+    /*
+     *  "ustar" header.
+     *
+     *  Specified on http://pubs.opengroup.org/onlinepubs/9699919799/utilities/pax.html
+     */
+    struct UstarHeader {
+        char name[100];
+        char mode[8];
+        char uid[8];
+        char gid[8];
+        char size[12];
+        char mtime[12];
+        char chksum[8];
+        char typeflag;
+        char linkname[100];
+        char magic[6];
+        char version[2];
+        char uname[32];
+        char gname[32];
+        char devmajor[8];
+        char devminor[8];
+        char prefix[155];
+        char unused[12];
+    };
+    static_assert(sizeof(UstarHeader) == 512, "sizeof UstarHeader");
+
+    const size_t BLOCK_SIZE = 512;
+
+    // Largest size that fits into the 11-digit size field
+    const Stream::FileSize_t MAX_SIZE = (Stream::FileSize_t(1) << 33) - 1;
+
+    // Copy buffer size
+    const size_t BUFFER_SIZE = 16384;
+
+    /* Set number field: zero-padded octal number, followed by a null byte. */
+    template<size_t N>
+    void setNumber(char (&field)[N], uint64_t value)
+    {
+        field[N-1] = '\0';
+        for (size_t i = N-1; i > 0; --i) {
+            field[i-1] = char('0' + (value & 7));
+            value >>= 3;
+        }
+    }
+
+    /* Set string field. Caller has verified the length. */
+    template<size_t N>
+    void setString(char (&field)[N], const String_t& value)
+    {
+        std::memcpy(field, value.data(), value.size());
+    }
+}
+
+afl::io::archive::TarWriter::TarWriter(DataSink& out, int options)
+    : Uncopyable(),
+      m_compressor((options & Gzip) != 0 ? new TransformDataSink(out) : 0),
+      m_sink(m_compressor.get() != 0 ? static_cast<DataSink&>(*m_compressor) : out),
+      m_finished(false)
+{
+    if (m_compressor.get() != 0) {
+        m_compressor->setNewTransform(new DeflateTransform(DeflateTransform::Gzip));
+    }
+}
+
+afl::io::archive::TarWriter::~TarWriter()
+{ }
+
+void
+afl::io::archive::TarWriter::addStream(const String_t& name, Stream& in, afl::sys::Time time)
+{
+    const Stream::FileSize_t pos = in.getPos();
+    const Stream::FileSize_t end = in.getSize();
+    const Stream::FileSize_t size = (end > pos ? end - pos : 0);
+    writeHeader(name, size, time);
+
+    afl::base::GrowableBytes_t buffer;
+    buffer.resize(BUFFER_SIZE);
+    Stream::FileSize_t remaining = size;
+    while (remaining > 0) {
+        afl::base::Bytes_t m(buffer.toMemory());
+        if (remaining < m.size()) {
+            m.trim(size_t(remaining));
+        }
+        m.trim(in.read(m));
+        if (m.empty()) {
+            throw afl::except::FileTooShortException(in);
+        }
+        m_sink.handleFullData(m);
+        remaining -= m.size();
+    }
+
+    writePadding(size);
+}
+
+void
+afl::io::archive::TarWriter::addData(const String_t& name, afl::base::ConstBytes_t data, afl::sys::Time time)
+{
+    ConstMemoryStream in(data);
+    addStream(name, in, time);
+}
+
+void
+afl::io::archive::TarWriter::finish()
+{
+    if (!m_finished) {
+        m_finished = true;
+
+        // End marker: two empty blocks
+        static const uint8_t ZERO[2*BLOCK_SIZE] = {};
+        m_sink.handleFullData(ZERO);
+
+        if (m_compressor.get() != 0) {
+            m_compressor->flush();
+        }
+    }
+}
+
+/** Write member header.
+    \param name Member name
+    \param size Member size
+    \param time Modification time */
+void
+afl::io::archive::TarWriter::writeHeader(const String_t& name, Stream::FileSize_t size, afl::sys::Time time)
+{
+    UstarHeader hdr;
+    afl::base::fromObject(hdr).fill(0);
+
+    // Name. If it does not fit into the name field, split it into prefix and name at a slash.
+    if (name.empty()) {
+        throw afl::except::FileProblemException(name, afl::string::Messages::invalidFileName());
+    }
+    if (name.size() <= sizeof(hdr.name)) {
+        setString(hdr.name, name);
+    } else {
+        String_t::size_type n = name.find('/', name.size() - sizeof(hdr.name) - 1);
+        if (n == String_t::npos || n == 0 || n > sizeof(hdr.prefix) || n+1 == name.size()) {
+            throw afl::except::FileProblemException(name, afl::string::Messages::invalidFileName());
+        }
+        setString(hdr.prefix, name.substr(0, n));
+        setString(hdr.name, name.substr(n+1));
+    }
+
+    // Attributes
+    if (size > MAX_SIZE) {
+        throw afl::except::FileProblemException(name, afl::string::Messages::unsupportedFeature());
+    }
+    const int64_t mtime = time.isValid() ? time.getUnixTime() : 0;
+    setNumber(hdr.mode, 0644);
+    setNumber(hdr.uid, 0);
+    setNumber(hdr.gid, 0);
+    setNumber(hdr.size, size);
+    setNumber(hdr.mtime, mtime > 0 ? uint64_t(mtime) : 0);
+    hdr.typeflag = '0';
+    std::memcpy(hdr.magic, "ustar", 6);
+    std::memcpy(hdr.version, "00", 2);
+
+    // Checksum: sum of all header bytes, with the checksum field counting as spaces
+    std::memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+    uint32_t sum = 0;
+    afl::base::ConstBytes_t bytes = afl::base::fromObject(hdr);
+    while (const uint8_t* p = bytes.eat()) {
+        sum += *p;
+    }
+    char chksum[7];
+    setNumber(chksum, sum);
+    std::memcpy(hdr.chksum, chksum, sizeof(chksum));
+
+    m_sink.handleFullData(afl::base::fromObject(hdr));
+}
+
+/** Write padding after member content.
+    \param size Member size */
+void
+afl::io::archive::TarWriter::writePadding(Stream::FileSize_t size)
+{
+    static const uint8_t ZERO[BLOCK_SIZE] = {};
+    const size_t rem = size_t(size % BLOCK_SIZE);
+    if (rem != 0) {
+        m_sink.handleFullData(afl::base::ConstBytes_t(ZERO).subrange(0, BLOCK_SIZE - rem));
+    }
+}
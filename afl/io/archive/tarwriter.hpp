@@ -0,0 +1,84 @@
+/**
+  *  \file afl/io/archive/tarwriter.hpp
+  *  \brief Class afl::io::archive::TarWriter
+  */
+#ifndef AFL_AFL_IO_ARCHIVE_TARWRITER_HPP
+#define AFL_AFL_IO_ARCHIVE_TARWRITER_HPP
+
+#include <memory>
+#include "afl/base/uncopyable.hpp"
+#include "afl/io/datasink.hpp"
+#include "afl/io/stream.hpp"
+#include "afl/sys/time.hpp"
+
+namespace afl { namespace io {
+
+    class TransformDataSink;
+
+} }
+
+namespace afl { namespace io { namespace archive {
+
+    /** TAR file write access.
+        Writes a "ustar" file into a DataSink (which can be a Stream), member by member,
+        optionally compressing the whole file using gzip (.tar.gz).
+
+        Member content is copied in blocks and never held in memory completely.
+        Because the header of a member contains its size, the size must be known in advance.
+
+        Limitations:
+        - member names must fit into the ustar name/prefix fields (at most 255 characters, split at a '/').
+        - member size is limited to 8 GiB.
+
+        Usage:
+        - construct TarWriter
+        - call addStream(), addData() for all members
+        - call finish() */
+    class TarWriter : public afl::base::Uncopyable {
+     public:
+        enum {
+            /** Option: compress output using gzip. */
+            Gzip = 1
+        };
+
+        /** Constructor.
+            \param out Output. Lifetime must exceed that of the TarWriter.
+            \param options Options */
+        TarWriter(DataSink& out, int options);
+
+        /** Destructor.
+            Does not implicitly call finish(). */
+        ~TarWriter();
+
+        /** Add member from a stream.
+            Copies the stream's content from the current position until its end (as reported by getSize()).
+            Throws a FileTooShortException if the stream does not provide that much data.
+            \param name Member name
+            \param in Stream to read
+            \param time Modification time */
+        void addStream(const String_t& name, Stream& in, afl::sys::Time time = afl::sys::Time());
+
+        /** Add member from memory.
+            \param name Member name
+            \param data Content
+            \param time Modification time */
+        void addData(const String_t& name, afl::base::ConstBytes_t data, afl::sys::Time time = afl::sys::Time());
+
+        /** Finish the TAR file.
+            Writes the end marker and, if compressing, flushes the compressor.
+            Must be called after the last member has been added.
+            No more members can be added afterwards. */
+        void finish();
+
+     private:
+        std::auto_ptr<TransformDataSink> m_compressor;
+        DataSink& m_sink;
+        bool m_finished;
+
+        void writeHeader(const String_t& name, Stream::FileSize_t size, afl::sys::Time time);
+        void writePadding(Stream::FileSize_t size);
+    };
+
+} } }
+
+#endif
@@ -3,18 +3,23 @@
   *  \brief Class afl::io::archive::ZipReader
   */
 
+#include <algorithm>
 #include "afl/io/archive/zipreader.hpp"
 #include "afl/base/growablememory.hpp"
 #include "afl/base/staticassert.hpp"
 #include "afl/bits/uint16le.hpp"
 #include "afl/bits/uint32le.hpp"
+#include "afl/bits/uint64le.hpp"
 #include "afl/bits/value.hpp"
+#include "afl/checksums/crc32.hpp"
+#include "afl/checksums/xxhash64.hpp"
 #include "afl/charset/codepage.hpp"
 #include "afl/charset/codepagecharset.hpp"
+#include "afl/except/fileformatexception.hpp"
 #include "afl/except/fileproblemexception.hpp"
 #include "afl/io/directoryentry.hpp"
 #include "afl/io/filemapping.hpp"
-#include "afl/io/inflatetransform.hpp"
+#include "afl/io/inflatestream.hpp"
 #include "afl/io/limitedstream.hpp"
 #include "afl/io/multiplexablestream.hpp"
 #include "afl/io/unchangeabledirectoryentry.hpp"
@@ -26,6 +31,7 @@ namespace {
     const uint16_t gfEncrypted       = 1;
     const uint16_t gfMethodExtra1    = 2;
     const uint16_t gfMethodExtra2    = 4;
+    const uint16_t gfDataDescriptor  = 8;             // sizes not known in local header; only supported with central directory
     const uint16_t gfUnicodeName     = 2048;
     const uint16_t gfUpdated         = 32768;         // not documented by PKWARE, but in use
     const uint16_t gfKnown           = gfEncrypted + gfMethodExtra1 + gfMethodExtra2 + gfUnicodeName + gfUpdated;
@@ -37,6 +43,9 @@ namespace {
     // Shortcuts
     typedef afl::bits::Value<afl::bits::UInt16LE> UInt16_t;
     typedef afl::bits::Value<afl::bits::UInt32LE> UInt32_t;
+    typedef afl::bits::Value<afl::bits::UInt64LE> UInt64_t;
+    typedef afl::io::Stream::FileSize_t FileSize_t;
+    using afl::base::ConstBytes_t;
     using afl::base::Ptr;
     using afl::base::Ref;
     using afl::except::FileProblemException;
@@ -57,6 +66,70 @@ namespace {
     };
     static_assert(sizeof(LocalHeader) == 26, "sizeof LocalHeader");
 
+    // Central directory file header format
+    struct CentralHeader {
+        UInt16_t creatorVersion;
+        UInt16_t minVersion;
+        UInt16_t flags;
+        UInt16_t method;
+        UInt32_t modificationTime;
+        UInt32_t crc;
+        UInt32_t compressedSize;
+        UInt32_t uncompressedSize;
+        UInt16_t nameLength;
+        UInt16_t extraLength;
+        UInt16_t commentLength;
+        UInt16_t diskNumber;
+        UInt16_t internalAttributes;
+        UInt32_t externalAttributes;
+        UInt32_t headerOffset;
+    };
+    static_assert(sizeof(CentralHeader) == 42, "sizeof CentralHeader");
+
+    // End of central directory record format
+    struct EndRecord {
+        UInt16_t diskNumber;
+        UInt16_t directoryDisk;
+        UInt16_t numDiskEntries;
+        UInt16_t numEntries;
+        UInt32_t directorySize;
+        UInt32_t directoryOffset;
+        UInt16_t commentLength;
+    };
+    static_assert(sizeof(EndRecord) == 18, "sizeof EndRecord");
+
+    // ZIP64 end of central directory locator format
+    struct Zip64Locator {
+        UInt32_t directoryDisk;
+        UInt64_t endRecordOffset;
+        UInt32_t numDisks;
+    };
+    static_assert(sizeof(Zip64Locator) == 16, "sizeof Zip64Locator");
+
+    // ZIP64 end of central directory record format
+    struct Zip64EndRecord {
+        UInt64_t recordSize;
+        UInt16_t creatorVersion;
+        UInt16_t minVersion;
+        UInt32_t diskNumber;
+        UInt32_t directoryDisk;
+        UInt64_t numDiskEntries;
+        UInt64_t numEntries;
+        UInt64_t directorySize;
+        UInt64_t directoryOffset;
+    };
+    static_assert(sizeof(Zip64EndRecord) == 52, "sizeof Zip64EndRecord");
+
+    // Maximum size of the ZIP file comment following the end record
+    const size_t MAX_COMMENT_SIZE = 0xFFFF;
+
+    // Hash table
+    const size_t MIN_HASH_SIZE = 64;
+    const size_t NO_ENTRY = size_t(-1);
+
+    // Marker for unknown data start position
+    const FileSize_t UNKNOWN_POSITION = FileSize_t(-1);
+
     String_t loadString(afl::io::Stream& in, size_t n)
     {
         // FIXME: move this into a library?
@@ -65,32 +138,109 @@ namespace {
         in.fullRead(buffer);
         return afl::string::fromBytes(buffer);
     }
+
+    /* Compute hash code of a member name. On 32-bit platforms, this takes the lower half. */
+    size_t hashName(const String_t& name)
+    {
+        return static_cast<size_t>(afl::checksums::XXHash64::compute(afl::string::toBytes(name)));
+    }
+
+    /* Read ZIP64 end record.
+       \param in     File
+       \param pos    Position of record (signature)
+       \param locPos Position of ZIP64 locator; record must end there
+       \param end64  [out] Record
+       \return true on success */
+    bool readZip64EndRecord(afl::io::Stream& in, FileSize_t pos, FileSize_t locPos, Zip64EndRecord& end64)
+    {
+        UInt32_t sig;
+        in.setPos(pos);
+        in.fullRead(afl::base::fromObject(sig));
+        in.fullRead(afl::base::fromObject(end64));
+        return sig == 0x06064B50
+            && end64.diskNumber == 0
+            && end64.directoryDisk == 0
+            && end64.recordSize == locPos - pos - 12;
+    }
+
+    /* Parse ZIP64 extended information extra field.
+       The field contains the values that did not fit into the central header (and are therefore given as 0xFFFFFFFF),
+       in fixed order.
+       \param extra            Extra fields
+       \param uncompressedSize [in/out] Uncompressed size
+       \param compressedSize   [in/out] Compressed size
+       \param headerOffset     [in/out] Local header position
+       \return true on success, false if the field is missing or truncated */
+    bool parseZip64Extra(ConstBytes_t extra, FileSize_t& uncompressedSize, FileSize_t& compressedSize, FileSize_t& headerOffset)
+    {
+        UInt16_t id, size;
+        while (extra.fullRead(afl::base::fromObject(id)) && extra.fullRead(afl::base::fromObject(size))) {
+            ConstBytes_t data = extra.split(size);
+            if (id == 1) {
+                UInt64_t value;
+                if (uncompressedSize == 0xFFFFFFFF) {
+                    if (!data.fullRead(afl::base::fromObject(value))) {
+                        return false;
+                    }
+                    uncompressedSize = value;
+                }
+                if (compressedSize == 0xFFFFFFFF) {
+                    if (!data.fullRead(afl::base::fromObject(value))) {
+                        return false;
+                    }
+                    compressedSize = value;
+                }
+                if (headerOffset == 0xFFFFFFFF) {
+                    if (!data.fullRead(afl::base::fromObject(value))) {
+                        return false;
+                    }
+                    headerOffset = value;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
 }
 
-/** Index entry. Stores information gathered from the file member header. */
+/** Index entry. Stores information gathered from the file member header.
+    If the entry was built from the central directory, the position of the data is not known until the local header is read;
+    in this case, \c start is UNKNOWN_POSITION and \c headerStart points at the local header. */
 struct afl::io::archive::ZipReader::IndexEntry {
     String_t name;
     uint16_t method;
+    Stream::FileSize_t headerStart;
     Stream::FileSize_t start;
     Stream::FileSize_t compressedSize;
     Stream::FileSize_t uncompressedSize;
+    uint32_t crc;
+
+    // Hash table linkage, managed by ZipReader::addEntry
+    size_t hash;
+    size_t nextInHash;
 
     IndexEntry(const String_t& name, uint16_t method,
+               Stream::FileSize_t headerStart,
                Stream::FileSize_t start,
                Stream::FileSize_t compressedSize,
-               Stream::FileSize_t uncompressedSize)
+               Stream::FileSize_t uncompressedSize,
+               uint32_t crc)
         : name(name),
           method(method),
+          headerStart(headerStart),
           start(start),
           compressedSize(compressedSize),
-          uncompressedSize(uncompressedSize)
+          uncompressedSize(uncompressedSize),
+          crc(crc),
+          hash(0),
+          nextInHash(NO_ENTRY)
         { }
 };
 
 /** Zip "DirectoryEntry" implementation. */
 class afl::io::archive::ZipReader::ZipDirEntry : public afl::io::UnchangeableDirectoryEntry {
  public:
-    ZipDirEntry(const IndexEntry& entry, const Ref<ZipReader>& parent);
+    ZipDirEntry(IndexEntry& entry, const Ref<ZipReader>& parent);
     ~ZipDirEntry();
 
     // DirectoryEntry:
@@ -104,7 +254,7 @@ class afl::io::archive::ZipReader::ZipDirEntry : public afl::io::UnchangeableDir
 
  private:
     /** IndexEntry. Owned by ZipReader. */
-    const IndexEntry& m_entry;
+    IndexEntry& m_entry;
     /** Parent. Keeps m_entry alive. */
     const Ref<ZipReader> m_parent;
 };
@@ -148,32 +298,23 @@ class afl::io::archive::ZipReader::ZipStoredMember : public afl::io::Stream {
 };
 
 /** Zip "Stream" implementation for a deflated member.
-    Uses a LimitedStream for housekeeping, plus a Transform for decoding.
-    FIXME: this could be a generic class for reading compressed stuff */
-class afl::io::archive::ZipReader::ZipDeflatedMember : public afl::io::MultiplexableStream {
+    Uses a LimitedStream for housekeeping, plus an InflateStream for decoding and seeking.
+    Computes the CRC-32 of the data read so far, and verifies it when the end is reached. */
+class afl::io::archive::ZipReader::ZipDeflatedMember : public afl::io::InflateStream {
  public:
-    ZipDeflatedMember(const Ref<Stream>& file, const IndexEntry& entry);
+    ZipDeflatedMember(const Ref<Stream>& file, const IndexEntry& entry, FileSize_t checkpointSpacing);
     ~ZipDeflatedMember();
 
-    virtual String_t getName();
-    virtual FileSize_t getSize();
-    virtual FileSize_t getPos();
-    virtual void setPos(FileSize_t pos);
-    virtual void flush();
-    virtual size_t write(ConstBytes_t m);
     virtual size_t read(Bytes_t m);
-    virtual uint32_t getCapabilities();
-    virtual Ptr<FileMapping> createFileMapping(FileSize_t limit);
+    virtual String_t getName();
 
  private:
     const Ref<Stream> m_file;
-    LimitedStream m_worker;
-    InflateTransform m_transform;
     const String_t m_name;
-
-    uint8_t m_buffer[4096];
-    ConstBytes_t m_bufferDescriptor;
-    FileSize_t m_bytesRead;
+    const uint32_t m_expectedCrc;
+    uint32_t m_crc;                 ///< CRC-32 of data up to m_crcPosition.
+    FileSize_t m_crcPosition;       ///< Amount of data (from beginning) covered by m_crc.
+    bool m_crcChecked;
 };
 
 /************************** ZipReader::ZipDirEntry *************************/
@@ -181,7 +322,7 @@ class afl::io::archive::ZipReader::ZipDeflatedMember : public afl::io::Multiplex
 /** Constructor.
     \param entry Index entry for this directory entry
     \param parent Link to containing zip file. */
-afl::io::archive::ZipReader::ZipDirEntry::ZipDirEntry(const IndexEntry& entry, const Ref<ZipReader>& parent)
+afl::io::archive::ZipReader::ZipDirEntry::ZipDirEntry(IndexEntry& entry, const Ref<ZipReader>& parent)
     : UnchangeableDirectoryEntry(Messages::cannotModifyArchiveFile()),
       m_entry(entry),
       m_parent(parent)
@@ -206,10 +347,11 @@ afl::io::archive::ZipReader::ZipDirEntry::getPathName()
 Ref<afl::io::Stream>
 afl::io::archive::ZipReader::ZipDirEntry::openFileForReading()
 {
+    m_parent->getDataStart(m_entry);
     if (m_entry.method == cmStored) {
         return *new ZipStoredMember(m_parent->m_file, m_entry);
     } else if (m_entry.method == cmDeflated) {
-        return *new ZipDeflatedMember(m_parent->m_file, m_entry);
+        return *new ZipDeflatedMember(m_parent->m_file, m_entry, (m_parent->m_options & RandomAccess) != 0 ? InflateStream::DEFAULT_CHECKPOINT_SPACING : 0);
     } else {
         throw FileProblemException(getTitle(), Messages::unsupportedCompressionMode());
     }
@@ -344,92 +486,46 @@ afl::io::archive::ZipReader::ZipStoredMember::createFileMapping(FileSize_t limit
 
 /*********************** ZipReader::ZipDeflatedMember **********************/
 
-afl::io::archive::ZipReader::ZipDeflatedMember::ZipDeflatedMember(const Ref<Stream>& file, const IndexEntry& entry)
-    : m_file(file),
-      m_worker(file->createChild(), entry.start, entry.compressedSize),
-      m_transform(InflateTransform::Raw),
+afl::io::archive::ZipReader::ZipDeflatedMember::ZipDeflatedMember(const Ref<Stream>& file, const IndexEntry& entry, FileSize_t checkpointSpacing)
+    : InflateStream(*new LimitedStream(file->createChild(), entry.start, entry.compressedSize), InflateStream::Raw, checkpointSpacing),
+      m_file(file),
       m_name(entry.name),
-      m_buffer(),
-      m_bufferDescriptor(),
-      m_bytesRead(0)
+      m_expectedCrc(entry.crc),
+      m_crc(0),
+      m_crcPosition(0),
+      m_crcChecked(false)
 { }
 
 afl::io::archive::ZipReader::ZipDeflatedMember::~ZipDeflatedMember()
 { }
 
-String_t
-afl::io::archive::ZipReader::ZipDeflatedMember::getName()
-{
-    return PosixFileNames().makePathName(m_file->getName(), m_name);
-}
-
-afl::io::Stream::FileSize_t
-afl::io::archive::ZipReader::ZipDeflatedMember::getSize()
-{
-    return FileSize_t(-1);
-}
-
-afl::io::Stream::FileSize_t
-afl::io::archive::ZipReader::ZipDeflatedMember::getPos()
-{
-    return m_bytesRead;
-}
-
-void
-afl::io::archive::ZipReader::ZipDeflatedMember::setPos(FileSize_t pos)
-{
-    if (pos != m_bytesRead) {
-        throw FileProblemException(*this, Messages::invalidOperation());
-    }
-}
-
-void
-afl::io::archive::ZipReader::ZipDeflatedMember::flush()
-{ }
-
-size_t
-afl::io::archive::ZipReader::ZipDeflatedMember::write(ConstBytes_t /*m*/)
-{
-    throw FileProblemException(*this, Messages::cannotWrite());
-}
-
 size_t
 afl::io::archive::ZipReader::ZipDeflatedMember::read(Bytes_t m)
 {
-    size_t did = 0;
-    while (!m.empty()) {
-        // Try to re-fill buffer if needed
-        if (m_bufferDescriptor.empty()) {
-            Bytes_t b(m_buffer);
-            b.trim(m_worker.read(b));
-            m_bufferDescriptor = b;
-        }
+    const FileSize_t pos = getPos();
+    const size_t n = InflateStream::read(m);
 
-        // Buffer still empty? End of file.
-        if (m_bufferDescriptor.empty()) {
-            break;
-        }
-
-        // Transform
-        Bytes_t result = m;
-        m_transform.transform(m_bufferDescriptor, result);
-        m.split(result.size());
-        did += result.size();
-        m_bytesRead += result.size();
+    // Extend checksum if this read continues the checksummed area.
+    // Reads after a backward seek re-read data that has already been checksummed.
+    if (pos <= m_crcPosition && pos + n > m_crcPosition) {
+        m_crc = afl::checksums::CRC32::getDefaultInstance().add(m.subrange(size_t(m_crcPosition - pos), size_t(pos + n - m_crcPosition)), m_crc);
+        m_crcPosition = pos + n;
     }
-    return did;
-}
 
-uint32_t
-afl::io::archive::ZipReader::ZipDeflatedMember::getCapabilities()
-{
-    return CanRead;
+    // Short read means end of data; verify checksum if it covers everything.
+    if (n < m.size() && !m_crcChecked && m_crcPosition == pos + n) {
+        m_crcChecked = true;
+        if (m_crc != m_expectedCrc) {
+            throw afl::except::FileFormatException(getName(), Messages::invalidCompressedData());
+        }
+    }
+    return n;
 }
 
-Ptr<afl::io::FileMapping>
-afl::io::archive::ZipReader::ZipDeflatedMember::createFileMapping(FileSize_t /*limit*/)
+String_t
+afl::io::archive::ZipReader::ZipDeflatedMember::getName()
 {
-    return 0;
+    return PosixFileNames().makePathName(m_file->getName(), m_name);
 }
 
 /******************************** ZipReader ********************************/
@@ -447,14 +543,11 @@ afl::base::Ref<afl::io::DirectoryEntry>
 afl::io::archive::ZipReader::getDirectoryEntryByName(String_t name)
 {
     // Look in existing index
-    size_t size = m_index.size();
-    IndexEntry* xe = findEntryByName(name, 0, size);
+    IndexEntry* xe = findEntryByName(name);
 
     // Not found, so read more
     while (xe == 0 && readNextEntry()) {
-        size_t nsize = m_index.size();
-        xe = findEntryByName(name, size, nsize);
-        size = nsize;
+        xe = findEntryByName(name);
     }
 
     // Found?
@@ -470,6 +563,12 @@ afl::io::archive::ZipReader::getDirectoryEntries()
     return *new ZipDirEnum(*this);
 }
 
+bool
+afl::io::archive::ZipReader::hasUnsupportedFeature() const
+{
+    return m_hadUnsupportedFeature;
+}
+
 afl::base::Ptr<afl::io::Directory>
 afl::io::archive::ZipReader::getParentDirectory()
 {
@@ -499,11 +598,175 @@ afl::io::archive::ZipReader::ZipReader(afl::base::Ref<Stream> file, int options)
       m_view(file->createChild()),
       m_options(options),
       m_index(),
+      m_hash(),
       m_indexerReachedEnd(false),
       m_hadUnsupportedFeature(false)
 {
-    // Read first entry to fail if we were not given a zip file
-    readNextEntry();
+    if (!readCentralDirectory()) {
+        // No central directory; walk the local headers instead.
+        if (m_view->hasCapabilities(Stream::CanSeek)) {
+            m_view->setPos(0);
+        }
+
+        // Read first entry to fail if we were not given a zip file
+        readNextEntry();
+    }
+}
+
+/** Read central directory.
+    Locates the end of central directory record and builds the complete index from the central directory.
+    \retval true Index has been built
+    \retval false File has no usable central directory; index unchanged. File position is unspecified. */
+bool
+afl::io::archive::ZipReader::readCentralDirectory()
+{
+    using afl::base::fromObject;
+
+    // We need random access
+    if (!m_view->hasCapabilities(Stream::CanSeek)) {
+        return false;
+    }
+
+    // Read the tail of the file. The end record is at the end, followed by a comment.
+    const size_t END_SIZE = 4 + sizeof(EndRecord);
+    const FileSize_t fileSize = m_view->getSize();
+    if (fileSize < END_SIZE) {
+        return false;
+    }
+    const size_t tailSize = size_t(std::min(fileSize, FileSize_t(END_SIZE + MAX_COMMENT_SIZE)));
+    const FileSize_t tailPos = fileSize - tailSize;
+    afl::base::GrowableBytes_t tail;
+    tail.resize(tailSize);
+    m_view->setPos(tailPos);
+    m_view->fullRead(tail);
+
+    // Locate the end record, starting at the end
+    EndRecord end;
+    size_t endPos = tailSize - END_SIZE + 1;
+    while (1) {
+        if (endPos == 0) {
+            return false;
+        }
+        --endPos;
+        ConstBytes_t m = tail.toMemory().subrange(endPos);
+        UInt32_t sig;
+        if (m.fullRead(fromObject(sig)) && sig == 0x06054B50 && m.fullRead(fromObject(end)) && end.commentLength <= m.size()) {
+            break;
+        }
+    }
+    if (end.diskNumber != 0 || end.directoryDisk != 0) {
+        return false;
+    }
+
+    FileSize_t numEntries = end.numEntries;
+    FileSize_t dirSize    = end.directorySize;
+    FileSize_t dirOffset  = end.directoryOffset;
+    FileSize_t dirEnd     = tailPos + endPos;
+
+    // If values are saturated, this is a ZIP64 file: a locator precedes the end record, and points at the ZIP64 end record,
+    // which immediately precedes the locator.
+    if (numEntries == 0xFFFF || dirSize == 0xFFFFFFFF || dirOffset == 0xFFFFFFFF) {
+        const FileSize_t MIN_END64_SIZE = 4 + sizeof(Zip64EndRecord);
+        if (dirEnd < 4 + sizeof(Zip64Locator) + MIN_END64_SIZE) {
+            return false;
+        }
+
+        UInt32_t sig;
+        Zip64Locator loc;
+        const FileSize_t locPos = dirEnd - 4 - sizeof(loc);
+        m_view->setPos(locPos);
+        m_view->fullRead(fromObject(sig));
+        m_view->fullRead(fromObject(loc));
+        if (sig != 0x07064B50 || loc.directoryDisk != 0 || loc.numDisks > 1) {
+            return false;
+        }
+
+        // Like the central directory offset, the recorded position of the end record is off if data has been prepended.
+        // Try the recorded position (which allows for an extensible data sector),
+        // then the position of a minimum-size record immediately preceding the locator.
+        Zip64EndRecord end64;
+        FileSize_t end64Pos = loc.endRecordOffset;
+        if (end64Pos > locPos - MIN_END64_SIZE || !readZip64EndRecord(*m_view, end64Pos, locPos, end64)) {
+            end64Pos = locPos - MIN_END64_SIZE;
+            if (!readZip64EndRecord(*m_view, end64Pos, locPos, end64)) {
+                return false;
+            }
+        }
+        numEntries = end64.numEntries;
+        dirSize    = end64.directorySize;
+        dirOffset  = end64.directoryOffset;
+        dirEnd     = end64Pos;
+    }
+
+    // Central directory immediately precedes the end record.
+    // If it is found later than recorded, data has been prepended to the file (e.g. self-extractor); all offsets are off by that amount.
+    if (dirSize > dirEnd || dirOffset > dirEnd - dirSize || dirSize != size_t(dirSize)) {
+        return false;
+    }
+    const FileSize_t delta = dirEnd - dirSize - dirOffset;
+
+    // Read and parse it in one go
+    afl::base::GrowableBytes_t dir;
+    dir.resize(size_t(dirSize));
+    m_view->setPos(dirEnd - dirSize);
+    m_view->fullRead(dir);
+
+    ConstBytes_t in(dir.toMemory());
+    bool ok = true;
+    for (FileSize_t i = 0; i < numEntries; ++i) {
+        UInt32_t sig;
+        CentralHeader header;
+        if (!in.fullRead(fromObject(sig)) || sig != 0x02014B50 || !in.fullRead(fromObject(header))) {
+            ok = false;
+            break;
+        }
+
+        const uint16_t flags = header.flags;
+        const uint16_t method = header.method;
+        const size_t nameLength = header.nameLength;
+        const size_t extraLength = header.extraLength;
+        const size_t commentLength = header.commentLength;
+        if (in.size() < nameLength + extraLength + commentLength) {
+            ok = false;
+            break;
+        }
+        String_t name = normalizeName(afl::string::fromBytes(in.split(nameLength)), flags);
+        ConstBytes_t extra = in.split(extraLength);
+        in.split(commentLength);
+
+        FileSize_t compressedSize = header.compressedSize;
+        FileSize_t uncompressedSize = header.uncompressedSize;
+        FileSize_t headerOffset = header.headerOffset;
+        if (compressedSize == 0xFFFFFFFF || uncompressedSize == 0xFFFFFFFF || headerOffset == 0xFFFFFFFF) {
+            if (!parseZip64Extra(extra, uncompressedSize, compressedSize, headerOffset)) {
+                ok = false;
+                break;
+            }
+        }
+
+        /* If it is supported, build index entry */
+        if (name.size() == 0) {
+            /* Directory */
+        } else if ((flags & ~(gfKnown | gfDataDescriptor)) == 0 && (flags & gfEncrypted) == 0 && (method == cmStored || method == cmDeflated)) {
+            /* Supported file */
+            addEntry(std::auto_ptr<IndexEntry>(new IndexEntry(name, method, headerOffset + delta, UNKNOWN_POSITION, compressedSize, uncompressedSize, header.crc)));
+        } else {
+            /* Unsupported */
+            if ((flags & ~(gfKnown | gfDataDescriptor)) != 0) {
+                m_hadUnsupportedFeature = true;
+            }
+        }
+    }
+
+    if (!ok) {
+        m_index.clear();
+        m_hash.clear();
+        m_hadUnsupportedFeature = false;
+        return false;
+    }
+
+    m_indexerReachedEnd = true;
+    return true;
 }
 
 /** Read next entry from Zip file.
@@ -528,7 +791,7 @@ afl::io::archive::ZipReader::readNextEntry()
         uint16_t flags       = header.flags;
         uint16_t method      = header.method;
         // uint32_t mtime       = getUint32(buffer+6);
-        // uint32_t crc         = getUint32(buffer+10);
+        uint32_t crc         = header.crc;
         uint32_t compsize    = header.compressedSize;
         uint32_t uncompsize  = header.uncompressedSize;
         uint16_t namelength  = header.nameLength;
@@ -541,15 +804,7 @@ afl::io::archive::ZipReader::readNextEntry()
         }
 
         /* Read file name */
-        String_t name = loadString(*m_view, namelength);
-        String_t::size_type n = name.rfind('/');
-        if (n != name.npos && ((m_options & KeepPaths) == 0 || n+1 == name.size())) {
-            /* Clear name if this is a directory, remove path part if configured so. */
-            name.erase(0, n+1);
-        }
-        if ((flags & gfUnicodeName) == 0) {
-            name = afl::charset::CodepageCharset(afl::charset::g_codepage437).decode(afl::string::toMemory(name).toBytes());
-        }
+        String_t name = normalizeName(loadString(*m_view, namelength), flags);
 
         /* Skip extra field */
         if (extraLength != 0) {
@@ -561,9 +816,8 @@ afl::io::archive::ZipReader::readNextEntry()
             /* Directory */
         } else if ((flags & gfEncrypted) == 0 && (method == cmStored || method == cmDeflated)) {
             /* Supported file */
-            if (!findEntryByName(name, 0, m_index.size())) {
-                m_index.pushBackNew(new IndexEntry(name, method, m_view->getPos(), compsize, uncompsize));
-            }
+            const FileSize_t pos = m_view->getPos();
+            addEntry(std::auto_ptr<IndexEntry>(new IndexEntry(name, method, UNKNOWN_POSITION, pos, compsize, uncompsize, crc)));
         } else {
             /* Unsupported */
         }
@@ -579,13 +833,92 @@ afl::io::archive::ZipReader::readNextEntry()
     }
 }
 
+/** Normalize a member name.
+    \param name Name as stored in the file
+    \param flags General flags
+    \return Name to use in index; empty for directories */
+String_t
+afl::io::archive::ZipReader::normalizeName(String_t name, uint16_t flags) const
+{
+    String_t::size_type n = name.rfind('/');
+    if (n != name.npos && ((m_options & KeepPaths) == 0 || n+1 == name.size())) {
+        /* Clear name if this is a directory, remove path part if configured so. */
+        name.erase(0, n+1);
+    }
+    if ((flags & gfUnicodeName) == 0) {
+        name = afl::charset::CodepageCharset(afl::charset::g_codepage437).decode(afl::string::toMemory(name).toBytes());
+    }
+    return name;
+}
+
+/** Add entry to index.
+    If an entry with the same name already exists, the new one is ignored.
+    \param e Newly-allocated entry */
+void
+afl::io::archive::ZipReader::addEntry(std::auto_ptr<IndexEntry> e)
+{
+    if (findEntryByName(e->name) != 0) {
+        return;
+    }
+
+    e->hash = hashName(e->name);
+    m_index.pushBackNew(e.release());
+
+    if (m_index.size() > m_hash.size()) {
+        // Grow hash table, keeping it at most 100% full
+        std::vector<size_t>(std::max(MIN_HASH_SIZE, 2*m_hash.size()), NO_ENTRY).swap(m_hash);
+        for (size_t i = 0, n = m_index.size(); i < n; ++i) {
+            size_t& head = m_hash[m_index[i]->hash & (m_hash.size() - 1)];
+            m_index[i]->nextInHash = head;
+            head = i;
+        }
+    } else {
+        const size_t i = m_index.size() - 1;
+        size_t& head = m_hash[m_index[i]->hash & (m_hash.size() - 1)];
+        m_index[i]->nextInHash = head;
+        head = i;
+    }
+}
+
+/** Find entry by name.
+    \param name Normalized name
+    \return Entry; null if none */
 afl::io::archive::ZipReader::IndexEntry*
-afl::io::archive::ZipReader::findEntryByName(const String_t& name, size_t start, size_t end)
+afl::io::archive::ZipReader::findEntryByName(const String_t& name) const
 {
-    for (size_t i = start; i < end; ++i) {
-        if (m_index[i]->name == name) {
-            return m_index[i];
+    if (m_hash.empty()) {
+        return 0;
+    }
+
+    const size_t hash = hashName(name);
+    size_t i = m_hash[hash & (m_hash.size() - 1)];
+    while (i != NO_ENTRY) {
+        IndexEntry* e = m_index[i];
+        if (e->hash == hash && e->name == name) {
+            return e;
         }
+        i = e->nextInHash;
     }
     return 0;
 }
+
+/** Get start of member data.
+    If the entry was built from the central directory, reads the local header to determine it.
+    \param e Entry
+    \return Position of member data */
+afl::io::Stream::FileSize_t
+afl::io::archive::ZipReader::getDataStart(IndexEntry& e)
+{
+    if (e.start == UNKNOWN_POSITION) {
+        UInt32_t sig;
+        LocalHeader header;
+        m_view->setPos(e.headerStart);
+        m_view->fullRead(afl::base::fromObject(sig));
+        m_view->fullRead(afl::base::fromObject(header));
+        if (sig != 0x04034B50) {
+            throw afl::except::FileFormatException(*m_file, Messages::invalidFileHeader());
+        }
+        e.start = e.headerStart + 4 + sizeof(header) + header.nameLength + header.extraLength;
+    }
+    return e.start;
+}
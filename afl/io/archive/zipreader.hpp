@@ -5,6 +5,8 @@
 #ifndef AFL_AFL_IO_ARCHIVE_ZIPREADER_HPP
 #define AFL_AFL_IO_ARCHIVE_ZIPREADER_HPP
 
+#include <memory>
+#include <vector>
 #include "afl/io/directory.hpp"
 #include "afl/base/ref.hpp"
 #include "afl/io/stream.hpp"
@@ -14,14 +16,20 @@ namespace afl { namespace io { namespace archive {
 
     /** ZIP file read access.
         This provides simple, read-only access to a ZIP file.
-        It builds an in-memory index of the member files on-the fly.
+        It builds an in-memory index of the member files, hashed by (normalized) name.
+
+        If the file has a central directory (which any complete ZIP file has), the index is built from that in one go.
+        ZIP64 archives and members whose sizes are only given in a data descriptor are supported this way.
+        Otherwise, the index is built on-the-fly by walking the local file headers.
 
         Limitations:
         - we support only "classic" PKZIP 2.0 compression (deflate), no Deflate64, LZMA, etc.
         - the ZIP file is "flattened" i.e. all directory structure removed.
           Use the KeepPaths option to get paths reported anyway.
-        - compressed members do not allow seeking.
-        - unlike many zippers, this one reads the local headers, not the central headers.
+        - seeking in compressed members requires decoding; use the RandomAccess option to make that fast.
+        - the checksum of a compressed member is verified when it has been read completely from the beginning
+          (FileFormatException on mismatch); stored members are not verified.
+        - multi-volume archives are not supported.
         - unless specifically marked as Unicode, file names are treated as codepage 437 (western DOS).
         - unsupported entries are ignored. In particular, if a file is not a zip file at all,
           it is treated as empty (with a large unsupported entry). */
@@ -42,9 +50,22 @@ namespace afl { namespace io { namespace archive {
                 If specified, reports path names "as-is".
                 If not specified (default), reports path names restricted to their final component,
                 thus "flattening" the file. */
-            KeepPaths = 1
+            KeepPaths = 1,
+
+            /** Option: random access to compressed members.
+                If specified, reading a compressed member records checkpoints (see InflateStream),
+                so that seeking within it only needs to decode a limited amount of data.
+                If not specified (default), seeking backward in a compressed member decodes it from the beginning. */
+            RandomAccess = 2
         };
 
+        /** Check for unsupported features.
+            Entries using unsupported features (e.g. unknown flags) are ignored;
+            when walking local headers, indexing stops at such an entry.
+            This information is complete after all entries have been enumerated.
+            \return true if an unsupported feature has been found */
+        bool hasUnsupportedFeature() const;
+
         // Directory:
         virtual afl::base::Ref<DirectoryEntry> getDirectoryEntryByName(String_t name);
         virtual afl::base::Ref<afl::base::Enumerator<afl::base::Ptr<DirectoryEntry> > > getDirectoryEntries();
@@ -61,6 +82,7 @@ namespace afl { namespace io { namespace archive {
         // Index
         struct IndexEntry;
         afl::container::PtrVector<IndexEntry> m_index;
+        std::vector<size_t> m_hash;
         bool m_indexerReachedEnd;
         bool m_hadUnsupportedFeature;
 
@@ -76,8 +98,12 @@ namespace afl { namespace io { namespace archive {
 
         ZipReader(afl::base::Ref<Stream> file, int options);
 
+        bool readCentralDirectory();
         bool readNextEntry();
-        IndexEntry* findEntryByName(const String_t& name, size_t start, size_t end);
+        String_t normalizeName(String_t name, uint16_t flags) const;
+        void addEntry(std::auto_ptr<IndexEntry> e);
+        IndexEntry* findEntryByName(const String_t& name) const;
+        Stream::FileSize_t getDataStart(IndexEntry& e);
     };
 
 } } }
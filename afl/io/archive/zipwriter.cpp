@@ -0,0 +1,458 @@
+/**
+  *  \file afl/io/archive/zipwriter.cpp
+  *  \brief Class afl::io::archive::ZipWriter
+  */
+
+#include "afl/io/archive/zipwriter.hpp"
+#include "afl/base/growablememory.hpp"
+#include "afl/checksums/crc32.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/except/filetooshortexception.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/transformdatasink.hpp"
+#include "afl/string/messages.hpp"
+#include "afl/sys/parsedtime.hpp"
+
+namespace {
+    // General flags
+    const uint16_t gfDataDescriptor  = 8;
+    const uint16_t gfUnicodeName     = 2048;
+
+    // Compression methods
+    const uint16_t cmStored   = 0;
+    const uint16_t cmDeflated = 8;
+
+    // Versions
+    const uint16_t VERSION_DEFAULT = 20;        // 2.0: Deflate, data descriptor
+    const uint16_t VERSION_ZIP64   = 45;        // 4.5: ZIP64
+
+    // Largest values for header fields; larger values need ZIP64
+    const uint16_t MAX_16 = 0xFFFF;
+    const uint32_t MAX_32 = 0xFFFFFFFF;
+
+    // Copy buffer size
+    const size_t BUFFER_SIZE = 16384;
+
+    typedef afl::io::Stream::FileSize_t FileSize_t;
+    typedef afl::base::GrowableBytes_t Buffer_t;
+
+    void put16(Buffer_t& out, uint16_t value)
+    {
+        out.append(uint8_t(value));
+        out.append(uint8_t(value >> 8));
+    }
+
+    void put32(Buffer_t& out, uint32_t value)
+    {
+        put16(out, uint16_t(value));
+        put16(out, uint16_t(value >> 16));
+    }
+
+    void put64(Buffer_t& out, uint64_t value)
+    {
+        put32(out, uint32_t(value));
+        put32(out, uint32_t(value >> 32));
+    }
+
+    /* Store a 32-bit size field; saturate if it needs ZIP64. */
+    void putSize32(Buffer_t& out, FileSize_t value)
+    {
+        put32(out, value >= MAX_32 ? MAX_32 : uint32_t(value));
+    }
+
+    /* Convert time into MS-DOS format (time in low half, date in high half). */
+    uint32_t packTime(const afl::sys::Time& time)
+    {
+        if (time.isValid()) {
+            afl::sys::ParsedTime pt;
+            time.unpack(pt, afl::sys::Time::LocalTime);
+            if (pt.m_year >= 1980 && pt.m_year < 2108) {
+                uint32_t date = ((pt.m_year - 1980U) << 9) + (uint32_t(pt.m_month) << 5) + pt.m_day;
+                uint32_t tod = (uint32_t(pt.m_hour) << 11) + (uint32_t(pt.m_minute) << 5) + pt.m_second/2U;
+                return (date << 16) + tod;
+            }
+        }
+
+        // 1980-01-01 00:00:00
+        return ((1U << 5) + 1U) << 16;
+    }
+
+    uint16_t packMethod(afl::io::archive::ZipWriter::Method method)
+    {
+        return method == afl::io::archive::ZipWriter::Deflate ? cmDeflated : cmStored;
+    }
+}
+
+/** Central directory entry. */
+struct afl::io::archive::ZipWriter::Entry {
+    String_t name;
+    uint16_t method;
+    uint16_t flags;
+    uint32_t time;
+    uint32_t crc;
+    FileSize_t compressedSize;
+    FileSize_t uncompressedSize;
+    FileSize_t offset;
+
+    Entry(const String_t& name, uint16_t method, uint16_t flags, uint32_t time, FileSize_t offset)
+        : name(name),
+          method(method),
+          flags(flags),
+          time(time),
+          crc(0),
+          compressedSize(0),
+          uncompressedSize(0),
+          offset(offset)
+        { }
+
+    bool hasLargeSize() const
+        { return compressedSize >= MAX_32 || uncompressedSize >= MAX_32; }
+};
+
+/** Member encoder.
+    Computes the checksum of the member data and compresses it into another DataSink,
+    counting the compressed bytes. */
+class afl::io::archive::ZipWriter::Encoder : public DataSink {
+ public:
+    Encoder(Method method, DataSink& out);
+    ~Encoder();
+
+    /** Add member data.
+        \param data Data */
+    void add(afl::base::ConstBytes_t data);
+
+    /** Finish compression.
+        Writes remaining compressed data. */
+    void finish();
+
+    /** Store checksum and sizes into an entry.
+        \param e [out] Entry */
+    void storeResult(Entry& e) const;
+
+    // DataSink (receives compressed data):
+    virtual bool handleData(afl::base::ConstBytes_t& data);
+
+ private:
+    DataSink& m_out;
+    TransformDataSink m_compressor;
+    uint32_t m_crc;
+    FileSize_t m_compressedSize;
+    FileSize_t m_uncompressedSize;
+};
+
+/************************** ZipWriter::Encoder *************************/
+
+afl::io::archive::ZipWriter::Encoder::Encoder(Method method, DataSink& out)
+    : m_out(out),
+      m_compressor(*this),
+      m_crc(0),
+      m_compressedSize(0),
+      m_uncompressedSize(0)
+{
+    if (method == Deflate) {
+        m_compressor.setNewTransform(new DeflateTransform(DeflateTransform::Raw));
+    }
+}
+
+afl::io::archive::ZipWriter::Encoder::~Encoder()
+{ }
+
+void
+afl::io::archive::ZipWriter::Encoder::add(afl::base::ConstBytes_t data)
+{
+    m_crc = afl::checksums::CRC32::getDefaultInstance().add(data, m_crc);
+    m_uncompressedSize += data.size();
+    m_compressor.handleFullData(data);
+}
+
+void
+afl::io::archive::ZipWriter::Encoder::finish()
+{
+    m_compressor.flush();
+}
+
+void
+afl::io::archive::ZipWriter::Encoder::storeResult(Entry& e) const
+{
+    e.crc = m_crc;
+    e.compressedSize = m_compressedSize;
+    e.uncompressedSize = m_uncompressedSize;
+}
+
+bool
+afl::io::archive::ZipWriter::Encoder::handleData(afl::base::ConstBytes_t& data)
+{
+    m_compressedSize += data.size();
+    m_out.handleFullData(data);
+    data.reset();
+    return false;
+}
+
+/************************** ZipWriter::Member **************************/
+
+afl::io::archive::ZipWriter::Member::Member(const String_t& name, Method method, afl::base::Ref<Stream> scratch, afl::sys::Time time)
+    : DataSink(),
+      Uncopyable(),
+      m_name(name),
+      m_method(method),
+      m_scratch(scratch),
+      m_time(time),
+      m_encoder(new Encoder(method, *scratch)),
+      m_finished(false)
+{ }
+
+afl::io::archive::ZipWriter::Member::~Member()
+{ }
+
+void
+afl::io::archive::ZipWriter::Member::finish()
+{
+    if (!m_finished) {
+        m_encoder->finish();
+        m_finished = true;
+    }
+}
+
+bool
+afl::io::archive::ZipWriter::Member::handleData(afl::base::ConstBytes_t& data)
+{
+    m_encoder->add(data);
+    data.reset();
+    return false;
+}
+
+/****************************** ZipWriter ******************************/
+
+afl::io::archive::ZipWriter::ZipWriter(DataSink& out)
+    : Uncopyable(),
+      m_out(out),
+      m_offset(0),
+      m_entries(),
+      m_finished(false)
+{ }
+
+afl::io::archive::ZipWriter::~ZipWriter()
+{ }
+
+void
+afl::io::archive::ZipWriter::addStream(const String_t& name, Stream& in, Method method, afl::sys::Time time)
+{
+    // Sizes and checksum are not known yet; they go into a data descriptor.
+    Entry& e = *m_entries.pushBackNew(new Entry(name, packMethod(method), uint16_t(gfUnicodeName | gfDataDescriptor), packTime(time), m_offset));
+    writeLocalHeader(e);
+
+    Encoder enc(method, m_out);
+    Buffer_t buffer;
+    buffer.resize(BUFFER_SIZE);
+    while (1) {
+        afl::base::Bytes_t m(buffer.toMemory());
+        m.trim(in.read(m));
+        if (m.empty()) {
+            break;
+        }
+        enc.add(m);
+    }
+    enc.finish();
+    enc.storeResult(e);
+    m_offset += e.compressedSize;
+
+    writeDataDescriptor(e);
+}
+
+void
+afl::io::archive::ZipWriter::addData(const String_t& name, afl::base::ConstBytes_t data, Method method, afl::sys::Time time)
+{
+    ConstMemoryStream in(data);
+    addStream(name, in, method, time);
+}
+
+void
+afl::io::archive::ZipWriter::addMember(Member& member)
+{
+    member.finish();
+
+    // Sizes and checksum are known, so write them into the local header.
+    Entry& e = *m_entries.pushBackNew(new Entry(member.m_name, packMethod(member.m_method), gfUnicodeName, packTime(member.m_time), m_offset));
+    member.m_encoder->storeResult(e);
+    writeLocalHeader(e);
+
+    // Copy compressed data
+    Stream& in = *member.m_scratch;
+    in.setPos(0);
+    Buffer_t buffer;
+    buffer.resize(BUFFER_SIZE);
+    FileSize_t remaining = e.compressedSize;
+    while (remaining > 0) {
+        afl::base::Bytes_t m(buffer.toMemory());
+        if (remaining < m.size()) {
+            m.trim(size_t(remaining));
+        }
+        m.trim(in.read(m));
+        if (m.empty()) {
+            throw afl::except::FileTooShortException(in);
+        }
+        write(m);
+        remaining -= m.size();
+    }
+}
+
+void
+afl::io::archive::ZipWriter::finish()
+{
+    if (!m_finished) {
+        m_finished = true;
+
+        // Central directory
+        const FileSize_t dirOffset = m_offset;
+        for (size_t i = 0, n = m_entries.size(); i < n; ++i) {
+            writeCentralHeader(*m_entries[i]);
+        }
+        const FileSize_t dirSize = m_offset - dirOffset;
+        const FileSize_t numEntries = m_entries.size();
+
+        Buffer_t h;
+        const bool zip64 = (numEntries >= MAX_16 || dirSize >= MAX_32 || dirOffset >= MAX_32);
+        if (zip64) {
+            // ZIP64 end record
+            const FileSize_t endOffset = m_offset;
+            put32(h, 0x06064B50);
+            put64(h, 44);                       // size of remainder of record
+            put16(h, VERSION_ZIP64);
+            put16(h, VERSION_ZIP64);
+            put32(h, 0);                        // this disk
+            put32(h, 0);                        // disk with central directory
+            put64(h, numEntries);
+            put64(h, numEntries);
+            put64(h, dirSize);
+            put64(h, dirOffset);
+
+            // ZIP64 end locator
+            put32(h, 0x07064B50);
+            put32(h, 0);                        // disk with ZIP64 end record
+            put64(h, endOffset);
+            put32(h, 1);                        // number of disks
+        }
+
+        // End record
+        const uint16_t shortNumEntries = zip64 ? MAX_16 : uint16_t(numEntries);
+        put32(h, 0x06054B50);
+        put16(h, 0);                            // this disk
+        put16(h, 0);                            // disk with central directory
+        put16(h, shortNumEntries);
+        put16(h, shortNumEntries);
+        putSize32(h, dirSize);
+        putSize32(h, dirOffset);
+        put16(h, 0);                            // comment length
+        write(h.toMemory());
+    }
+}
+
+/** Write data to output, keeping track of the position.
+    \param data Data */
+void
+afl::io::archive::ZipWriter::write(afl::base::ConstBytes_t data)
+{
+    m_out.handleFullData(data);
+    m_offset += data.size();
+}
+
+/** Write local file header.
+    \param e Entry */
+void
+afl::io::archive::ZipWriter::writeLocalHeader(const Entry& e)
+{
+    afl::base::ConstBytes_t name = afl::string::toBytes(e.name);
+    if (name.size() > MAX_16) {
+        throw afl::except::FileProblemException(e.name, afl::string::Messages::invalidFileName());
+    }
+
+    // A streamed member may turn out to need ZIP64 after the header has been written.
+    // Therefore, it always gets a ZIP64 extra field (with zero sizes), and thus an 8-byte data descriptor.
+    const bool descriptor = (e.flags & gfDataDescriptor) != 0;
+    const bool zip64 = descriptor || e.hasLargeSize();
+
+    Buffer_t h;
+    put32(h, 0x04034B50);
+    put16(h, zip64 ? VERSION_ZIP64 : VERSION_DEFAULT);
+    put16(h, e.flags);
+    put16(h, e.method);
+    put32(h, e.time);
+    put32(h, e.crc);
+    if (zip64) {
+        put32(h, MAX_32);
+        put32(h, MAX_32);
+    } else {
+        put32(h, uint32_t(e.compressedSize));
+        put32(h, uint32_t(e.uncompressedSize));
+    }
+    put16(h, uint16_t(name.size()));
+    put16(h, zip64 ? 20 : 0);
+    h.append(name);
+    if (zip64) {
+        put16(h, 1);                            // ZIP64 extended information
+        put16(h, 16);
+        put64(h, descriptor ? 0 : e.uncompressedSize);
+        put64(h, descriptor ? 0 : e.compressedSize);
+    }
+    write(h.toMemory());
+}
+
+/** Write data descriptor.
+    Because the local header has a ZIP64 extra field, sizes are always 8 bytes.
+    \param e Entry */
+void
+afl::io::archive::ZipWriter::writeDataDescriptor(const Entry& e)
+{
+    Buffer_t h;
+    put32(h, 0x08074B50);
+    put32(h, e.crc);
+    put64(h, e.compressedSize);
+    put64(h, e.uncompressedSize);
+    write(h.toMemory());
+}
+
+/** Write central directory file header.
+    \param e Entry */
+void
+afl::io::archive::ZipWriter::writeCentralHeader(const Entry& e)
+{
+    afl::base::ConstBytes_t name = afl::string::toBytes(e.name);
+
+    // ZIP64 extended information: only the values that do not fit, in this order
+    Buffer_t extra;
+    if (e.uncompressedSize >= MAX_32) {
+        put64(extra, e.uncompressedSize);
+    }
+    if (e.compressedSize >= MAX_32) {
+        put64(extra, e.compressedSize);
+    }
+    if (e.offset >= MAX_32) {
+        put64(extra, e.offset);
+    }
+
+    Buffer_t h;
+    put32(h, 0x02014B50);
+    put16(h, VERSION_ZIP64);                    // made by
+    put16(h, extra.empty() && (e.flags & gfDataDescriptor) == 0 ? VERSION_DEFAULT : VERSION_ZIP64);
+    put16(h, e.flags);
+    put16(h, e.method);
+    put32(h, e.time);
+    put32(h, e.crc);
+    putSize32(h, e.compressedSize);
+    putSize32(h, e.uncompressedSize);
+    put16(h, uint16_t(name.size()));
+    put16(h, extra.empty() ? 0 : uint16_t(4 + extra.size()));
+    put16(h, 0);                                // comment length
+    put16(h, 0);                                // disk number
+    put16(h, 0);                                // internal attributes
+    put32(h, 0);                                // external attributes
+    putSize32(h, e.offset);
+    h.append(name);
+    if (!extra.empty()) {
+        put16(h, 1);
+        put16(h, uint16_t(extra.size()));
+        h.append(extra.toMemory());
+    }
+    write(h.toMemory());
+}
@@ -0,0 +1,135 @@
+/**
+  *  \file afl/io/archive/zipwriter.hpp
+  *  \brief Class afl::io::archive::ZipWriter
+  */
+#ifndef AFL_AFL_IO_ARCHIVE_ZIPWRITER_HPP
+#define AFL_AFL_IO_ARCHIVE_ZIPWRITER_HPP
+
+#include <memory>
+#include "afl/base/ref.hpp"
+#include "afl/base/uncopyable.hpp"
+#include "afl/container/ptrvector.hpp"
+#include "afl/io/datasink.hpp"
+#include "afl/io/stream.hpp"
+#include "afl/sys/time.hpp"
+
+namespace afl { namespace io { namespace archive {
+
+    /** ZIP file write access.
+        Writes a ZIP file into a DataSink (which can be a Stream), member by member.
+
+        Member content is checksummed and compressed while being written and never held in memory completely.
+        Because the output need not be seekable, a member added using addStream() or addData() has
+        its checksum and sizes stored in a data descriptor following the data.
+        ZIP64 records are produced as needed.
+
+        To compress multiple members in parallel, use Member objects:
+        each Member compresses into a scratch stream (e.g. a temporary file) independently,
+        and can then be added to the ZipWriter using addMember().
+
+        Member names are stored as UTF-8. They should use '/' as path separator.
+
+        Usage:
+        - construct ZipWriter
+        - call addStream(), addData(), addMember() for all members
+        - call finish() */
+    class ZipWriter : public afl::base::Uncopyable {
+     public:
+        /** Compression method. */
+        enum Method {
+            Store,              ///< Store member uncompressed.
+            Deflate             ///< Compress member using Deflate (requires DeflateTransform).
+        };
+
+        class Member;
+
+        /** Constructor.
+            \param out Output. Lifetime must exceed that of the ZipWriter. */
+        explicit ZipWriter(DataSink& out);
+
+        /** Destructor.
+            Does not implicitly call finish(). */
+        ~ZipWriter();
+
+        /** Add member from a stream.
+            Copies the stream's content from the current position until its end.
+            \param name Member name
+            \param in Stream to read
+            \param method Compression method
+            \param time Modification time. If not valid, the oldest possible time (1980) is stored. */
+        void addStream(const String_t& name, Stream& in, Method method, afl::sys::Time time = afl::sys::Time());
+
+        /** Add member from memory.
+            \param name Member name
+            \param data Content
+            \param method Compression method
+            \param time Modification time. If not valid, the oldest possible time (1980) is stored. */
+        void addData(const String_t& name, afl::base::ConstBytes_t data, Method method, afl::sys::Time time = afl::sys::Time());
+
+        /** Add pre-compressed member.
+            Finishes the member (Member::finish()) if needed, and copies its compressed content into the ZIP file.
+            \param member Member */
+        void addMember(Member& member);
+
+        /** Finish the ZIP file.
+            Writes the central directory.
+            Must be called after the last member has been added.
+            No more members can be added afterwards. */
+        void finish();
+
+     private:
+        class Encoder;
+        struct Entry;
+
+        DataSink& m_out;
+        Stream::FileSize_t m_offset;
+        afl::container::PtrVector<Entry> m_entries;
+        bool m_finished;
+
+        void write(afl::base::ConstBytes_t data);
+        void writeLocalHeader(const Entry& e);
+        void writeDataDescriptor(const Entry& e);
+        void writeCentralHeader(const Entry& e);
+    };
+
+    /** Pre-compressed ZIP file member.
+        Compresses data into a scratch stream, computing the checksum on the fly.
+        Member objects are independent of each other and of the ZipWriter;
+        they can therefore be filled in parallel, in different threads.
+
+        Give data to the member using handleData() or handleFullData(),
+        then add it to the ZipWriter using ZipWriter::addMember(). */
+    class ZipWriter::Member : public DataSink, public afl::base::Uncopyable {
+     public:
+        /** Constructor.
+            \param name Member name
+            \param method Compression method
+            \param scratch Scratch stream that receives the compressed data. Should be empty.
+            \param time Modification time */
+        Member(const String_t& name, Method method, afl::base::Ref<Stream> scratch, afl::sys::Time time = afl::sys::Time());
+
+        /** Destructor. */
+        ~Member();
+
+        /** Finish compression.
+            Call after the last handleData(); afterwards, no more data can be added.
+            If not called explicitly, called by ZipWriter::addMember(). */
+        void finish();
+
+        // DataSink:
+        virtual bool handleData(afl::base::ConstBytes_t& data);
+
+     private:
+        friend class ZipWriter;
+
+        String_t m_name;
+        Method m_method;
+        afl::base::Ref<Stream> m_scratch;
+        afl::sys::Time m_time;
+        std::auto_ptr<Encoder> m_encoder;
+        bool m_finished;
+    };
+
+} } }
+
+#endif
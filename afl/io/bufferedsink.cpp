@@ -3,14 +3,21 @@
   *  \brief Class afl::io::BufferedSink
   */
 
+#include <algorithm>
 #include <cassert>
 #include "afl/io/bufferedsink.hpp"
 
-afl::io::BufferedSink::BufferedSink(DataSink& sink)
+const size_t afl::io::BufferedSink::DEFAULT_BUFFER_SIZE;
+
+afl::io::BufferedSink::BufferedSink(DataSink& sink, size_t bufferSize)
     : m_sink(sink),
-      m_buffer(m_rawBuffer),
-      m_bufferFill(0)
-{ }
+      m_buffer(),
+      m_bufferFill(0),
+      m_rawBuffer()
+{
+    m_rawBuffer.resize(std::max(bufferSize, size_t(1)));
+    m_buffer = m_rawBuffer.toMemory();
+}
 
 afl::io::BufferedSink::~BufferedSink()
 {
@@ -53,7 +60,7 @@ afl::io::BufferedSink::flush()
         tmp.trim(m_bufferFill);
 
         // Reset state
-        m_buffer = m_rawBuffer;
+        m_buffer = m_rawBuffer.toMemory();
         m_bufferFill = 0;
 
         // Write data
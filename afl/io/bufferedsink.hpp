@@ -6,18 +6,24 @@
 #define AFL_AFL_IO_BUFFEREDSINK_HPP
 
 #include "afl/io/datasink.hpp"
+#include "afl/base/growablememory.hpp"
 #include "afl/base/uncopyable.hpp"
 
 namespace afl { namespace io {
 
     /** Buffered data sink.
         Attempts to increase efficiency by writing larger blocks.
-        Small data blocks are combined before being written. */
+        Small data blocks are combined before being written;
+        blocks larger than the buffer are passed through directly. */
     class BufferedSink : public DataSink, private afl::base::Uncopyable {
      public:
+        /** Default buffer size. */
+        static const size_t DEFAULT_BUFFER_SIZE = 16384;
+
         /** Constructor.
-            \param sink Data sink that receives the buffered data. Lifetime must exceed that of the BufferedSink. */
-        BufferedSink(DataSink& sink);
+            \param sink Data sink that receives the buffered data. Lifetime must exceed that of the BufferedSink.
+            \param bufferSize Buffer size */
+        BufferedSink(DataSink& sink, size_t bufferSize = DEFAULT_BUFFER_SIZE);
 
         // DataSink:
         virtual ~BufferedSink();
@@ -38,7 +44,7 @@ namespace afl { namespace io {
         size_t m_bufferFill;
 
         /** Buffer data. Accessed through m_buffer. */
-        uint8_t m_rawBuffer[1024];
+        afl::base::GrowableBytes_t m_rawBuffer;
     };
 
 } }
@@ -10,13 +10,18 @@
 #include "afl/string/messages.hpp"
 #include "afl/io/filemapping.hpp"
 
-afl::io::BufferedStream::BufferedStream(Stream& s)
+const size_t afl::io::BufferedStream::DEFAULT_BUFFER_SIZE;
+
+afl::io::BufferedStream::BufferedStream(Stream& s, size_t bufferSize)
     : MultiplexableStream(),
       m_mode(Neutral),
       m_stream(s),
       m_buffer(),
-      m_bufferFill(0)
-{ }
+      m_bufferFill(0),
+      m_rawBuffer()
+{
+    m_rawBuffer.resize(std::max(bufferSize, size_t(1)));
+}
 
 afl::io::BufferedStream::~BufferedStream()
 {
@@ -33,13 +38,31 @@ afl::io::BufferedStream::~BufferedStream()
 size_t
 afl::io::BufferedStream::read(Bytes_t m)
 {
-    // Quick, simple, dirty
+    setMode(Reading);
     size_t did = 0;
-    uint8_t* pout;
-    const uint8_t* pin;
-    while ((pout = m.eat()) != 0 && (pin = readByte()) != 0) {
-        *pout = *pin;
-        ++did;
+    while (!m.empty()) {
+        if (m_buffer.empty()) {
+            if (m.size() >= m_rawBuffer.size()) {
+                // More than one buffer full: read directly.
+                size_t now = m_stream.read(m);
+                if (now == 0) {
+                    break;
+                }
+                did += now;
+                m.split(now);
+                continue;
+            }
+            refillBuffer();
+            if (m_buffer.empty()) {
+                break;
+            }
+        }
+
+        // Read from buffer
+        size_t copied = m.copyFrom(m_buffer).size();
+        m.split(copied);
+        m_buffer.split(copied);
+        did += copied;
     }
     return did;
 }
@@ -134,6 +157,13 @@ afl::io::BufferedStream::createFileMapping(FileSize_t limit)
     return m_stream.createFileMapping(limit);
 }
 
+afl::base::Ptr<afl::io::FileMapping>
+afl::io::BufferedStream::createWritableFileMapping(FileSize_t limit, bool shared)
+{
+    setMode(Neutral);
+    return m_stream.createWritableFileMapping(limit, shared);
+}
+
 void
 afl::io::BufferedStream::flush()
 {
@@ -201,7 +231,7 @@ afl::io::BufferedStream::setMode(Mode m)
                 m_mode = Neutral;
                 throw afl::except::FileProblemException(m_stream, afl::string::Messages::cannotWrite());
             }
-            m_buffer = m_rawBuffer;
+            m_buffer = m_rawBuffer.toMemory();
             m_bufferFill = 0;
             break;
 
@@ -223,7 +253,7 @@ afl::io::BufferedStream::refillBuffer()
     assert(m_mode == Reading);
     assert(m_buffer.empty());
 
-    m_buffer = m_rawBuffer;
+    m_buffer = m_rawBuffer.toMemory();
     m_buffer.trim(m_stream.read(m_buffer));
 }
 
@@ -237,6 +267,6 @@ afl::io::BufferedStream::flushBuffer()
         m_stream.fullWrite(m_buffer);
     }
 
-    m_buffer = m_rawBuffer;
+    m_buffer = m_rawBuffer.toMemory();
     m_bufferFill = 0;
 }
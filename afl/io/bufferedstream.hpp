@@ -6,6 +6,7 @@
 #define AFL_AFL_IO_BUFFEREDSTREAM_HPP
 
 #include "afl/io/stream.hpp"
+#include "afl/base/growablememory.hpp"
 #include "afl/base/memory.hpp"
 #include "afl/base/uncopyable.hpp"
 #include "afl/io/multiplexablestream.hpp"
@@ -17,12 +18,18 @@ namespace afl { namespace io {
         so that small read() and write() calls do not immediately go down to the underlying stream,
         but go through a buffer, saving system calls.
 
-        BufferedStream also enriches the Stream interface with methods for bytewise read. */
+        BufferedStream also enriches the Stream interface with methods for bytewise read.
+
+        Reads and writes that are larger than the buffer bypass it and go to the underlying stream directly. */
     class BufferedStream : public MultiplexableStream, public afl::base::Uncopyable {
      public:
+        /** Default buffer size. */
+        static const size_t DEFAULT_BUFFER_SIZE = 16384;
+
         /** Constructor.
-            \param s Underlying stream. Lifetime must be managed such that \c s outlives the BufferedStream object. */
-        BufferedStream(Stream& s);
+            \param s Underlying stream. Lifetime must be managed such that \c s outlives the BufferedStream object.
+            \param bufferSize Buffer size. Larger buffers save system calls when processing large files sequentially. */
+        BufferedStream(Stream& s, size_t bufferSize = DEFAULT_BUFFER_SIZE);
 
         /** Destructor. */
         virtual ~BufferedStream();
@@ -36,6 +43,7 @@ namespace afl { namespace io {
         virtual uint32_t getCapabilities();
         virtual String_t getName();
         virtual afl::base::Ptr<FileMapping> createFileMapping(FileSize_t limit);
+        virtual afl::base::Ptr<FileMapping> createWritableFileMapping(FileSize_t limit, bool shared);
 
         /*
          *  BufferedStream methods:
@@ -89,7 +97,7 @@ namespace afl { namespace io {
         size_t m_bufferFill;
 
         /** Buffer data. Accessed through m_buffer. */
-        uint8_t m_rawBuffer[1024];
+        afl::base::GrowableBytes_t m_rawBuffer;
 
         /** Set mode. Prepares for the operation specified as \c m.
             \param m New operation. */
@@ -0,0 +1,26 @@
+/**
+  *  \file afl/io/charsettransform.cpp
+  *  \brief Class afl::io::CharsetTransform
+  */
+
+#include "afl/io/charsettransform.hpp"
+
+afl::io::CharsetTransform::CharsetTransform(const afl::charset::Charset& cs, Direction dir)
+    : Transform(),
+      m_transcoder(dir == Encode ? cs.createEncoder() : cs.createDecoder())
+{ }
+
+afl::io::CharsetTransform::~CharsetTransform()
+{ }
+
+void
+afl::io::CharsetTransform::transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    m_transcoder->transcode(in, out);
+}
+
+void
+afl::io::CharsetTransform::flush()
+{
+    m_transcoder->flush();
+}
@@ -0,0 +1,47 @@
+/**
+  *  \file afl/io/charsettransform.hpp
+  *  \brief Class afl::io::CharsetTransform
+  */
+#ifndef AFL_AFL_IO_CHARSETTRANSFORM_HPP
+#define AFL_AFL_IO_CHARSETTRANSFORM_HPP
+
+#include <memory>
+#include "afl/io/transform.hpp"
+#include "afl/charset/charset.hpp"
+#include "afl/charset/transcoder.hpp"
+
+namespace afl { namespace io {
+
+    /** Character set conversion as Transform.
+        Adapts a streaming encoder or decoder (afl::charset::Transcoder) of a Charset to the Transform interface,
+        so that character set conversion can be used with TransformReaderStream or TransformDataSink.
+
+        For example, to read a Latin-1 file as UTF-8, use
+        <code>CharsetTransform(CodepageCharset(g_codepageLatin1), CharsetTransform::Decode)</code>. */
+    class CharsetTransform : public Transform {
+     public:
+        /** Direction of conversion. */
+        enum Direction {
+            Encode,                 ///< Convert UTF-8 into the charset (Charset::encode()).
+            Decode                  ///< Convert the charset into UTF-8 (Charset::decode()).
+        };
+
+        /** Constructor.
+            \param cs Character set. Need not live longer than the CharsetTransform.
+            \param dir Direction */
+        CharsetTransform(const afl::charset::Charset& cs, Direction dir);
+
+        /** Destructor. */
+        ~CharsetTransform();
+
+        // Transform:
+        virtual void transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+        virtual void flush();
+
+     private:
+        std::auto_ptr<afl::charset::Transcoder> m_transcoder;
+    };
+
+} }
+
+#endif
@@ -13,11 +13,22 @@
 /*
  *  ZLIB is available - real version
  */
+# include <deque>
 # include <zlib.h>
 # include "afl/except/invaliddataexception.hpp"
 # include "afl/string/messages.hpp"
 # include "afl/bits/value.hpp"
+# include "afl/bits/uint32be.hpp"
 # include "afl/bits/uint32le.hpp"
+# include "afl/base/growablememory.hpp"
+# include "afl/base/stoppable.hpp"
+# include "afl/checksums/adler32.hpp"
+# include "afl/container/ptrqueue.hpp"
+# include "afl/container/ptrvector.hpp"
+# include "afl/sys/mutex.hpp"
+# include "afl/sys/mutexguard.hpp"
+# include "afl/sys/semaphore.hpp"
+# include "afl/sys/thread.hpp"
 namespace {
     static const uint8_t DEFAULT_GZIP_HEADER[] = {
         0x1F, 0x8B, // magic
@@ -28,6 +39,14 @@ namespace {
         255         // OS
     };
 
+    static const uint8_t DEFAULT_ZLIB_HEADER[] = {
+        0x78,       // method 8, window size 32k
+        0x9C        // default level, check bits
+    };
+
+    /* Size of the deflate window, i.e. maximum useful dictionary size. */
+    const size_t WINDOW_SIZE = 32768;
+
     inline unsigned int convertSize(size_t sz)
     {
         static const unsigned int maxValue = ~0U;
@@ -239,6 +258,366 @@ afl::io::DeflateTransform::Impl::reportError(int code)
     }
     throw afl::except::InvalidDataException(message);
 }
+
+/*
+ *  Parallel compression
+ *
+ *  The main thread cuts the input into blocks. Each block is compressed by a worker
+ *  into a raw deflate fragment, primed with the end of the previous block as dictionary.
+ *  All fragments except the last end with a sync flush (which aligns to a byte boundary
+ *  and does not set the "final" bit), so they can simply be concatenated.
+ *  The main thread retires blocks in order, combining their checksums.
+ *
+ *  Locking: m_queueMutex protects m_queue and m_stop.
+ *  A Job is owned by the main thread except between being queued and having its done semaphore posted.
+ */
+
+class afl::io::DeflateTransform::ParallelImpl {
+    struct GzipTrailer {
+        afl::bits::Value<afl::bits::UInt32LE> crc32;
+        afl::bits::Value<afl::bits::UInt32LE> bytes;
+    };
+    struct ZlibTrailer {
+        afl::bits::Value<afl::bits::UInt32BE> adler32;
+    };
+ public:
+    ParallelImpl(Personality pers, size_t numThreads);
+    ~ParallelImpl();
+
+    void transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+    void flush();
+
+ private:
+    struct Job;
+    class Worker;
+
+    enum State {
+        PrepareHeader,
+        Compressing,
+        PrepareTrailer,
+        EndReached
+    };
+
+    // Main thread:
+    const Personality m_personality;
+    const afl::checksums::CRC32& m_crc;
+    State m_state;
+    bool m_flushing;
+    bool m_lastSubmitted;
+    const size_t m_maxJobs;
+
+    afl::base::ConstBytes_t m_pending;
+    GzipTrailer m_gzipTrailer;
+    ZlibTrailer m_zlibTrailer;
+    uint32_t m_check;
+    uint32_t m_size;
+
+    std::auto_ptr<Job> m_current;           ///< Block being collected.
+    afl::base::GrowableBytes_t m_tail;      ///< Dictionary for next block.
+    afl::container::PtrQueue<Job> m_jobs;   ///< Submitted jobs, in order.
+    std::auto_ptr<Job> m_outputJob;         ///< Job whose output is in m_pending.
+
+    // Shared with workers:
+    afl::sys::Mutex m_queueMutex;
+    std::deque<Job*> m_queue;
+    afl::sys::Semaphore m_wake;
+    bool m_stop;
+
+    // Threads: must be last
+    afl::container::PtrVector<Worker> m_workers;
+    afl::container::PtrVector<afl::sys::Thread> m_threads;
+
+    void submitJob();
+    void retireJob();
+    void runWorker();
+    void compressJob(Job& job);
+};
+
+struct afl::io::DeflateTransform::ParallelImpl::Job {
+    afl::base::GrowableBytes_t input;
+    afl::base::GrowableBytes_t dictionary;
+    afl::base::GrowableBytes_t output;
+    bool isLast;
+    uint32_t check;
+    String_t error;
+    afl::sys::Semaphore done;
+
+    Job()
+        : input(), dictionary(), output(), isLast(false), check(0), error(), done(0)
+        { }
+};
+
+class afl::io::DeflateTransform::ParallelImpl::Worker : public afl::base::Stoppable {
+ public:
+    Worker(ParallelImpl& parent)
+        : m_parent(parent)
+        { }
+    virtual void run()
+        { m_parent.runWorker(); }
+    virtual void stop()
+        {
+            // ParallelImpl's destructor stops all workers at once before joining them.
+        }
+ private:
+    ParallelImpl& m_parent;
+};
+
+afl::io::DeflateTransform::ParallelImpl::ParallelImpl(Personality pers, size_t numThreads)
+    : m_personality(pers),
+      m_crc(afl::checksums::CRC32::getDefaultInstance()),
+      m_state(PrepareHeader),
+      m_flushing(false),
+      m_lastSubmitted(false),
+      m_maxJobs(2*numThreads),
+      m_pending(),
+      m_gzipTrailer(),
+      m_zlibTrailer(),
+      m_check(pers == Zlib ? 1 : 0),
+      m_size(0),
+      m_current(),
+      m_tail(),
+      m_jobs(),
+      m_outputJob(),
+      m_queueMutex(),
+      m_queue(),
+      m_wake(0),
+      m_stop(false),
+      m_workers(),
+      m_threads()
+{
+    for (size_t i = 0; i < numThreads; ++i) {
+        Worker* w = m_workers.pushBackNew(new Worker(*this));
+        m_threads.pushBackNew(new afl::sys::Thread("DeflateTransform", *w))->start();
+    }
+}
+
+afl::io::DeflateTransform::ParallelImpl::~ParallelImpl()
+{
+    {
+        afl::sys::MutexGuard g(m_queueMutex);
+        m_stop = true;
+    }
+    for (size_t i = 0, n = m_threads.size(); i < n; ++i) {
+        m_wake.post();
+    }
+    m_threads.clear();
+}
+
+void
+afl::io::DeflateTransform::ParallelImpl::transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    size_t outIndex = 0;
+    while (1) {
+        // Deliver pending output
+        size_t did = out.subrange(outIndex).copyFrom(m_pending).size();
+        m_pending.split(did);
+        outIndex += did;
+        if (!m_pending.empty()) {
+            break;
+        }
+
+        const bool haveRoom = (outIndex < out.size());
+        if (m_state == PrepareHeader) {
+            // Header
+            switch (m_personality) {
+             case Gzip:
+                m_pending = DEFAULT_GZIP_HEADER;
+                break;
+
+             case Zlib:
+                m_pending = DEFAULT_ZLIB_HEADER;
+                break;
+
+             case Raw:
+                break;
+            }
+            m_state = Compressing;
+        } else if (m_state == Compressing) {
+            // Accept input
+            if (m_current.get() == 0) {
+                m_current.reset(new Job());
+            }
+            if (!in.empty() && m_current->input.size() < BLOCK_SIZE) {
+                m_current->input.append(in.split(BLOCK_SIZE - m_current->input.size()));
+            }
+
+            if (!m_jobs.empty() && m_jobs.front()->done.wait(0)) {
+                // Oldest job completed
+                retireJob();
+            } else if (m_current->input.size() >= BLOCK_SIZE && m_jobs.size() < m_maxJobs) {
+                // Block complete
+                submitJob();
+            } else if (m_flushing && in.empty() && !m_lastSubmitted) {
+                // Final block (possibly empty)
+                m_current->isLast = true;
+                m_lastSubmitted = true;
+                submitJob();
+            } else if (m_lastSubmitted && m_jobs.empty()) {
+                // Everything done
+                m_state = PrepareTrailer;
+            } else if (haveRoom && !m_jobs.empty() && (m_lastSubmitted || m_current->input.size() >= BLOCK_SIZE)) {
+                // Cannot proceed without a result; wait for it
+                m_jobs.front()->done.wait();
+                retireJob();
+            } else {
+                // Cannot proceed at all: input buffered, or output full
+                break;
+            }
+        } else if (m_state == PrepareTrailer) {
+            // Trailer
+            switch (m_personality) {
+             case Gzip:
+                m_gzipTrailer.crc32 = m_check;
+                m_gzipTrailer.bytes = m_size;
+                m_pending = afl::base::fromObject(m_gzipTrailer);
+                break;
+
+             case Zlib:
+                m_zlibTrailer.adler32 = m_check;
+                m_pending = afl::base::fromObject(m_zlibTrailer);
+                break;
+
+             case Raw:
+                break;
+            }
+            m_state = EndReached;
+        } else {
+            // EndReached
+            break;
+        }
+    }
+    out.trim(outIndex);
+}
+
+inline void
+afl::io::DeflateTransform::ParallelImpl::flush()
+{
+    m_flushing = true;
+}
+
+/** Submit current job to the worker threads. */
+void
+afl::io::DeflateTransform::ParallelImpl::submitJob()
+{
+    // Prime with previous block's tail; remember this block's tail for the next one
+    Job* job = m_current.release();
+    job->dictionary.swap(m_tail);
+    afl::base::ConstBytes_t input(job->input);
+    if (input.size() > WINDOW_SIZE) {
+        input.split(input.size() - WINDOW_SIZE);
+    }
+    m_tail.clear();
+    m_tail.append(input);
+
+    m_jobs.pushBackNew(job);
+    {
+        afl::sys::MutexGuard g(m_queueMutex);
+        m_queue.push_back(job);
+    }
+    m_wake.post();
+}
+
+/** Retire oldest job.
+    Its done semaphore must have been consumed. */
+void
+afl::io::DeflateTransform::ParallelImpl::retireJob()
+{
+    m_outputJob.reset(m_jobs.extractFront());
+    if (!m_outputJob->error.empty()) {
+        m_state = EndReached;
+        throw afl::except::InvalidDataException(m_outputJob->error);
+    }
+
+    // Update checksum and size (m_size is defined as being mod 2**32, overflow is ok)
+    const size_t n = m_outputJob->input.size();
+    if (m_personality == Zlib) {
+        m_check = uint32_t(adler32_combine(m_check, m_outputJob->check, z_off_t(n)));
+    } else {
+        m_check = m_crc.combine(m_check, m_outputJob->check, n);
+    }
+    m_size += uint32_t(n);
+
+    m_pending = m_outputJob->output;
+}
+
+/** Worker thread main loop. */
+void
+afl::io::DeflateTransform::ParallelImpl::runWorker()
+{
+    while (1) {
+        m_wake.wait();
+        Job* job;
+        {
+            afl::sys::MutexGuard g(m_queueMutex);
+            if (m_stop) {
+                break;
+            }
+            job = m_queue.front();
+            m_queue.pop_front();
+        }
+        try {
+            compressJob(*job);
+        }
+        catch (std::exception& e) {
+            job->error = e.what();
+        }
+        job->done.post();
+    }
+}
+
+/** Compress one block.
+    Runs in a worker thread.
+    \param job Job */
+void
+afl::io::DeflateTransform::ParallelImpl::compressJob(Job& job)
+{
+    // Checksum
+    if (m_personality == Zlib) {
+        job.check = afl::checksums::Adler32().add(job.input, 1);
+    } else {
+        job.check = m_crc.add(job.input, 0);
+    }
+
+    // Compress
+    z_stream zs = z_stream();
+    int result = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (result == Z_OK && !job.dictionary.empty()) {
+        result = deflateSetDictionary(&zs, job.dictionary.unsafeData(), convertSize(job.dictionary.size()));
+    }
+    if (result == Z_OK) {
+        const int mode = (job.isLast ? Z_FINISH : Z_SYNC_FLUSH);
+        size_t have = 0;
+        job.output.resize(deflateBound(&zs, uLong(job.input.size())) + 16);
+        zs.next_in = job.input.unsafeData();
+        zs.avail_in = convertSize(job.input.size());
+        while (1) {
+            zs.next_out = job.output.unsafeData() + have;
+            zs.avail_out = convertSize(job.output.size() - have);
+            result = deflate(&zs, mode);
+            have = job.output.size() - zs.avail_out;
+            if (result == Z_STREAM_END) {
+                result = Z_OK;
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                break;
+            }
+            if (!job.isLast && zs.avail_in == 0 && zs.avail_out != 0) {
+                // Sync flush complete
+                result = Z_OK;
+                break;
+            }
+            job.output.resize(2*job.output.size());
+        }
+        job.output.resize(have);
+    }
+    if (result != Z_OK) {
+        job.error = afl::string::Messages::unexpectedError();
+        job.error += ": ";
+        job.error += zError(result);
+    }
+    deflateEnd(&zs);
+}
 #else
 /*
  *  No ZLIB available - dummy version
@@ -258,10 +637,30 @@ class afl::io::DeflateTransform::Impl {
     static bool isAvailable()
         { return false; }
 };
+
+class afl::io::DeflateTransform::ParallelImpl {
+ public:
+    ParallelImpl(Personality /*pers*/, size_t /*numThreads*/)
+        { throw afl::except::UnsupportedException("deflate"); }
+
+    void transform(afl::base::ConstBytes_t& /*in*/, afl::base::Bytes_t& out)
+        { out.reset(); }
+
+    void flush()
+        { }
+};
 #endif
 
+const size_t afl::io::DeflateTransform::BLOCK_SIZE;
+
 afl::io::DeflateTransform::DeflateTransform(Personality personality)
-    : m_pImpl(new Impl(personality))
+    : m_pImpl(new Impl(personality)),
+      m_pParallelImpl()
+{ }
+
+afl::io::DeflateTransform::DeflateTransform(Personality personality, size_t numThreads)
+    : m_pImpl(numThreads > 1 ? 0 : new Impl(personality)),
+      m_pParallelImpl(numThreads > 1 ? new ParallelImpl(personality, numThreads) : 0)
 { }
 
 afl::io::DeflateTransform::~DeflateTransform()
@@ -270,13 +669,21 @@ afl::io::DeflateTransform::~DeflateTransform()
 void
 afl::io::DeflateTransform::transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
 {
-    return m_pImpl->transform(in, out);
+    if (m_pParallelImpl.get() != 0) {
+        m_pParallelImpl->transform(in, out);
+    } else {
+        m_pImpl->transform(in, out);
+    }
 }
 
 void
 afl::io::DeflateTransform::flush()
 {
-    m_pImpl->flush();
+    if (m_pParallelImpl.get() != 0) {
+        m_pParallelImpl->flush();
+    } else {
+        m_pImpl->flush();
+    }
 }
 
 bool
@@ -16,7 +16,15 @@ namespace afl { namespace io {
         <b>Conditional availability:</b>
         If zlib was not available when building afl, this class will refuse being constructed
         by throwing an afl::except::UnsupportedException.
-        You can use isAvailable() to check availability beforehand. */
+        You can use isAvailable() to check availability beforehand.
+
+        <b>Parallel compression:</b>
+        If constructed with more than one thread, the input is split into blocks of BLOCK_SIZE bytes
+        that are compressed independently by a pool of worker threads,
+        each primed with the last 32k of the preceding block as dictionary.
+        The blocks are stitched together into a single valid deflate stream,
+        and the checksum (CRC32 for gzip, Adler-32 for zlib) is combined from per-block checksums.
+        This produces slightly larger output than single-threaded compression. */
     class DeflateTransform : public Transform {
      public:
         /** Personality (stream type). */
@@ -30,6 +38,12 @@ namespace afl { namespace io {
             \param personality Personality (stream type) */
         explicit DeflateTransform(Personality personality);
 
+        /** Constructor for parallel compression.
+            \param personality Personality (stream type)
+            \param numThreads  Number of worker threads. 0 or 1 means to compress in the calling thread,
+                               just like the single-argument constructor. */
+        DeflateTransform(Personality personality, size_t numThreads);
+
         /** Destructor. */
         ~DeflateTransform();
 
@@ -42,9 +56,14 @@ namespace afl { namespace io {
             \retval false zlib functionality is not available; constructing DeflateDataSink will fail */
         static bool isAvailable();
 
+        /** Block size for parallel compression. */
+        static const size_t BLOCK_SIZE = 128*1024;
+
      private:
         class Impl;
+        class ParallelImpl;
         std::auto_ptr<Impl> m_pImpl;
+        std::auto_ptr<ParallelImpl> m_pParallelImpl;
     };
 
 } }
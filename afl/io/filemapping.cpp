@@ -0,0 +1,16 @@
+/**
+  *  \file afl/io/filemapping.cpp
+  *  \brief Class afl::io::FileMapping
+  */
+
+#include "afl/io/filemapping.hpp"
+
+afl::base::Bytes_t
+afl::io::FileMapping::getWritable()
+{
+    return afl::base::Nothing;
+}
+
+void
+afl::io::FileMapping::advise(Advice /*advice*/)
+{ }
@@ -11,7 +11,7 @@
 
 namespace afl { namespace io {
 
-    /** Read-only file mapping.
+    /** File mapping.
         Maps (a section of) a file into memory for reading.
         Use Stream::createFileMapping() or Stream::createVirtualMapping() to create an instance of this class.
         - createVirtualMapping() will create a real, operating-system supported mapping if possible,
@@ -27,15 +27,44 @@ namespace afl { namespace io {
         Small files are more efficiently accessed by reading normally (you could use InternalFileMapping directly);
         large files may eat up too much of the process' address space
         (or real memory, if an operating-system supported mapping is not available).
+        To process large files, map them in windows:
+        use Stream::setPos() to select the start of a window, and Stream::createFileMapping() with a limit to map it.
+        Use advise() to tell the operating system how you are going to access the data.
 
         There are no restrictions about sizes and positions;
         if unaligned mappings are attempted, those are enlarged to match page borders.
-        It is unspecified, whether (and when) modifications to the underlying file show up in the mapping. */
+        It is unspecified, whether (and when) modifications to the underlying file show up in the mapping.
+
+        Stream::createWritableFileMapping() creates a mapping that can also be modified, using getWritable().
+        Modifications are written back to the file if requested (shared mapping);
+        otherwise, they are private to this mapping and discarded when it is destroyed. */
     class FileMapping : public afl::base::Deletable, public afl::base::RefCounted {
      public:
+        /** Access pattern hint. */
+        enum Advice {
+            NormalAccess,       ///< No particular access pattern.
+            SequentialAccess,   ///< Data will be accessed sequentially. Read ahead aggressively, release data early.
+            RandomAccess,       ///< Data will be accessed randomly. Read-ahead is not useful.
+            WillNeed,           ///< Data will be accessed soon. Start reading it now.
+            DontNeed,           ///< Data will not be accessed soon. Memory can be released.
+            HugePages           ///< Use huge pages if possible. Reduces TLB pressure for large mappings.
+        };
+
         /** Get content of file mapping.
             \return Memory descriptor, describing content of the mapped file */
         virtual afl::base::ConstBytes_t get() const = 0;
+
+        /** Get writable content of file mapping.
+            The default implementation returns an empty descriptor, meaning the mapping is not writable.
+            \return Memory descriptor, describing the same memory as get(), or empty */
+        virtual afl::base::Bytes_t getWritable();
+
+        /** Give access pattern hint.
+            This does not change the content of the mapping, and may be ignored by implementations.
+            Hints can be combined by calling this function multiple times (e.g. RandomAccess, then HugePages).
+            The default implementation ignores the hint.
+            \param advice Hint */
+        virtual void advise(Advice advice);
     };
 
 } }
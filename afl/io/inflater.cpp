@@ -0,0 +1,867 @@
+/**
+  *  \file afl/io/inflater.cpp
+  *  \brief Class afl::io::Inflater
+  *
+  *  Huffman decoding tables are arrays of uint32_t entries:
+  *    bits 0-4    number of bits to consume
+  *    bits 5-7    kind (see below)
+  *    bits 8-11   number of extra bits (Base), index bits (Subtable), or bits of first literal (LiteralPair)
+  *    bits 16-31  value
+  *  The root table is indexed with the next rootBits bits of input.
+  *  Codes longer than rootBits are resolved through a subtable, appended to the root table.
+  *
+  *  Decoded data is written to a linear window. Matches are copied within the window,
+  *  eight bytes at a time if possible; the window has some slack at the end to allow overshooting.
+  *  When the window is nearly full (and all data has been delivered), the last 32k are moved to its beginning.
+  *
+  *  The fast path (decodeFast) is used when there is plenty of input and window space.
+  *  It refills the bit buffer eight bytes at a time, and gives back unused bytes when done.
+  *  Otherwise, the slow path (decode) reads input byte by byte, exactly as much as needed,
+  *  and can suspend at any point.
+  *
+  *  Both paths leave fewer than 8 bits in the bit buffer at block boundaries,
+  *  so a checkpoint needs to save only the partial last byte besides the window.
+  */
+
+#include <algorithm>
+#include <cstring>
+#include "afl/io/inflater.hpp"
+#include "afl/bits/bits.hpp"
+#include "afl/bits/uint64le.hpp"
+#include "afl/except/invaliddataexception.hpp"
+#include "afl/string/messages.hpp"
+
+namespace {
+    /* Table entry kinds */
+    const uint32_t Literal     = 0 << 5;      // value: byte
+    const uint32_t LiteralPair = 1 << 5;      // value: first byte + 256*second byte
+    const uint32_t Base        = 2 << 5;      // value: length/distance base, plus extra bits
+    const uint32_t EndOfBlock  = 3 << 5;
+    const uint32_t Subtable    = 4 << 5;      // value: subtable index, plus index bits
+    const uint32_t Invalid     = 5 << 5;
+    const uint32_t KIND_MASK   = 7 << 5;
+
+    /* Table sizes */
+    const uint32_t LITERAL_ROOT_BITS     = 11;
+    const uint32_t DISTANCE_ROOT_BITS    = 8;
+    const uint32_t CODE_LENGTH_ROOT_BITS = 7;
+
+    const uint32_t NUM_LITERAL_CODES  = 288;
+    const uint32_t NUM_DISTANCE_CODES = 32;
+    const uint32_t NUM_CODE_LENGTH_CODES = 19;
+    const uint32_t MAX_CODE_LENGTH = 15;
+
+    /* Window */
+    const size_t WINDOW_SIZE = 32768;
+    const size_t BUFFER_SIZE = 4*WINDOW_SIZE;
+    const size_t BUFFER_SLACK = 8;
+    const size_t MAX_MATCH = 258;
+
+    /* Symbol definitions */
+    const uint16_t LENGTH_BASE[] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    const uint8_t LENGTH_EXTRA[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    const uint16_t DISTANCE_BASE[] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+    };
+    const uint8_t DISTANCE_EXTRA[] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    const uint8_t CODE_LENGTH_ORDER[NUM_CODE_LENGTH_CODES] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+
+    /* Entry access */
+    inline uint32_t makeEntry(uint32_t bits, uint32_t kind, uint32_t extra, uint32_t value)
+    {
+        return bits | kind | (extra << 8) | (value << 16);
+    }
+    inline uint32_t getEntryBits(uint32_t e)
+    {
+        return e & 31;
+    }
+    inline uint32_t getEntryKind(uint32_t e)
+    {
+        return e & KIND_MASK;
+    }
+    inline uint32_t getEntryExtra(uint32_t e)
+    {
+        return (e >> 8) & 15;
+    }
+    inline uint32_t getEntryValue(uint32_t e)
+    {
+        return e >> 16;
+    }
+
+    /* Bit mask */
+    inline uint64_t mask(uint32_t n)
+    {
+        return (uint64_t(1) << n) - 1;
+    }
+
+    /* Symbol definitions for literal/length alphabet */
+    uint32_t getLiteralSymbol(uint32_t sym)
+    {
+        if (sym < 256) {
+            return makeEntry(0, Literal, 0, sym);
+        } else if (sym == 256) {
+            return makeEntry(0, EndOfBlock, 0, 0);
+        } else if (sym - 257 < sizeof(LENGTH_BASE)/sizeof(LENGTH_BASE[0])) {
+            return makeEntry(0, Base, LENGTH_EXTRA[sym - 257], LENGTH_BASE[sym - 257]);
+        } else {
+            return makeEntry(0, Invalid, 0, 0);
+        }
+    }
+
+    /* Symbol definitions for distance alphabet */
+    uint32_t getDistanceSymbol(uint32_t sym)
+    {
+        if (sym < sizeof(DISTANCE_BASE)/sizeof(DISTANCE_BASE[0])) {
+            return makeEntry(0, Base, DISTANCE_EXTRA[sym], DISTANCE_BASE[sym]);
+        } else {
+            return makeEntry(0, Invalid, 0, 0);
+        }
+    }
+
+    /* Symbol definitions for code length alphabet */
+    uint32_t getCodeLengthSymbol(uint32_t sym)
+    {
+        return makeEntry(0, Literal, 0, sym);
+    }
+
+    /* Report invalid data */
+    void fail(const char* what)
+    {
+        String_t message = afl::string::Messages::invalidCompressedData();
+        message += ": ";
+        message += what;
+        throw afl::except::InvalidDataException(message);
+    }
+
+    /* Build decoding table.
+       \param table    [out] Table
+       \param rootBits [in] Number of index bits for root table
+       \param lengths  [in] Code lengths, one per symbol (0=symbol not used)
+       \param n        [in] Number of symbols
+       \param symbol   [in] Symbol definitions
+       \param allowSingle [in] Accept an incomplete code if it has at most one symbol of length 1
+                        (like zlib, for distance codes; unused codes decode as Invalid)
+       \retval false Code is over-subscribed or incomplete */
+    bool buildTable(std::vector<uint32_t>& table, uint32_t rootBits, const uint8_t* lengths, uint32_t n, uint32_t symbol(uint32_t), bool allowSingle)
+    {
+        // Count codes per length, and verify that code is neither over-subscribed nor incomplete.
+        uint32_t count[MAX_CODE_LENGTH+1];
+        for (uint32_t i = 0; i <= MAX_CODE_LENGTH; ++i) {
+            count[i] = 0;
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            ++count[lengths[i]];
+        }
+        count[0] = 0;
+
+        int32_t left = 1;
+        uint32_t numCodes = 0;
+        for (uint32_t len = 1; len <= MAX_CODE_LENGTH; ++len) {
+            left = 2*left - int32_t(count[len]);
+            if (left < 0) {
+                return false;
+            }
+            numCodes += count[len];
+        }
+        if (left > 0 && !(allowSingle && numCodes == count[1] && numCodes <= 1)) {
+            return false;
+        }
+
+        // First code of each length
+        uint32_t next[MAX_CODE_LENGTH+1];
+        uint32_t code = 0;
+        next[0] = 0;
+        for (uint32_t len = 1; len <= MAX_CODE_LENGTH; ++len) {
+            code = (code + count[len-1]) << 1;
+            next[len] = code;
+        }
+
+        // Assign codes. Deflate sends codes starting with the most significant bit, so reverse them.
+        const uint32_t rootSize = 1U << rootBits;
+        uint16_t codes[NUM_LITERAL_CODES];
+        uint8_t subBits[1U << LITERAL_ROOT_BITS];
+        std::memset(subBits, 0, rootSize);
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t len = lengths[i];
+            if (len != 0) {
+                codes[i] = uint16_t(afl::bits::bitReverse16(uint16_t(next[len]++)) >> (16 - len));
+                if (len > rootBits) {
+                    uint8_t& sb = subBits[codes[i] & (rootSize-1)];
+                    if (sb < len - rootBits) {
+                        sb = uint8_t(len - rootBits);
+                    }
+                }
+            }
+        }
+
+        // Allocate root table and subtables
+        table.assign(rootSize, makeEntry(rootBits, Invalid, 0, 0));
+        for (uint32_t i = 0; i < rootSize; ++i) {
+            if (subBits[i] != 0) {
+                table[i] = makeEntry(rootBits, Subtable, subBits[i], uint32_t(table.size()));
+                table.resize(table.size() + (size_t(1) << subBits[i]), makeEntry(subBits[i], Invalid, 0, 0));
+            }
+        }
+
+        // Fill in codes
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t len = lengths[i];
+            if (len != 0 && len <= rootBits) {
+                const uint32_t e = symbol(i) | len;
+                for (uint32_t j = codes[i]; j < rootSize; j += 1U << len) {
+                    table[j] = e;
+                }
+            } else if (len != 0) {
+                const uint32_t sub = table[codes[i] & (rootSize-1)];
+                const uint32_t subSize = 1U << getEntryExtra(sub);
+                const uint32_t subLen = len - rootBits;
+                const uint32_t e = symbol(i) | subLen;
+                for (uint32_t j = codes[i] >> rootBits; j < subSize; j += 1U << subLen) {
+                    table[getEntryValue(sub) + j] = e;
+                }
+            }
+        }
+        return true;
+    }
+
+    /* Combine pairs of literals in root table.
+       If an index consists of a literal code followed by another complete literal code,
+       the entry can produce both at once. */
+    void buildLiteralPairs(std::vector<uint32_t>& table, uint32_t rootBits)
+    {
+        const uint32_t rootSize = 1U << rootBits;
+        const std::vector<uint32_t> single(table.begin(), table.begin() + rootSize);
+        for (uint32_t i = 0; i < rootSize; ++i) {
+            const uint32_t first = single[i];
+            const uint32_t firstBits = getEntryBits(first);
+            if (getEntryKind(first) == Literal && firstBits < rootBits) {
+                const uint32_t second = single[i >> firstBits];
+                const uint32_t totalBits = firstBits + getEntryBits(second);
+                if (getEntryKind(second) == Literal && totalBits <= rootBits) {
+                    table[i] = makeEntry(totalBits, LiteralPair, firstBits, getEntryValue(first) + 256*getEntryValue(second));
+                }
+            }
+        }
+    }
+}
+
+afl::io::Inflater::Inflater()
+    : m_state(BlockHeader),
+      m_lastBlock(false),
+      m_bitBuffer(0),
+      m_bitCount(0),
+      m_entry(0),
+      m_length(0),
+      m_remaining(0),
+      m_numLiteralCodes(0),
+      m_numDistanceCodes(0),
+      m_numCodeLengthCodes(0),
+      m_index(0),
+      m_haveFixedTables(false),
+      m_literalTable(),
+      m_distanceTable(),
+      m_codeLengthTable(),
+      m_window(),
+      m_readPos(0),
+      m_writePos(0),
+      m_inputPosition(0),
+      m_outputBase(0),
+      m_checkpointSpacing(0),
+      m_checkpoints()
+{
+    m_window.resize(BUFFER_SIZE + BUFFER_SLACK);
+}
+
+afl::io::Inflater::~Inflater()
+{ }
+
+bool
+afl::io::Inflater::inflate(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    size_t outIndex = 0;
+    bool starved = false;
+    while (1) {
+        // Deliver pending output
+        size_t n = out.subrange(outIndex).copyFrom(m_window.subrange(m_readPos, m_writePos - m_readPos)).size();
+        m_readPos += n;
+        outIndex += n;
+        if (m_readPos < m_writePos || m_state == Finished || starved) {
+            break;
+        }
+
+        // Everything delivered; make room if needed, and decode more
+        if (BUFFER_SIZE - m_writePos < MAX_MATCH) {
+            slide();
+        }
+        const size_t inputSize = in.size();
+        starved = !decode(in);
+        m_inputPosition += inputSize - in.size();
+    }
+    out.trim(outIndex);
+    return m_state == Finished && m_readPos == m_writePos;
+}
+
+void
+afl::io::Inflater::reset()
+{
+    m_state = BlockHeader;
+    m_lastBlock = false;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    m_readPos = 0;
+    m_writePos = 0;
+    m_inputPosition = 0;
+    m_outputBase = 0;
+    m_checkpoints.clear();
+}
+
+void
+afl::io::Inflater::setCheckpointSpacing(uint64_t spacing)
+{
+    m_checkpointSpacing = spacing;
+}
+
+const afl::io::Inflater::Checkpoint*
+afl::io::Inflater::findCheckpoint(uint64_t outputPosition) const
+{
+    // Binary search for first checkpoint after outputPosition; checkpoints are recorded in increasing order
+    size_t lo = 0, hi = m_checkpoints.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (m_checkpoints[mid]->outputPosition <= outputPosition) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? m_checkpoints[lo-1] : 0;
+}
+
+void
+afl::io::Inflater::resume(const Checkpoint& cp)
+{
+    const size_t n = cp.window.size();
+    m_state = BlockHeader;
+    m_lastBlock = false;
+    m_bitBuffer = cp.bits;
+    m_bitCount = cp.bitCount;
+    if (n != 0) {
+        std::memcpy(m_window.unsafeData(), cp.window.unsafeData(), n);
+    }
+    m_readPos = n;
+    m_writePos = n;
+    m_inputPosition = cp.inputPosition;
+    m_outputBase = cp.outputPosition - n;
+}
+
+/** Decode, slow path.
+    \param in [in/out] Input
+    \retval true Stopped because window is full or stream is finished
+    \retval false Stopped because more input is needed */
+bool
+afl::io::Inflater::decode(afl::base::ConstBytes_t& in)
+{
+    const size_t inputSize = in.size();
+    while (1) {
+        switch (m_state) {
+         case BlockHeader:
+            if (m_lastBlock) {
+                // Discard padding bits of last byte
+                m_bitBuffer = 0;
+                m_bitCount = 0;
+                m_state = Finished;
+                return true;
+            }
+            if (m_checkpointSpacing != 0) {
+                addCheckpoint(m_inputPosition + (inputSize - in.size()));
+            }
+            if (!needBits(in, 3)) {
+                return false;
+            }
+            m_lastBlock = getBits(1) != 0;
+            switch (getBits(2)) {
+             case 0:
+                getBits(m_bitCount & 7);
+                m_state = StoredHeader;
+                break;
+             case 1:
+                buildFixedTables();
+                m_state = Codes;
+                break;
+             case 2:
+                m_state = TableHeader;
+                break;
+             default:
+                fail("invalid block type");
+            }
+            break;
+
+         case StoredHeader:
+            if (!needBits(in, 32)) {
+                return false;
+            } else {
+                const uint32_t len = getBits(16);
+                const uint32_t nlen = getBits(16);
+                if (len != (~nlen & 0xFFFF)) {
+                    fail("invalid stored block length");
+                }
+                m_remaining = len;
+                m_state = Stored;
+            }
+            break;
+
+         case Stored: {
+            // Bytes from bit buffer
+            uint8_t* window = m_window.unsafeData();
+            while (m_remaining > 0 && m_bitCount >= 8 && m_writePos < BUFFER_SIZE) {
+                window[m_writePos++] = uint8_t(getBits(8));
+                --m_remaining;
+            }
+
+            // Bytes from input
+            size_t n = in.size();
+            if (n > m_remaining) {
+                n = m_remaining;
+            }
+            if (n > BUFFER_SIZE - m_writePos) {
+                n = BUFFER_SIZE - m_writePos;
+            }
+            if (n != 0) {
+                std::memcpy(window + m_writePos, in.unsafeData(), n);
+            }
+            in.split(n);
+            m_writePos += n;
+            m_remaining -= uint32_t(n);
+
+            if (m_remaining == 0) {
+                m_state = BlockHeader;
+            } else if (m_writePos == BUFFER_SIZE) {
+                return true;
+            } else {
+                return false;
+            }
+            break;
+         }
+
+         case TableHeader:
+            if (!needBits(in, 14)) {
+                return false;
+            }
+            m_numLiteralCodes = getBits(5) + 257;
+            m_numDistanceCodes = getBits(5) + 1;
+            m_numCodeLengthCodes = getBits(4) + 4;
+            if (m_numLiteralCodes > 286 || m_numDistanceCodes > 30) {
+                fail("too many length or distance symbols");
+            }
+            std::memset(m_lengths, 0, sizeof(m_lengths));
+            m_index = 0;
+            m_state = CodeLengthLengths;
+            break;
+
+         case CodeLengthLengths:
+            while (m_index < m_numCodeLengthCodes) {
+                if (!needBits(in, 3)) {
+                    return false;
+                }
+                m_lengths[CODE_LENGTH_ORDER[m_index++]] = uint8_t(getBits(3));
+            }
+            if (!buildTable(m_codeLengthTable, CODE_LENGTH_ROOT_BITS, m_lengths, NUM_CODE_LENGTH_CODES, getCodeLengthSymbol, false)) {
+                fail("invalid code lengths set");
+            }
+            std::memset(m_lengths, 0, sizeof(m_lengths));
+            m_index = 0;
+            m_entry = 0;
+            m_state = CodeLengths;
+            break;
+
+         case CodeLengths: {
+            const uint32_t total = m_numLiteralCodes + m_numDistanceCodes;
+            while (m_index < total) {
+                // Symbol. Keep it in m_entry while waiting for its extra bits.
+                if (m_entry == 0) {
+                    uint32_t e;
+                    if (!decodeSymbol(in, m_codeLengthTable, CODE_LENGTH_ROOT_BITS, e)) {
+                        return false;
+                    }
+                    if (getEntryKind(e) != Literal) {
+                        fail("invalid code lengths set");
+                    }
+                    m_entry = getEntryValue(e) + 1;
+                }
+
+                const uint32_t sym = m_entry - 1;
+                if (sym < 16) {
+                    m_lengths[m_index++] = uint8_t(sym);
+                } else {
+                    // Repeat
+                    static const uint8_t EXTRA_BITS[] = { 2, 3, 7 };
+                    static const uint8_t MIN_REPEAT[] = { 3, 3, 11 };
+                    if (!needBits(in, EXTRA_BITS[sym - 16])) {
+                        return false;
+                    }
+                    const uint32_t count = MIN_REPEAT[sym - 16] + getBits(EXTRA_BITS[sym - 16]);
+                    uint8_t value = 0;
+                    if (sym == 16) {
+                        if (m_index == 0) {
+                            fail("invalid bit length repeat");
+                        }
+                        value = m_lengths[m_index-1];
+                    }
+                    if (count > total - m_index) {
+                        fail("invalid bit length repeat");
+                    }
+                    std::memset(m_lengths + m_index, value, count);
+                    m_index += count;
+                }
+                m_entry = 0;
+            }
+            buildDynamicTables();
+            m_state = Codes;
+            break;
+         }
+
+         case Codes:
+            if (BUFFER_SIZE - m_writePos < MAX_MATCH) {
+                return true;
+            }
+            if (in.size() >= 16) {
+                decodeFast(in);
+                if (m_state != Codes) {
+                    break;
+                }
+                if (BUFFER_SIZE - m_writePos < MAX_MATCH) {
+                    return true;
+                }
+            }
+            if (!decodeSymbol(in, m_literalTable, LITERAL_ROOT_BITS, m_entry)) {
+                return false;
+            }
+            switch (getEntryKind(m_entry)) {
+             case Literal:
+                m_window.unsafeData()[m_writePos++] = uint8_t(getEntryValue(m_entry));
+                break;
+             case LiteralPair:
+                m_window.unsafeData()[m_writePos++] = uint8_t(getEntryValue(m_entry));
+                m_window.unsafeData()[m_writePos++] = uint8_t(getEntryValue(m_entry) >> 8);
+                break;
+             case Base:
+                m_state = LengthExtra;
+                break;
+             case EndOfBlock:
+                m_state = BlockHeader;
+                break;
+             default:
+                fail("invalid literal/length code");
+            }
+            break;
+
+         case LengthExtra:
+            if (!needBits(in, getEntryExtra(m_entry))) {
+                return false;
+            }
+            m_length = getEntryValue(m_entry) + getBits(getEntryExtra(m_entry));
+            m_state = Distance;
+            break;
+
+         case Distance:
+            if (!decodeSymbol(in, m_distanceTable, DISTANCE_ROOT_BITS, m_entry)) {
+                return false;
+            }
+            if (getEntryKind(m_entry) != Base) {
+                fail("invalid distance code");
+            }
+            m_state = DistanceExtra;
+            break;
+
+         case DistanceExtra: {
+            if (!needBits(in, getEntryExtra(m_entry))) {
+                return false;
+            }
+            const uint32_t distance = getEntryValue(m_entry) + getBits(getEntryExtra(m_entry));
+            if (distance > m_writePos) {
+                fail("invalid distance too far back");
+            }
+            copyMatch(distance, m_length);
+            m_state = Codes;
+            break;
+         }
+
+         case Finished:
+            return true;
+        }
+    }
+}
+
+/** Decode, fast path.
+    Decodes symbols as long as there is enough input and window space,
+    until the end of the block.
+    \param in [in/out] Input */
+void
+afl::io::Inflater::decodeFast(afl::base::ConstBytes_t& in)
+{
+    const uint8_t* const start = in.unsafeData();
+    const uint8_t* const limit = start + in.size() - 8;
+    const uint8_t* p = start;
+
+    const uint32_t* const lit = &m_literalTable[0];
+    const uint32_t* const dist = &m_distanceTable[0];
+    uint8_t* const window = m_window.unsafeData();
+    const size_t writeLimit = BUFFER_SIZE - MAX_MATCH;
+
+    uint64_t bitBuffer = m_bitBuffer;
+    uint32_t bitCount = m_bitCount;
+    size_t pos = m_writePos;
+
+    while (p <= limit && pos <= writeLimit) {
+        // Refill to at least 56 bits.
+        // This may leave some bits of the next byte above bitCount; they will be re-read identically.
+        bitBuffer |= afl::bits::UInt64LE::unpack(*reinterpret_cast<const afl::bits::UInt64LE::Bytes_t*>(p)) << bitCount;
+        p += (63 - bitCount) >> 3;
+        bitCount |= 56;
+
+        // Literal/length. Consumes at most 15+5 bits.
+        uint32_t e = lit[bitBuffer & mask(LITERAL_ROOT_BITS)];
+        if (getEntryKind(e) == Subtable) {
+            bitBuffer >>= LITERAL_ROOT_BITS;
+            bitCount -= LITERAL_ROOT_BITS;
+            e = lit[getEntryValue(e) + (bitBuffer & mask(getEntryExtra(e)))];
+        }
+        bitBuffer >>= getEntryBits(e);
+        bitCount -= getEntryBits(e);
+
+        const uint32_t kind = getEntryKind(e);
+        if (kind == Literal) {
+            window[pos++] = uint8_t(getEntryValue(e));
+        } else if (kind == LiteralPair) {
+            window[pos] = uint8_t(getEntryValue(e));
+            window[pos+1] = uint8_t(getEntryValue(e) >> 8);
+            pos += 2;
+        } else if (kind == Base) {
+            const uint32_t length = getEntryValue(e) + uint32_t(bitBuffer & mask(getEntryExtra(e)));
+            bitBuffer >>= getEntryExtra(e);
+            bitCount -= getEntryExtra(e);
+
+            // Distance. Consumes at most 15+13 bits; at least 36 are available.
+            e = dist[bitBuffer & mask(DISTANCE_ROOT_BITS)];
+            if (getEntryKind(e) == Subtable) {
+                bitBuffer >>= DISTANCE_ROOT_BITS;
+                bitCount -= DISTANCE_ROOT_BITS;
+                e = dist[getEntryValue(e) + (bitBuffer & mask(getEntryExtra(e)))];
+            }
+            bitBuffer >>= getEntryBits(e);
+            bitCount -= getEntryBits(e);
+            if (getEntryKind(e) != Base) {
+                fail("invalid distance code");
+            }
+            const uint32_t distance = getEntryValue(e) + uint32_t(bitBuffer & mask(getEntryExtra(e)));
+            bitBuffer >>= getEntryExtra(e);
+            bitCount -= getEntryExtra(e);
+            if (distance > pos) {
+                fail("invalid distance too far back");
+            }
+
+            // Copy
+            uint8_t* dst = window + pos;
+            const uint8_t* src = dst - distance;
+            uint8_t* const end = dst + length;
+            if (distance >= 8) {
+                do {
+                    std::memcpy(dst, src, 8);
+                    dst += 8;
+                    src += 8;
+                } while (dst < end);
+            } else if (distance == 1) {
+                std::memset(dst, *src, length);
+            } else {
+                do {
+                    *dst++ = *src++;
+                } while (dst < end);
+            }
+            pos += length;
+        } else if (kind == EndOfBlock) {
+            m_state = BlockHeader;
+            break;
+        } else {
+            fail("invalid literal/length code");
+        }
+    }
+
+    // Give back whole bytes. Since we are entered with less than 8 bits, these all come from this call.
+    uint32_t unused = bitCount >> 3;
+    if (unused > uint32_t(p - start)) {
+        unused = uint32_t(p - start);
+    }
+    p -= unused;
+    bitCount -= 8*unused;
+    m_bitBuffer = bitBuffer & mask(bitCount);
+    m_bitCount = bitCount;
+    m_writePos = pos;
+    in.split(p - start);
+}
+
+/** Decode a symbol, slow path.
+    Reads input byte by byte until the symbol can be decoded.
+    \param in       [in/out] Input
+    \param table    [in] Decoding table
+    \param rootBits [in] Number of index bits for table
+    \param entry    [out] Table entry
+    \retval true Symbol decoded
+    \retval false More input needed */
+bool
+afl::io::Inflater::decodeSymbol(afl::base::ConstBytes_t& in, const std::vector<uint32_t>& table, uint32_t rootBits, uint32_t& entry)
+{
+    while (1) {
+        uint32_t e = table[size_t(m_bitBuffer & mask(rootBits))];
+        if (getEntryKind(e) == Subtable) {
+            if (m_bitCount >= rootBits) {
+                const uint32_t e2 = table[getEntryValue(e) + size_t((m_bitBuffer >> rootBits) & mask(getEntryExtra(e)))];
+                if (rootBits + getEntryBits(e2) <= m_bitCount) {
+                    getBits(rootBits + getEntryBits(e2));
+                    entry = e2;
+                    return true;
+                }
+            }
+        } else {
+            if (getEntryBits(e) <= m_bitCount) {
+                getBits(getEntryBits(e));
+                entry = e;
+                return true;
+            }
+            if (getEntryKind(e) == LiteralPair && getEntryExtra(e) <= m_bitCount) {
+                // First literal is complete, second one may be garbage. Return just the first one
+                // so that we never read more input than needed.
+                getBits(getEntryExtra(e));
+                entry = makeEntry(getEntryExtra(e), Literal, 0, getEntryValue(e) & 255);
+                return true;
+            }
+        }
+
+        const uint8_t* p = in.eat();
+        if (p == 0) {
+            return false;
+        }
+        m_bitBuffer |= uint64_t(*p) << m_bitCount;
+        m_bitCount += 8;
+    }
+}
+
+/** Make sure bit buffer contains the given number of bits.
+    \param in [in/out] Input
+    \param n  [in] Number of bits required
+    \retval true Bits available
+    \retval false More input needed */
+bool
+afl::io::Inflater::needBits(afl::base::ConstBytes_t& in, uint32_t n)
+{
+    while (m_bitCount < n) {
+        const uint8_t* p = in.eat();
+        if (p == 0) {
+            return false;
+        }
+        m_bitBuffer |= uint64_t(*p) << m_bitCount;
+        m_bitCount += 8;
+    }
+    return true;
+}
+
+/** Consume bits from bit buffer.
+    \param n Number of bits; must be available
+    \return value */
+inline uint32_t
+afl::io::Inflater::getBits(uint32_t n)
+{
+    const uint32_t result = uint32_t(m_bitBuffer & mask(n));
+    m_bitBuffer >>= n;
+    m_bitCount -= n;
+    return result;
+}
+
+/** Copy match, slow path.
+    \param distance Distance, verified
+    \param length Length, window space verified */
+void
+afl::io::Inflater::copyMatch(uint32_t distance, uint32_t length)
+{
+    uint8_t* dst = m_window.unsafeData() + m_writePos;
+    const uint8_t* src = dst - distance;
+    for (uint32_t i = 0; i < length; ++i) {
+        dst[i] = src[i];
+    }
+    m_writePos += length;
+}
+
+/** Build tables for fixed-code block. */
+void
+afl::io::Inflater::buildFixedTables()
+{
+    if (!m_haveFixedTables) {
+        uint8_t lengths[NUM_LITERAL_CODES];
+        std::memset(lengths,       8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        buildTable(m_literalTable, LITERAL_ROOT_BITS, lengths, NUM_LITERAL_CODES, getLiteralSymbol, false);
+        buildLiteralPairs(m_literalTable, LITERAL_ROOT_BITS);
+
+        std::memset(lengths, 5, NUM_DISTANCE_CODES);
+        buildTable(m_distanceTable, DISTANCE_ROOT_BITS, lengths, NUM_DISTANCE_CODES, getDistanceSymbol, true);
+        m_haveFixedTables = true;
+    }
+}
+
+/** Build tables for dynamic-code block from m_lengths. */
+void
+afl::io::Inflater::buildDynamicTables()
+{
+    m_haveFixedTables = false;
+    if (m_lengths[256] == 0) {
+        fail("missing end-of-block code");
+    }
+    if (!buildTable(m_literalTable, LITERAL_ROOT_BITS, m_lengths, m_numLiteralCodes, getLiteralSymbol, false)) {
+        fail("invalid literal/lengths set");
+    }
+    buildLiteralPairs(m_literalTable, LITERAL_ROOT_BITS);
+    if (!buildTable(m_distanceTable, DISTANCE_ROOT_BITS, m_lengths + m_numLiteralCodes, m_numDistanceCodes, getDistanceSymbol, true)) {
+        fail("invalid distances set");
+    }
+}
+
+/** Move window content to make room.
+    Keeps the last 32k for back-references; all data must have been delivered. */
+void
+afl::io::Inflater::slide()
+{
+    uint8_t* window = m_window.unsafeData();
+    std::memmove(window, window + m_writePos - WINDOW_SIZE, WINDOW_SIZE);
+    m_outputBase += m_writePos - WINDOW_SIZE;
+    m_writePos = m_readPos = WINDOW_SIZE;
+}
+
+/** Record a checkpoint at the current position (start of a block), if due.
+    \param inputPosition Number of input bytes consumed so far */
+void
+afl::io::Inflater::addCheckpoint(uint64_t inputPosition)
+{
+    const uint64_t outputPosition = m_outputBase + m_writePos;
+    if (m_bitCount < 8 && (m_checkpoints.empty() || outputPosition >= m_checkpoints.back()->outputPosition + m_checkpointSpacing)) {
+        const size_t n = std::min(m_writePos, WINDOW_SIZE);
+        Checkpoint* cp = m_checkpoints.pushBackNew(new Checkpoint());
+        cp->inputPosition = inputPosition;
+        cp->outputPosition = outputPosition;
+        cp->bitCount = m_bitCount;
+        cp->bits = uint32_t(m_bitBuffer);
+        cp->window.append(m_window.subrange(m_writePos - n, n));
+    }
+}
@@ -0,0 +1,144 @@
+/**
+  *  \file afl/io/inflater.hpp
+  *  \brief Class afl::io::Inflater
+  */
+#ifndef AFL_AFL_IO_INFLATER_HPP
+#define AFL_AFL_IO_INFLATER_HPP
+
+#include <vector>
+#include "afl/base/growablememory.hpp"
+#include "afl/base/memory.hpp"
+#include "afl/base/uncopyable.hpp"
+#include "afl/container/ptrvector.hpp"
+
+namespace afl { namespace io {
+
+    /** Deflate decoder.
+        Built-in implementation of the "inflate" algorithm (RFC 1951) that does not need zlib.
+        This decodes a raw deflate stream; headers and trailers of container formats (gzip, zlib)
+        are handled by InflateTransform.
+
+        Decoding uses table-driven Huffman decoding with a 64-bit bit buffer.
+        The literal/length table resolves two consecutive short literals in one lookup.
+        Output is produced into an internal window from which it is copied to the caller.
+
+        Input is consumed exactly up to the end of the deflate stream;
+        data following it (e.g. a gzip trailer) remains in the input buffer.
+
+        Optionally, the decoder can record checkpoints while decoding (see setCheckpointSpacing()).
+        A checkpoint contains everything needed to resume decoding in the middle of the stream,
+        which allows random access into compressed data (see InflateStream). */
+    class Inflater : public afl::base::Uncopyable {
+     public:
+        /** Checkpoint.
+            Decoder state at a block boundary. */
+        struct Checkpoint {
+            uint64_t inputPosition;             ///< Number of input bytes consumed so far.
+            uint64_t outputPosition;            ///< Number of output bytes produced so far.
+            uint32_t bitCount;                  ///< Number of unused bits of the last consumed byte (0-7).
+            uint32_t bits;                      ///< Value of unused bits.
+            afl::base::GrowableBytes_t window;  ///< Preceding output (up to 32k) for back-references.
+        };
+
+        /** Constructor. */
+        Inflater();
+
+        /** Destructor. */
+        ~Inflater();
+
+        /** Decode data.
+            Consumes as much input as possible and produces as much output as possible.
+            \param in  [in/out] On input, compressed data. On return, unprocessed compressed data.
+            \param out [in/out] On input, space for output. On return, produced output.
+            \retval true End of stream has been reached and all output has been delivered
+            \retval false More input or output space required
+            \throw afl::except::InvalidDataException on invalid input */
+        bool inflate(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+
+        /** Reset.
+            Prepares decoding a new stream. Discards all checkpoints. */
+        void reset();
+
+        /** Set checkpoint spacing.
+            If enabled, the decoder records a checkpoint at the start of the stream,
+            and at block boundaries whenever at least the given amount of output has been produced since the previous one.
+            Each checkpoint needs up to 32k memory.
+            \param spacing Minimum distance between checkpoints, in output bytes; 0 to disable */
+        void setCheckpointSpacing(uint64_t spacing);
+
+        /** Find checkpoint.
+            \param outputPosition Desired output position
+            \return Checkpoint with the largest outputPosition not greater than the given position; null if none */
+        const Checkpoint* findCheckpoint(uint64_t outputPosition) const;
+
+        /** Resume at checkpoint.
+            Resets the decoder to the state described by the checkpoint.
+            The next call to inflate() must provide input starting at the checkpoint's inputPosition,
+            and will produce output starting at its outputPosition.
+            Recorded checkpoints are kept.
+            \param cp Checkpoint, typically obtained from findCheckpoint() */
+        void resume(const Checkpoint& cp);
+
+     private:
+        enum State {
+            BlockHeader,
+            StoredHeader,
+            Stored,
+            TableHeader,
+            CodeLengthLengths,
+            CodeLengths,
+            Codes,
+            LengthExtra,
+            Distance,
+            DistanceExtra,
+            Finished
+        };
+
+        // Decoder state
+        State m_state;
+        bool m_lastBlock;
+        uint64_t m_bitBuffer;
+        uint32_t m_bitCount;
+        uint32_t m_entry;                      ///< Current table entry (LengthExtra, DistanceExtra).
+        uint32_t m_length;                     ///< Current match length (Distance, DistanceExtra).
+        uint32_t m_remaining;                  ///< Remaining bytes in stored block.
+
+        // Dynamic block header
+        uint32_t m_numLiteralCodes;
+        uint32_t m_numDistanceCodes;
+        uint32_t m_numCodeLengthCodes;
+        uint32_t m_index;
+        uint8_t m_lengths[288 + 32];
+
+        // Tables
+        bool m_haveFixedTables;
+        std::vector<uint32_t> m_literalTable;
+        std::vector<uint32_t> m_distanceTable;
+        std::vector<uint32_t> m_codeLengthTable;
+
+        // Window
+        afl::base::GrowableBytes_t m_window;
+        size_t m_readPos;
+        size_t m_writePos;
+
+        // Positions and checkpoints
+        uint64_t m_inputPosition;              ///< Input consumed before current inflate() call.
+        uint64_t m_outputBase;                 ///< Output position corresponding to window start.
+        uint64_t m_checkpointSpacing;
+        afl::container::PtrVector<Checkpoint> m_checkpoints;
+
+        bool decode(afl::base::ConstBytes_t& in);
+        void decodeFast(afl::base::ConstBytes_t& in);
+        bool decodeSymbol(afl::base::ConstBytes_t& in, const std::vector<uint32_t>& table, uint32_t rootBits, uint32_t& entry);
+        bool needBits(afl::base::ConstBytes_t& in, uint32_t n);
+        uint32_t getBits(uint32_t n);
+        void copyMatch(uint32_t distance, uint32_t length);
+        void buildFixedTables();
+        void buildDynamicTables();
+        void slide();
+        void addCheckpoint(uint64_t inputPosition);
+    };
+
+} }
+
+#endif
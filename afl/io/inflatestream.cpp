@@ -0,0 +1,228 @@
+/**
+  *  \file afl/io/inflatestream.cpp
+  *  \brief Class afl::io::InflateStream
+  *
+  *  Checkpoints are recorded by the Inflater, relative to the start of the compressed data (m_dataStart).
+  *  To seek, we resume the Inflater at a checkpoint, re-position the underlying stream to the checkpoint's
+  *  input position, and decode (and discard) data up to the desired position.
+  *  This is the same approach as zlib's "zran" example.
+  */
+
+#include "afl/io/inflatestream.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/except/filetooshortexception.hpp"
+#include "afl/except/invaliddataexception.hpp"
+#include "afl/io/filemapping.hpp"
+#include "afl/string/messages.hpp"
+
+namespace {
+    const uint8_t flHeaderCRC = 2;
+    const uint8_t flExtraData = 4;
+    const uint8_t flFileName  = 8;
+    const uint8_t flComment   = 16;
+    const uint8_t flAll       = 1 + flHeaderCRC + flExtraData + flFileName + flComment;
+}
+
+const afl::io::Stream::FileSize_t afl::io::InflateStream::DEFAULT_CHECKPOINT_SPACING;
+
+afl::io::InflateStream::InflateStream(afl::base::Ref<Stream> input, Personality personality, FileSize_t checkpointSpacing)
+    : m_input(input),
+      m_personality(personality),
+      m_headerDone(false),
+      m_dataStart(input->getPos()),
+      m_inflater(),
+      m_buffer(),
+      m_bufferDescriptor(),
+      m_position(0),
+      m_size(FileSize_t(-1)),
+      m_finished(false)
+{
+    m_inflater.setCheckpointSpacing(checkpointSpacing);
+}
+
+afl::io::InflateStream::~InflateStream()
+{ }
+
+size_t
+afl::io::InflateStream::read(Bytes_t m)
+{
+    readHeader();
+
+    size_t did = 0;
+    while (did < m.size() && !m_finished) {
+        // Re-fill buffer if needed
+        if (m_bufferDescriptor.empty()) {
+            Bytes_t b(m_buffer);
+            b.trim(m_input->read(b));
+            m_bufferDescriptor = b;
+        }
+        const bool inputEnd = m_bufferDescriptor.empty();
+
+        // Decode
+        Bytes_t out = m.subrange(did);
+        m_finished = m_inflater.inflate(m_bufferDescriptor, out);
+        did += out.size();
+        m_position += out.size();
+        if (m_finished) {
+            m_size = m_position;
+        } else if (inputEnd && out.empty()) {
+            // Truncated file
+            break;
+        }
+    }
+    return did;
+}
+
+size_t
+afl::io::InflateStream::write(ConstBytes_t /*m*/)
+{
+    throw afl::except::FileProblemException(*this, afl::string::Messages::cannotWrite());
+}
+
+void
+afl::io::InflateStream::flush()
+{ }
+
+void
+afl::io::InflateStream::setPos(FileSize_t pos)
+{
+    if (pos == m_position) {
+        return;
+    }
+    readHeader();
+
+    // Go back if needed, or skip ahead if a checkpoint is closer than the current position
+    const Inflater::Checkpoint* cp = m_inflater.findCheckpoint(pos);
+    if (pos < m_position || (cp != 0 && cp->outputPosition > m_position)) {
+        if (cp != 0) {
+            m_input->setPos(m_dataStart + cp->inputPosition);
+            m_inflater.resume(*cp);
+            m_position = cp->outputPosition;
+        } else {
+            // No checkpoint: restart from the beginning
+            m_input->setPos(m_dataStart);
+            m_inflater.reset();
+            m_position = 0;
+        }
+        m_bufferDescriptor.reset();
+        m_finished = false;
+    }
+
+    // Decode and discard data up to desired position
+    while (m_position < pos) {
+        uint8_t tmp[4096];
+        Bytes_t b(tmp);
+        if (pos - m_position < b.size()) {
+            b.trim(size_t(pos - m_position));
+        }
+        if (read(b) == 0) {
+            break;
+        }
+    }
+}
+
+afl::io::Stream::FileSize_t
+afl::io::InflateStream::getPos()
+{
+    return m_position;
+}
+
+afl::io::Stream::FileSize_t
+afl::io::InflateStream::getSize()
+{
+    return m_size;
+}
+
+uint32_t
+afl::io::InflateStream::getCapabilities()
+{
+    return CanRead | (m_input->getCapabilities() & CanSeek);
+}
+
+String_t
+afl::io::InflateStream::getName()
+{
+    return m_input->getName();
+}
+
+afl::base::Ptr<afl::io::FileMapping>
+afl::io::InflateStream::createFileMapping(FileSize_t /*limit*/)
+{
+    return 0;
+}
+
+/** Read and verify the gzip or zlib header, if not done yet.
+    Sets m_dataStart to the start of the deflate stream. */
+void
+afl::io::InflateStream::readHeader()
+{
+    if (m_headerDone) {
+        return;
+    }
+
+    switch (m_personality) {
+     case Gzip: {
+        uint8_t header[10];
+        for (size_t i = 0; i < sizeof(header); ++i) {
+            header[i] = readHeaderByte();
+        }
+        if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8 || (header[3] & ~flAll) != 0) {
+            throw afl::except::InvalidDataException(afl::string::Messages::invalidFileHeader());
+        }
+        if ((header[3] & flExtraData) != 0) {
+            uint16_t len = readHeaderByte();
+            len = uint16_t(len + 256*readHeaderByte());
+            while (len > 0) {
+                readHeaderByte();
+                --len;
+            }
+        }
+        if ((header[3] & flFileName) != 0) {
+            while (readHeaderByte() != 0) {
+            }
+        }
+        if ((header[3] & flComment) != 0) {
+            while (readHeaderByte() != 0) {
+            }
+        }
+        if ((header[3] & flHeaderCRC) != 0) {
+            readHeaderByte();
+            readHeaderByte();
+        }
+        break;
+     }
+
+     case Zlib: {
+        const uint8_t cmf = readHeaderByte();
+        const uint8_t flg = readHeaderByte();
+        if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (flg & 0x20) != 0 || (256*cmf + flg) % 31 != 0) {
+            throw afl::except::InvalidDataException(afl::string::Messages::invalidFileHeader());
+        }
+        break;
+     }
+
+     case Raw:
+        break;
+    }
+
+    m_dataStart = m_input->getPos() - m_bufferDescriptor.size();
+    m_headerDone = true;
+}
+
+/** Read a header byte.
+    \return byte
+    \throw afl::except::FileTooShortException if file ends */
+uint8_t
+afl::io::InflateStream::readHeaderByte()
+{
+    if (m_bufferDescriptor.empty()) {
+        Bytes_t b(m_buffer);
+        b.trim(m_input->read(b));
+        m_bufferDescriptor = b;
+    }
+    const uint8_t* p = m_bufferDescriptor.eat();
+    if (p == 0) {
+        throw afl::except::FileTooShortException(*this);
+    }
+    return *p;
+}
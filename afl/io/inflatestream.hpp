@@ -0,0 +1,82 @@
+/**
+  *  \file afl/io/inflatestream.hpp
+  *  \brief Class afl::io::InflateStream
+  */
+#ifndef AFL_AFL_IO_INFLATESTREAM_HPP
+#define AFL_AFL_IO_INFLATESTREAM_HPP
+
+#include "afl/base/ref.hpp"
+#include "afl/io/inflater.hpp"
+#include "afl/io/multiplexablestream.hpp"
+
+namespace afl { namespace io {
+
+    /** Decompressing stream with random access.
+        Provides read access to the decompressed content of a deflate stream (raw, gzip, or zlib),
+        for example a .tar.gz file or a deflated ZIP member.
+
+        Unlike TransformReaderStream with an InflateTransform, this stream supports setPos().
+        While reading, it records checkpoints (decoder state and 32k history) at deflate block boundaries,
+        whenever at least the checkpoint spacing has been produced since the previous one.
+        setPos() resumes decoding at the closest checkpoint before the desired position and decodes forward from there,
+        making its cost proportional to the checkpoint spacing, not to the position.
+        Seeking forward into data not yet read decodes (and records checkpoints for) all data up to there.
+        If checkpoints are disabled, seeking backward restarts decoding from the beginning.
+
+        Seeking backward requires the underlying stream to be seekable.
+        Seeking beyond the end of the decompressed data places the file pointer at the end.
+
+        The gzip or zlib trailer is not verified; data following the compressed stream is ignored. */
+    class InflateStream : public MultiplexableStream {
+     public:
+        /** Personality (stream type). */
+        enum Personality {
+            Gzip,               ///< Gzip file (with header).
+            Raw,                ///< Just a deflate stream.
+            Zlib                ///< Zlib stream (with header).
+        };
+
+        /** Default checkpoint spacing. */
+        static const FileSize_t DEFAULT_CHECKPOINT_SPACING = 1024*1024;
+
+        /** Constructor.
+            \param input             Underlying stream, positioned at the start of the compressed data
+            \param personality       Personality (stream type)
+            \param checkpointSpacing Minimum distance between checkpoints, in bytes of decompressed data; 0 to disable */
+        InflateStream(afl::base::Ref<Stream> input, Personality personality, FileSize_t checkpointSpacing = DEFAULT_CHECKPOINT_SPACING);
+
+        /** Destructor. */
+        ~InflateStream();
+
+        // Stream:
+        virtual size_t read(Bytes_t m);
+        virtual size_t write(ConstBytes_t m);
+        virtual void flush();
+        virtual void setPos(FileSize_t pos);
+        virtual FileSize_t getPos();
+        virtual FileSize_t getSize();
+        virtual uint32_t getCapabilities();
+        virtual String_t getName();
+        virtual afl::base::Ptr<FileMapping> createFileMapping(FileSize_t limit = FileSize_t(-1));
+
+     private:
+        const afl::base::Ref<Stream> m_input;
+        const Personality m_personality;
+        bool m_headerDone;
+        FileSize_t m_dataStart;            ///< Position of compressed data in m_input.
+        Inflater m_inflater;
+
+        uint8_t m_buffer[4096];
+        ConstBytes_t m_bufferDescriptor;
+
+        FileSize_t m_position;             ///< Current position in decompressed data.
+        FileSize_t m_size;                 ///< Size of decompressed data, FileSize_t(-1) if not known yet.
+        bool m_finished;
+
+        void readHeader();
+        uint8_t readHeaderByte();
+    };
+
+} }
+
+#endif
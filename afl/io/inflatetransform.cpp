@@ -29,29 +29,29 @@
   *    DWORD    CRC32
   *    DWORD    size
   *  CRC and size are NOT verified.
+  *
+  *  Format of zlib stream:
+  *    BYTE     CMF (method 8, window size)
+  *    BYTE     FLG (check bits, no preset dictionary)
+  *    BYTE[]   compressed stream
+  *    DWORD    Adler-32, big-endian
+  *
+  *  Decompression uses zlib if available, afl::io::Inflater otherwise.
   */
 
-#include <cassert>
 #include "afl/io/inflatetransform.hpp"
 #include "afl/base/staticassert.hpp"
+#include "afl/checksums/adler32.hpp"
 #include "afl/config.h"
+#include "afl/except/invaliddataexception.hpp"
+#include "afl/string/messages.hpp"
 
 #ifdef HAVE_ZLIB
 /*
- *  ZLIB is available - real version
+ *  ZLIB is available - use it
  */
 # include <zlib.h>
-# include "afl/except/invaliddataexception.hpp"
-# include "afl/string/messages.hpp"
 namespace {
-    const uint8_t flASCII     = 1;
-    const uint8_t flHeaderCRC = 2;
-    const uint8_t flExtraData = 4;
-    const uint8_t flFileName  = 8;
-    const uint8_t flComment   = 16;
-    const uint8_t flAll       = flASCII + flHeaderCRC + flExtraData + flFileName + flComment;
-
-
     inline unsigned int convertSize(size_t sz)
     {
         static const unsigned int maxValue = ~0U;
@@ -61,14 +61,107 @@ namespace {
             return static_cast<unsigned int>(sz);
         }
     }
+
+    /* Raw deflate decoder using zlib. Same interface as afl::io::Inflater. */
+    class Engine {
+     public:
+        Engine();
+        ~Engine();
+        bool inflate(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
+
+     private:
+        bool m_initialized;
+        z_stream m_zStream;
+
+        void reportError(int code);
+    };
+}
+
+inline
+Engine::Engine()
+    : m_initialized(false),
+      m_zStream()
+{ }
+
+Engine::~Engine()
+{
+    if (m_initialized) {
+        inflateEnd(&m_zStream);
+    }
+}
+
+bool
+Engine::inflate(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+{
+    if (!m_initialized) {
+        int result = inflateInit2(&m_zStream, -15);
+        if (result != Z_OK) {
+            reportError(result);
+        }
+        m_initialized = true;
+    }
+
+    // Feed all data into zlib.
+    m_zStream.next_in = const_cast<Bytef*>(in.unsafeData());
+    m_zStream.avail_in = convertSize(in.size());
+    m_zStream.next_out = out.unsafeData();
+    m_zStream.avail_out = convertSize(out.size());
+
+    int result = ::inflate(&m_zStream, 0);
+
+    // Update buffer pointers
+    out.trim(out.size() - m_zStream.avail_out);
+    in.split(in.size() - m_zStream.avail_in);
+
+    // Process zlib return code
+    if (result == Z_STREAM_END) {
+        // end of stream signalled by stream
+        return true;
+    } else if (result == Z_BUF_ERROR || result == Z_OK) {
+        // Z_BUF_ERROR means our input buffer got empty
+        return false;
+    } else {
+        // Actual error
+        reportError(result);
+        return false;
+    }
+}
+
+void
+Engine::reportError(int code)
+{
+    String_t message = afl::string::Messages::invalidCompressedData();
+    message += ": ";
+    message += zError(code);
+    if (m_zStream.msg != 0) {
+        message += ", ";
+        message += m_zStream.msg;
+    }
+    throw afl::except::InvalidDataException(message);
+}
+#else
+/*
+ *  No ZLIB available - use built-in decoder
+ */
+# include "afl/io/inflater.hpp"
+namespace {
+    typedef afl::io::Inflater Engine;
+}
+#endif
+
+namespace {
+    const uint8_t flASCII     = 1;
+    const uint8_t flHeaderCRC = 2;
+    const uint8_t flExtraData = 4;
+    const uint8_t flFileName  = 8;
+    const uint8_t flComment   = 16;
+    const uint8_t flAll       = flASCII + flHeaderCRC + flExtraData + flFileName + flComment;
 }
 
 class afl::io::InflateTransform::Impl {
  public:
     Impl(Personality pers);
-    ~Impl();
     void transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out);
-    static bool isAvailable();
 
  private:
     enum State {
@@ -78,7 +171,7 @@ class afl::io::InflateTransform::Impl {
         CheckFileName,
         CheckComment,
         CheckHeaderCRC,
-        FinishedHeader,
+        CheckZlibHeader,
         Decompressing,
         CheckingTrailer,
         EndReached
@@ -92,46 +185,28 @@ class afl::io::InflateTransform::Impl {
     uint8_t  m_gzHeaderFlags;
     uint16_t m_gzExtraDataLength;
 
-    z_stream m_zStream;
+    uint32_t m_adler;
 
-    void reportError(int code);
+    Engine m_engine;
 };
 
 inline
 afl::io::InflateTransform::Impl::Impl(Personality pers)
     : m_personality(pers),
-      m_state(pers == Gzip ? CheckHeader : FinishedHeader),
+      m_state(pers == Gzip ? CheckHeader : pers == Zlib ? CheckZlibHeader : Decompressing),
       m_size(0),
       m_gzHeaderFlags(0),
       m_gzExtraDataLength(0),
-      m_zStream()
+      m_adler(1),
+      m_engine()
 { }
 
-afl::io::InflateTransform::Impl::~Impl()
-{
-    switch (m_state) {
-     case CheckHeader:
-     case CheckExtraDataLength:
-     case CheckExtraData:
-     case CheckFileName:
-     case CheckComment:
-     case CheckHeaderCRC:
-     case FinishedHeader:
-        break;
-     case Decompressing:
-     case CheckingTrailer:
-     case EndReached:
-        inflateEnd(&m_zStream);
-        break;
-    }
-}
-
 inline void
 afl::io::InflateTransform::Impl::transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
 {
-    int result;
     size_t outIndex = 0;
-    while (m_state != EndReached && !in.empty() && outIndex < out.size()) {
+    bool starved = false;
+    while (m_state != EndReached && !starved && (!in.empty() || m_state == Decompressing) && outIndex < out.size()) {
         switch (m_state) {
          case CheckHeader:
             // Check to read 10 bytes
@@ -222,51 +297,44 @@ afl::io::InflateTransform::Impl::transform(afl::base::ConstBytes_t& in, afl::bas
                 m_size += in.split(2 - m_size).size();
                 if (m_size >= 2) {
                     m_size = 0;
-                    m_state = FinishedHeader;
+                    m_state = Decompressing;
                 }
             } else {
-                m_state = FinishedHeader;
+                m_state = Decompressing;
             }
             break;
 
-         case FinishedHeader:
-            // Final state for gzip header parsing, initial state for raw inflate:
-            // initialize zlib
-            result = inflateInit2(&m_zStream, m_personality == Zlib ? 15 : -15);
-            m_state = Decompressing;
-            if (result != Z_OK) {
-                reportError(result);
+         case CheckZlibHeader:
+            // Two bytes: method 8, window size up to 32k, no preset dictionary, check bits
+            while (m_size < 2 && !in.empty()) {
+                m_buffer[m_size++] = *in.eat();
+            }
+            if (m_size >= 2) {
+                if ((m_buffer[0] & 15) != 8
+                    || (m_buffer[0] >> 4) > 7
+                    || (m_buffer[1] & 0x20) != 0
+                    || (256*m_buffer[0] + m_buffer[1]) % 31 != 0)
+                {
+                    throw afl::except::InvalidDataException(afl::string::Messages::invalidFileHeader());
+                }
+                m_size = 0;
+                m_state = Decompressing;
             }
             break;
 
          case Decompressing:
          {
-            // Feed all data into zlib.
-            m_zStream.next_in = const_cast<Bytef*>(in.unsafeData());
-            m_zStream.avail_in = convertSize(in.size());
-
+            const size_t inputSize = in.size();
             afl::base::Bytes_t remainingOutput = out.subrange(outIndex);
-            m_zStream.next_out = remainingOutput.unsafeData();
-            m_zStream.avail_out = convertSize(remainingOutput.size());
-
-            result = inflate(&m_zStream, 0);
-
-            // Update buffer pointers
-            outIndex += remainingOutput.size() - m_zStream.avail_out;
-            in.split(in.size() - m_zStream.avail_in);
-
-            // Process zlib return code
-            if (result == Z_STREAM_END) {
-                // end of stream signalled by stream
-                m_state = CheckingTrailer;
-            } else if (result == Z_BUF_ERROR || m_zStream.avail_in == 0) {
-                // buffer error, means: our input buffer got empty
-            } else if (result == Z_OK) {
-                // OK
-            } else {
-                // Actual error
-                m_state = EndReached;
-                reportError(result);
+            bool finished = m_engine.inflate(in, remainingOutput);
+            outIndex += remainingOutput.size();
+            if (m_personality == Zlib) {
+                m_adler = afl::checksums::Adler32().add(remainingOutput, m_adler);
+            }
+            if (finished) {
+                m_state = (m_personality == Raw ? EndReached : CheckingTrailer);
+            } else if (remainingOutput.empty() && in.size() == inputSize) {
+                starved = true;
             }
             break;
          }
@@ -280,7 +348,18 @@ afl::io::InflateTransform::Impl::transform(afl::base::ConstBytes_t& in, afl::bas
                     m_state = EndReached;
                 }
             } else {
-                m_state = EndReached;
+                // Ends with 4 bytes Adler-32
+                while (m_size < 4 && !in.empty()) {
+                    m_buffer[m_size++] = *in.eat();
+                }
+                if (m_size >= 4) {
+                    const uint32_t check = (uint32_t(m_buffer[0]) << 24) | (uint32_t(m_buffer[1]) << 16) | (uint32_t(m_buffer[2]) << 8) | m_buffer[3];
+                    if (check != m_adler) {
+                        throw afl::except::InvalidDataException(afl::string::Messages::invalidCompressedData());
+                    }
+                    m_size = 0;
+                    m_state = EndReached;
+                }
             }
             break;
 
@@ -291,42 +370,6 @@ afl::io::InflateTransform::Impl::transform(afl::base::ConstBytes_t& in, afl::bas
     out.trim(outIndex);
 }
 
-inline bool
-afl::io::InflateTransform::Impl::isAvailable()
-{
-    return true;
-}
-
-void
-afl::io::InflateTransform::Impl::reportError(int code)
-{
-    String_t message = afl::string::Messages::invalidCompressedData();
-    message += ": ";
-    message += zError(code);
-    if (m_zStream.msg != 0) {
-        message += ", ";
-        message += m_zStream.msg;
-    }
-    throw afl::except::InvalidDataException(message);
-}
-#else
-/*
- *  No ZLIB available - dummy version
- */
-# include "afl/except/unsupportedexception.hpp"
-class afl::io::InflateTransform::Impl {
- public:
-    Impl(Personality /*pers*/)
-        { throw afl::except::UnsupportedException("inflate"); }
-
-    void transform(afl::base::ConstBytes_t& /*in*/, afl::base::Bytes_t& out)
-        { out.reset(); }
-
-    static bool isAvailable()
-        { return false; }
-};
-#endif
-
 afl::io::InflateTransform::InflateTransform(Personality personality)
     : m_pImpl(new Impl(personality))
 { }
@@ -347,5 +390,5 @@ afl::io::InflateTransform::flush()
 bool
 afl::io::InflateTransform::isAvailable()
 {
-    return Impl::isAvailable();
+    return true;
 }
@@ -11,12 +11,8 @@
 namespace afl { namespace io {
 
     /** Inflate transformation.
-        This transformation inflates data (using zlib).
-
-        <b>Conditional availability:</b>
-        If zlib was not available when building afl, this class will refuse being constructed
-        by throwing an afl::except::UnsupportedException.
-        You can use isAvailable() to check availability beforehand. */
+        This transformation inflates data.
+        It uses zlib if that was available when building afl, the built-in afl::io::Inflater otherwise. */
     class InflateTransform : public Transform {
      public:
         /** Personality (stream type). */
@@ -38,8 +34,8 @@ namespace afl { namespace io {
         virtual void flush();
 
         /** Check availability.
-            \retval true zlib functionality is available; you can construct InflateDataSink objects
-            \retval false zlib functionality is not available; constructing InflateDataSink will fail */
+            InflateTransform is always available; this function exists for symmetry with DeflateTransform.
+            \retval true */
         static bool isAvailable();
 
      private:
@@ -24,10 +24,28 @@
 #include "afl/string/messages.hpp"
 #include "afl/string/parse.hpp"
 
+namespace {
+    /* Copy the matching prefix of a schema into a NameMap.
+       Used when an object's keys differ from the schema.
+       \param schema     [in/out] Schema; will be reset
+       \param numMatched [in/out] Number of matching keys; will be reset
+       \param names      [out] NameMap to receive the keys */
+    void copyKeys(afl::base::Ptr<const afl::data::NameMap>& schema, afl::data::NameMap::Index_t& numMatched, afl::data::NameMap& names)
+    {
+        if (schema.get() != 0) {
+            for (afl::data::NameMap::Index_t i = 0; i < numMatched; ++i) {
+                names.add(schema->getNameByIndex(i));
+            }
+            schema.reset();
+            numMatched = 0;
+        }
+    }
+}
 
 afl::io::json::Parser::Parser(afl::io::BufferedStream& stream, afl::data::ValueFactory& factory)
     : m_stream(stream),
-      m_factory(factory)
+      m_factory(factory),
+      m_schemas(afl::data::NameQuery::HASH_MAX)
 { }
 
 afl::io::json::Parser::~Parser()
@@ -187,8 +205,14 @@ afl::io::json::Parser::parseHash()
         endOfFile();
     }
 
+    // Keys are matched against a previously-seen key set (schema) first.
+    // As long as the keys match in order, they need not be stored again.
+    // On the first mismatch, the matching prefix is copied into a fresh NameMap.
     afl::data::Segment values;
     afl::data::NameMap names;
+    afl::base::Ptr<const afl::data::NameMap> schema;
+    afl::data::NameMap::Index_t numMatched = 0;
+    bool first = true;
     if (*ch != '}') {
         // Read content
         while (1) {
@@ -199,7 +223,19 @@ afl::io::json::Parser::parseHash()
             // Picking a different element across different JSON parsers can be a security problem
             // (https://justi.cz/security/2017/11/14/couchdb-rce-npm.html).
             parseChar('"');
-            afl::data::NameMap::Index_t index = names.addMaybe(parseString());
+            const String_t key = parseString();
+            if (first) {
+                schema = m_schemas[afl::data::NameQuery(key).getHashCode()];
+                first = false;
+            }
+
+            afl::data::NameMap::Index_t index;
+            if (schema.get() != 0 && numMatched < schema->getNumNames() && schema->getNameByIndex(numMatched) == key) {
+                index = numMatched++;
+            } else {
+                copyKeys(schema, numMatched, names);
+                index = names.addMaybe(key);
+            }
 
             // Delimiter
             skipWhitespace();
@@ -226,7 +262,20 @@ afl::io::json::Parser::parseHash()
     m_stream.readByte();
 
     // Produce result
-    return m_factory.createHash(names, values);
+    if (schema.get() != 0 && numMatched == schema->getNumNames()) {
+        return m_factory.createHash(afl::base::Ref<const afl::data::NameMap>(*schema), values);
+    }
+    copyKeys(schema, numMatched, names);
+    if (names.getNumNames() == 0) {
+        return m_factory.createHash(names, values);
+    }
+
+    // New key set; remember it for following objects
+    afl::data::NameMap* newSchema = new afl::data::NameMap();
+    newSchema->swap(names);
+    afl::base::Ref<const afl::data::NameMap> result(*newSchema);
+    m_schemas[afl::data::NameQuery(result->getNameByIndex(0)).getHashCode()] = &*result;
+    return m_factory.createHash(result, values);
 }
 
 /** Internal - Parse a Number.
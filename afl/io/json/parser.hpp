@@ -5,6 +5,9 @@
 #ifndef AFL_AFL_IO_JSON_PARSER_HPP
 #define AFL_AFL_IO_JSON_PARSER_HPP
 
+#include <vector>
+#include "afl/base/ptr.hpp"
+#include "afl/data/namemap.hpp"
 #include "afl/data/valuefactory.hpp"
 #include "afl/io/bufferedstream.hpp"
 
@@ -13,7 +16,11 @@ namespace afl { namespace io { namespace json {
     /** JSON Parser.
         Allows reading JSON-formatted data from a BufferedStream.
         The stream must be in UTF-8 encoding (there will be no character translation).
-        All JSON data types (numbers, strings, booleans, null, arrays/vectors, objects/hashes) are supported. */
+        All JSON data types (numbers, strings, booleans, null, arrays/vectors, objects/hashes) are supported.
+
+        Objects that have the same keys in the same order as a previous object (e.g. an array of records)
+        share their keys (ValueFactory::createHash(const afl::base::Ref<const NameMap>&, Segment&)).
+        The parser remembers the most recent key set for each possible first key's hash code. */
     class Parser {
      public:
         /** Constructor.
@@ -45,6 +52,9 @@ namespace afl { namespace io { namespace json {
         afl::io::BufferedStream& m_stream;
         afl::data::ValueFactory& m_factory;
 
+        // Recently-used key sets, indexed by hash code of first key
+        std::vector<afl::base::Ptr<const afl::data::NameMap> > m_schemas;
+
         // Error messages
         void endOfFile();
         void syntaxError();
@@ -51,7 +51,13 @@ afl::io::LimitedStream::read(Bytes_t m)
         m.trim(size_t(m_length - m_position));
     }
 
-    // Read
+    // Read. If we know the absolute position, use a positional read;
+    // this does not depend on the parent's file position, and can thus proceed in parallel with other children.
+    if (hasPosition()) {
+        size_t result = m_parent->readAt(m_origin + m_position, m);
+        m_position += result;
+        return result;
+    }
     try {
         size_t result = m_parent->read(m);
         m_position += result;
@@ -72,6 +78,7 @@ afl::io::LimitedStream::write(ConstBytes_t m)
     }
 
     // Write
+    syncPosition();
     try {
         size_t result = m_parent->write(m);
         m_position += result;
@@ -143,7 +150,36 @@ afl::io::LimitedStream::createFileMapping(FileSize_t limit)
     if (hasLength() && limit > m_length - m_position) {
         limit = m_length - m_position;
     }
-    return m_parent->createFileMapping(limit);
+    syncPosition();
+    afl::base::Ptr<FileMapping> result = m_parent->createFileMapping(limit);
+    if (result.get() != 0) {
+        m_position += result->get().size();
+    }
+    return result;
+}
+
+afl::base::Ptr<afl::io::FileMapping>
+afl::io::LimitedStream::createWritableFileMapping(FileSize_t limit, bool shared)
+{
+    if (hasLength() && limit > m_length - m_position) {
+        limit = m_length - m_position;
+    }
+    syncPosition();
+    afl::base::Ptr<FileMapping> result = m_parent->createWritableFileMapping(limit, shared);
+    if (result.get() != 0) {
+        m_position += result->get().size();
+    }
+    return result;
+}
+
+// Set parent's file position to match ours.
+// Required before operations that use the parent's file position, because read() does not advance it.
+void
+afl::io::LimitedStream::syncPosition()
+{
+    if (hasPosition()) {
+        m_parent->setPos(m_origin + m_position);
+    }
 }
 
 // Fix up position after something unexpected happened to the stream during a read/write of n bytes.
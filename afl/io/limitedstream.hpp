@@ -21,7 +21,10 @@ namespace afl { namespace io {
 
         \b Length: If set, specifies the size of the accessible window for seekable streams,
         the maximum number of bytes to read for non-seekable streams.
-        If not set, the underlying stream can be read until its end. */
+        If not set, the underlying stream can be read until its end.
+
+        If an origin is set, reading uses the parent stream's readAt().
+        The parent's file position is therefore not advanced by read(). */
     class LimitedStream : public Stream {
      public:
         /** File position to signify "no limit/not present". */
@@ -47,6 +50,7 @@ namespace afl { namespace io {
         virtual String_t getName();
         virtual afl::base::Ref<Stream> createChild();
         virtual afl::base::Ptr<FileMapping> createFileMapping(FileSize_t limit = FileSize_t(-1));
+        virtual afl::base::Ptr<FileMapping> createWritableFileMapping(FileSize_t limit, bool shared);
 
      private:
         /** Underlying stream. */
@@ -64,6 +68,7 @@ namespace afl { namespace io {
         bool hasPosition() const;
         bool hasLength() const;
         void fixupPosition(size_t n);
+        void syncPosition();
     };
 
 } }
@@ -7,6 +7,7 @@
 #include "afl/io/multiplexablestream.hpp"
 #include "afl/sys/mutex.hpp"
 #include "afl/sys/mutexguard.hpp"
+#include "afl/sys/semaphore.hpp"
 #include "afl/io/filemapping.hpp"
 
 /** Control Node.
@@ -35,8 +36,22 @@ class afl::io::MultiplexableStream::ControlNode : public afl::base::RefCounted {
     void removeChild(Child* ch);
 
     /** Remove the parent.
+        Must be called with m_mutex held.
+        \return true if positional reads are still in progress; caller must wait for m_readersDone. */
+    bool removeParent();
+
+    /** Start a positional read without holding m_mutex.
+        Must be called with m_mutex held.
+        While the read is in progress, removing the parent waits for it.
+        \return Stream to perform the requested operation on. Null if operation cannot be performed. */
+    Stream* beginRead();
+
+    /** Finish a positional read started with beginRead().
         Must be called with m_mutex held. */
-    void removeParent();
+    void endRead();
+
+    /** Posted when the last positional read finishes after removeParent() returned true. */
+    afl::sys::Semaphore m_readersDone;
 
     /** Activate a child.
         Must be called with m_mutex held.
@@ -46,6 +61,19 @@ class afl::io::MultiplexableStream::ControlNode : public afl::base::RefCounted {
         \return Stream to perform the requested operation on. Null if operation cannot be performed. */
     Stream* activateChild(Child* ch, bool wantSetPos);
 
+    /** Deactivate a child.
+        Must be called with m_mutex held.
+        If the child is active, saves its position into m_posIfInactive,
+        so that it can be used for a stateless operation.
+        \param ch The child
+        \return Stream to perform the requested operation on. Null if operation cannot be performed. */
+    Stream* deactivateChild(Child* ch);
+
+    /** Check for concurrent positional reads.
+        Must be called with m_mutex held.
+        \return true if children can read from the master stream using readAt() without holding m_mutex */
+    bool hasConcurrentReadAt();
+
     /** Get parent.
         Must be called with m_mutex held.
         Performs all necessary checks and decides whether a stateless operation can be performed on the master stream.
@@ -56,6 +84,8 @@ class afl::io::MultiplexableStream::ControlNode : public afl::base::RefCounted {
     MultiplexableStream* m_parent;
     Child* m_firstChild;
     Child* m_activeChild;
+    size_t m_numReaders;
+    bool m_waitingForReaders;
 };
 
 /** Child stream.
@@ -77,6 +107,8 @@ class afl::io::MultiplexableStream::Child : public afl::io::Stream {
     virtual String_t getName();
     virtual afl::base::Ref<Stream> createChild();
     virtual afl::base::Ptr<FileMapping> createFileMapping(FileSize_t limit);
+    virtual afl::base::Ptr<FileMapping> createWritableFileMapping(FileSize_t limit, bool shared);
+    virtual size_t readAt(FileSize_t pos, Bytes_t m);
 
  private:
     afl::base::Ref<ControlNode> m_controlNode;
@@ -92,9 +124,12 @@ class afl::io::MultiplexableStream::Child : public afl::io::Stream {
 
 inline
 afl::io::MultiplexableStream::ControlNode::ControlNode(MultiplexableStream* parent)
-    : m_parent(parent),
+    : m_readersDone(0),
+      m_parent(parent),
       m_firstChild(0),
-      m_activeChild(0)
+      m_activeChild(0),
+      m_numReaders(0),
+      m_waitingForReaders(false)
 { }
 
 afl::io::MultiplexableStream::ControlNode::~ControlNode()
@@ -102,6 +137,7 @@ afl::io::MultiplexableStream::ControlNode::~ControlNode()
     assert(m_parent == 0);
     assert(m_firstChild == 0);
     assert(m_activeChild == 0);
+    assert(m_numReaders == 0);
 }
 
 inline void
@@ -129,11 +165,32 @@ afl::io::MultiplexableStream::ControlNode::removeChild(Child* ch)
     }
 }
 
-inline void
+inline bool
 afl::io::MultiplexableStream::ControlNode::removeParent()
 {
     m_parent = 0;
     m_activeChild = 0;
+    m_waitingForReaders = (m_numReaders != 0);
+    return m_waitingForReaders;
+}
+
+inline afl::io::Stream*
+afl::io::MultiplexableStream::ControlNode::beginRead()
+{
+    if (m_parent != 0) {
+        ++m_numReaders;
+    }
+    return m_parent;
+}
+
+inline void
+afl::io::MultiplexableStream::ControlNode::endRead()
+{
+    --m_numReaders;
+    if (m_numReaders == 0 && m_waitingForReaders) {
+        m_waitingForReaders = false;
+        m_readersDone.post();
+    }
 }
 
 afl::io::Stream*
@@ -160,6 +217,26 @@ afl::io::MultiplexableStream::ControlNode::activateChild(Child* ch, bool wantSet
     }
 }
 
+afl::io::Stream*
+afl::io::MultiplexableStream::ControlNode::deactivateChild(Child* ch)
+{
+    if (m_parent != 0) {
+        if (ch == m_activeChild) {
+            ch->m_posIfInactive = m_parent->getPos();
+            m_activeChild = 0;
+        }
+        return m_parent;
+    } else {
+        return 0;
+    }
+}
+
+inline bool
+afl::io::MultiplexableStream::ControlNode::hasConcurrentReadAt()
+{
+    return m_parent != 0 && m_parent->hasConcurrentReadAt();
+}
+
 inline afl::io::Stream*
 afl::io::MultiplexableStream::ControlNode::getParent()
 {
@@ -188,12 +265,39 @@ afl::io::MultiplexableStream::Child::~Child()
 size_t
 afl::io::MultiplexableStream::Child::read(Bytes_t m)
 {
-    afl::sys::MutexGuard g(m_controlNode->m_mutex);
-    if (Stream* w = m_controlNode->activateChild(this, false)) {
-        return w->read(m);
-    } else {
-        return 0;
+    Stream* w;
+    FileSize_t pos;
+    {
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+        if (!m_controlNode->hasConcurrentReadAt()) {
+            // Regular read, serialized with all other children
+            w = m_controlNode->activateChild(this, false);
+            return w != 0 ? w->read(m) : 0;
+        }
+
+        // Positional read: detach from master's file position
+        if (m_controlNode->deactivateChild(this) == 0) {
+            return 0;
+        }
+        w = m_controlNode->beginRead();
+        pos = m_posIfInactive;
+    }
+
+    // Read without holding the mutex. If this throws, the position remains unchanged.
+    size_t n;
+    try {
+        n = w->readAt(pos, m);
     }
+    catch (...) {
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+        m_controlNode->endRead();
+        throw;
+    }
+
+    afl::sys::MutexGuard g(m_controlNode->m_mutex);
+    m_controlNode->endRead();
+    m_posIfInactive = pos + n;
+    return n;
 }
 
 size_t
@@ -286,6 +390,49 @@ afl::io::MultiplexableStream::Child::createFileMapping(FileSize_t limit)
     }
 }
 
+afl::base::Ptr<afl::io::FileMapping>
+afl::io::MultiplexableStream::Child::createWritableFileMapping(FileSize_t limit, bool shared)
+{
+    afl::sys::MutexGuard g(m_controlNode->m_mutex);
+    if (Stream* w = m_controlNode->activateChild(this, false)) {
+        return w->createWritableFileMapping(limit, shared);
+    } else {
+        return 0;
+    }
+}
+
+size_t
+afl::io::MultiplexableStream::Child::readAt(FileSize_t pos, Bytes_t m)
+{
+    Stream* w;
+    {
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+        if (!m_controlNode->hasConcurrentReadAt()) {
+            w = m_controlNode->activateChild(this, true);
+            return w != 0 ? w->readAt(pos, m) : 0;
+        }
+        w = m_controlNode->beginRead();
+        if (w == 0) {
+            return 0;
+        }
+    }
+
+    // Read without holding the mutex
+    size_t n;
+    try {
+        n = w->readAt(pos, m);
+    }
+    catch (...) {
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+        m_controlNode->endRead();
+        throw;
+    }
+
+    afl::sys::MutexGuard g(m_controlNode->m_mutex);
+    m_controlNode->endRead();
+    return n;
+}
+
 /************************** MultiplexableStream **************************/
 
 afl::io::MultiplexableStream::MultiplexableStream()
@@ -294,8 +441,7 @@ afl::io::MultiplexableStream::MultiplexableStream()
 
 afl::io::MultiplexableStream::~MultiplexableStream()
 {
-    afl::sys::MutexGuard g(m_controlNode->m_mutex);
-    m_controlNode->removeParent();
+    detachChildren();
 }
 
 afl::base::Ref<afl::io::Stream>
@@ -303,3 +449,25 @@ afl::io::MultiplexableStream::createChild()
 {
     return *new Child(m_controlNode);
 }
+
+bool
+afl::io::MultiplexableStream::hasConcurrentReadAt()
+{
+    return false;
+}
+
+void
+afl::io::MultiplexableStream::detachChildren()
+{
+    bool wait;
+    {
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+        wait = m_controlNode->removeParent();
+    }
+    if (wait) {
+        m_controlNode->m_readersDone.wait();
+
+        // Reader posts m_readersDone while holding the mutex; make sure it is done.
+        afl::sys::MutexGuard g(m_controlNode->m_mutex);
+    }
+}
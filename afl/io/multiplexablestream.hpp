@@ -15,6 +15,10 @@ namespace afl { namespace io {
         It does so by keeping track of created children and switching back and forth between them.
         Accesses are serialized using a Mutex.
 
+        If the master stream reports hasConcurrentReadAt(), children read using readAt() without holding the Mutex,
+        each child keeping its own position.
+        This allows multiple threads to read different regions of one file concurrently, each through its own child.
+
         If the master stream dies before the children,
         the children go into a zombie state where they do not react on any request (but do not crash). */
     class MultiplexableStream : public Stream {
@@ -25,6 +29,21 @@ namespace afl { namespace io {
 
         afl::base::Ref<Stream> createChild();
 
+     protected:
+        /** Check for concurrent positional reads.
+            If this function returns true, readAt() does not use or modify the file position
+            and can be called from multiple threads concurrently,
+            even concurrently with other operations.
+            \return true if readAt() can be called concurrently. Default implementation returns false. */
+        virtual bool hasConcurrentReadAt();
+
+        /** Detach all children.
+            Children go into zombie state; waits until all concurrent positional reads have finished.
+            This is called by the destructor.
+            A derived class whose hasConcurrentReadAt() returns true must call it at the beginning of its destructor,
+            so that no child reads from the partially-destroyed object. */
+        void detachChildren();
+
      private:
         class ControlNode;
         class Child;
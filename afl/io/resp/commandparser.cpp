@@ -0,0 +1,126 @@
+/**
+  *  \file afl/io/resp/commandparser.cpp
+  *  \brief Class afl::io::resp::CommandParser
+  *
+  *  This parses exactly the format produced by Redis clients for commands:
+  *    "*" <count> CRLF { "$" <length> CRLF <data> CRLF }
+  *  Anything else (including LF-only line ends, null or nested arrays, and non-bulk elements)
+  *  is rejected and left for Parser to handle.
+  */
+
+#include "afl/io/resp/commandparser.hpp"
+#include "afl/data/stringvalue.hpp"
+
+using afl::base::ConstBytes_t;
+
+namespace {
+    /* Upper limit for numbers. Same as Parser's limit. */
+    const uint32_t MAX_NUMBER = 0x7FFFFFFF;
+
+    /* Minimum size of an element ("$0\r\n\r\n").
+       Used to reject impossible element counts early. */
+    const size_t MIN_ELEMENT_SIZE = 6;
+
+    /* Read a header line: <marker> <digits> CRLF.
+       \param in     [in/out] Data
+       \param marker Expected marker character
+       \param result [out] Parsed number
+       \return true on success */
+    bool readHeader(ConstBytes_t& in, uint8_t marker, uint32_t& result)
+    {
+        const uint8_t* pc = in.eat();
+        if (pc == 0 || *pc != marker) {
+            return false;
+        }
+
+        uint32_t value = 0;
+        bool haveDigits = false;
+        while ((pc = in.eat()) != 0 && *pc >= '0' && *pc <= '9') {
+            const uint32_t digit = *pc - '0';
+            if (value > (MAX_NUMBER - digit) / 10) {
+                return false;
+            }
+            value = 10*value + digit;
+            haveDigits = true;
+        }
+        if (pc == 0 || *pc != '\r' || !haveDigits) {
+            return false;
+        }
+
+        pc = in.eat();
+        if (pc == 0 || *pc != '\n') {
+            return false;
+        }
+
+        result = value;
+        return true;
+    }
+}
+
+afl::io::resp::CommandParser::CommandParser()
+    : m_arguments()
+{ }
+
+afl::io::resp::CommandParser::~CommandParser()
+{ }
+
+bool
+afl::io::resp::CommandParser::parse(afl::base::ConstBytes_t& data)
+{
+    m_arguments.clear();
+
+    // Header
+    ConstBytes_t in(data);
+    uint32_t count;
+    if (!readHeader(in, '*', count) || count > in.size() / MIN_ELEMENT_SIZE) {
+        return false;
+    }
+
+    // Elements
+    m_arguments.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t length;
+        if (!readHeader(in, '$', length) || in.size() < size_t(length) + 2) {
+            m_arguments.clear();
+            return false;
+        }
+        m_arguments.push_back(in.split(length));
+
+        const uint8_t* cr = in.eat();
+        const uint8_t* lf = in.eat();
+        if (*cr != '\r' || *lf != '\n') {
+            m_arguments.clear();
+            return false;
+        }
+    }
+
+    data = in;
+    return true;
+}
+
+afl::base::ConstBytes_t
+afl::io::resp::CommandParser::getArgument(size_t index) const
+{
+    if (index < m_arguments.size()) {
+        return m_arguments[index];
+    } else {
+        return ConstBytes_t();
+    }
+}
+
+void
+afl::io::resp::CommandParser::storeArguments(afl::data::Segment& out) const
+{
+    const size_t n = m_arguments.size();
+    for (size_t i = 0; i < n; ++i) {
+        afl::string::ConstStringMemory_t str(afl::string::ConstStringMemory_t::unsafeCreate(reinterpret_cast<const char*>(m_arguments[i].unsafeData()), m_arguments[i].size()));
+        if (afl::data::StringValue* sv = dynamic_cast<afl::data::StringValue*>(out[i])) {
+            sv->setValue(str);
+        } else {
+            out.setNew(i, new afl::data::StringValue(afl::string::fromMemory(str)));
+        }
+    }
+    if (out.size() > n) {
+        out.popBackN(out.size() - n);
+    }
+}
@@ -0,0 +1,69 @@
+/**
+  *  \file afl/io/resp/commandparser.hpp
+  *  \brief Class afl::io::resp::CommandParser
+  */
+#ifndef AFL_AFL_IO_RESP_COMMANDPARSER_HPP
+#define AFL_AFL_IO_RESP_COMMANDPARSER_HPP
+
+#include <vector>
+#include "afl/base/memory.hpp"
+#include "afl/base/uncopyable.hpp"
+#include "afl/data/segment.hpp"
+
+namespace afl { namespace io { namespace resp {
+
+    /** Fast-path RESP command parser.
+        Whereas Parser is a general-purpose push parser that can process arbitrarily fragmented input,
+        this class parses just a complete multi-bulk command (array of bulk strings, "*2\r\n$3\r\nfoo\r\n$3\r\nbar\r\n")
+        in a single pass over a buffer.
+        It does not copy the arguments, but produces descriptors pointing into the buffer;
+        these remain valid as long as the buffer remains valid.
+
+        Typical usage is to try CommandParser first, and use a Parser for everything it does not accept
+        (incomplete data, short form, anything other than a well-formed multi-bulk command).
+        CommandParser never throws; diagnosing syntax errors is left to Parser. */
+    class CommandParser : public afl::base::Uncopyable {
+     public:
+        /** Constructor. */
+        CommandParser();
+
+        /** Destructor. */
+        ~CommandParser();
+
+        /** Parse a command.
+            If the data starts with a complete multi-bulk command, parses it, and removes it from the data.
+            Otherwise, leaves the data unchanged.
+            \param data [in/out] On input, data to process. On output, remaining unprocessed data.
+            \retval true Command has been parsed; use getNumArguments(), getArgument() to access it
+            \retval false Data does not start with a complete multi-bulk command; data has not been consumed */
+        bool parse(afl::base::ConstBytes_t& data);
+
+        /** Get number of arguments of last parsed command.
+            \return number of arguments (including the command verb) */
+        size_t getNumArguments() const;
+
+        /** Get argument of last parsed command.
+            \param index Index [0,getNumArguments())
+            \return Argument data; points into the buffer passed to parse(). Empty if index is out of range. */
+        afl::base::ConstBytes_t getArgument(size_t index) const;
+
+        /** Store arguments of last parsed command in a Segment.
+            The segment will receive one string value for each argument.
+            If the segment already contains string values (e.g. from a previous call),
+            these are re-used, avoiding allocation of new value objects for every command.
+            \param out [in/out] Segment */
+        void storeArguments(afl::data::Segment& out) const;
+
+     private:
+        std::vector<afl::base::ConstBytes_t> m_arguments;
+    };
+
+} } }
+
+inline size_t
+afl::io::resp::CommandParser::getNumArguments() const
+{
+    return m_arguments.size();
+}
+
+#endif
@@ -4,6 +4,7 @@
   */
 
 #include "afl/io/stream.hpp"
+#include "afl/base/growablememory.hpp"
 #include "afl/except/filetooshortexception.hpp"
 #include "afl/string/messages.hpp"
 #include "afl/io/internalfilemapping.hpp"
@@ -13,6 +14,12 @@ const uint32_t afl::io::Stream::CanRead;
 const uint32_t afl::io::Stream::CanWrite;
 const uint32_t afl::io::Stream::CanSeek;
 
+namespace {
+    /* Buffer size for copyFrom().
+       Large enough to keep the number of system calls low when copying big files. */
+    const size_t COPY_BUFFER_SIZE = 64*1024;
+}
+
 void
 afl::io::Stream::fullRead(Bytes_t m)
 {
@@ -37,6 +44,13 @@ afl::io::Stream::fullWrite(ConstBytes_t m)
     }
 }
 
+size_t
+afl::io::Stream::readAt(FileSize_t pos, Bytes_t m)
+{
+    setPos(pos);
+    return read(m);
+}
+
 bool
 afl::io::Stream::hasCapabilities(uint32_t which)
 {
@@ -46,32 +60,60 @@ afl::io::Stream::hasCapabilities(uint32_t which)
 void
 afl::io::Stream::copyFrom(Stream& other)
 {
-    uint8_t buffer[4096];
-    while (1) {
-        Bytes_t m(buffer);
-        m.trim(other.read(m));
-        if (m.empty()) {
-            break;
-        }
+    copyFromDirect(other, FileSize_t(-1));
+
+    // If copyFromDirect() copied everything, the first read reports end of file.
+    // Do that with a small stack buffer, and allocate the big buffer only if there is more data.
+    uint8_t first[4096];
+    Bytes_t m(first);
+    m.trim(other.read(m));
+    if (!m.empty()) {
         fullWrite(m);
+
+        afl::base::GrowableBytes_t buffer;
+        buffer.resize(COPY_BUFFER_SIZE);
+        while (1) {
+            m = buffer;
+            m.trim(other.read(m));
+            if (m.empty()) {
+                break;
+            }
+            fullWrite(m);
+        }
     }
 }
 
 void
 afl::io::Stream::copyFrom(Stream& other, FileSize_t size)
 {
-    uint8_t buffer[4096];
-    while (size > 0) {
-        Bytes_t m(buffer);
-        if (size < m.size()) {
-            m.trim(size_t(size));
+    size -= copyFromDirect(other, size);
+    if (size > 0) {
+        afl::base::GrowableBytes_t buffer;
+        buffer.resize(size < COPY_BUFFER_SIZE ? size_t(size) : COPY_BUFFER_SIZE);
+        while (size > 0) {
+            Bytes_t m(buffer);
+            if (size < m.size()) {
+                m.trim(size_t(size));
+            }
+            other.fullRead(m);
+            fullWrite(m);
+            size -= m.size();
         }
-        other.fullRead(m);
-        fullWrite(m);
-        size -= m.size();
     }
 }
 
+afl::io::Stream::FileSize_t
+afl::io::Stream::copyFromDirect(Stream& /*other*/, FileSize_t /*size*/)
+{
+    return 0;
+}
+
+afl::base::Ptr<afl::io::FileMapping>
+afl::io::Stream::createWritableFileMapping(FileSize_t /*limit*/, bool /*shared*/)
+{
+    return 0;
+}
+
 afl::base::Ref<afl::io::FileMapping>
 afl::io::Stream::createVirtualMapping(FileSize_t limit)
 {
@@ -136,6 +136,20 @@ namespace afl { namespace io {
             \param m Memory to write. */
         void fullWrite(ConstBytes_t m);
 
+        /** Read from a given position.
+            Reads up to m.size() bytes starting at file position \c pos, like setPos(pos) followed by read(m).
+            Afterwards, the file position is unspecified.
+
+            Streams that can read without a file pointer (e.g. using pread()) override this method
+            to implement it without touching the file position, and possibly allow concurrent calls from multiple threads
+            (see MultiplexableStream::hasConcurrentReadAt()).
+            The default implementation uses setPos() and read().
+
+            \param pos Position
+            \param m Memory descriptor
+            \return Number of bytes read */
+        virtual size_t readAt(FileSize_t pos, Bytes_t m);
+
         /** Check for capabilities.
             \param which Capabilities to check (one or more of CanXxx).
             \return true if this stream supports all the specified capabilities */
@@ -154,11 +168,32 @@ namespace afl { namespace io {
             \param size Number of bytes to copy */
         void copyFrom(Stream& other, FileSize_t size);
 
+        /** Copy from another stream, using an operating-system supported method.
+            copyFrom() calls this first to let a stream copy data without passing it through a user-space buffer
+            (for example, using sendfile() if both streams are operating-system files).
+            The default implementation copies nothing.
+            \param other Stream to copy from
+            \param size Maximum number of bytes to copy
+            \return Number of bytes copied. If this is less than \c size, copyFrom() continues with a regular copy. */
+        virtual FileSize_t copyFromDirect(Stream& other, FileSize_t size);
+
+        /** Create a writable file mapping.
+            Like createFileMapping(), but the mapping can be modified using FileMapping::getWritable().
+            The mapping cannot extend the file; use setPos() and write() or similar to set the size first.
+            Mapping a stream that was opened for reading only succeeds only for a private mapping.
+            The default implementation returns null.
+            \param limit  Size limit. Map at most this many bytes.
+            \param shared true to write modifications back to the file; false to keep them private to the mapping
+            \return New file mapping if possible, null if mapping could not be created */
+        virtual afl::base::Ptr<FileMapping> createWritableFileMapping(FileSize_t limit, bool shared);
+
         /** Create a virtual file mapping.
             The file mapping consists of all bytes from the current file position (getPos()) and includes up to \c limit bytes.
             The file position is advanced by \c limit bytes, as if read() had been called for that size.
 
             Creates a real, operating-system supported mapping if possible, an InternalFileMapping otherwise.
+            The latter reads the requested range into memory.
+            To process large streams, use \c limit to map them in windows.
 
             \param limit Size limit. Map at most this many bytes.
             \return New file mapping, never null */
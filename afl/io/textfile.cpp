@@ -18,6 +18,8 @@
 afl::io::TextFile::TextFile(Stream& s)
     : BufferedStream(s),
       m_charset(new afl::charset::CodepageCharset(afl::charset::g_codepageLatin1)),
+      m_encoder(),
+      m_decoder(),
       m_utf8Snoop(true),
       m_sysNewline(true)
 { }
@@ -29,7 +31,7 @@ void
 afl::io::TextFile::setCharsetNew(afl::charset::Charset* cs)
 {
     assert(cs != 0);
-    m_charset.reset(cs);
+    setCharset(cs);
     m_utf8Snoop = false;
 }
 
@@ -71,7 +73,7 @@ afl::io::TextFile::doReadLine(String_t& line)
             if (m_utf8Snoop && rawLine.size() == sizeof(BOM)) {
                 // UTF-8 snooping
                 if (rawLine.compare(0, sizeof(BOM), BOM, sizeof(BOM)) == 0) {
-                    m_charset.reset(new afl::charset::Utf8Charset());
+                    setCharset(new afl::charset::Utf8Charset());
                     rawLine.clear();
                 }
                 m_utf8Snoop = false;
@@ -89,7 +91,24 @@ afl::io::TextFile::doReadLine(String_t& line)
 
     // Produce result
     if (pch != 0 || rawLine.size() != 0) {
-        line = m_charset->decode(afl::string::toBytes(rawLine));
+        // Convert in pieces using the streaming decoder, reusing the line's buffer
+        if (m_decoder.get() == 0) {
+            m_decoder.reset(m_charset->createDecoder());
+        }
+        line.clear();
+        uint8_t buffer[1024];
+        afl::base::ConstBytes_t in = afl::string::toBytes(rawLine);
+        afl::base::Bytes_t out;
+        bool flushed = false;
+        do {
+            if (in.empty() && !flushed) {
+                m_decoder->flush();
+                flushed = true;
+            }
+            out = buffer;
+            m_decoder->transcode(in, out);
+            line.append(reinterpret_cast<const char*>(out.unsafeData()), out.size());
+        } while (!flushed || !out.empty());
         return true;
     } else {
         line.clear();
@@ -100,7 +119,23 @@ afl::io::TextFile::doReadLine(String_t& line)
 void
 afl::io::TextFile::doWriteText(afl::string::ConstStringMemory_t text)
 {
-    fullWrite(m_charset->encode(text));
+    // Convert in pieces using the streaming encoder, avoiding a temporary copy of the whole text
+    if (m_encoder.get() == 0) {
+        m_encoder.reset(m_charset->createEncoder());
+    }
+    uint8_t buffer[1024];
+    afl::base::ConstBytes_t in = text.toBytes();
+    afl::base::Bytes_t out;
+    bool flushed = false;
+    do {
+        if (in.empty() && !flushed) {
+            m_encoder->flush();
+            flushed = true;
+        }
+        out = buffer;
+        m_encoder->transcode(in, out);
+        fullWrite(out);
+    } while (!flushed || !out.empty());
 }
 
 void
@@ -119,3 +154,11 @@ afl::io::TextFile::doFlush()
 {
     BufferedStream::flush();
 }
+
+void
+afl::io::TextFile::setCharset(afl::charset::Charset* cs)
+{
+    m_charset.reset(cs);
+    m_encoder.reset();
+    m_decoder.reset();
+}
@@ -8,6 +8,7 @@
 #include <memory>
 #include "afl/io/bufferedstream.hpp"
 #include "afl/charset/charset.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/string/string.hpp"
 #include "afl/io/textreader.hpp"
 #include "afl/io/textwriter.hpp"
@@ -78,8 +79,12 @@ namespace afl { namespace io {
 
      private:
         std::auto_ptr<afl::charset::Charset> m_charset;
+        std::auto_ptr<afl::charset::Transcoder> m_encoder;
+        std::auto_ptr<afl::charset::Transcoder> m_decoder;
         bool m_utf8Snoop;
         bool m_sysNewline;
+
+        void setCharset(afl::charset::Charset* cs);
     };
 
 } }
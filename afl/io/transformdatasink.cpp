@@ -45,3 +45,22 @@ afl::io::TransformDataSink::handleData(afl::base::ConstBytes_t& data)
         return result;
     }
 }
+
+void
+afl::io::TransformDataSink::flush()
+{
+    if (m_pTransform.get() != 0) {
+        // Feed empty blocks into the transformation until we do not get anything more out.
+        m_pTransform->flush();
+        uint8_t buffer[4096];
+        while (1) {
+            afl::base::ConstBytes_t data;
+            afl::base::Bytes_t out(buffer);
+            m_pTransform->transform(data, out);
+            if (out.empty()) {
+                break;
+            }
+            m_other.handleFullData(out);
+        }
+    }
+}
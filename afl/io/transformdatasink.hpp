@@ -31,6 +31,12 @@ namespace afl { namespace io {
             \param pTransform Transformation to use. TransformDataSink assumes ownership. */
         void setNewTransform(Transform* pTransform);
 
+        /** Flush.
+            Signals end of data to the transformation,
+            and pushes all remaining output (for example, an "end" packet) into the other sink.
+            Call this after the last handleData(). */
+        void flush();
+
         // DataSink:
         virtual bool handleData(afl::base::ConstBytes_t& data);
 
@@ -4,6 +4,7 @@
   */
 
 #include <memory>
+#include <vector>
 #include "afl/io/xml/parser.hpp"
 #include "afl/io/xml/textnode.hpp"
 #include "afl/io/xml/pinode.hpp"
@@ -77,7 +78,85 @@ afl::io::xml::Parser::parseNodes(Nodes_t& nodes)
     }
 }
 
-afl::io::xml::Node*
+void
+afl::io::xml::Parser::parseMatching(const String_t& path, SubtreeHandler& handler)
+{
+    // Split path into elements
+    std::vector<String_t> pattern;
+    String_t::size_type pos = 0;
+    while (pos < path.size()) {
+        String_t::size_type n = path.find('/', pos);
+        if (n == String_t::npos) {
+            n = path.size();
+        }
+        if (n != pos) {
+            pattern.push_back(path.substr(pos, n - pos));
+        }
+        pos = n+1;
+    }
+    if (pattern.empty()) {
+        return;
+    }
+
+    // Process tokens. We track the currently-open tags in 'stack';
+    // the first 'matchDepth' of them match the first elements of the pattern.
+    std::vector<String_t> stack;
+    size_t matchDepth = 0;
+    while (1) {
+        switch (m_token) {
+         case BaseReader::Eof:
+         case BaseReader::Null:
+         case BaseReader::Error:
+            // End or error; stop
+            return;
+
+         case BaseReader::TagStart:
+            if (matchDepth == stack.size() && (pattern[matchDepth] == "*" || pattern[matchDepth] == m_reader.getTag())) {
+                if (matchDepth+1 == pattern.size()) {
+                    // Full match: build and report the subtree (this consumes the closing tag)
+                    std::auto_ptr<TagNode> node(parseTag());
+                    handler.handleSubtree(*node);
+                    break;
+                }
+                ++matchDepth;
+            }
+            stack.push_back(m_reader.getTag());
+            readNext();
+            break;
+
+         case BaseReader::TagEnd: {
+            // Closing tag. Like parseTag(), leave a closing tag for the enclosing context alone.
+            if (stack.empty()) {
+                return;
+            }
+            // Close the innermost tag of that name; ignore mismatching tags
+            size_t i = stack.size();
+            while (i > 0 && stack[i-1] != m_reader.getTag()) {
+                --i;
+            }
+            if (i > 0) {
+                stack.resize(i-1);
+                if (matchDepth > stack.size()) {
+                    matchDepth = stack.size();
+                }
+            }
+            readNext();
+            break;
+         }
+
+         case BaseReader::TagAttribute:
+         case BaseReader::PIStart:
+         case BaseReader::PIAttribute:
+         case BaseReader::Comment:
+         case BaseReader::Text:
+            // Skip
+            readNext();
+            break;
+        }
+    }
+}
+
+afl::io::xml::TagNode*
 afl::io::xml::Parser::parseTag()
 {
     // FIXME: limit recursion depth
@@ -5,12 +5,14 @@
 #ifndef AFL_AFL_IO_XML_PARSER_HPP
 #define AFL_AFL_IO_XML_PARSER_HPP
 
+#include "afl/base/deletable.hpp"
 #include "afl/io/xml/basereader.hpp"
 #include "afl/io/xml/node.hpp"
 
 namespace afl { namespace io { namespace xml {
 
     class NamedNode;
+    class TagNode;
 
     /** Parser and DOM builder.
         Reads the token stream of a BaseReader and builds a tree of Node objects.
@@ -21,9 +23,19 @@ namespace afl { namespace io { namespace xml {
         After parse(), it will have read one token beyond the returned node.
 
         Therefore, if you wish to read multiple nodes, you must re-use the Parser instance
-        or you lose tokens. */
+        or you lose tokens.
+
+        For large documents, use parseMatching() to build only the parts of the tree you are interested in. */
     class Parser {
      public:
+        /** Receiver for parseMatching(). */
+        class SubtreeHandler : public afl::base::Deletable {
+         public:
+            /** Handle a subtree.
+                \param node Node. Will be destroyed after this function returns. */
+            virtual void handleSubtree(const TagNode& node) = 0;
+        };
+
         /** Constructor.
             \param rdr Reader providing a stream of tokens. Must live longer than Parser. */
         explicit Parser(BaseReader& rdr);
@@ -44,8 +56,24 @@ namespace afl { namespace io { namespace xml {
             \param nodes [in/out] Nodes */
         void parseNodes(Nodes_t& nodes);
 
+        /** Read matching subtrees.
+            Reads nodes until an error or an unmatched closing tag is encountered (i.e.\ the same as parseNodes()),
+            but does not build a tree.
+            Instead, only tags matching the given path are built into a tree and passed to the handler,
+            and destroyed after the handler returns.
+            Memory usage is therefore bounded by the size of the largest matching subtree, not the document.
+
+            The path consists of tag names separated by "/", relative to the current position,
+            for example, "/feed/entry" reports all "entry" tags contained in a top-level "feed" tag.
+            A path element "*" matches any tag name.
+            Matching tags are reported in document order; matches within matching tags are not reported.
+
+            \param path    Path
+            \param handler Handler */
+        void parseMatching(const String_t& path, SubtreeHandler& handler);
+
      private:
-        Node* parseTag();
+        TagNode* parseTag();
         Node* parsePI();
         void readNext();
 
@@ -16,6 +16,7 @@
 #include "afl/charset/utf8.hpp"
 #include "afl/io/xml/entityhandler.hpp"
 #include "afl/charset/codepage.hpp"
+#include "arch/xmlaccel.hpp"
 
 namespace {
     // Options/character classes for Reader::readCharacterSequence:
@@ -30,6 +31,50 @@ namespace {
     const int LBracketChar   = 256;
     const int AnyChar        = 512;
     const int ProcessQuotes  = 16384;
+
+    /* Determine character class of a character. */
+    int getCharacterClass(afl::charset::Unichar_t ch)
+    {
+        switch (ch) {
+         case '<':    return LTChar;
+         case '>':    return GTChar;
+         case '=':    return EQChar;
+         case '!':    return BangChar;
+         case '?':    return QuesChar;
+         case '/':    return SlashChar;
+         case '-':    return MinusChar;
+         case '[':    return LBracketChar;
+         case 0x85:   return WhitespaceChar; /* NEXT LINE */
+         case 0x2028: return WhitespaceChar; /* LINE SEPARATOR */
+         default:     return ch <= ' ' ? WhitespaceChar : AnyChar;
+        }
+    }
+
+    /* Find initial run of ASCII characters that readASCIIRun() accepts, using vector instructions if available.
+       Returns the number of bytes known to be acceptable; the caller checks the remainder. */
+    size_t findASCIIRun(const uint8_t* p, size_t size, int acceptClasses)
+    {
+        // Only worthwhile for sequences that accept ordinary characters (text, names, values)
+        size_t n = 0;
+        if (size >= 16 && (acceptClasses & AnyChar) != 0) {
+            static const char SPECIAL_CHARS[] = "<>=!?/-[";
+            uint8_t stopChars[MAX_XML_STOP_CHARS];
+            size_t numStopChars = 0;
+            for (const char* q = SPECIAL_CHARS; *q != '\0'; ++q) {
+                if ((acceptClasses & getCharacterClass(uint8_t(*q))) == 0) {
+                    stopChars[numStopChars++] = uint8_t(*q);
+                }
+            }
+            if ((acceptClasses & ProcessQuotes) != 0) {
+                stopChars[numStopChars++] = '"';
+                stopChars[numStopChars++] = '\'';
+            }
+            if (!findXmlRunAccel(p, size, stopChars, numStopChars, (acceptClasses & WhitespaceChar) == 0, n)) {
+                n = 0;
+            }
+        }
+        return n;
+    }
 }
 
 // Constructor.
@@ -240,7 +285,7 @@ afl::io::xml::Reader::readNextToken()
                     m_value.clear();
                 }
             } else {
-                m_value = expandEntities(m_value);
+                expandEntities(m_value);
             }
             return Text;
         }
@@ -275,7 +320,7 @@ afl::io::xml::Reader::readNextToken()
                 m_value.clear();
                 readCharacterSequence(WhitespaceChar, 0);
                 readCharacterSequence(~(WhitespaceChar | GTChar| SlashChar), &m_value);
-                m_value = expandEntities(m_value);
+                expandEntities(m_value);
                 return TagAttribute;
             } else {
                 m_value = m_name;
@@ -508,28 +553,7 @@ afl::io::xml::Reader::readCharacterSequence(int acceptClasses, String_t* accum)
     afl::charset::Unichar_t currentQuote = 0;
     while (m_haveCurrentCharacter) {
         // Figure out this character's class
-        int myClass;
-        if (m_currentCharacter <= ' ' || m_currentCharacter == 0x85 /* NEXT LINE */ || m_currentCharacter == 0x2028 /* LINE SEPARATOR */) {
-            myClass = WhitespaceChar;
-        } else if (m_currentCharacter == '<') {
-            myClass = LTChar;
-        } else if (m_currentCharacter == '>') {
-            myClass = GTChar;
-        } else if (m_currentCharacter == '=') {
-            myClass = EQChar;
-        } else if (m_currentCharacter == '!') {
-            myClass = BangChar;
-        } else if (m_currentCharacter == '?') {
-            myClass = QuesChar;
-        } else if (m_currentCharacter == '/') {
-            myClass = SlashChar;
-        } else if (m_currentCharacter == '-') {
-            myClass = MinusChar;
-        } else if (m_currentCharacter == '[') {
-            myClass = LBracketChar;
-        } else {
-            myClass = AnyChar;
-        }
+        const int myClass = getCharacterClass(m_currentCharacter);
 
         // Quoting
         if (currentQuote != 0 && m_currentCharacter == currentQuote) {
@@ -544,6 +568,11 @@ afl::io::xml::Reader::readCharacterSequence(int acceptClasses, String_t* accum)
                 m_unicodeHandler.append(*accum, m_currentCharacter);
             }
             ++count;
+
+            // Process following ASCII characters in bulk
+            if (currentQuote == 0) {
+                count += readASCIIRun(acceptClasses, accum);
+            }
         } else {
             // Non-matching class
             break;
@@ -555,6 +584,47 @@ afl::io::xml::Reader::readCharacterSequence(int acceptClasses, String_t* accum)
     return count;
 }
 
+/** Read run of ASCII characters.
+    Fast path for readCharacterSequence(): in UTF-8 and codepage encodings, ASCII characters are represented as themselves.
+    Therefore, instead of decoding individual characters, we can directly scan the buffer
+    and transfer a run of acceptable characters into the output at once.
+    This function stops at the end of the buffer, non-ASCII characters, quotes (if requested), and non-acceptable characters;
+    these are then processed normally by readNextChar().
+    \param acceptClasses [in] Character classes to accept, plus optional options.
+    \param accum  [out,optional] Characters will be stored here
+    \return Number of characters read */
+size_t
+afl::io::xml::Reader::readASCIIRun(int acceptClasses, String_t* accum)
+{
+    if (m_encoding != Utf8 && m_encoding != Codepage) {
+        return 0;
+    }
+
+    const uint8_t* p = m_buffer.unsafeData();
+    const size_t size = m_buffer.size();
+    const bool processQuotes = (acceptClasses & ProcessQuotes) != 0;
+    size_t n = findASCIIRun(p, size, acceptClasses);
+    while (n < size) {
+        const uint8_t ch = p[n];
+        if (ch >= 0x80
+            || (processQuotes && (ch == '"' || ch == '\''))
+            || (acceptClasses & getCharacterClass(ch)) == 0)
+        {
+            break;
+        }
+        ++n;
+    }
+
+    if (n != 0) {
+        if (accum) {
+            accum->append(reinterpret_cast<const char*>(p), n);
+        }
+        m_buffer.split(n);
+        m_bufferPos += n;
+    }
+    return n;
+}
+
 /** Read content of a "<![CDATA" block.
     Assumes everything up to and including the opening bracket has already been read.
     Reads everything up to and including the final "]]>".
@@ -603,11 +673,15 @@ afl::io::xml::Reader::readUnparsedCharacterData(String_t& out)
 
 /** Expand entity-references within a string.
     This function uses the provided EntityHandler.
-    \param s the string
-    \return Updated string */
-String_t
-afl::io::xml::Reader::expandEntities(const String_t s)
+    \param s [in/out] the string */
+void
+afl::io::xml::Reader::expandEntities(String_t& s)
 {
+    // Most strings do not contain entity references; leave those alone
+    if (s.find('&') == String_t::npos) {
+        return;
+    }
+
     String_t out;
     String_t::size_type pos = 0;
     String_t::size_type n, q;
@@ -621,6 +695,6 @@ afl::io::xml::Reader::expandEntities(const String_t s)
         out.append(m_entityHandler.expandEntityReference(String_t(s, n+1, q-n-1)));
         pos = q+1;
     }
-    out.append(s.substr(pos));
-    return out;
+    out.append(s, pos, String_t::npos);
+    s.swap(out);
 }
@@ -119,8 +119,9 @@ namespace afl { namespace io { namespace xml {
         void refillBuffer();
         void detectEncoding();
         size_t readCharacterSequence(int acceptClasses, String_t* accum);
+        size_t readASCIIRun(int acceptClasses, String_t* accum);
         void readUnparsedCharacterData(String_t& out);
-        String_t expandEntities(String_t s);
+        void expandEntities(String_t& s);
     };
 
 } } }
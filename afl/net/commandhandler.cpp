@@ -7,6 +7,13 @@
 #include "afl/net/commandhandler.hpp"
 #include "afl/data/access.hpp"
 
+void
+afl::net::CommandHandler::callDirect(const Segment_t& command, ReplyBuilder& reply)
+{
+    std::auto_ptr<Value_t> result(call(command));
+    reply.addValue(result.get());
+}
+
 int32_t
 afl::net::CommandHandler::callInt(const afl::data::Segment& command)
 {
@@ -11,6 +11,7 @@
 #include "afl/base/types.hpp"
 #include "afl/string/string.hpp"
 #include "afl/base/optional.hpp"
+#include "afl/net/replybuilder.hpp"
 
 namespace afl { namespace net {
 
@@ -56,6 +57,17 @@ namespace afl { namespace net {
             \throw afl::except::InvalidDataException The remote end sent invalid data (protocol error). */
         virtual void callVoid(const Segment_t& command) = 0;
 
+        /** Invoke a command, producing the result into a ReplyBuilder.
+            A server that serializes the result anyway can use this to avoid building an intermediate Value tree.
+            The default implementation produces the result of call().
+            Implementations can override this to produce (some or all) results directly.
+            If this function throws, the content produced so far into the ReplyBuilder must be discarded.
+            \param command Command and arguments as a list of values.
+            \param reply   Reply builder. Receives exactly one element (which may be an array).
+            \throw afl::except::RemoteErrorException The remote end signalled an error.
+            \throw afl::except::InvalidDataException The remote end sent invalid data (protocol error). */
+        virtual void callDirect(const Segment_t& command, ReplyBuilder& reply);
+
 
         /*
          *  Derived methods
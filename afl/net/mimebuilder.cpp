@@ -3,9 +3,11 @@
   *  \brief Class afl::net::MimeBuilder
   */
 
+#include <memory>
 #include "afl/net/mimebuilder.hpp"
 #include "afl/charset/base64.hpp"
 #include "afl/charset/quotedprintable.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/net/headertable.hpp"
 #include "afl/net/headerconsumer.hpp"
 
@@ -64,10 +66,26 @@ afl::net::MimeBuilder::addBase64(afl::base::ConstBytes_t data)
     // to 19 input triplets i.e. 57 input characters
     flushHeaderAndStartBody();
     while (!data.empty()) {
-        size_t room = 57 - m_Base64Accumulator.size();
-        m_Base64Accumulator.append(afl::string::fromBytes(data.split(room)));
-        if (m_Base64Accumulator.size() == 57) {
-            flushBase64();
+        if (m_Base64Accumulator.empty() && !m_PendingCRLF && data.size() >= 57) {
+            // Fast path: encode all complete lines into a single element.
+            // Base64 lines never start with '-' or '.', so this does not affect finish() or write().
+            afl::base::ConstBytes_t lines = data.split(data.size() / 57 * 57);
+            String_t text(lines.size() / 57 * 78, '\0');
+            std::auto_ptr<afl::charset::Transcoder> enc(Base64().createEncoder());
+            afl::base::Bytes_t out(afl::base::Bytes_t::unsafeCreate(reinterpret_cast<uint8_t*>(&text[0]), text.size()));
+            while (!lines.empty()) {
+                afl::base::ConstBytes_t line = lines.split(57);
+                afl::base::Bytes_t encoded = out.split(76);
+                enc->transcode(line, encoded);
+                out.split(2).copyFrom(afl::string::toBytes(CRLF));
+            }
+            m_Content.push_back(Element(text, TextElement));
+        } else {
+            size_t room = 57 - m_Base64Accumulator.size();
+            m_Base64Accumulator.append(afl::string::fromBytes(data.split(room)));
+            if (m_Base64Accumulator.size() == 57) {
+                flushBase64();
+            }
         }
     }
 }
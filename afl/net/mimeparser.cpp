@@ -3,6 +3,7 @@
   *  \brief Class afl::net::MimeParser
   */
 
+#include <cstring>
 #include <memory>
 #include "afl/net/mimeparser.hpp"
 #include "afl/charset/base64.hpp"
@@ -28,19 +29,20 @@ namespace {
         return afl::charset::Base64().decode(afl::string::toBytes(in));
     }
 
-    inline String_t decodeBase64(afl::base::ConstBytes_t bytes)
-    {
-        return afl::charset::Base64().decode(bytes);
-    }
-
     inline String_t decodeQP(const String_t& in)
     {
         return afl::charset::QuotedPrintable().decode(afl::string::toBytes(in));
     }
 
-    inline String_t decodeQP(afl::base::ConstBytes_t bytes)
+    /* Get length of a run of body text, up to the next line terminator. */
+    size_t getLineLength(afl::base::ConstBytes_t data)
     {
-        return afl::charset::QuotedPrintable().decode(bytes);
+        const uint8_t* p = data.unsafeData();
+        size_t n = 0;
+        while (n < data.size() && p[n] != '\r' && p[n] != '\n') {
+            ++n;
+        }
+        return n;
     }
 
     inline bool isEntirelyWhitespace(const String_t& str, size_t start, size_t end)
@@ -260,9 +262,10 @@ afl::net::MimeParser::MimeParser()
     : m_headers(),
       m_trace(),
       m_body(),
-      m_accum(),
       m_state(StateHeader),
       m_decodeBody(true),
+      m_decoder(),
+      m_pendingEquals(false),
       m_pLog(0),
       m_headerParser(new HeaderParser(*this))
 {
@@ -323,15 +326,18 @@ afl::net::MimeParser::finish()
      case StatePlainBody:
         break;
      case StateBase64Body:
-        flushBase64Body();
+        flushBody();
         break;
      case StateQPBody:
         // Decode pending partial line. Do not handle trailing "=",
         // because there's no line we could join this with.
-        addBody(decodeQP(m_accum));
+        if (m_pendingEquals) {
+            decodeBody(afl::string::toBytes("="));
+        }
+        flushBody();
         break;
     }
-    m_accum.clear();
+    m_pendingEquals = false;
 }
 
 // Clear.
@@ -342,8 +348,9 @@ afl::net::MimeParser::clear()
     m_trace.clear();
     m_body.clear();
     m_body.push_back(String_t());
-    m_accum.clear();
     m_state = StateHeader;
+    m_decoder.reset();
+    m_pendingEquals = false;
     m_headerParser.reset(new HeaderParser(*this));
 }
 
@@ -465,8 +472,10 @@ afl::net::MimeParser::addDataHeader(afl::base::ConstBytes_t& data)
             String_t typ = strLCase(hf->getPrimaryValue());
             if (typ == "base64") {
                 m_state = StateBase64Body;
+                m_decoder.reset(afl::charset::Base64().createDecoder());
             } else if (typ == "quoted-printable") {
                 m_state = StateQPBody;
+                m_decoder.reset(afl::charset::QuotedPrintable().createDecoder());
             } else {
                 if (typ != "8bit" && typ != "7bit") {
                     if (m_pLog != 0) {
@@ -495,45 +504,55 @@ afl::net::MimeParser::addDataPlainBody(afl::base::ConstBytes_t& data)
     }
 }
 
-/* Add data while in "base64 Body" state. */
+/* Add data while in "base64 Body" state.
+   The body is a single base64 stream; line breaks are ignored.
+   A line ending in "=" ends the encoded data; the next line starts anew. */
 void
 afl::net::MimeParser::addDataBase64Body(afl::base::ConstBytes_t& data)
 {
-    while (const uint8_t* pc = data.eat()) {
-        const uint8_t c = *pc;
-        if (c == '\r') {
-            // skip
-        } else if (c == '\n') {
-            // whole line
-            flushBase64Body();
-        } else {
-            m_accum.push_back(c);
+    while (!data.empty()) {
+        afl::base::ConstBytes_t line = data.split(getLineLength(data));
+        if (!line.empty()) {
+            m_pendingEquals = (*line.at(line.size()-1) == '=');
+            decodeBody(line);
+        }
+        if (const uint8_t* pc = data.eat()) {
+            if (*pc == '\n' && m_pendingEquals) {
+                flushBody();
+                m_pendingEquals = false;
+            }
         }
     }
 }
 
-/* Add data while in "quoted-printable Body" state. */
+/* Add data while in "quoted-printable Body" state.
+   A line ending in "=" is joined with the next one (soft line break).
+   Because that "=" is only known to be a soft line break at the end of the line, it is held back until then. */
 void
 afl::net::MimeParser::addDataQPBody(afl::base::ConstBytes_t& data)
 {
-    while (const uint8_t* pc = data.eat()) {
-        const uint8_t c = *pc;
-        if (c == '\r') {
-            // skip
-        } else if (c == '\n') {
-            // whole line
-            bool addNL = true;
-            if (!m_accum.empty() && m_accum[m_accum.size()-1] == '=') {
-                addNL = false;
-                m_accum.pop_back();
+    while (!data.empty()) {
+        afl::base::ConstBytes_t line = data.split(getLineLength(data));
+        if (!line.empty()) {
+            if (m_pendingEquals) {
+                decodeBody(afl::string::toBytes("="));
             }
-            addBody(decodeQP(m_accum));
-            m_accum.clear();
-            if (addNL) {
-                m_body.push_back(String_t());
+            m_pendingEquals = (*line.at(line.size()-1) == '=');
+            if (m_pendingEquals) {
+                line.trim(line.size()-1);
+            }
+            decodeBody(line);
+        }
+        if (const uint8_t* pc = data.eat()) {
+            if (*pc == '\n') {
+                // whole line
+                if (m_pendingEquals) {
+                    m_pendingEquals = false;
+                } else {
+                    flushBody();
+                    m_body.push_back(String_t());
+                }
             }
-        } else {
-            m_accum.push_back(c);
         }
     }
 }
@@ -541,23 +560,40 @@ afl::net::MimeParser::addDataQPBody(afl::base::ConstBytes_t& data)
 /* Add text to the body.
    Handles possible line splitting. */
 void
-afl::net::MimeParser::addBody(const String_t& str)
+afl::net::MimeParser::addBody(afl::base::ConstBytes_t data)
 {
-    for (String_t::size_type i = 0; i < str.size(); ++i) {
-        if (str[i] == '\n') {
-            m_body.push_back(String_t());
-        } else {
-            m_body.back() += str[i];
+    while (!data.empty()) {
+        const uint8_t* p = data.unsafeData();
+        const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(p, '\n', data.size()));
+        if (nl == 0) {
+            m_body.back().append(reinterpret_cast<const char*>(p), data.size());
+            break;
         }
+        m_body.back().append(reinterpret_cast<const char*>(p), size_t(nl - p));
+        m_body.push_back(String_t());
+        data.split(size_t(nl - p) + 1);
     }
 }
 
-/* Finish a base64 part. */
+/* Decode body text and add the result to the body. */
+void
+afl::net::MimeParser::decodeBody(afl::base::ConstBytes_t data)
+{
+    uint8_t buffer[1024];
+    afl::base::Bytes_t out;
+    do {
+        out = buffer;
+        m_decoder->transcode(data, out);
+        addBody(out);
+    } while (!data.empty() || out.size() == sizeof(buffer));
+}
+
+/* Decode pending partial input of the body decoder. */
 void
-afl::net::MimeParser::flushBase64Body()
+afl::net::MimeParser::flushBody()
 {
-    addBody(decodeBase64(m_accum));
-    m_accum.clear();
+    m_decoder->flush();
+    decodeBody(afl::base::Nothing);
 }
 
 /* Process a "Received" header. */
@@ -11,6 +11,7 @@
 #include "afl/base/memory.hpp"
 #include "afl/base/optional.hpp"
 #include "afl/base/types.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/io/datasink.hpp"
 #include "afl/string/string.hpp"
 #include "afl/sys/loglistener.hpp"
@@ -141,9 +142,6 @@ namespace afl { namespace net {
         /** Body of mail, one entry per line. */
         BodyVec_t m_body;
 
-        /** Accumulator for parsing. */
-        std::vector<uint8_t> m_accum;
-
         /** Parser state. */
         enum {
             StateHeader,
@@ -155,6 +153,13 @@ namespace afl { namespace net {
         /** Body decoding? */
         bool m_decodeBody;
 
+        /** Decoder for StateBase64Body, StateQPBody. */
+        std::auto_ptr<afl::charset::Transcoder> m_decoder;
+
+        /** Current line ends with '=' that has not yet been given to m_decoder (StateQPBody)
+            or that has been given to m_decoder (StateBase64Body). */
+        bool m_pendingEquals;
+
         /** Logger. */
         afl::sys::LogListener* m_pLog;
 
@@ -168,8 +173,9 @@ namespace afl { namespace net {
         void addDataPlainBody(afl::base::ConstBytes_t& data);
         void addDataBase64Body(afl::base::ConstBytes_t& data);
         void addDataQPBody(afl::base::ConstBytes_t& data);
-        void addBody(const String_t& str);
-        void flushBase64Body();
+        void addBody(afl::base::ConstBytes_t data);
+        void decodeBody(afl::base::ConstBytes_t data);
+        void flushBody();
 
         void processReceivedHeader(const String_t& value);
     };
@@ -244,6 +244,23 @@ namespace {
         }
     }
 
+    String_t eatVerb(afl::data::SegmentView& v)
+    {
+        String_t verb;
+        if (!v.eat(verb)) {
+            fail(MISSING_COMMAND);
+        }
+        return afl::string::strUCase(verb);
+    }
+
+    void addStringSet(afl::net::ReplyBuilder& reply, const std::set<String_t>& set)
+    {
+        reply.addArray(set.size());
+        for (std::set<String_t>::const_iterator it = set.begin(), e = set.end(); it != e; ++it) {
+            reply.addString(afl::string::toMemory(*it));
+        }
+    }
+
     bool matchKey(const String_t& pat, const String_t& key)
     {
         String_t::size_type n = pat.find('*');
@@ -279,11 +296,7 @@ afl::net::redis::InternalDatabase::call(const Segment_t& command)
 
     // Read the command
     afl::data::SegmentView v(command);
-    String_t verb;
-    if (!v.eat(verb)) {
-        fail(MISSING_COMMAND);
-    }
-    verb = afl::string::strUCase(verb);
+    String_t verb = eatVerb(v);
 
     // Placeholder for generic args
     try {
@@ -294,6 +307,28 @@ afl::net::redis::InternalDatabase::call(const Segment_t& command)
     }
 }
 
+// CommandHandler: call, with direct output.
+void
+afl::net::redis::InternalDatabase::callDirect(const Segment_t& command, ReplyBuilder& reply)
+{
+    // Protect it
+    afl::sys::MutexGuard g(m_mutex);
+
+    // Read the command
+    afl::data::SegmentView v(command);
+    String_t verb = eatVerb(v);
+
+    try {
+        if (!executeDirect(verb, v, reply)) {
+            std::auto_ptr<Value_t> result(execute(verb, v));
+            reply.addValue(result.get());
+        }
+    }
+    catch (std::runtime_error& e) {
+        throw std::runtime_error(afl::string::Format("%s [verb: %s]", e.what(), verb));
+    }
+}
+
 // CommandHandler: call, without value return.
 void
 afl::net::redis::InternalDatabase::callVoid(const Segment_t& command)
@@ -1061,6 +1096,105 @@ afl::net::redis::InternalDatabase::execute(const String_t& verb, afl::data::Segm
     }
 }
 
+bool
+afl::net::redis::InternalDatabase::executeDirect(const String_t& verb, afl::data::SegmentView v, ReplyBuilder& reply)
+{
+    String_t keyArg;
+
+    // All these commands must validate their parameters before producing output
+    if (verb == "GET") {
+        // GET key
+        checkArgumentCount(v, 1);
+        v.eat(keyArg);
+
+        if (String* sk = get<String>(keyArg)) {
+            reply.addString(afl::string::toMemory(sk->m_string));
+        } else {
+            reply.addNull();
+        }
+        return true;
+    } else if (verb == "HGETALL") {
+        // HGETALL key
+        checkArgumentCount(v, 1);
+        v.eat(keyArg);
+
+        if (Hash* hk = get<Hash>(keyArg)) {
+            reply.addArray(2*hk->m_hash.size());
+            for (std::map<String_t, String_t>::const_iterator it = hk->m_hash.begin(), e = hk->m_hash.end(); it != e; ++it) {
+                reply.addString(afl::string::toMemory(it->first));
+                reply.addString(afl::string::toMemory(it->second));
+            }
+        } else {
+            reply.addArray(0);
+        }
+        return true;
+    } else if (verb == "HKEYS") {
+        // HKEYS key
+        checkArgumentCount(v, 1);
+        v.eat(keyArg);
+
+        if (Hash* hk = get<Hash>(keyArg)) {
+            reply.addArray(hk->m_hash.size());
+            for (std::map<String_t, String_t>::const_iterator it = hk->m_hash.begin(), e = hk->m_hash.end(); it != e; ++it) {
+                reply.addString(afl::string::toMemory(it->first));
+            }
+        } else {
+            reply.addArray(0);
+        }
+        return true;
+    } else if (verb == "LRANGE") {
+        // LRANGE key beg end
+        int32_t beg = 0, end = 0;
+        checkArgumentCount(v, 3);
+        v.eat(keyArg);
+        v.eat(beg);
+        v.eat(end);
+
+        List* lk = get<List>(keyArg);
+        size_t i = 0, n = 0;
+        if (lk != 0) {
+            // Same index conversion as execute(), but produce the result in a single pass
+            size_t size = lk->m_list.size();
+            i = lk->convertIndex(beg);
+            size_t j = lk->convertIndex(end);
+            if (i <= j && i < size) {
+                n = std::min(j, size-1) - i + 1;
+            }
+        }
+
+        reply.addArray(n);
+        if (n != 0) {
+            std::list<String_t>::const_iterator it = lk->m_list.begin();
+            std::advance(it, static_cast<ptrdiff_t>(i));
+            for (; n > 0; --n, ++it) {
+                reply.addString(afl::string::toMemory(*it));
+            }
+        }
+        return true;
+    } else if (verb == "SMEMBERS") {
+        // SMEMBERS set
+        checkArgumentCount(v, 1);
+        v.eat(keyArg);
+
+        if (Set* sk = get<Set>(keyArg)) {
+            addStringSet(reply, sk->m_set);
+        } else {
+            reply.addArray(0);
+        }
+        return true;
+    } else if (verb == "SDIFF" || verb == "SINTER" || verb == "SUNION") {
+        // SDIFF/SINTER/SUNION set...
+        checkArgumentCountAtLeast(v, 1);
+
+        std::set<String_t> set;
+        executeSetOperation(verb == "SDIFF" ? Difference : verb == "SINTER" ? Intersection : Union, set, v);
+        addStringSet(reply, set);
+        return true;
+    } else {
+        return false;
+    }
+}
+
 template<typename T>
 T*
 afl::net::redis::InternalDatabase::get(const String_t& name) const
@@ -27,7 +27,9 @@ namespace afl { namespace net { namespace redis {
         - does not do multithreading, therefore no blocking primitives such as BLPOP or pub/sub
         - numeric values are int32_t, not int64_t (INCR etc.) or double (sort keys)
 
-        As of 20151025, this implementation is very simple and not optimized for memory or speed efficiency. */
+        As of 20151025, this implementation is very simple and not optimized for memory or speed efficiency.
+        callDirect() produces results of commands returning potentially large arrays (LRANGE, SMEMBERS, HGETALL, etc.)
+        directly into the ReplyBuilder, without building a Value tree. */
     class InternalDatabase : public CommandHandler {
      public:
         /** Constructor. Make an empty database. */
@@ -39,6 +41,7 @@ namespace afl { namespace net { namespace redis {
         // CommandHandler methods:
         virtual Value_t* call(const Segment_t& command);
         virtual void callVoid(const Segment_t& command);
+        virtual void callDirect(const Segment_t& command, ReplyBuilder& reply);
 
      private:
         // Value classes
@@ -66,6 +69,16 @@ namespace afl { namespace net { namespace redis {
             \param v Remaining arguments */
         Value_t* execute(const String_t& verb, afl::data::SegmentView v);
 
+        /** Execute command, producing the result directly into a ReplyBuilder.
+            Implements commands with potentially large results.
+            Produces no output if it throws.
+            \param verb Command verb
+            \param v Remaining arguments
+            \param reply ReplyBuilder
+            \retval true Command has been executed
+            \retval false Command not handled here; use execute() */
+        bool executeDirect(const String_t& verb, afl::data::SegmentView v, ReplyBuilder& reply);
+
         /** Get key, given a type.
             \param name Key
             \return Pointer to given type if found, null if not found
@@ -0,0 +1,48 @@
+/**
+  *  \file afl/net/replybuilder.hpp
+  *  \brief Interface afl::net::ReplyBuilder
+  */
+#ifndef AFL_AFL_NET_REPLYBUILDER_HPP
+#define AFL_AFL_NET_REPLYBUILDER_HPP
+
+#include "afl/base/deletable.hpp"
+#include "afl/base/types.hpp"
+#include "afl/data/value.hpp"
+#include "afl/string/string.hpp"
+
+namespace afl { namespace net {
+
+    /** Interface for building a command reply.
+        A CommandHandler normally returns its result as a tree of afl::data::Value objects.
+        A server that needs to serialize that result anyway can instead pass a ReplyBuilder to CommandHandler::callDirect(),
+        allowing the handler to produce its result directly into the output, without building a Value tree.
+
+        A reply consists of exactly one element (null, integer, string, array, or Value).
+        An array is started by addArray() and consists of the given number of following elements. */
+    class ReplyBuilder : public afl::base::Deletable {
+     public:
+        /** Add null value. */
+        virtual void addNull() = 0;
+
+        /** Add integer value.
+            \param iv Value */
+        virtual void addInteger(int32_t iv) = 0;
+
+        /** Add string value.
+            \param str Value. Can contain arbitrary binary data. */
+        virtual void addString(afl::string::ConstStringMemory_t str) = 0;
+
+        /** Start an array.
+            Must be followed by exactly \c numElements more elements.
+            \param numElements Number of elements */
+        virtual void addArray(size_t numElements) = 0;
+
+        /** Add value tree.
+            Use for results that are available as afl::data::Value anyway.
+            \param value Value, can be null */
+        virtual void addValue(const afl::data::Value* value) = 0;
+    };
+
+} }
+
+#endif
@@ -7,7 +7,7 @@
 #include "afl/net/resp/protocolhandler.hpp"
 #include "afl/sys/types.hpp"
 #include "afl/data/visitor.hpp"
-#include "afl/io/resp/writer.hpp"
+#include "afl/net/resp/replywriter.hpp"
 #include "afl/data/vector.hpp"
 #include "afl/string/messages.hpp"
 
@@ -16,9 +16,13 @@ afl::net::resp::ProtocolHandler::ProtocolHandler(CommandHandler& ch)
     : afl::net::ProtocolHandler(),
       m_state(Idle),
       m_ch(ch),
-      m_data(),
+      m_sendBuffer(),
+      m_replyBuffer(),
       m_factory(),
-      m_parser(m_factory)
+      m_parser(m_factory),
+      m_commandParser(),
+      m_arguments(),
+      m_parserActive(false)
 {
     m_parser.setAcceptShortForm(true);
 }
@@ -33,13 +37,14 @@ afl::net::resp::ProtocolHandler::getOperation(Operation& op)
 {
     // Acknowledge previous data
     if (m_state == Sending) {
-        m_data.popFront();
+        m_sendBuffer.clear();
         m_state = Idle;
     }
 
-    // Next data
-    if (m_state == Idle && !m_data.empty()) {
-        op.m_dataToSend = m_data.front()->getContent();
+    // Next data. Swap buffers so that replies can be collected while we're sending.
+    if (m_state == Idle && !m_replyBuffer.empty()) {
+        m_sendBuffer.swap(m_replyBuffer);
+        op.m_dataToSend = m_sendBuffer;
         m_state = Sending;
     } else {
         op.m_dataToSend.reset();
@@ -61,8 +66,17 @@ afl::net::resp::ProtocolHandler::handleData(afl::base::ConstBytes_t bytes)
 {
     try {
         while (!bytes.empty()) {
-            if (m_parser.handleData(bytes)) {
+            if (!m_parserActive && m_commandParser.parse(bytes)) {
+                // Fast path: complete command
+                m_commandParser.storeArguments(m_arguments);
+                handleCommand(m_arguments);
+            } else if (m_parser.handleData(bytes)) {
+                // Parser completed a value
+                m_parserActive = false;
                 handleNewValue(m_parser.extract());
+            } else {
+                // Parser consumed everything and needs more data
+                m_parserActive = true;
             }
         }
     }
@@ -90,56 +104,61 @@ afl::net::resp::ProtocolHandler::handleConnectionClose()
 void
 afl::net::resp::ProtocolHandler::handleNewValue(afl::data::Value* p)
 {
+    // Commands must be vectors; find out whether we have one
     class Visitor : public afl::data::Visitor {
      public:
-        Visitor(CommandHandler& ch, afl::io::resp::Writer& writer)
-            : m_ch(ch),
-              m_writer(writer)
+        Visitor()
+            : m_pCommand(0)
             { }
         virtual void visitString(const String_t& /*str*/)
-            { fail(); }
+            { }
         virtual void visitInteger(int32_t /*iv*/)
-            { fail(); }
+            { }
         virtual void visitFloat(double /*fv*/)
-            { fail(); }
+            { }
         virtual void visitBoolean(bool /*bv*/)
-            { fail(); }
+            { }
         virtual void visitHash(const afl::data::Hash& /*hv*/)
-            { fail(); }
+            { }
         virtual void visitVector(const afl::data::Vector& vv)
-            {
-                try {
-                    std::auto_ptr<afl::data::Value> result(m_ch.call(vv));
-                    m_writer.visit(result.get());
-                }
-                catch (std::exception& e) {
-                    m_writer.sendError(e.what());
-                }
-            }
+            { m_pCommand = &vv; }
         virtual void visitOther(const afl::data::Value& /*other*/)
-            { fail(); }
+            { }
         virtual void visitNull()
-            { fail(); }
+            { }
         virtual void visitError(const String_t& /*source*/, const String_t& /*str*/)
-            { fail(); }
-
+            { }
+        const afl::data::Segment* getCommand() const
+            { return m_pCommand; }
      private:
-        CommandHandler& m_ch;
-        afl::io::resp::Writer& m_writer;
-        void fail()
-            { m_writer.sendError(afl::string::Messages::invalidOperation()); }
+        const afl::data::Segment* m_pCommand;
     };
 
     // Grab hold of the value
     std::auto_ptr<afl::data::Value> pp(p);
 
-    // Make room for output
-    std::auto_ptr<afl::io::InternalSink> sink(new afl::io::InternalSink());
-    afl::io::resp::Writer writer(*sink);
-
     // Generate output
-    Visitor(m_ch, writer).visit(pp.get());
+    Visitor v;
+    v.visit(pp.get());
+    if (const afl::data::Segment* cmd = v.getCommand()) {
+        handleCommand(*cmd);
+    } else {
+        ReplyWriter(m_replyBuffer).sendError(afl::string::Messages::invalidOperation());
+    }
+}
 
-    // Stash it away
-    m_data.pushBackNew(sink.release());
+void
+afl::net::resp::ProtocolHandler::handleCommand(const afl::data::Segment& command)
+{
+    // Generate output directly into the reply buffer.
+    // If the command fails, discard its partial output and send the error instead.
+    const size_t mark = m_replyBuffer.size();
+    ReplyWriter writer(m_replyBuffer);
+    try {
+        m_ch.callDirect(command, writer);
+    }
+    catch (std::exception& e) {
+        m_replyBuffer.trim(mark);
+        writer.sendError(e.what());
+    }
 }
@@ -5,9 +5,9 @@
 #ifndef AFL_AFL_NET_RESP_PROTOCOLHANDLER_HPP
 #define AFL_AFL_NET_RESP_PROTOCOLHANDLER_HPP
 
-#include "afl/container/ptrqueue.hpp"
+#include "afl/base/growablememory.hpp"
 #include "afl/data/defaultvaluefactory.hpp"
-#include "afl/io/internalsink.hpp"
+#include "afl/io/resp/commandparser.hpp"
 #include "afl/io/resp/parser.hpp"
 #include "afl/net/commandhandler.hpp"
 #include "afl/net/protocolhandler.hpp"
@@ -22,7 +22,15 @@ namespace afl { namespace net { namespace resp {
 
         For a stateful (=per-session state) protocol, derive your own ProtocolHandler class.
         Create an instance of your CommandHandler and one of afl::net::resp::ProtocolHandler,
-        and dispatch calls into your ProtocolHandler to the afl::net::resp::ProtocolHandler instance. */
+        and dispatch calls into your ProtocolHandler to the afl::net::resp::ProtocolHandler instance.
+
+        Complete multi-bulk commands (the format used by all Redis clients) are parsed directly from the
+        receive buffer using a CommandParser, re-using the argument values between commands.
+        Fragmented input, short-form commands, and everything else goes through the general-purpose Parser.
+
+        Replies are produced using CommandHandler::callDirect() and serialized directly into a per-connection buffer
+        which is re-used for the whole lifetime of the connection.
+        Replies produced while a previous batch is being sent are collected and sent together. */
     class ProtocolHandler : public afl::net::ProtocolHandler {
      public:
         /** Constructor.
@@ -47,11 +55,16 @@ namespace afl { namespace net { namespace resp {
         };
         State m_state;
         CommandHandler& m_ch;
-        afl::container::PtrQueue<afl::io::InternalSink> m_data;
+        afl::base::GrowableBytes_t m_sendBuffer;
+        afl::base::GrowableBytes_t m_replyBuffer;
         afl::data::DefaultValueFactory m_factory;
         afl::io::resp::Parser m_parser;
+        afl::io::resp::CommandParser m_commandParser;
+        afl::data::Segment m_arguments;
+        bool m_parserActive;
 
         void handleNewValue(afl::data::Value* p);
+        void handleCommand(const afl::data::Segment& command);
     };
 
 } } }
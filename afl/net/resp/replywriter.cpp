@@ -0,0 +1,91 @@
+/**
+  *  \file afl/net/resp/replywriter.cpp
+  *  \brief Class afl::net::resp::ReplyWriter
+  */
+
+#include "afl/net/resp/replywriter.hpp"
+#include "afl/io/datasink.hpp"
+#include "afl/io/resp/writer.hpp"
+#include "afl/string/format.hpp"
+
+namespace {
+    /* DataSink adaptor to let afl::io::resp::Writer write into our buffer. */
+    class BufferSink : public afl::io::DataSink {
+     public:
+        BufferSink(afl::base::GrowableBytes_t& out)
+            : m_out(out)
+            { }
+        virtual bool handleData(afl::base::ConstBytes_t& data)
+            {
+                m_out.append(data);
+                data.reset();
+                return false;
+            }
+     private:
+        afl::base::GrowableBytes_t& m_out;
+    };
+}
+
+afl::net::resp::ReplyWriter::ReplyWriter(afl::base::GrowableBytes_t& out)
+    : m_out(out)
+{ }
+
+afl::net::resp::ReplyWriter::~ReplyWriter()
+{ }
+
+void
+afl::net::resp::ReplyWriter::sendError(const String_t& str)
+{
+    BufferSink sink(m_out);
+    afl::io::resp::Writer(sink).sendError(str);
+}
+
+void
+afl::net::resp::ReplyWriter::addNull()
+{
+    m_out.append(afl::string::toBytes("$-1\r\n"));
+}
+
+void
+afl::net::resp::ReplyWriter::addInteger(int32_t iv)
+{
+    // Like Writer, send integers as strings
+    addString(afl::string::toMemory(afl::string::Format("%d", iv)));
+}
+
+void
+afl::net::resp::ReplyWriter::addString(afl::string::ConstStringMemory_t str)
+{
+    writeHeader('$', str.size());
+    m_out.append(str.toBytes());
+    m_out.append(afl::string::toBytes("\r\n"));
+}
+
+void
+afl::net::resp::ReplyWriter::addArray(size_t numElements)
+{
+    writeHeader('*', numElements);
+}
+
+void
+afl::net::resp::ReplyWriter::addValue(const afl::data::Value* value)
+{
+    BufferSink sink(m_out);
+    afl::io::resp::Writer(sink).visit(value);
+}
+
+void
+afl::net::resp::ReplyWriter::writeHeader(char marker, size_t value)
+{
+    // Format "<marker><value>\r\n" without going through a String_t
+    uint8_t buffer[30];
+    size_t pos = sizeof(buffer);
+    buffer[--pos] = '\n';
+    buffer[--pos] = '\r';
+    do {
+        buffer[--pos] = uint8_t('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    buffer[--pos] = uint8_t(marker);
+    m_out.append(afl::base::ConstBytes_t(buffer).subrange(pos));
+}
@@ -0,0 +1,46 @@
+/**
+  *  \file afl/net/resp/replywriter.hpp
+  *  \brief Class afl::net::resp::ReplyWriter
+  */
+#ifndef AFL_AFL_NET_RESP_REPLYWRITER_HPP
+#define AFL_AFL_NET_RESP_REPLYWRITER_HPP
+
+#include "afl/base/growablememory.hpp"
+#include "afl/net/replybuilder.hpp"
+
+namespace afl { namespace net { namespace resp {
+
+    /** RESP reply writer.
+        Implements ReplyBuilder by serializing RESP directly into a byte buffer.
+        The output is identical to what afl::io::resp::Writer produces for the equivalent Value tree
+        (in particular, integers are sent as bulk strings). */
+    class ReplyWriter : public ReplyBuilder {
+     public:
+        /** Constructor.
+            \param out Output buffer. Data is appended to it. */
+        explicit ReplyWriter(afl::base::GrowableBytes_t& out);
+
+        /** Destructor. */
+        ~ReplyWriter();
+
+        /** Send an error message.
+            \param str error message
+            \see afl::io::resp::Writer::sendError */
+        void sendError(const String_t& str);
+
+        // ReplyBuilder:
+        virtual void addNull();
+        virtual void addInteger(int32_t iv);
+        virtual void addString(afl::string::ConstStringMemory_t str);
+        virtual void addArray(size_t numElements);
+        virtual void addValue(const afl::data::Value* value);
+
+     private:
+        afl::base::GrowableBytes_t& m_out;
+
+        void writeHeader(char marker, size_t value);
+    };
+
+} } }
+
+#endif
@@ -0,0 +1,121 @@
+/**
+  *  \file app/charsetbench.cpp
+  *  \brief Sample application: Charset Benchmark
+  *
+  *  Invoke as
+  *    charsetbench [-mb=N]
+  *  This will decode and encode N MiB of text (default: 64) using all codepages
+  *  (afl::charset::CodepageCharset), and report the throughput.
+  *  "Text" is mostly ASCII with some codepage characters, "Binary" uses only the upper half of the codepage.
+  */
+
+#include "afl/base/growablememory.hpp"
+#include "afl/charset/codepage.hpp"
+#include "afl/charset/codepagecharset.hpp"
+#include "afl/string/format.hpp"
+#include "afl/string/parse.hpp"
+#include "afl/sys/environment.hpp"
+#include "afl/sys/time.hpp"
+
+namespace {
+    struct CodepageInfo {
+        const char* name;
+        const afl::charset::Codepage* codepage;
+    };
+    const CodepageInfo CODEPAGES[] = {
+        { "cp1250",  &afl::charset::g_codepage1250 },
+        { "cp1251",  &afl::charset::g_codepage1251 },
+        { "cp1252",  &afl::charset::g_codepage1252 },
+        { "cp437",   &afl::charset::g_codepage437 },
+        { "cp850",   &afl::charset::g_codepage850 },
+        { "cp852",   &afl::charset::g_codepage852 },
+        { "cp866",   &afl::charset::g_codepage866 },
+        { "koi8r",   &afl::charset::g_codepageKOI8R },
+        { "latin1",  &afl::charset::g_codepageLatin1 },
+        { "latin2",  &afl::charset::g_codepageLatin2 },
+    };
+
+    const size_t CHUNK_SIZE = 65536;
+
+    double getSpeed(size_t bytes, uint32_t elapsed)
+    {
+        return double(bytes) / 1048576.0 * 1000.0 / double(elapsed == 0 ? 1 : elapsed);
+    }
+
+    /* Benchmark decode+encode of one data set, add result columns to line */
+    void benchmark(String_t& line, afl::charset::Charset& cs, afl::base::ConstBytes_t data, size_t totalSize)
+    {
+        const size_t numChunks = totalSize / CHUNK_SIZE;
+
+        // Decode
+        uint32_t startTime = afl::sys::Time::getTickCounter();
+        String_t text;
+        for (size_t n = 0; n < numChunks; ++n) {
+            text = cs.decode(data.subrange((n * CHUNK_SIZE) % (data.size() - CHUNK_SIZE + 1), CHUNK_SIZE));
+        }
+        line += afl::string::Format(" %10.0f", getSpeed(numChunks * CHUNK_SIZE, afl::sys::Time::getTickCounter() - startTime));
+
+        // Encode (measured in codepage bytes, for comparability)
+        startTime = afl::sys::Time::getTickCounter();
+        size_t result = 0;
+        for (size_t n = 0; n < numChunks; ++n) {
+            result += cs.encode(afl::string::toMemory(text)).size();
+        }
+        line += afl::string::Format(" %10.0f", getSpeed(numChunks * CHUNK_SIZE, afl::sys::Time::getTickCounter() - startTime));
+        if (result != numChunks * CHUNK_SIZE) {
+            // Not all codepages round-trip; mark those
+            line += "*";
+        } else {
+            line += " ";
+        }
+    }
+}
+
+int main(int, char** argv)
+{
+    // Environment
+    afl::sys::Environment& env = afl::sys::Environment::getInstance(argv);
+    afl::base::Ref<afl::io::TextWriter> out(env.attachTextWriter(env.Output));
+
+    // Parse command line
+    size_t totalMB = 64;
+    afl::base::Ref<afl::sys::Environment::CommandLine_t> cmdl(env.getCommandLine());
+    String_t what;
+    while (cmdl->getNextElement(what)) {
+        uint32_t mb;
+        if (what.compare(0, 4, "-mb=", 4) == 0 && afl::string::strToInteger(what.substr(4), mb) && mb > 0) {
+            totalMB = mb;
+        } else {
+            out->writeLine(afl::string::Format("Unknown command line parameter: \"%s\"", what));
+            out->flush();
+            return 1;
+        }
+    }
+
+    // Test data: pseudo-random
+    // - text: printable ASCII with every 16th character from the upper half
+    // - binary: upper half only
+    afl::base::GrowableBytes_t textData, binaryData;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < 1048576; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const uint8_t rnd = uint8_t(seed >> 16);
+        textData.append(i % 16 == 15 ? uint8_t(0x80 | rnd) : uint8_t(0x20 + rnd % 0x5F));
+        binaryData.append(uint8_t(0x80 | rnd));
+    }
+
+    // Header
+    out->writeLine("MB/s         Text dec   Text enc     Bin dec    Bin enc");
+
+    // Benchmarks
+    const size_t totalSize = totalMB * 1048576;
+    for (size_t i = 0; i < sizeof(CODEPAGES)/sizeof(CODEPAGES[0]); ++i) {
+        afl::charset::CodepageCharset cs(*CODEPAGES[i].codepage);
+        String_t line = afl::string::Format("%-10s", CODEPAGES[i].name);
+        benchmark(line, cs, textData, totalSize);
+        benchmark(line, cs, binaryData, totalSize);
+        out->writeLine(line);
+        out->flush();
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+/**
+  *  \file app/checksumbench.cpp
+  *  \brief Sample application: Checksum Benchmark
+  *
+  *  Invoke as
+  *    checksumbench [-mb=N]
+  *  This will compute all checksums (afl::checksums::Checksum descendants) over N MiB of data (default: 256),
+  *  using different block sizes, and report the throughput.
+  */
+
+#include "afl/base/growablememory.hpp"
+#include "afl/checksums/adler32.hpp"
+#include "afl/checksums/bytesum.hpp"
+#include "afl/checksums/crc16.hpp"
+#include "afl/checksums/crc32.hpp"
+#include "afl/string/format.hpp"
+#include "afl/string/parse.hpp"
+#include "afl/sys/environment.hpp"
+#include "afl/sys/time.hpp"
+
+namespace {
+    const size_t BLOCK_SIZES[] = { 16, 256, 4096, 65536, 1048576 };
+
+    void benchmark(afl::io::TextWriter& out, const char* name, const afl::checksums::Checksum& cs, afl::base::ConstBytes_t data, size_t totalSize)
+    {
+        String_t line = afl::string::Format("%-10s", name);
+        for (size_t i = 0; i < sizeof(BLOCK_SIZES)/sizeof(BLOCK_SIZES[0]); ++i) {
+            const size_t blockSize = BLOCK_SIZES[i];
+            const size_t numBlocks = totalSize / blockSize;
+
+            // Process blocks. Use the result to prevent the compiler from optimizing it out.
+            const uint32_t startTime = afl::sys::Time::getTickCounter();
+            uint32_t result = 0;
+            for (size_t n = 0; n < numBlocks; ++n) {
+                result = cs.add(data.subrange((n * blockSize) % (data.size() - blockSize + 1), blockSize), result);
+            }
+            const uint32_t elapsed = afl::sys::Time::getTickCounter() - startTime;
+
+            const double mbps = double(numBlocks * blockSize) / 1048576.0 * 1000.0 / double(elapsed == 0 ? 1 : elapsed);
+            line += afl::string::Format(" %10.0f", mbps);
+            if (result == 0xFFFFFFFF) {
+                line += "!";
+            }
+        }
+        out.writeLine(line);
+        out.flush();
+    }
+}
+
+int main(int, char** argv)
+{
+    // Environment
+    afl::sys::Environment& env = afl::sys::Environment::getInstance(argv);
+    afl::base::Ref<afl::io::TextWriter> out(env.attachTextWriter(env.Output));
+
+    // Parse command line
+    size_t totalMB = 256;
+    afl::base::Ref<afl::sys::Environment::CommandLine_t> cmdl(env.getCommandLine());
+    String_t what;
+    while (cmdl->getNextElement(what)) {
+        uint32_t mb;
+        if (what.compare(0, 4, "-mb=", 4) == 0 && afl::string::strToInteger(what.substr(4), mb) && mb > 0) {
+            totalMB = mb;
+        } else {
+            out->writeLine(afl::string::Format("Unknown command line parameter: \"%s\"", what));
+            out->flush();
+            return 1;
+        }
+    }
+
+    // Test data: pseudo-random, larger than largest block size, so we're not just measuring the cache
+    afl::base::GrowableBytes_t data;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < 4*1048576; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data.append(uint8_t(seed >> 16));
+    }
+
+    // Header
+    String_t header = afl::string::Format("%-10s", "MB/s");
+    for (size_t i = 0; i < sizeof(BLOCK_SIZES)/sizeof(BLOCK_SIZES[0]); ++i) {
+        header += afl::string::Format(" %10d", BLOCK_SIZES[i]);
+    }
+    out->writeLine(header);
+
+    // Benchmarks
+    const size_t totalSize = totalMB * 1048576;
+    benchmark(*out, "ByteSum", afl::checksums::ByteSum(), data, totalSize);
+    benchmark(*out, "Adler32", afl::checksums::Adler32(), data, totalSize);
+    benchmark(*out, "CRC16", afl::checksums::CRC16::getDefaultInstance(), data, totalSize);
+    benchmark(*out, "CRC32", afl::checksums::CRC32::getDefaultInstance(), data, totalSize);
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+  *  \file app/copy.cpp
+  *  \brief Sample application: Copy files
+  *
+  *  Invoke as
+  *    copy [-buffered] source dest
+  *  Copies a file using Stream::copyFrom() and reports the throughput on standard error.
+  *  Use "-" as dest to copy to standard output (e.g. a pipe or socket).
+  *  Use "-socket" as dest to copy into a local socket connection (POSIX only);
+  *  the receiving end is read and discarded by a separate thread.
+  *  Use "-buffered" to force copying through a user-space buffer,
+  *  for comparison with the operating-system supported method.
+  */
+
+#include <memory>
+#include "afl/base/stoppable.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/io/filesystem.hpp"
+#include "afl/string/format.hpp"
+#include "afl/sys/environment.hpp"
+#include "afl/sys/thread.hpp"
+#include "afl/sys/time.hpp"
+
+#if TARGET_OS_POSIX
+# include <sys/socket.h>
+# include <unistd.h>
+
+namespace {
+    /* Socket target.
+       Replaces standard output by one end of a socket connection;
+       a thread reads and discards everything arriving at the other end.
+       Standard output then is an operating-system stream like any other. */
+    class SocketTarget : private afl::base::Stoppable {
+     public:
+        explicit SocketTarget(int fd)
+            : m_fd(fd), m_thread("copy.socket", *this)
+            { m_thread.start(); }
+
+        /* Close standard output and wait until the receiver saw everything. */
+        ~SocketTarget()
+            {
+                ::close(1);
+                m_thread.join();
+                ::close(m_fd);
+            }
+
+        /* Create socket target. Returns null on error. */
+        static SocketTarget* create()
+            {
+                int fds[2];
+                if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                    return 0;
+                }
+                if (::dup2(fds[0], 1) < 0) {
+                    ::close(fds[0]);
+                    ::close(fds[1]);
+                    return 0;
+                }
+                ::close(fds[0]);
+                return new SocketTarget(fds[1]);
+            }
+
+     private:
+        int m_fd;
+        afl::sys::Thread m_thread;
+
+        virtual void run()
+            {
+                static char buffer[65536];
+                while (::read(m_fd, buffer, sizeof(buffer)) > 0)
+                    ;
+            }
+        virtual void stop()
+            { }
+    };
+}
+#else
+namespace {
+    class SocketTarget {
+     public:
+        static SocketTarget* create()
+            { return 0; }
+    };
+}
+#endif
+
+int main(int, char** argv)
+{
+    // Environment
+    afl::sys::Environment& env = afl::sys::Environment::getInstance(argv);
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    afl::base::Ref<afl::io::TextWriter> err(env.attachTextWriter(env.Error));
+
+    try {
+        // Parse command line
+        afl::base::Ref<afl::sys::Environment::CommandLine_t> cmdl(env.getCommandLine());
+        String_t what;
+        String_t source, dest;
+        bool buffered = false;
+        while (cmdl->getNextElement(what)) {
+            if (what == "-buffered") {
+                buffered = true;
+            } else if (what != "-" && what != "-socket" && (what == "" || what[0] == '-')) {
+                err->writeLine(afl::string::Format("Unknown command line parameter: \"%s\"", what));
+                err->flush();
+                return 1;
+            } else if (source.empty()) {
+                source = what;
+            } else if (dest.empty()) {
+                dest = what;
+            } else {
+                err->writeLine("Too many parameters");
+                err->flush();
+                return 1;
+            }
+        }
+        if (dest.empty()) {
+            err->writeLine("Usage: copy [-buffered] source dest");
+            err->flush();
+            return 1;
+        }
+
+        // Socket target
+        std::auto_ptr<SocketTarget> socket;
+        if (dest == "-socket") {
+            socket.reset(SocketTarget::create());
+            if (socket.get() == 0) {
+                err->writeLine("Unable to create socket");
+                err->flush();
+                return 1;
+            }
+        }
+
+        // Open files. A child stream is not recognized as an operating-system file, and forces a buffered copy.
+        afl::base::Ref<afl::io::Stream> file = fs.openFile(source, fs.OpenRead);
+        afl::base::Ref<afl::io::Stream> in = (buffered ? file->createChild() : file);
+        uint32_t start = afl::sys::Time::getTickCounter();
+        {
+            afl::base::Ref<afl::io::Stream> out = (socket.get() != 0 || dest == "-" ? env.attachStream(env.Output) : fs.openFile(dest, fs.Create));
+
+            // Copy
+            out->copyFrom(*in);
+            out->flush();
+        }
+        socket.reset();
+        uint32_t time = afl::sys::Time::getTickCounter() - start;
+
+        // Report
+        afl::io::Stream::FileSize_t size = in->getPos();
+        err->writeLine(afl::string::Format("%d bytes in %d ms, %.1f MB/s", size, time, double(size) / 1048576.0 / (time == 0 ? 0.001 : time / 1000.0)));
+        err->flush();
+        return 0;
+    }
+    catch (afl::except::FileProblemException& e) {
+        err->writeLine(afl::string::Format("%s: %s", e.getFileName(), e.what()));
+        err->flush();
+        return 1;
+    }
+    catch (std::exception& e) {
+        err->writeLine(afl::string::Format("exception: %s", e.what()));
+        err->flush();
+        return 1;
+    }
+}
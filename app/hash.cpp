@@ -8,16 +8,26 @@
   *    hash -md5 file.dat
   *  This will compute the given hash and output it to standard output,
   *  and will produce the same output as "md5sum", "sha1sum", etc.
+  *
+  *  Additional options (apply to following files):
+  *    -crc32       compute CRC32 instead of a hash
+  *    -threads=N   use N worker threads (default: 0, i.e. single-threaded)
+  *    -tree        compute a tree hash (RFC 6962) with 1 MiB leaves; unlike regular hashing,
+  *                 this hashes in parallel, but produces a different result
   */
 
 #include <memory>
 #include <cstdlib>
+#include "afl/checksums/crc32.hpp"
 #include "afl/checksums/hash.hpp"
 #include "afl/checksums/md5.hpp"
+#include "afl/checksums/parallelhasher.hpp"
 #include "afl/checksums/sha1.hpp"
 #include "afl/except/fileproblemexception.hpp"
 #include "afl/io/filesystem.hpp"
 #include "afl/string/format.hpp"
+#include "afl/string/hex.hpp"
+#include "afl/string/parse.hpp"
 #include "afl/sys/environment.hpp"
 #include "afl/checksums/sha256.hpp"
 #include "afl/checksums/sha224.hpp"
@@ -25,31 +35,52 @@
 #include "afl/checksums/sha512.hpp"
 
 namespace {
-    void hashStream(afl::checksums::Hash* pHash,
+    struct Config {
+        std::auto_ptr<afl::checksums::Hash> hash;
+        bool crc32;
+        bool tree;
+        size_t numThreads;
+
+        Config()
+            : hash(), crc32(false), tree(false), numThreads(0)
+            { }
+
+        void setHash(afl::checksums::Hash* p)
+            {
+                hash.reset(p);
+                crc32 = false;
+            }
+    };
+
+    void hashStream(const Config& config,
                     afl::io::Stream& in,
                     afl::io::TextWriter& out)
     {
-        // Do we have a hash?
-        if (pHash == 0) {
+        afl::checksums::ParallelHasher hasher(config.numThreads);
+        String_t result;
+        if (config.crc32) {
+            // CRC32
+            result = afl::string::Format("%08x", hasher.computeCRC32(afl::checksums::CRC32::getDefaultInstance(), in));
+        } else if (config.hash.get() == 0) {
+            // Do we have a hash?
             out.writeLine("No hash configured");
             out.flush();
             std::exit(1);
-        }
-
-        // Read the file
-        pHash->clear();
-        while (1) {
-            uint8_t buffer[4096];
-            afl::base::Bytes_t bufferDescriptor(buffer);
-            bufferDescriptor.trim(in.read(bufferDescriptor));
-            if (bufferDescriptor.empty()) {
-                break;
+        } else if (config.tree) {
+            // Tree hash
+            uint8_t buffer[afl::checksums::Hash::MAX_HASH_SIZE];
+            afl::base::ConstBytes_t hash = hasher.computeTreeHash(*config.hash, in, buffer);
+            while (const uint8_t* p = hash.eat()) {
+                afl::string::putHexByte(result, *p, afl::string::HEX_DIGITS_LOWER);
             }
-            pHash->add(bufferDescriptor);
+        } else {
+            // Regular hash
+            hasher.computeHash(*config.hash, in);
+            result = config.hash->getHashAsHexString();
         }
 
         // Get output
-        out.writeLine(afl::string::Format("%s  %s", pHash->getHashAsHexString(), in.getName()));
+        out.writeLine(afl::string::Format("%s  %s", result, in.getName()));
     }
 }
 
@@ -61,7 +92,7 @@ int main(int, char** argv)
     afl::base::Ref<afl::io::TextWriter> out(env.attachTextWriter(env.Output));
 
     // Current hash
-    std::auto_ptr<afl::checksums::Hash> hash;
+    Config config;
 
     // Operate
     try {
@@ -69,23 +100,30 @@ int main(int, char** argv)
         String_t what;
         while (cmdl->getNextElement(what)) {
             if (what == "-") {
-                hashStream(hash.get(), *env.attachStream(env.Input), *out);
+                hashStream(config, *env.attachStream(env.Input), *out);
             } else if (what == "-md5") {
-                hash.reset(new afl::checksums::MD5());
+                config.setHash(new afl::checksums::MD5());
             } else if (what == "-sha1") {
-                hash.reset(new afl::checksums::SHA1());
+                config.setHash(new afl::checksums::SHA1());
             } else if (what == "-sha224") {
-                hash.reset(new afl::checksums::SHA224());
+                config.setHash(new afl::checksums::SHA224());
             } else if (what == "-sha256") {
-                hash.reset(new afl::checksums::SHA256());
+                config.setHash(new afl::checksums::SHA256());
             } else if (what == "-sha384") {
-                hash.reset(new afl::checksums::SHA384());
+                config.setHash(new afl::checksums::SHA384());
             } else if (what == "-sha512") {
-                hash.reset(new afl::checksums::SHA512());
+                config.setHash(new afl::checksums::SHA512());
+            } else if (what == "-crc32") {
+                config.setHash(0);
+                config.crc32 = true;
+            } else if (what == "-tree") {
+                config.tree = true;
+            } else if (what.compare(0, 9, "-threads=", 9) == 0 && afl::string::strToInteger(what.substr(9), config.numThreads)) {
+                // ok
             } else if (what == "" || what[0] == '-') {
                 out->writeLine(afl::string::Format("Unknown command line parameter: \"%s\"", what));
             } else {
-                hashStream(hash.get(), *fs.openFile(what, fs.OpenRead), *out);
+                hashStream(config, *fs.openFile(what, fs.OpenRead), *out);
             }
         }
         out->flush();
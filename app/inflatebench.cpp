@@ -0,0 +1,200 @@
+/**
+  *  \file app/inflatebench.cpp
+  *  \brief Sample application: Inflate Benchmark
+  *
+  *  Invoke as
+  *    inflatebench [-mb=N]
+  *  This will compress N MiB of data (default: 64) using afl::io::DeflateTransform,
+  *  and decompress it using the built-in decoder (afl::io::Inflater) and using afl::io::InflateTransform,
+  *  which uses zlib if available, and report the throughput.
+  *  "Text" is highly compressible, "Binary" is barely compressible, "Stored" is not compressed at all.
+  */
+
+#include "afl/base/growablememory.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/inflater.hpp"
+#include "afl/io/inflatetransform.hpp"
+#include "afl/string/format.hpp"
+#include "afl/string/parse.hpp"
+#include "afl/sys/environment.hpp"
+#include "afl/sys/time.hpp"
+
+namespace {
+    const size_t CHUNK_SIZE = 65536;
+
+    double getSpeed(size_t bytes, uint32_t elapsed)
+    {
+        return double(bytes) / 1048576.0 * 1000.0 / double(elapsed == 0 ? 1 : elapsed);
+    }
+
+    /* Compress data into a raw deflate stream */
+    void compress(afl::base::GrowableBytes_t& result, afl::base::ConstBytes_t data)
+    {
+        afl::io::DeflateTransform tx(afl::io::DeflateTransform::Raw);
+        uint8_t buffer[CHUNK_SIZE];
+        while (!data.empty()) {
+            afl::base::Bytes_t out(buffer);
+            tx.transform(data, out);
+            result.append(out);
+        }
+        tx.flush();
+        while (1) {
+            afl::base::ConstBytes_t in;
+            afl::base::Bytes_t out(buffer);
+            tx.transform(in, out);
+            if (out.empty()) {
+                break;
+            }
+            result.append(out);
+        }
+    }
+
+    /* Build a raw deflate stream consisting of stored blocks */
+    void store(afl::base::GrowableBytes_t& result, afl::base::ConstBytes_t data)
+    {
+        do {
+            afl::base::ConstBytes_t block = data.split(CHUNK_SIZE - 1);
+            const uint16_t len = uint16_t(block.size());
+            result.append(uint8_t(data.empty() ? 1 : 0));
+            result.append(uint8_t(len));
+            result.append(uint8_t(len >> 8));
+            result.append(uint8_t(~len & 0xFF));
+            result.append(uint8_t(~len >> 8 & 0xFF));
+            result.append(block);
+        } while (!data.empty());
+    }
+
+    /* Decompress using built-in decoder; returns number of bytes produced */
+    size_t decodeBuiltin(afl::base::ConstBytes_t in)
+    {
+        afl::io::Inflater inf;
+        uint8_t buffer[CHUNK_SIZE];
+        size_t result = 0;
+        bool done = false;
+        while (!done) {
+            afl::base::Bytes_t out(buffer);
+            done = inf.inflate(in, out);
+            result += out.size();
+            if (!done && in.empty() && out.empty()) {
+                throw afl::except::FileProblemException("<inflatebench>", "Truncated data");
+            }
+        }
+        return result;
+    }
+
+    /* Decompress using InflateTransform; returns number of bytes produced */
+    size_t decodeTransform(afl::base::ConstBytes_t in)
+    {
+        afl::io::InflateTransform tx(afl::io::InflateTransform::Raw);
+        uint8_t buffer[CHUNK_SIZE];
+        size_t result = 0;
+        while (1) {
+            afl::base::Bytes_t out(buffer);
+            tx.transform(in, out);
+            if (out.empty()) {
+                break;
+            }
+            result += out.size();
+        }
+        return result;
+    }
+
+    /* Benchmark one data set, add result columns to line */
+    void benchmark(String_t& line, afl::base::ConstBytes_t compressed, size_t expectedSize, size_t totalSize)
+    {
+        const size_t numRounds = (totalSize + expectedSize - 1) / expectedSize;
+
+        // Built-in
+        uint32_t startTime = afl::sys::Time::getTickCounter();
+        size_t result = 0;
+        for (size_t n = 0; n < numRounds; ++n) {
+            result += decodeBuiltin(compressed);
+        }
+        line += afl::string::Format(" %10.0f", getSpeed(result, afl::sys::Time::getTickCounter() - startTime));
+        line += (result == numRounds * expectedSize ? " " : "*");
+
+        // Transform
+        startTime = afl::sys::Time::getTickCounter();
+        result = 0;
+        for (size_t n = 0; n < numRounds; ++n) {
+            result += decodeTransform(compressed);
+        }
+        line += afl::string::Format(" %10.0f", getSpeed(result, afl::sys::Time::getTickCounter() - startTime));
+        line += (result == numRounds * expectedSize ? " " : "*");
+    }
+}
+
+int main(int, char** argv)
+{
+    // Environment
+    afl::sys::Environment& env = afl::sys::Environment::getInstance(argv);
+    afl::base::Ref<afl::io::TextWriter> out(env.attachTextWriter(env.Output));
+
+    // Parse command line
+    size_t totalMB = 64;
+    afl::base::Ref<afl::sys::Environment::CommandLine_t> cmdl(env.getCommandLine());
+    String_t what;
+    while (cmdl->getNextElement(what)) {
+        uint32_t mb;
+        if (what.compare(0, 4, "-mb=", 4) == 0 && afl::string::strToInteger(what.substr(4), mb) && mb > 0) {
+            totalMB = mb;
+        } else {
+            out->writeLine(afl::string::Format("Unknown command line parameter: \"%s\"", what));
+            out->flush();
+            return 1;
+        }
+    }
+
+    if (!afl::io::DeflateTransform::isAvailable()) {
+        out->writeLine("Compression is not available (zlib missing).");
+        out->flush();
+        return 1;
+    }
+
+    // Test data: pseudo-random
+    // - text: words from a small vocabulary
+    // - binary: random bytes with a skewed distribution
+    static const char*const WORDS[] = { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "and ", "runs\n" };
+    afl::base::GrowableBytes_t textData, binaryData;
+    uint32_t seed = 1;
+    while (textData.size() < 4*1048576) {
+        seed = seed * 1103515245 + 12345;
+        textData.append(afl::string::toBytes(WORDS[(seed >> 16) % 10]));
+    }
+    for (size_t i = 0; i < 4*1048576; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const uint8_t rnd = uint8_t(seed >> 16);
+        binaryData.append(uint8_t(rnd & (rnd >> 1)));
+    }
+
+    afl::base::GrowableBytes_t textCompressed, binaryCompressed, binaryStored;
+    compress(textCompressed, textData);
+    compress(binaryCompressed, binaryData);
+    store(binaryStored, binaryData);
+
+    // Header
+    out->writeLine("MB/s           Built-in   Transform");
+
+    // Benchmarks
+    const size_t totalSize = totalMB * 1048576;
+    {
+        String_t line = "Text        ";
+        benchmark(line, textCompressed, textData.size(), totalSize);
+        out->writeLine(line);
+        out->flush();
+    }
+    {
+        String_t line = "Binary      ";
+        benchmark(line, binaryCompressed, binaryData.size(), totalSize);
+        out->writeLine(line);
+        out->flush();
+    }
+    {
+        String_t line = "Stored      ";
+        benchmark(line, binaryStored, binaryData.size(), totalSize);
+        out->writeLine(line);
+        out->flush();
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+  *  \file arch/adler32accel.hpp
+  *  \brief System-dependant Part of afl/checksums/adler32.cpp
+  *
+  *  Provides vectorized Adler-32 kernels.
+  *  The function processes a sequence of whole 32-byte chunks without modulo reduction and returns true,
+  *  or returns false if acceleration is not available on this CPU, in which case the caller uses its portable code.
+  *  Availability is checked at runtime, so a binary built on one machine still works on another.
+  */
+#ifndef AFL_ARCH_ADLER32ACCEL_HPP
+#define AFL_ARCH_ADLER32ACCEL_HPP
+
+#include "afl/base/types.hpp"
+#include "arch/cpufeatures.hpp"
+
+#ifdef AFL_ARCH_HAVE_X86_FEATURES
+/*
+ *  Implementation using SSSE3 or AVX2.
+ *  Functions using the instructions are compiled with a target attribute,
+ *  so the remaining code does not require the extensions.
+ *
+ *  For a chunk of 32 bytes b[0..31], Adler-32 computes
+ *     s2' = s2 + 32*s1 + sum((32-i)*b[i])
+ *     s1' = s1 + sum(b[i])
+ *  The weighted sum is computed using multiply-add, the plain sum using sum-of-absolute-differences.
+ *  The 32*s1 term is accumulated separately (vps) and added at the end.
+ *  Lanes wrap modulo 2^32, which is harmless because the exact total does not overflow
+ *  as long as the caller observes the same block limit as the portable code.
+ */
+# include <immintrin.h>
+
+namespace {
+    /* Sum the four 32-bit lanes of a vector */
+    __attribute__((target("sse2")))
+    inline uint32_t sumAdler32Lanes(__m128i v)
+    {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return uint32_t(_mm_cvtsi128_si32(v));
+    }
+
+    /* Adler-32 using SSSE3, two 16-byte vectors per chunk */
+    __attribute__((target("ssse3")))
+    inline void addAdler32SSSE3(uint32_t& s1, uint32_t& s2, const uint8_t* data, size_t numChunks)
+    {
+        const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+        const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+
+        __m128i vs1 = zero;
+        __m128i vs2 = zero;
+        __m128i vps = _mm_cvtsi32_si128(int(s1 * numChunks));
+
+        const __m128i* p = reinterpret_cast<const __m128i*>(data);
+        while (numChunks > 0) {
+            const __m128i b1 = _mm_loadu_si128(p);
+            const __m128i b2 = _mm_loadu_si128(p + 1);
+            vps = _mm_add_epi32(vps, vs1);
+            vs1 = _mm_add_epi32(vs1, _mm_add_epi32(_mm_sad_epu8(b1, zero), _mm_sad_epu8(b2, zero)));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(b2, tap2), ones));
+            p += 2;
+            --numChunks;
+        }
+        vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(vps, 5));
+
+        s1 += sumAdler32Lanes(vs1);
+        s2 += sumAdler32Lanes(vs2);
+    }
+
+    /* Adler-32 using AVX2, one 32-byte vector per chunk */
+    __attribute__((target("avx2")))
+    inline void addAdler32AVX2(uint32_t& s1, uint32_t& s2, const uint8_t* data, size_t numChunks)
+    {
+        const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ones = _mm256_set1_epi16(1);
+
+        __m256i vs1 = zero;
+        __m256i vs2 = zero;
+        __m256i vps = _mm256_setr_epi32(int(s1 * numChunks), 0, 0, 0, 0, 0, 0, 0);
+
+        const __m256i* p = reinterpret_cast<const __m256i*>(data);
+        while (numChunks > 0) {
+            const __m256i b = _mm256_loadu_si256(p);
+            vps = _mm256_add_epi32(vps, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(b, zero));
+            vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(b, tap), ones));
+            ++p;
+            --numChunks;
+        }
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vps, 5));
+
+        s1 += sumAdler32Lanes(_mm_add_epi32(_mm256_castsi256_si128(vs1), _mm256_extracti128_si256(vs1, 1)));
+        s2 += sumAdler32Lanes(_mm_add_epi32(_mm256_castsi256_si128(vs2), _mm256_extracti128_si256(vs2, 1)));
+    }
+
+    /* Add chunks to Adler-32 sums, without modulo reduction.
+       \param s1        [in/out] Low sum
+       \param s2        [in/out] High sum
+       \param data      Data
+       \param numChunks Number of 32-byte chunks */
+    inline bool addAdler32Accel(uint32_t& s1, uint32_t& s2, const uint8_t* data, size_t numChunks)
+    {
+        if (hasCpuFeatures(CPU_AVX2)) {
+            addAdler32AVX2(s1, s2, data, numChunks);
+            return true;
+        } else if (hasCpuFeatures(CPU_SSSE3)) {
+            addAdler32SSSE3(s1, s2, data, numChunks);
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+#else
+/*
+ *  No acceleration available
+ */
+namespace {
+    inline bool addAdler32Accel(uint32_t& /*s1*/, uint32_t& /*s2*/, const uint8_t* /*data*/, size_t /*numChunks*/)
+    {
+        return false;
+    }
+}
+#endif
+
+#endif
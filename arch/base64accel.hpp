@@ -0,0 +1,270 @@
+/**
+  *  \file arch/base64accel.hpp
+  *  \brief System-dependant Part of afl/charset/base64.cpp
+  *
+  *  Provides vectorized kernels for Base64 encoding and decoding.
+  *  Each function processes a prefix of the given groups and reports how many it did,
+  *  or returns false if acceleration is not available on this CPU, in which case the caller uses its portable code.
+  *  Availability is checked at runtime, so a binary built on one machine still works on another.
+  */
+#ifndef AFL_ARCH_BASE64ACCEL_HPP
+#define AFL_ARCH_BASE64ACCEL_HPP
+
+#include "afl/base/types.hpp"
+#include "arch/cpufeatures.hpp"
+
+#ifdef AFL_ARCH_HAVE_X86_FEATURES
+/*
+ *  Implementation using SSSE3 or AVX2 (gcc 5 and later, clang).
+ *  Functions using the instructions are compiled with a target attribute,
+ *  so the remaining code does not require the extensions.
+ *
+ *  Algorithms follow Wojciech Mula, Daniel Lemire: "Faster Base64 Encoding and Decoding Using AVX2 Instructions" (2018).
+ *  Encoding spreads each 3-byte group into four 6-bit indexes using shuffle and multiply,
+ *  and translates them into characters by adding a per-range offset.
+ *  Decoding classifies characters by range, rejecting blocks that contain characters outside the alphabet,
+ *  and packs the 6-bit values using multiply-add.
+ */
+# include <immintrin.h>
+
+namespace {
+    /* Acceleration level */
+    enum Base64AccelLevel {
+        Base64NoAccel,
+        Base64SSSE3,
+        Base64AVX2
+    };
+
+    /* Get acceleration level. AVX2 kernels also use SSSE3 instructions. */
+    inline Base64AccelLevel haveBase64Accel()
+    {
+        return hasCpuFeatures(CPU_AVX2 | CPU_SSSE3) ? Base64AVX2
+            : hasCpuFeatures(CPU_SSSE3) ? Base64SSSE3
+            : Base64NoAccel;
+    }
+
+
+    /*
+     *  SSSE3
+     */
+
+    /* Convert 12 bytes (in positions 0..11 of the shuffle source) into 16 characters */
+    __attribute__((target("ssse3")))
+    inline __m128i encodeBase64BlockSSSE3(__m128i in)
+    {
+        // Spread each group into one 32-bit lane: bytes b1,b0,b2,b1
+        in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        // Move the 6-bit fields into separate bytes
+        const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        const __m128i indexes = _mm_or_si128(t0, t1);
+
+        // Translate: 0..25 -> 'A'.., 26..51 -> 'a'.., 52..61 -> '0'.., 62 -> '+', 63 -> '/'.
+        // Reduce index to a range number (0 for 'a', 1..10 for digits, 11 '+', 12 '/', 13 'A'), and look up the offset.
+        const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        __m128i range = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+        return _mm_add_epi8(indexes, _mm_shuffle_epi8(offsets, range));
+    }
+
+    /* Convert 16 characters into 6-bit values. Returns false if a character is not in the alphabet. */
+    __attribute__((target("ssse3")))
+    inline bool decodeBase64ValuesSSSE3(__m128i in, __m128i& values)
+    {
+        // Signed compares; bytes 0x80 and above are negative and fail all ranges.
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1)));
+        const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1)));
+        const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+        const __m128i plus  = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+        const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        const __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus)), slash);
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            return false;
+        }
+
+        const __m128i offset = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                                                         _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                                            _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                                                                      _mm_and_si128(plus, _mm_set1_epi8(62 - '+'))),
+                                                         _mm_and_si128(slash, _mm_set1_epi8(63 - '/'))));
+        values = _mm_add_epi8(in, offset);
+        return true;
+    }
+
+    /* Pack 16 6-bit values into 12 bytes (positions 0..11 of each 16-byte lane) */
+    __attribute__((target("ssse3")))
+    inline __m128i packBase64ValuesSSSE3(__m128i values)
+    {
+        const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    }
+
+    __attribute__((target("ssse3")))
+    inline size_t encodeBase64SSSE3(const uint8_t* in, size_t numGroups, uint8_t* out)
+    {
+        // Each step reads 16 bytes (uses 12) and writes 16
+        size_t i = 0;
+        while (numGroups - i >= 6) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3*i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4*i), encodeBase64BlockSSSE3(data));
+            i += 4;
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3")))
+    inline size_t decodeBase64SSSE3(const uint8_t* in, size_t numGroups, uint8_t* out)
+    {
+        // Each step reads 16 characters and writes 16 bytes (12 valid)
+        size_t i = 0;
+        while (numGroups - i >= 6) {
+            __m128i values;
+            if (!decodeBase64ValuesSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4*i)), values)) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3*i), packBase64ValuesSSSE3(values));
+            i += 4;
+        }
+        return i;
+    }
+
+
+    /*
+     *  AVX2
+     */
+
+    __attribute__((target("avx2")))
+    inline __m256i encodeBase64BlockAVX2(__m256i in)
+    {
+        in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                     10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+        const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+        const __m256i indexes = _mm256_or_si256(t0, t1);
+
+        const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                                 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        __m256i range = _mm256_subs_epu8(indexes, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indexes), _mm256_set1_epi8(13)));
+        return _mm256_add_epi8(indexes, _mm256_shuffle_epi8(offsets, range));
+    }
+
+    __attribute__((target("avx2")))
+    inline bool decodeBase64ValuesAVX2(__m256i in, __m256i& values)
+    {
+        const __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+        const __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+        const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+        const __m256i plus  = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+        const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+        const __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, plus)), slash);
+        if (_mm256_movemask_epi8(valid) != -1) {
+            return false;
+        }
+
+        const __m256i offset = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+                                                               _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+                                               _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+                                                                               _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+'))),
+                                                               _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/'))));
+        values = _mm256_add_epi8(in, offset);
+        return true;
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i packBase64ValuesAVX2(__m256i values)
+    {
+        const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                                            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        // Move the 12 bytes of the upper lane next to those of the lower lane
+        return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t encodeBase64AVX2(const uint8_t* in, size_t numGroups, uint8_t* out)
+    {
+        // Each step reads 28 bytes (uses 24: 12 for each lane) and writes 32
+        size_t i = 0;
+        while (numGroups - i >= 10) {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3*i));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3*i + 12));
+            const __m256i data = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4*i), encodeBase64BlockAVX2(data));
+            i += 8;
+        }
+        return i + encodeBase64SSSE3(in + 3*i, numGroups - i, out + 4*i);
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t decodeBase64AVX2(const uint8_t* in, size_t numGroups, uint8_t* out)
+    {
+        // Each step reads 32 characters and writes 32 bytes (24 valid)
+        size_t i = 0;
+        while (numGroups - i >= 11) {
+            __m256i values;
+            if (!decodeBase64ValuesAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4*i)), values)) {
+                break;
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 3*i), packBase64ValuesAVX2(values));
+            i += 8;
+        }
+        return i + decodeBase64SSSE3(in + 4*i, numGroups - i, out + 3*i);
+    }
+
+
+    /*
+     *  Entry points
+     */
+
+    /* Encode groups of 3 bytes into 4 characters each.
+       in: numGroups*3 bytes; out: space for numGroups*4 characters.
+       done: set to number of groups converted (from the beginning). */
+    inline bool encodeBase64Accel(const uint8_t* in, size_t numGroups, uint8_t* out, size_t& done)
+    {
+        switch (haveBase64Accel()) {
+         case Base64AVX2:  done = encodeBase64AVX2(in, numGroups, out);  return true;
+         case Base64SSSE3: done = encodeBase64SSSE3(in, numGroups, out); return true;
+         default:          return false;
+        }
+    }
+
+    /* Decode groups of 4 characters into 3 bytes each.
+       in: numGroups*4 characters; out: space for numGroups*3 bytes.
+       done: set to number of groups converted (from the beginning).
+       Conversion stops early at a block containing characters outside the alphabet (including padding). */
+    inline bool decodeBase64Accel(const uint8_t* in, size_t numGroups, uint8_t* out, size_t& done)
+    {
+        switch (haveBase64Accel()) {
+         case Base64AVX2:  done = decodeBase64AVX2(in, numGroups, out);  return true;
+         case Base64SSSE3: done = decodeBase64SSSE3(in, numGroups, out); return true;
+         default:          return false;
+        }
+    }
+}
+
+#else
+/*
+ *  No acceleration available
+ */
+namespace {
+    inline bool encodeBase64Accel(const uint8_t* /*in*/, size_t /*numGroups*/, uint8_t* /*out*/, size_t& /*done*/)
+    {
+        return false;
+    }
+
+    inline bool decodeBase64Accel(const uint8_t* /*in*/, size_t /*numGroups*/, uint8_t* /*out*/, size_t& /*done*/)
+    {
+        return false;
+    }
+}
+#endif
+
+#endif
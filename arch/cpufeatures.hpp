@@ -0,0 +1,91 @@
+/**
+  *  \file arch/cpufeatures.hpp
+  *  \brief System-dependant CPU feature detection
+  *
+  *  Used by the accelerated kernels in arch/ to decide at runtime which instruction set extensions they can use,
+  *  so a binary built on one machine still works on another.
+  *
+  *  If AFL_ARCH_HAVE_X86_FEATURES is defined, getCpuFeatures() returns a combination of the CPU_xxx bits;
+  *  kernels using these instructions are compiled with a target attribute.
+  *  Otherwise, no detection is available, and kernels must not be compiled.
+  */
+#ifndef AFL_ARCH_CPUFEATURES_HPP
+#define AFL_ARCH_CPUFEATURES_HPP
+
+#include "afl/base/types.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5 || defined(__clang__))
+/*
+ *  x86 (gcc 5 and later, clang).
+ */
+# define AFL_ARCH_HAVE_X86_FEATURES 1
+# include <cpuid.h>
+
+namespace {
+    /* x86 instruction set extensions */
+    const uint32_t CPU_SSE2   = 1;
+    const uint32_t CPU_PCLMUL = 2;
+    const uint32_t CPU_SSSE3  = 4;
+    const uint32_t CPU_AVX2   = 8;              // includes operating system support for AVX registers
+    const uint32_t CPU_SSE41  = 16;
+    const uint32_t CPU_SHA    = 32;
+
+    /* Detect CPU features */
+    inline uint32_t detectCpuFeatures()
+    {
+        uint32_t result = 0;
+        unsigned int a, b, c, d;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) {
+            return result;
+        }
+        if ((d & (1U << 26)) != 0) {
+            result |= CPU_SSE2;
+        }
+        if ((c & (1U << 1)) != 0) {
+            result |= CPU_PCLMUL;
+        }
+        if ((c & (1U << 9)) != 0) {
+            result |= CPU_SSSE3;
+        }
+        if ((c & (1U << 19)) != 0) {
+            result |= CPU_SSE41;
+        }
+
+        // AVX registers need OSXSAVE (bit 27), AVX (bit 28), and the OS saving YMM state
+        bool haveAVX = false;
+        if ((c & (1U << 27)) != 0 && (c & (1U << 28)) != 0) {
+            unsigned int xcr0, xcr0High;
+            __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+            haveAVX = (xcr0 & 6) == 6;
+        }
+
+        if (__get_cpuid_max(0, 0) >= 7) {
+            __cpuid_count(7, 0, a, b, c, d);
+            if (haveAVX && (b & (1U << 5)) != 0) {
+                result |= CPU_AVX2;
+            }
+            if ((b & (1U << 29)) != 0) {
+                result |= CPU_SHA;
+            }
+        }
+        return result;
+    }
+
+    /* Get CPU features, detected once. */
+    inline uint32_t getCpuFeatures()
+    {
+        static const uint32_t result = detectCpuFeatures();
+        return result;
+    }
+
+    /* Check for a set of CPU features.
+       \param features CPU_xxx bits
+       \return true if all given features are available */
+    inline bool hasCpuFeatures(uint32_t features)
+    {
+        return (getCpuFeatures() & features) == features;
+    }
+}
+#endif
+
+#endif
@@ -3,9 +3,9 @@
   *  \brief Class arch::posix::PosixFileMapping
   */
 
-#include <algorithm>
 #if TARGET_OS_POSIX
 #define _FILE_OFFSET_BITS 64
+#include <algorithm>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -29,13 +29,33 @@ namespace {
         }
         return result;
     }
+
+    /* Convert access pattern hint into madvise() parameter.
+       Returns -1 if the hint is not supported on this system. */
+    int getAdvice(afl::io::FileMapping::Advice advice)
+    {
+        switch (advice) {
+         case afl::io::FileMapping::NormalAccess:     return MADV_NORMAL;
+         case afl::io::FileMapping::SequentialAccess: return MADV_SEQUENTIAL;
+         case afl::io::FileMapping::RandomAccess:     return MADV_RANDOM;
+         case afl::io::FileMapping::WillNeed:         return MADV_WILLNEED;
+         case afl::io::FileMapping::DontNeed:         return MADV_DONTNEED;
+#ifdef MADV_HUGEPAGE
+         case afl::io::FileMapping::HugePages:        return MADV_HUGEPAGE;
+#else
+         case afl::io::FileMapping::HugePages:        return -1;
+#endif
+        }
+        return -1;
+    }
 }
 
 // Constructor.
-arch::posix::PosixFileMapping::PosixFileMapping(void* address, size_t bytesBefore, size_t bytesMapped)
+arch::posix::PosixFileMapping::PosixFileMapping(void* address, size_t bytesBefore, size_t bytesMapped, bool writable)
     : m_address(address),
       m_bytesBefore(bytesBefore),
-      m_bytesMapped(bytesMapped)
+      m_bytesMapped(bytesMapped),
+      m_writable(writable)
 { }
 
 // Destructor.
@@ -51,9 +71,45 @@ arch::posix::PosixFileMapping::get() const
     return afl::base::ConstBytes_t::unsafeCreate(static_cast<uint8_t*>(m_address), m_bytesMapped).subrange(m_bytesBefore);
 }
 
+// Get writable content of file mapping.
+afl::base::Bytes_t
+arch::posix::PosixFileMapping::getWritable()
+{
+    if (m_writable) {
+        return afl::base::Bytes_t::unsafeCreate(static_cast<uint8_t*>(m_address), m_bytesMapped).subrange(m_bytesBefore);
+    } else {
+        return afl::base::Nothing;
+    }
+}
+
+// Give access pattern hint.
+void
+arch::posix::PosixFileMapping::advise(Advice advice)
+{
+    // This is only a hint; ignore errors (e.g. huge pages not supported for this file system).
+    int value = getAdvice(advice);
+    if (value >= 0) {
+        ::madvise(m_address, m_bytesMapped, value);
+    }
+}
+
 // Create file mapping.
 afl::base::Ptr<afl::io::FileMapping>
 arch::posix::PosixFileMapping::createFileMapping(int fd, afl::io::Stream::FileSize_t limit)
+{
+    return createMapping(fd, limit, PROT_READ, MAP_SHARED);
+}
+
+// Create writable file mapping.
+afl::base::Ptr<afl::io::FileMapping>
+arch::posix::PosixFileMapping::createWritableFileMapping(int fd, afl::io::Stream::FileSize_t limit, bool shared)
+{
+    return createMapping(fd, limit, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE);
+}
+
+// Create mapping with given mmap() parameters.
+afl::base::Ptr<afl::io::FileMapping>
+arch::posix::PosixFileMapping::createMapping(int fd, afl::io::Stream::FileSize_t limit, int prot, int flags)
 {
     // Must behave like a real file
     off_t pos = ::lseek(fd, 0, SEEK_CUR);
@@ -88,7 +144,7 @@ arch::posix::PosixFileMapping::createFileMapping(int fd, afl::io::Stream::FileSi
     sizeToMap += bytesBefore;
 
     // OK, try to map
-    void* address = ::mmap(0, sizeToMap, PROT_READ, MAP_SHARED, fd, pos);
+    void* address = ::mmap(0, sizeToMap, prot, flags, fd, pos);
     if (address == MAP_FAILED) {
         return 0;
     }
@@ -97,7 +153,7 @@ arch::posix::PosixFileMapping::createFileMapping(int fd, afl::io::Stream::FileSi
     // Success! Build a handle for it. Be careful that constructing the handle might fail.
     afl::base::Ptr<afl::io::FileMapping> result;
     try {
-        result = new PosixFileMapping(address, bytesBefore, sizeToMap);
+        result = new PosixFileMapping(address, bytesBefore, sizeToMap, (prot & PROT_WRITE) != 0);
     }
     catch (...) {
         ::munmap(address, sizeToMap);
@@ -19,20 +19,29 @@ namespace arch { namespace posix {
             Receives the result of the mmap() operation.
             \param address Mapped address
             \param bytesBefore Mapped bytes before user-requested data (in case of misaligned request)
-            \param bytesMapped Total number of bytes mapped (including bytesBefore) */
-        PosixFileMapping(void* address, size_t bytesBefore, size_t bytesMapped);
+            \param bytesMapped Total number of bytes mapped (including bytesBefore)
+            \param writable true if mapping was created writable */
+        PosixFileMapping(void* address, size_t bytesBefore, size_t bytesMapped, bool writable);
 
         virtual ~PosixFileMapping();
 
         virtual afl::base::ConstBytes_t get() const;
+        virtual afl::base::Bytes_t getWritable();
+        virtual void advise(Advice advice);
 
         /** Create file mapping. */
         static afl::base::Ptr<afl::io::FileMapping> createFileMapping(int fd, afl::io::Stream::FileSize_t limit);
 
+        /** Create writable file mapping. */
+        static afl::base::Ptr<afl::io::FileMapping> createWritableFileMapping(int fd, afl::io::Stream::FileSize_t limit, bool shared);
+
      private:
         void* m_address;
         size_t m_bytesBefore;
         size_t m_bytesMapped;
+        bool m_writable;
+
+        static afl::base::Ptr<afl::io::FileMapping> createMapping(int fd, afl::io::Stream::FileSize_t limit, int prot, int flags);
     };
 
 } }
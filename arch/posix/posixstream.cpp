@@ -5,11 +5,21 @@
 
 #if TARGET_OS_POSIX
 #define _FILE_OFFSET_BITS 64
-#define _POSIX_C_SOURCE 200809L
+#ifdef __linux__
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE 1                 /* get splice(), syscall() */
+# endif
+#else
+# define _POSIX_C_SOURCE 200809L
+#endif
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+# include <sys/syscall.h>
+#endif
 #include "arch/posix/posixstream.hpp"
 #include "afl/except/filesystemexception.hpp"
 #include "afl/sys/error.hpp"
@@ -21,6 +31,44 @@
 # define O_LARGEFILE 0
 #endif
 
+#ifdef __linux__
+namespace {
+    /* Maximum size for a single direct copy call.
+       Linux transfers at most 0x7ffff000 bytes per call anyway. */
+    const size_t MAX_DIRECT_COPY = 0x40000000;
+
+    /* Direct copy methods */
+    enum CopyMethod {
+        CopyFileRange,          // copy_file_range(): file to file, may share or copy blocks within the file system
+        Splice,                 // splice(): one side is a pipe
+        SendFile                // sendfile(): source is a file, target anything (e.g. socket)
+    };
+
+    /* Copy one chunk using the given method.
+       All methods use and advance the file positions of both file descriptors.
+       Returns number of bytes copied, 0 at end of file, -1 on error. */
+    ssize_t copyDirect(CopyMethod method, int out, int in, size_t size)
+    {
+        switch (method) {
+         case CopyFileRange:
+# ifdef __NR_copy_file_range
+            // Use the system call directly; the library function is only available in glibc 2.27 and later.
+            return ssize_t(::syscall(__NR_copy_file_range, in, static_cast<loff_t*>(0), out, static_cast<loff_t*>(0), size, 0U));
+# else
+            errno = ENOSYS;
+            return -1;
+# endif
+         case Splice:
+            return ::splice(in, 0, out, 0, size, SPLICE_F_MOVE);
+         case SendFile:
+            return ::sendfile(out, in, 0, size);
+        }
+        errno = EINVAL;
+        return -1;
+    }
+}
+#endif
+
 namespace {
     int dupWrap(int fd)
     {
@@ -66,6 +114,8 @@ arch::posix::PosixStream::PosixStream(afl::io::FileSystem::FileName_t name, int
 
 arch::posix::PosixStream::~PosixStream()
 {
+    // Children may be reading concurrently (hasConcurrentReadAt())
+    detachChildren();
     if (m_fd >= 0) {
         ::close(m_fd);
     }
@@ -138,6 +188,80 @@ arch::posix::PosixStream::createFileMapping(FileSize_t limit)
     return PosixFileMapping::createFileMapping(m_fd, limit);
 }
 
+afl::base::Ptr<afl::io::FileMapping>
+arch::posix::PosixStream::createWritableFileMapping(FileSize_t limit, bool shared)
+{
+    return PosixFileMapping::createWritableFileMapping(m_fd, limit, shared);
+}
+
+arch::posix::PosixStream::FileSize_t
+arch::posix::PosixStream::copyFromDirect(afl::io::Stream& other, FileSize_t size)
+{
+#ifdef __linux__
+    // Copy between two file descriptors within the kernel.
+    // - file to file: copy_file_range(). Falls back to sendfile() if the kernel or file system does not support it.
+    // - pipe involved: splice().
+    // - otherwise: sendfile(). Source must be a real file; since 2.6.33, target can be any file descriptor (file, socket).
+    // The file positions are advanced, as if read()/write() had been used.
+    // If anything fails, just stop; copyFrom() will continue with regular read()/write()
+    // and report the error if there is a real problem.
+    PosixStream* src = dynamic_cast<PosixStream*>(&other);
+    if (src == 0) {
+        return 0;
+    }
+
+    struct stat inStat, outStat;
+    if (::fstat(src->m_fd, &inStat) != 0 || ::fstat(m_fd, &outStat) != 0) {
+        return 0;
+    }
+    CopyMethod method;
+    if (S_ISREG(inStat.st_mode) && S_ISREG(outStat.st_mode)) {
+        method = CopyFileRange;
+    } else if (S_ISFIFO(inStat.st_mode) || S_ISFIFO(outStat.st_mode)) {
+        method = Splice;
+    } else {
+        method = SendFile;
+    }
+
+    FileSize_t total = 0;
+    while (total < size) {
+        size_t chunk = (size - total < MAX_DIRECT_COPY ? size_t(size - total) : MAX_DIRECT_COPY);
+        ssize_t n = copyDirect(method, m_fd, src->m_fd, chunk);
+        if (n < 0 && total == 0 && method != SendFile && S_ISREG(inStat.st_mode)) {
+            // Method not supported for these files (e.g. old kernel, different file systems, O_APPEND target)
+            method = SendFile;
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += FileSize_t(n);
+    }
+    return total;
+#else
+    (void) other;
+    (void) size;
+    return 0;
+#endif
+}
+
+size_t
+arch::posix::PosixStream::readAt(FileSize_t pos, Bytes_t m)
+{
+    ssize_t n = ::pread(m_fd, m.unsafeData(), m.size(), off_t(pos));
+    if (n < 0) {
+        error();
+    }
+    return size_t(n);
+}
+
+bool
+arch::posix::PosixStream::hasConcurrentReadAt()
+{
+    // pread() does not work on pipes
+    return (m_capabilities & CanSeek) != 0;
+}
+
 void
 arch::posix::PosixStream::init(afl::io::FileSystem::FileName_t name, afl::io::FileSystem::OpenMode mode)
 {
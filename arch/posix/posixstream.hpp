@@ -27,9 +27,15 @@ namespace arch { namespace posix {
         virtual uint32_t getCapabilities();
         virtual String_t getName();
         virtual afl::base::Ptr<afl::io::FileMapping> createFileMapping(FileSize_t limit);
+        virtual FileSize_t copyFromDirect(afl::io::Stream& other, FileSize_t size);
+        virtual afl::base::Ptr<afl::io::FileMapping> createWritableFileMapping(FileSize_t limit, bool shared);
+        virtual size_t readAt(FileSize_t pos, Bytes_t m);
 
         int getFileDescriptor() const;
 
+     protected:
+        virtual bool hasConcurrentReadAt();
+
      private:
         int m_fd;
         String_t m_name;
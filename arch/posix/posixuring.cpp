@@ -0,0 +1,291 @@
+/**
+  *  \file arch/posix/posixuring.cpp
+  *  \brief Class arch::posix::PosixUring
+  *
+  *  The rings are shared with the kernel:
+  *  - submission queue: we write entries and advance the tail, the kernel consumes them in io_uring_enter()
+  *  - completion queue: the kernel writes entries and advances the tail, we consume them and advance the head
+  *  Tails and heads written by the other side are read with acquire semantics,
+  *  our own ones are written with release semantics.
+  */
+
+#if TARGET_OS_POSIX
+#ifdef __linux__
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE 1                 /* get syscall() */
+# endif
+#endif
+#include <cstring>
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "arch/posix/posixuring.hpp"
+#include "arch/posix/posixstream.hpp"
+
+#if defined(__linux__) && defined(__GNUC__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <sys/syscall.h>
+#  include <linux/io_uring.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#   define AFL_HAVE_IO_URING 1
+#  endif
+# endif
+#endif
+
+#ifdef AFL_HAVE_IO_URING
+namespace {
+    /* Maximum size of a single transfer. Linux transfers at most 0x7ffff000 bytes per call anyway. */
+    const size_t MAX_TRANSFER = 0x40000000;
+
+    /* Access a 32-bit field in a ring */
+    uint32_t* getRingField(void* ring, uint32_t offset)
+    {
+        return reinterpret_cast<uint32_t*>(static_cast<char*>(ring) + offset);
+    }
+
+    /* Map a ring */
+    void* mapRing(int fd, size_t size, off_t offset)
+    {
+        void* result = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return result == MAP_FAILED ? 0 : result;
+    }
+
+    int enterRing(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+    {
+        return int(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, static_cast<void*>(0), 0));
+    }
+}
+#endif
+
+arch::posix::PosixUring::PosixUring()
+    : m_fd(-1),
+      m_sqRing(0), m_sqRingSize(0), m_sqes(0), m_sqesSize(0),
+      m_sqHead(0), m_sqTail(0), m_sqArray(0), m_sqMask(0), m_sqEntries(0),
+      m_cqRing(0), m_cqRingSize(0), m_cqHead(0), m_cqTail(0), m_cqes(0), m_cqMask(0)
+{ }
+
+arch::posix::PosixUring::~PosixUring()
+{
+    close();
+}
+
+bool
+arch::posix::PosixUring::init(uint32_t numEntries)
+{
+#ifdef AFL_HAVE_IO_URING
+    close();
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    m_fd = int(::syscall(__NR_io_uring_setup, numEntries, &params));
+    if (m_fd < 0) {
+        // Not supported by kernel, or forbidden by seccomp
+        m_fd = -1;
+        return false;
+    }
+
+    // Transfers at the current position (offset -1) are supported since Linux 5.6
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+        close();
+        return false;
+    }
+
+    // Map the rings
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqRing = mapRing(m_fd, m_sqRingSize, IORING_OFF_SQ_RING);
+    m_cqRing = mapRing(m_fd, m_cqRingSize, IORING_OFF_CQ_RING);
+    m_sqes = mapRing(m_fd, m_sqesSize, IORING_OFF_SQES);
+    if (m_sqRing == 0 || m_cqRing == 0 || m_sqes == 0) {
+        close();
+        return false;
+    }
+
+    m_sqHead    = getRingField(m_sqRing, params.sq_off.head);
+    m_sqTail    = getRingField(m_sqRing, params.sq_off.tail);
+    m_sqArray   = getRingField(m_sqRing, params.sq_off.array);
+    m_sqMask    = *getRingField(m_sqRing, params.sq_off.ring_mask);
+    m_sqEntries = *getRingField(m_sqRing, params.sq_off.ring_entries);
+
+    m_cqHead    = getRingField(m_cqRing, params.cq_off.head);
+    m_cqTail    = getRingField(m_cqRing, params.cq_off.tail);
+    m_cqes      = static_cast<char*>(m_cqRing) + params.cq_off.cqes;
+    m_cqMask    = *getRingField(m_cqRing, params.cq_off.ring_mask);
+    return true;
+#else
+    (void) numEntries;
+    return false;
+#endif
+}
+
+bool
+arch::posix::PosixUring::submitRead(afl::io::Stream& stream, afl::base::Bytes_t data, uint64_t tag)
+{
+#ifdef AFL_HAVE_IO_URING
+    return submitTransfer(IORING_OP_READ, stream, data.unsafeData(), data.size(), tag);
+#else
+    (void) stream;
+    (void) data;
+    (void) tag;
+    return false;
+#endif
+}
+
+bool
+arch::posix::PosixUring::submitWrite(afl::io::Stream& stream, afl::base::ConstBytes_t data, uint64_t tag)
+{
+#ifdef AFL_HAVE_IO_URING
+    // Kernel does not modify the buffer for IORING_OP_WRITE
+    return submitTransfer(IORING_OP_WRITE, stream, const_cast<uint8_t*>(data.unsafeData()), data.size(), tag);
+#else
+    (void) stream;
+    (void) data;
+    (void) tag;
+    return false;
+#endif
+}
+
+bool
+arch::posix::PosixUring::submitCancel(uint64_t targetTag, uint64_t tag)
+{
+#ifdef AFL_HAVE_IO_URING
+    io_uring_sqe sqe;
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.fd = -1;
+    sqe.addr = targetTag;
+    sqe.user_data = tag;
+    return submit(&sqe);
+#else
+    (void) targetTag;
+    (void) tag;
+    return false;
+#endif
+}
+
+bool
+arch::posix::PosixUring::submitNop(uint64_t tag)
+{
+#ifdef AFL_HAVE_IO_URING
+    io_uring_sqe sqe;
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_NOP;
+    sqe.fd = -1;
+    sqe.user_data = tag;
+    return submit(&sqe);
+#else
+    (void) tag;
+    return false;
+#endif
+}
+
+void
+arch::posix::PosixUring::wait(uint64_t& tag, int32_t& result)
+{
+#ifdef AFL_HAVE_IO_URING
+    while (1) {
+        const uint32_t head = *m_cqHead;
+        if (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = static_cast<const io_uring_cqe*>(m_cqes)[head & m_cqMask];
+            tag = cqe.user_data;
+            result = cqe.res;
+            __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+            return;
+        }
+        enterRing(m_fd, 0, 1, IORING_ENTER_GETEVENTS);
+    }
+#else
+    tag = 0;
+    result = -1;
+#endif
+}
+
+/** Submit a read or write. */
+bool
+arch::posix::PosixUring::submitTransfer(int opcode, afl::io::Stream& stream, uint8_t* data, size_t size, uint64_t tag)
+{
+#ifdef AFL_HAVE_IO_URING
+    PosixStream* ps = dynamic_cast<PosixStream*>(&stream);
+    if (ps == 0) {
+        return false;
+    }
+
+    io_uring_sqe sqe;
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = uint8_t(opcode);
+    sqe.fd = ps->getFileDescriptor();
+    sqe.off = uint64_t(-1);
+    sqe.addr = uint64_t(reinterpret_cast<uintptr_t>(data));
+    sqe.len = uint32_t(size > MAX_TRANSFER ? MAX_TRANSFER : size);
+    sqe.user_data = tag;
+    return submit(&sqe);
+#else
+    (void) opcode;
+    (void) stream;
+    (void) data;
+    (void) size;
+    (void) tag;
+    return false;
+#endif
+}
+
+/** Submit an entry.
+    Places the entry in the submission queue and hands it to the kernel.
+    If the kernel does not take it, it is removed again, so that it is not submitted later by accident. */
+bool
+arch::posix::PosixUring::submit(const void* sqe)
+{
+#ifdef AFL_HAVE_IO_URING
+    if (m_fd < 0) {
+        return false;
+    }
+
+    const uint32_t tail = *m_sqTail;
+    if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+        return false;
+    }
+    const uint32_t index = tail & m_sqMask;
+    std::memcpy(static_cast<io_uring_sqe*>(m_sqes) + index, sqe, sizeof(io_uring_sqe));
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int n;
+    do {
+        n = enterRing(m_fd, 1, 0, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != 1) {
+        __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+#else
+    (void) sqe;
+    return false;
+#endif
+}
+
+/** Unmap the rings and close the file descriptor. */
+void
+arch::posix::PosixUring::close()
+{
+    if (m_sqes != 0) {
+        ::munmap(m_sqes, m_sqesSize);
+        m_sqes = 0;
+    }
+    if (m_cqRing != 0) {
+        ::munmap(m_cqRing, m_cqRingSize);
+        m_cqRing = 0;
+    }
+    if (m_sqRing != 0) {
+        ::munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = 0;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+#else
+int g_variableToMakePosixUringObjectFileNotEmpty;
+#endif
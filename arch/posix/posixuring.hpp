@@ -0,0 +1,99 @@
+/**
+  *  \file arch/posix/posixuring.hpp
+  *  \brief Class arch::posix::PosixUring
+  */
+#ifndef AFL_ARCH_POSIX_POSIXURING_HPP
+#define AFL_ARCH_POSIX_POSIXURING_HPP
+
+#include "afl/base/memory.hpp"
+#include "afl/base/types.hpp"
+#include "afl/base/uncopyable.hpp"
+#include "afl/io/stream.hpp"
+
+namespace arch { namespace posix {
+
+    /** Asynchronous I/O using Linux io_uring.
+        Minimal binding using the io_uring_setup and io_uring_enter system calls directly, without liburing.
+        Transfers use the file's current position, like read() and write().
+
+        Each submission carries a tag that is reported with its completion.
+        Submissions must be serialized by the caller, and completions must be consumed by a single thread;
+        these two can be different threads.
+        The caller must not have more submissions outstanding than the number of entries given to init().
+
+        On other systems, or if the kernel does not support io_uring, init() fails. */
+    class PosixUring : private afl::base::Uncopyable {
+     public:
+        /** Constructor. */
+        PosixUring();
+
+        /** Destructor. */
+        ~PosixUring();
+
+        /** Set up the ring.
+            \param numEntries Number of entries
+            \return true on success, false if io_uring is not available */
+        bool init(uint32_t numEntries);
+
+        /** Submit a read.
+            \param stream Stream; must be a PosixStream
+            \param data   Buffer. Must remain valid until completion.
+            \param tag    Tag
+            \return true if submitted, false if stream is not supported or submission failed */
+        bool submitRead(afl::io::Stream& stream, afl::base::Bytes_t data, uint64_t tag);
+
+        /** Submit a write.
+            \param stream Stream; must be a PosixStream
+            \param data   Data. Must remain valid until completion.
+            \param tag    Tag
+            \return true if submitted, false if stream is not supported or submission failed */
+        bool submitWrite(afl::io::Stream& stream, afl::base::ConstBytes_t data, uint64_t tag);
+
+        /** Submit cancellation of a pending submission.
+            The cancellation produces a completion of its own.
+            \param targetTag Tag of submission to cancel
+            \param tag       Tag
+            \return true if submitted */
+        bool submitCancel(uint64_t targetTag, uint64_t tag);
+
+        /** Submit a no-op.
+            Can be used to wake the thread waiting for completions.
+            \param tag Tag
+            \return true if submitted */
+        bool submitNop(uint64_t tag);
+
+        /** Wait for a completion.
+            \param tag    [out] Tag of completed submission
+            \param result [out] Result: number of bytes transferred, or negative error code */
+        void wait(uint64_t& tag, int32_t& result);
+
+     private:
+        int m_fd;
+
+        // Submission queue
+        void* m_sqRing;
+        size_t m_sqRingSize;
+        void* m_sqes;
+        size_t m_sqesSize;
+        uint32_t* m_sqHead;
+        uint32_t* m_sqTail;
+        uint32_t* m_sqArray;
+        uint32_t m_sqMask;
+        uint32_t m_sqEntries;
+
+        // Completion queue
+        void* m_cqRing;
+        size_t m_cqRingSize;
+        uint32_t* m_cqHead;
+        uint32_t* m_cqTail;
+        void* m_cqes;
+        uint32_t m_cqMask;
+
+        bool submitTransfer(int opcode, afl::io::Stream& stream, uint8_t* data, size_t size, uint64_t tag);
+        bool submit(const void* sqe);
+        void close();
+    };
+
+} }
+
+#endif
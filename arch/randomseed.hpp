@@ -0,0 +1,68 @@
+/**
+  *  \file arch/randomseed.hpp
+  *  \brief System-dependant part of afl/data/namequery.cpp
+  *
+  *  Provides a function getRandomSeed() that returns an unpredictable 64-bit value.
+  *  This is not intended for cryptographic use; it only needs to be different between program runs
+  *  and not guessable from outside.
+  */
+#ifndef AFL_ARCH_RANDOMSEED_HPP
+#define AFL_ARCH_RANDOMSEED_HPP
+
+#include "afl/base/types.hpp"
+
+#if TARGET_OS_POSIX
+/*
+ *  POSIX: use /dev/urandom if available, mix in process Id and time.
+ */
+# include <fcntl.h>
+# include <unistd.h>
+# include <time.h>
+
+namespace {
+    inline uint64_t getRandomSeed()
+    {
+        uint64_t result = 0;
+        int fd = ::open("/dev/urandom", O_RDONLY);
+        if (fd >= 0) {
+            uint8_t buffer[8];
+            if (::read(fd, buffer, sizeof(buffer)) == ssize_t(sizeof(buffer))) {
+                for (size_t i = 0; i < sizeof(buffer); ++i) {
+                    result = (result << 8) | buffer[i];
+                }
+            }
+            ::close(fd);
+        }
+
+        result ^= uint64_t(::time(0)) * 1000000007U;
+        result ^= uint64_t(::getpid()) << 40;
+        return result;
+    }
+}
+#elif TARGET_OS_WIN32
+/*
+ *  Win32: mix performance counter, process Id and time.
+ */
+# include <windows.h>
+
+namespace {
+    inline uint64_t getRandomSeed()
+    {
+        LARGE_INTEGER counter;
+        uint64_t result = 0;
+        if (QueryPerformanceCounter(&counter)) {
+            result = uint64_t(counter.QuadPart);
+        }
+
+        FILETIME ft;
+        GetSystemTimeAsFileTime(&ft);
+        result ^= (uint64_t(ft.dwHighDateTime) << 32) + ft.dwLowDateTime;
+        result ^= uint64_t(GetCurrentProcessId()) << 40;
+        return result;
+    }
+}
+#else
+# error Teach me about your random numbers
+#endif
+
+#endif
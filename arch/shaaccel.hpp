@@ -0,0 +1,436 @@
+/**
+  *  \file arch/shaaccel.hpp
+  *  \brief System-dependant Part of afl/checksums/sha1.cpp and afl/checksums/sha2core.cpp
+  *
+  *  Provides hardware-accelerated SHA-1, SHA-256 and SHA-512 compression functions,
+  *  and a SHA-256 compression function processing up to MAX_SHA256_LANES independent messages at once.
+  *  Each function processes a sequence of whole blocks and returns true,
+  *  or returns false if acceleration is not available on this CPU, in which case the caller uses its portable code.
+  *  Availability is checked at runtime, so a binary built on one machine still works on another.
+  */
+#ifndef AFL_ARCH_SHAACCEL_HPP
+#define AFL_ARCH_SHAACCEL_HPP
+
+#include <algorithm>
+#include "afl/base/types.hpp"
+#include "afl/bits/rotate.hpp"
+#include "arch/cpufeatures.hpp"
+
+namespace {
+    /* Maximum number of messages processed at once by processSHA256BlocksMulti() */
+    const size_t MAX_SHA256_LANES = 8;
+}
+
+#ifdef AFL_ARCH_HAVE_X86_FEATURES
+/*
+ *  Implementation using x86 SHA extensions and AVX2 (gcc 5 and later, clang).
+ *  Functions using the instructions are compiled with a target attribute,
+ *  so the remaining code does not require the extensions.
+ *
+ *  SHA-512 has no dedicated instructions.
+ *  Its message schedule does not depend on the hash state, so we compute the schedules of four blocks at once
+ *  using AVX2 (one block per 64-bit lane), and run the rounds with regular instructions.
+ *
+ *  Multi-buffer SHA-256 runs eight independent messages in the eight 32-bit lanes of AVX2 registers.
+ *  This is used if the SHA extensions are not available; otherwise, these are faster.
+ */
+# include <immintrin.h>
+
+namespace {
+    /* Check for SHA extensions (and SSSE3, SSE4.1 which we also use). */
+    inline bool haveSHAExtensions()
+    {
+        return hasCpuFeatures(CPU_SHA | CPU_SSSE3 | CPU_SSE41);
+    }
+
+    /* SHA-1 using SHA extensions */
+    __attribute__((target("sha,sse4.1")))
+    inline void processSHA1BlocksNative(uint32_t (&state)[5], const uint8_t* data, size_t numBlocks)
+    {
+        const __m128i MASK = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+        // Register layout: ABCD holds A in the top lane, E0 holds E in the top lane
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0x1B);
+        __m128i e0 = _mm_set_epi32(int(state[4]), 0, 0, 0);
+
+        while (numBlocks > 0) {
+            const __m128i abcdSave = abcd;
+            const __m128i e0Save = e0;
+            __m128i w[4];
+            __m128i prev = abcd;
+
+            // 20 groups of 4 rounds. W[i] = msg2(msg1(W[i-4], W[i-3]) ^ W[i-2], W[i-1]).
+            for (int i = 0; i < 20; ++i) {
+                __m128i m;
+                if (i < 4) {
+                    m = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16*i)), MASK);
+                } else {
+                    m = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w[i&3], w[(i+1)&3]), w[(i+2)&3]), w[(i+3)&3]);
+                }
+                w[i&3] = m;
+
+                const __m128i e = (i == 0 ? _mm_add_epi32(e0, m) : _mm_sha1nexte_epu32(prev, m));
+                prev = abcd;
+                switch (i / 5) {
+                 case 0:  abcd = _mm_sha1rnds4_epu32(abcd, e, 0); break;
+                 case 1:  abcd = _mm_sha1rnds4_epu32(abcd, e, 1); break;
+                 case 2:  abcd = _mm_sha1rnds4_epu32(abcd, e, 2); break;
+                 default: abcd = _mm_sha1rnds4_epu32(abcd, e, 3); break;
+                }
+            }
+
+            e0 = _mm_sha1nexte_epu32(prev, e0Save);
+            abcd = _mm_add_epi32(abcd, abcdSave);
+            data += 64;
+            --numBlocks;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_shuffle_epi32(abcd, 0x1B));
+        state[4] = uint32_t(_mm_extract_epi32(e0, 3));
+    }
+
+    /* SHA-256 using SHA extensions */
+    __attribute__((target("sha,sse4.1")))
+    inline void processSHA256BlocksNative(uint32_t (&state)[8], const uint8_t* data, size_t numBlocks, const uint32_t* ks)
+    {
+        const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+        // Register layout: state0 = ABEF, state1 = CDGH
+        const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        const __m128i hgfe = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(dcba, hgfe, 8);
+        __m128i state1 = _mm_blend_epi16(hgfe, dcba, 0xF0);
+
+        while (numBlocks > 0) {
+            const __m128i save0 = state0;
+            const __m128i save1 = state1;
+            __m128i w[4];
+
+            // 16 groups of 4 rounds. W[i] = msg2(msg1(W[i-4], W[i-3]) + alignr(W[i-1], W[i-2]), W[i-1]).
+            for (int i = 0; i < 16; ++i) {
+                __m128i m;
+                if (i < 4) {
+                    m = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16*i)), MASK);
+                } else {
+                    m = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i&3], w[(i+1)&3]),
+                                                           _mm_alignr_epi8(w[(i+3)&3], w[(i+2)&3], 4)),
+                                             w[(i+3)&3]);
+                }
+                w[i&3] = m;
+
+                __m128i k = _mm_add_epi32(m, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&ks[4*i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+                k = _mm_shuffle_epi32(k, 0x0E);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+            }
+
+            state0 = _mm_add_epi32(state0, save0);
+            state1 = _mm_add_epi32(state1, save1);
+            data += 64;
+            --numBlocks;
+        }
+
+        const __m128i feba = _mm_shuffle_epi32(state0, 0x1B);
+        const __m128i dchg = _mm_shuffle_epi32(state1, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+    }
+
+    inline bool processSHA1Blocks(uint32_t (&state)[5], const uint8_t* data, size_t numBlocks)
+    {
+        if (haveSHAExtensions()) {
+            processSHA1BlocksNative(state, data, numBlocks);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /* Rotate each 64-bit lane right */
+    template<int N>
+    __attribute__((target("avx2")))
+    inline __m256i rotateRight64x4(__m256i x)
+    {
+        return _mm256_or_si256(_mm256_srli_epi64(x, N), _mm256_slli_epi64(x, 64-N));
+    }
+
+    /* SHA-512 message schedules of four blocks using AVX2.
+       \param wk   [out] wk[t][j] = W[t] + K[t] of block j
+       \param data [in] Blocks (128 bytes each)
+       \param ks   [in] Round constants */
+    __attribute__((target("avx2")))
+    inline void computeSHA512SchedulesAVX2(uint64_t (&wk)[80][4], const uint8_t* const (&data)[4], const uint64_t* ks)
+    {
+        const __m256i MASK = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                              7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        __m256i w[16];
+
+        // Load and transpose: each 128-bit load gets two words of one block
+        for (int t = 0; t < 16; t += 2) {
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data[0] + 8*t));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data[1] + 8*t));
+            const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data[2] + 8*t));
+            const __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data[3] + 8*t));
+            const __m256i b02 = _mm256_inserti128_si256(_mm256_castsi128_si256(b0), b2, 1);
+            const __m256i b13 = _mm256_inserti128_si256(_mm256_castsi128_si256(b1), b3, 1);
+            w[t]   = _mm256_shuffle_epi8(_mm256_unpacklo_epi64(b02, b13), MASK);
+            w[t+1] = _mm256_shuffle_epi8(_mm256_unpackhi_epi64(b02, b13), MASK);
+        }
+
+        // W[t] = ssig1(W[t-2]) + W[t-7] + ssig0(W[t-15]) + W[t-16]
+        for (int t = 0; t < 80; ++t) {
+            if (t >= 16) {
+                const __m256i w2  = w[(t-2) & 15];
+                const __m256i w15 = w[(t-15) & 15];
+                const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotateRight64x4<19>(w2), rotateRight64x4<61>(w2)), _mm256_srli_epi64(w2, 6));
+                const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotateRight64x4<1>(w15), rotateRight64x4<8>(w15)), _mm256_srli_epi64(w15, 7));
+                w[t & 15] = _mm256_add_epi64(_mm256_add_epi64(s1, w[(t-7) & 15]), _mm256_add_epi64(s0, w[t & 15]));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&wk[t][0]),
+                                _mm256_add_epi64(w[t & 15], _mm256_set1_epi64x(static_cast<long long>(ks[t]))));
+        }
+    }
+
+    /* SHA-512 rounds of one block, given the precomputed schedule */
+    inline void processSHA512Rounds(uint64_t (&state)[8], const uint64_t (&wk)[80][4], size_t lane)
+    {
+        using afl::bits::rotateRight64;
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t t = 0; t < 80; ++t) {
+            const uint64_t t1 = h + (rotateRight64(e, 14) ^ rotateRight64(e, 18) ^ rotateRight64(e, 41)) + ((e & f) ^ (~e & g)) + wk[t][lane];
+            const uint64_t t2 = (rotateRight64(a, 28) ^ rotateRight64(a, 34) ^ rotateRight64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    /* SHA-512 using AVX2 for the message schedule */
+    inline void processSHA512BlocksAVX2(uint64_t (&state)[8], const uint8_t* data, size_t numBlocks, const uint64_t* ks)
+    {
+        uint64_t wk[80][4];
+        while (numBlocks > 0) {
+            // Process up to 4 blocks; if there are fewer, repeat the last one
+            const size_t now = std::min(numBlocks, size_t(4));
+            const uint8_t* const blocks[4] = {
+                data,
+                data + 128*std::min(size_t(1), now-1),
+                data + 128*std::min(size_t(2), now-1),
+                data + 128*(now-1),
+            };
+            computeSHA512SchedulesAVX2(wk, blocks, ks);
+            for (size_t i = 0; i < now; ++i) {
+                processSHA512Rounds(state, wk, i);
+            }
+            data += 128*now;
+            numBlocks -= now;
+        }
+    }
+
+    /* Rotate each 32-bit lane right */
+    template<int N>
+    __attribute__((target("avx2")))
+    inline __m256i rotateRight32x8(__m256i x)
+    {
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32-N));
+    }
+
+    /* Transpose 8x8 matrix of 32-bit words */
+    __attribute__((target("avx2")))
+    inline void transposeSHA256Words(__m256i (&r)[8])
+    {
+        const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+        const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+        const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+        const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+        const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+        const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+        const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+        const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+        const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+        r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    /* SHA-256 of eight messages using AVX2.
+       Lane j of each vector belongs to message j. */
+    __attribute__((target("avx2")))
+    inline void processSHA256BlocksMultiAVX2(uint32_t (&states)[8][8], const uint8_t* (&data)[8], size_t numBlocks, const uint32_t* ks)
+    {
+        const __m256i MASK = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+        // Load state: hs[i] = word i of all states
+        __m256i hs[8];
+        for (int i = 0; i < 8; ++i) {
+            hs[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&states[i][0]));
+        }
+        transposeSHA256Words(hs);
+
+        while (numBlocks > 0) {
+            // Load message: w[t] = word t of all blocks
+            __m256i w[16];
+            for (int half = 0; half < 2; ++half) {
+                __m256i r[8];
+                for (int j = 0; j < 8; ++j) {
+                    r[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data[j] + 32*half));
+                }
+                transposeSHA256Words(r);
+                for (int t = 0; t < 8; ++t) {
+                    w[8*half + t] = _mm256_shuffle_epi8(r[t], MASK);
+                }
+            }
+
+            __m256i a = hs[0], b = hs[1], c = hs[2], d = hs[3];
+            __m256i e = hs[4], f = hs[5], g = hs[6], h = hs[7];
+            for (int t = 0; t < 64; ++t) {
+                if (t >= 16) {
+                    // W[t] = ssig1(W[t-2]) + W[t-7] + ssig0(W[t-15]) + W[t-16]
+                    const __m256i w2  = w[(t-2) & 15];
+                    const __m256i w15 = w[(t-15) & 15];
+                    const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotateRight32x8<17>(w2), rotateRight32x8<19>(w2)), _mm256_srli_epi32(w2, 10));
+                    const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotateRight32x8<7>(w15), rotateRight32x8<18>(w15)), _mm256_srli_epi32(w15, 3));
+                    w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(s1, w[(t-7) & 15]), _mm256_add_epi32(s0, w[t & 15]));
+                }
+
+                const __m256i bsig1 = _mm256_xor_si256(_mm256_xor_si256(rotateRight32x8<6>(e), rotateRight32x8<11>(e)), rotateRight32x8<25>(e));
+                const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, bsig1), _mm256_add_epi32(ch, w[t & 15])),
+                                                    _mm256_set1_epi32(static_cast<int>(ks[t])));
+                const __m256i bsig0 = _mm256_xor_si256(_mm256_xor_si256(rotateRight32x8<2>(a), rotateRight32x8<13>(a)), rotateRight32x8<22>(a));
+                const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                const __m256i t2 = _mm256_add_epi32(bsig0, maj);
+                h = g;
+                g = f;
+                f = e;
+                e = _mm256_add_epi32(d, t1);
+                d = c;
+                c = b;
+                b = a;
+                a = _mm256_add_epi32(t1, t2);
+            }
+            hs[0] = _mm256_add_epi32(hs[0], a);
+            hs[1] = _mm256_add_epi32(hs[1], b);
+            hs[2] = _mm256_add_epi32(hs[2], c);
+            hs[3] = _mm256_add_epi32(hs[3], d);
+            hs[4] = _mm256_add_epi32(hs[4], e);
+            hs[5] = _mm256_add_epi32(hs[5], f);
+            hs[6] = _mm256_add_epi32(hs[6], g);
+            hs[7] = _mm256_add_epi32(hs[7], h);
+
+            for (int j = 0; j < 8; ++j) {
+                data[j] += 64;
+            }
+            --numBlocks;
+        }
+
+        transposeSHA256Words(hs);
+        for (int i = 0; i < 8; ++i) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&states[i][0]), hs[i]);
+        }
+    }
+
+    inline bool processSHA256Blocks(uint32_t (&state)[8], const uint8_t* data, size_t numBlocks, const uint32_t* ks)
+    {
+        if (haveSHAExtensions()) {
+            processSHA256BlocksNative(state, data, numBlocks, ks);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    inline bool processSHA512Blocks(uint64_t (&state)[8], const uint8_t* data, size_t numBlocks, const uint64_t* ks)
+    {
+        if (hasCpuFeatures(CPU_AVX2)) {
+            processSHA512BlocksAVX2(state, data, numBlocks, ks);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /* Process blocks of multiple independent SHA-256 messages.
+       \param states    [in/out] States, numLanes pointers to 8 words each
+       \param data      [in] Data, numLanes pointers to numBlocks blocks each
+       \param numLanes  [in] Number of messages, at most MAX_SHA256_LANES
+       \param numBlocks [in] Number of blocks (64 bytes each) per message
+       \param ks        [in] Round constants
+       \return true if blocks have been processed; false if no acceleration is available */
+    inline bool processSHA256BlocksMulti(uint32_t* const* states, const uint8_t* const* data, size_t numLanes, size_t numBlocks, const uint32_t* ks)
+    {
+        if (!haveSHAExtensions() && hasCpuFeatures(CPU_AVX2) && numLanes >= 2) {
+            // Unused lanes repeat the last message
+            uint32_t laneStates[8][8];
+            const uint8_t* laneData[8];
+            for (size_t j = 0; j < 8; ++j) {
+                const size_t src = std::min(j, numLanes-1);
+                std::copy(states[src], states[src] + 8, laneStates[j]);
+                laneData[j] = data[src];
+            }
+            processSHA256BlocksMultiAVX2(laneStates, laneData, numBlocks, ks);
+            for (size_t j = 0; j < numLanes; ++j) {
+                std::copy(laneStates[j], laneStates[j] + 8, states[j]);
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+#else
+/*
+ *  No acceleration available
+ */
+namespace {
+    inline bool processSHA1Blocks(uint32_t (&/*state*/)[5], const uint8_t* /*data*/, size_t /*numBlocks*/)
+    {
+        return false;
+    }
+
+    inline bool processSHA256Blocks(uint32_t (&/*state*/)[8], const uint8_t* /*data*/, size_t /*numBlocks*/, const uint32_t* /*ks*/)
+    {
+        return false;
+    }
+
+    inline bool processSHA512Blocks(uint64_t (&/*state*/)[8], const uint8_t* /*data*/, size_t /*numBlocks*/, const uint64_t* /*ks*/)
+    {
+        return false;
+    }
+
+    inline bool processSHA256BlocksMulti(uint32_t* const* /*states*/, const uint8_t* const* /*data*/, size_t /*numLanes*/, size_t /*numBlocks*/, const uint32_t* /*ks*/)
+    {
+        return false;
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/**
+  *  \file arch/streamworker.hpp
+  *  \brief System-dependant Part of afl/async/streamworker.cpp
+  *
+  *  This defines the class StreamWorker::Ring, which performs transfers using the operating system's asynchronous I/O facility.
+  *  It must provide the methods of arch::posix::PosixUring:
+  *  - init() to set it up. If this fails, StreamWorker performs all operations using its threads.
+  *  - submitRead(), submitWrite() to start a transfer. These can fail if the stream is not supported,
+  *    in which case StreamWorker performs that operation using its threads.
+  *  - submitCancel(), submitNop()
+  *  - wait() to wait for a completion
+  */
+#ifndef AFL_ARCH_STREAMWORKER_HPP
+#define AFL_ARCH_STREAMWORKER_HPP
+
+#include "afl/async/streamworker.hpp"
+
+#if TARGET_OS_POSIX
+/*
+ *  POSIX: io_uring on Linux
+ */
+#include "arch/posix/posixuring.hpp"
+class afl::async::StreamWorker::Ring : public arch::posix::PosixUring { };
+#else
+/*
+ *  Other: no asynchronous I/O
+ */
+#include "afl/base/memory.hpp"
+#include "afl/io/stream.hpp"
+class afl::async::StreamWorker::Ring {
+ public:
+    bool init(uint32_t /*numEntries*/)
+        { return false; }
+    bool submitRead(afl::io::Stream& /*stream*/, afl::base::Bytes_t /*data*/, uint64_t /*tag*/)
+        { return false; }
+    bool submitWrite(afl::io::Stream& /*stream*/, afl::base::ConstBytes_t /*data*/, uint64_t /*tag*/)
+        { return false; }
+    bool submitCancel(uint64_t /*targetTag*/, uint64_t /*tag*/)
+        { return false; }
+    bool submitNop(uint64_t /*tag*/)
+        { return false; }
+    void wait(uint64_t& tag, int32_t& result)
+        { tag = 0; result = -1; }
+};
+#endif
+
+#endif
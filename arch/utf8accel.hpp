@@ -0,0 +1,380 @@
+/**
+  *  \file arch/utf8accel.hpp
+  *  \brief System-dependant Part of afl/charset/utf8.cpp
+  *
+  *  Provides vectorized kernels for bulk UTF-8 processing.
+  *  Each function processes the whole buffer and returns true,
+  *  or returns false if acceleration is not available on this CPU, in which case the caller uses its portable code.
+  *  Availability is checked at runtime, so a binary built on one machine still works on another.
+  */
+#ifndef AFL_ARCH_UTF8ACCEL_HPP
+#define AFL_ARCH_UTF8ACCEL_HPP
+
+#include <cstring>
+#include "afl/base/types.hpp"
+#include "arch/cpufeatures.hpp"
+
+#ifdef AFL_ARCH_HAVE_X86_FEATURES
+/*
+ *  Implementation using SSSE3 or AVX2 (gcc 5 and later, clang).
+ *  Functions using the instructions are compiled with a target attribute,
+ *  so the remaining code does not require the extensions.
+ *
+ *  UTF-8 validation uses the lookup algorithm from
+ *  John Keiser, Daniel Lemire: "Validating UTF-8 In Less Than One Instruction Per Byte" (2020).
+ *  Each byte is classified together with its predecessor using three 16-entry tables;
+ *  the AND of the three lookups is nonzero exactly if the pair is erroneous.
+ *  The remaining condition (third/fourth byte of a sequence must be a continuation) is checked separately.
+ */
+# include <immintrin.h>
+
+namespace {
+    /* Error classes for UTF-8 validation */
+    const uint8_t UTF8_TOO_SHORT      = 1 << 0;   // lead byte not followed by continuation
+    const uint8_t UTF8_TOO_LONG       = 1 << 1;   // ASCII followed by continuation
+    const uint8_t UTF8_OVERLONG_3     = 1 << 2;   // E0 80..9F
+    const uint8_t UTF8_TOO_LARGE      = 1 << 3;   // F4 90..BF, F5..FF
+    const uint8_t UTF8_SURROGATE      = 1 << 4;   // ED A0..BF
+    const uint8_t UTF8_OVERLONG_2     = 1 << 5;   // C0, C1
+    const uint8_t UTF8_TOO_LARGE_1000 = 1 << 6;   // F5..FF 80..8F
+    const uint8_t UTF8_OVERLONG_4     = 1 << 6;   // F0 80..8F
+    const uint8_t UTF8_TWO_CONTS      = 1 << 7;   // continuation followed by continuation
+    const uint8_t UTF8_CARRY          = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS;
+
+    /* Classification of first byte by high nibble */
+    const uint8_t UTF8_BYTE_1_HIGH[16] = {
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    };
+
+    /* Classification of first byte by low nibble */
+    const uint8_t UTF8_BYTE_1_LOW[16] = {
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    };
+
+    /* Classification of second byte by high nibble */
+    const uint8_t UTF8_BYTE_2_HIGH[16] = {
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    };
+
+    /* Maximum values for the last bytes of a block that do not start an incomplete sequence */
+    const uint8_t UTF8_MAX_COMPLETE[32] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+    };
+
+    /* Acceleration level */
+    enum Utf8AccelLevel {
+        Utf8NoAccel,
+        Utf8SSSE3,
+        Utf8AVX2
+    };
+
+    /* Get acceleration level. AVX2 kernels also use SSSE3 instructions. */
+    inline Utf8AccelLevel haveUtf8Accel()
+    {
+        return hasCpuFeatures(CPU_AVX2 | CPU_SSSE3) ? Utf8AVX2
+            : hasCpuFeatures(CPU_SSSE3) ? Utf8SSSE3
+            : Utf8NoAccel;
+    }
+
+
+    /*
+     *  SSSE3
+     */
+
+    __attribute__((target("ssse3")))
+    inline size_t findNonAsciiSSSE3(const uint8_t* p, size_t n)
+    {
+        size_t i = 0;
+        while (n - i >= 16) {
+            const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+            if (mask != 0) {
+                return i + size_t(__builtin_ctz(unsigned(mask)));
+            }
+            i += 16;
+        }
+        while (i < n && p[i] < 0x80) {
+            ++i;
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3")))
+    inline size_t countContinuationBytesSSSE3(const uint8_t* p, size_t n)
+    {
+        // Continuation bytes are 0x80..0xBF, that is, less than -64 as signed.
+        // Count them in byte lanes, and sum up before the lanes overflow.
+        const __m128i limit = _mm_set1_epi8(-64);
+        __m128i sum = _mm_setzero_si128();
+        size_t i = 0;
+        while (n - i >= 16) {
+            __m128i acc = _mm_setzero_si128();
+            for (int j = 0; j < 255 && n - i >= 16; ++j, i += 16) {
+                acc = _mm_sub_epi8(acc, _mm_cmplt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), limit));
+            }
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(acc, _mm_setzero_si128()));
+        }
+
+        uint64_t parts[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(parts), sum);
+        size_t result = size_t(parts[0] + parts[1]);
+        while (i < n) {
+            result += ((p[i] & 0xC0) == 0x80);
+            ++i;
+        }
+        return result;
+    }
+
+    __attribute__((target("ssse3")))
+    inline void checkUtf8SSSE3(const uint8_t* p, size_t n, bool& valid, bool& suspect)
+    {
+        const __m128i byte1High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_HIGH));
+        const __m128i byte1Low  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_LOW));
+        const __m128i byte2High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_2_HIGH));
+        const __m128i maxComplete = _mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_MAX_COMPLETE + 16));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+
+        __m128i error = _mm_setzero_si128();
+        __m128i suspects = _mm_setzero_si128();
+        __m128i prevInput = _mm_setzero_si128();
+        __m128i prevIncomplete = _mm_setzero_si128();
+
+        size_t i = 0;
+        while (i < n) {
+            // Load block; pad the last one with zeroes (ASCII)
+            __m128i input;
+            if (n - i >= 16) {
+                input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            } else {
+                uint8_t tmp[16] = {0};
+                std::memcpy(tmp, p + i, n - i);
+                input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tmp));
+            }
+            i += 16;
+
+            if (_mm_movemask_epi8(input) == 0) {
+                // ASCII: only need to check that previous block was complete
+                error = _mm_or_si128(error, prevIncomplete);
+                prevIncomplete = _mm_setzero_si128();
+            } else {
+                const __m128i prev1 = _mm_alignr_epi8(input, prevInput, 15);
+                const __m128i prev2 = _mm_alignr_epi8(input, prevInput, 14);
+                const __m128i prev3 = _mm_alignr_epi8(input, prevInput, 13);
+
+                // Check pairs
+                const __m128i sc = _mm_and_si128(_mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                                                               _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble))),
+                                                 _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+                // Check that third/fourth bytes are continuations
+                const __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80))),
+                                                    _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80))));
+                error = _mm_or_si128(error, _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(char(0x80))), sc));
+
+                // Suspects: 0xBF or 0xEE, followed by 0xBE or 0xBF
+                const __m128i isBE = _mm_cmpeq_epi8(_mm_max_epu8(input, _mm_set1_epi8(char(0xBE))), input);
+                const __m128i isBF = _mm_or_si128(_mm_cmpeq_epi8(prev1, _mm_set1_epi8(char(0xBF))),
+                                                  _mm_cmpeq_epi8(prev1, _mm_set1_epi8(char(0xEE))));
+                suspects = _mm_or_si128(suspects, _mm_and_si128(isBE, isBF));
+
+                prevIncomplete = _mm_subs_epu8(input, maxComplete);
+            }
+            prevInput = input;
+        }
+        error = _mm_or_si128(error, prevIncomplete);
+
+        valid = _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+        suspect = _mm_movemask_epi8(suspects) != 0;
+    }
+
+
+    /*
+     *  AVX2
+     */
+
+    __attribute__((target("avx2")))
+    inline size_t findNonAsciiAVX2(const uint8_t* p, size_t n)
+    {
+        size_t i = 0;
+        while (n - i >= 32) {
+            const int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+            if (mask != 0) {
+                return i + size_t(__builtin_ctz(unsigned(mask)));
+            }
+            i += 32;
+        }
+        return i + findNonAsciiSSSE3(p + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t countContinuationBytesAVX2(const uint8_t* p, size_t n)
+    {
+        const __m256i limit = _mm256_set1_epi8(-64);
+        __m256i sum = _mm256_setzero_si256();
+        size_t i = 0;
+        while (n - i >= 32) {
+            __m256i acc = _mm256_setzero_si256();
+            for (int j = 0; j < 255 && n - i >= 32; ++j, i += 32) {
+                acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(limit, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i))));
+            }
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+        }
+
+        uint64_t parts[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(parts), sum);
+        return size_t(parts[0] + parts[1] + parts[2] + parts[3]) + countContinuationBytesSSSE3(p + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline void checkUtf8AVX2(const uint8_t* p, size_t n, bool& valid, bool& suspect)
+    {
+        const __m256i byte1High = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_HIGH)));
+        const __m256i byte1Low  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_1_LOW)));
+        const __m256i byte2High = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(UTF8_BYTE_2_HIGH)));
+        const __m256i maxComplete = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(UTF8_MAX_COMPLETE));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+        __m256i error = _mm256_setzero_si256();
+        __m256i suspects = _mm256_setzero_si256();
+        __m256i prevInput = _mm256_setzero_si256();
+        __m256i prevIncomplete = _mm256_setzero_si256();
+
+        size_t i = 0;
+        while (i < n) {
+            // Load block; pad the last one with zeroes (ASCII)
+            __m256i input;
+            if (n - i >= 32) {
+                input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            } else {
+                uint8_t tmp[32] = {0};
+                std::memcpy(tmp, p + i, n - i);
+                input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tmp));
+            }
+            i += 32;
+
+            if (_mm256_movemask_epi8(input) == 0) {
+                // ASCII: only need to check that previous block was complete
+                error = _mm256_or_si256(error, prevIncomplete);
+                prevIncomplete = _mm256_setzero_si256();
+            } else {
+                // alignr works on 128-bit lanes; combine upper half of previous block with lower half of current one
+                const __m256i shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+                const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+                const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+                const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+                // Check pairs
+                const __m256i sc = _mm256_and_si256(_mm256_and_si256(_mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                                                                     _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, nibble))),
+                                                    _mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+                // Check that third/fourth bytes are continuations
+                const __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(char(0xE0 - 0x80))),
+                                                       _mm256_subs_epu8(prev3, _mm256_set1_epi8(char(0xF0 - 0x80))));
+                error = _mm256_or_si256(error, _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8(char(0x80))), sc));
+
+                // Suspects: 0xBF or 0xEE, followed by 0xBE or 0xBF
+                const __m256i isBE = _mm256_cmpeq_epi8(_mm256_max_epu8(input, _mm256_set1_epi8(char(0xBE))), input);
+                const __m256i isBF = _mm256_or_si256(_mm256_cmpeq_epi8(prev1, _mm256_set1_epi8(char(0xBF))),
+                                                     _mm256_cmpeq_epi8(prev1, _mm256_set1_epi8(char(0xEE))));
+                suspects = _mm256_or_si256(suspects, _mm256_and_si256(isBE, isBF));
+
+                prevIncomplete = _mm256_subs_epu8(input, maxComplete);
+            }
+            prevInput = input;
+        }
+        error = _mm256_or_si256(error, prevIncomplete);
+
+        valid = _mm256_testz_si256(error, error) != 0;
+        suspect = _mm256_testz_si256(suspects, suspects) == 0;
+    }
+
+
+    /*
+     *  Entry points
+     */
+
+    /* Find first non-ASCII byte; see Utf8::findNonAscii() */
+    inline bool findNonAsciiAccel(const uint8_t* p, size_t n, size_t& result)
+    {
+        switch (haveUtf8Accel()) {
+         case Utf8AVX2:  result = findNonAsciiAVX2(p, n);  return true;
+         case Utf8SSSE3: result = findNonAsciiSSSE3(p, n); return true;
+         default:        return false;
+        }
+    }
+
+    /* Count continuation bytes (0x80..0xBF) */
+    inline bool countContinuationBytesAccel(const uint8_t* p, size_t n, size_t& result)
+    {
+        switch (haveUtf8Accel()) {
+         case Utf8AVX2:  result = countContinuationBytesAVX2(p, n);  return true;
+         case Utf8SSSE3: result = countContinuationBytesSSSE3(p, n); return true;
+         default:        return false;
+        }
+    }
+
+    /* Check UTF-8.
+       valid: set to true if buffer is well-formed UTF-8 (RFC 3629).
+       suspect: set to true if buffer contains a byte 0xBF or 0xEE followed by 0xBE or 0xBF.
+       All non-characters and error characters (see Utf8) contain this pattern. */
+    inline bool checkUtf8Accel(const uint8_t* p, size_t n, bool& valid, bool& suspect)
+    {
+        switch (haveUtf8Accel()) {
+         case Utf8AVX2:  checkUtf8AVX2(p, n, valid, suspect);  return true;
+         case Utf8SSSE3: checkUtf8SSSE3(p, n, valid, suspect); return true;
+         default:        return false;
+        }
+    }
+}
+
+#else
+/*
+ *  No acceleration available
+ */
+namespace {
+    inline bool findNonAsciiAccel(const uint8_t* /*p*/, size_t /*n*/, size_t& /*result*/)
+    {
+        return false;
+    }
+
+    inline bool countContinuationBytesAccel(const uint8_t* /*p*/, size_t /*n*/, size_t& /*result*/)
+    {
+        return false;
+    }
+
+    inline bool checkUtf8Accel(const uint8_t* /*p*/, size_t /*n*/, bool& /*valid*/, bool& /*suspect*/)
+    {
+        return false;
+    }
+}
+#endif
+
+#endif
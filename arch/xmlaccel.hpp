@@ -0,0 +1,96 @@
+/**
+  *  \file arch/xmlaccel.hpp
+  *  \brief System-dependant Part of afl/io/xml/reader.cpp
+  *
+  *  Provides a vectorized scan for runs of plain ASCII characters.
+  *  The function examines whole 16-byte blocks and returns true,
+  *  or returns false if acceleration is not available on this CPU, in which case the caller uses its portable code.
+  *  In either case, the caller examines the remaining bytes itself.
+  *  Availability is checked at runtime, so a binary built on one machine still works on another.
+  */
+#ifndef AFL_ARCH_XMLACCEL_HPP
+#define AFL_ARCH_XMLACCEL_HPP
+
+#include "afl/base/types.hpp"
+#include "arch/cpufeatures.hpp"
+
+#ifdef AFL_ARCH_HAVE_X86_FEATURES
+/*
+ *  Implementation using SSE2.
+ *  The function using the instructions is compiled with a target attribute,
+ *  so the remaining code does not require the extension.
+ *
+ *  Each block is compared against all stop characters at once;
+ *  the movemask of the combined result locates the first one.
+ */
+# include <emmintrin.h>
+
+namespace {
+    /* Maximum number of stop characters */
+    const size_t MAX_XML_STOP_CHARS = 10;
+
+    /* Find run using SSE2 */
+    __attribute__((target("sse2")))
+    inline size_t findXmlRunSSE2(const uint8_t* data, size_t size, const uint8_t* stopChars, size_t numStopChars, bool stopAtControl)
+    {
+        __m128i stop[MAX_XML_STOP_CHARS];
+        for (size_t i = 0; i < numStopChars; ++i) {
+            stop[i] = _mm_set1_epi8(char(stopChars[i]));
+        }
+        const __m128i space = _mm_set1_epi8(' ');
+
+        size_t n = 0;
+        while (size - n >= 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + n));
+            __m128i hit = stopAtControl
+                ? _mm_cmpeq_epi8(_mm_min_epu8(v, space), v)
+                : _mm_setzero_si128();
+            for (size_t i = 0; i < numStopChars; ++i) {
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, stop[i]));
+            }
+
+            // Sign bit of v marks bytes 0x80 and above
+            const int mask = _mm_movemask_epi8(_mm_or_si128(hit, v));
+            if (mask != 0) {
+                return n + size_t(__builtin_ctz(static_cast<unsigned int>(mask)));
+            }
+            n += 16;
+        }
+        return n;
+    }
+
+    /* Find run of ASCII characters.
+       \param data          [in] Data
+       \param size          [in] Size of data
+       \param stopChars     [in] Characters that end the run, at most MAX_XML_STOP_CHARS
+       \param numStopChars  [in] Number of stop characters
+       \param stopAtControl [in] true to also end the run at control characters and space (<= ' ')
+       \param result        [out] Number of bytes that contain no byte ending the run.
+                            If this is less than size, either data[result] ends the run,
+                            or fewer than 16 bytes remain to be examined. */
+    inline bool findXmlRunAccel(const uint8_t* data, size_t size, const uint8_t* stopChars, size_t numStopChars, bool stopAtControl, size_t& result)
+    {
+        if (hasCpuFeatures(CPU_SSE2)) {
+            result = findXmlRunSSE2(data, size, stopChars, numStopChars, stopAtControl);
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+#else
+/*
+ *  No acceleration available
+ */
+namespace {
+    const size_t MAX_XML_STOP_CHARS = 10;
+
+    inline bool findXmlRunAccel(const uint8_t* /*data*/, size_t /*size*/, const uint8_t* /*stopChars*/, size_t /*numStopChars*/, bool /*stopAtControl*/, size_t& /*result*/)
+    {
+        return false;
+    }
+}
+#endif
+
+#endif
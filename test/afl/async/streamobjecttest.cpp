@@ -0,0 +1,207 @@
+/**
+  *  \file test/afl/async/streamobjecttest.cpp
+  *  \brief Test for afl::async::StreamObject
+  */
+
+#include "afl/async/streamobject.hpp"
+
+#include "afl/async/controller.hpp"
+#include "afl/async/notifier.hpp"
+#include "afl/async/receiveoperation.hpp"
+#include "afl/async/sendoperation.hpp"
+#include "afl/async/streamworker.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/directory.hpp"
+#include "afl/io/filesystem.hpp"
+#include "afl/io/internalstream.hpp"
+#include "afl/string/string.hpp"
+#include "afl/sys/semaphore.hpp"
+#include "afl/sys/thread.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+
+/** Test synchronous operations. */
+AFL_TEST("afl.async.StreamObject:sync", a)
+{
+    afl::base::Ref<afl::io::InternalStream> stream = *new afl::io::InternalStream();
+    stream->setName("name");
+    afl::async::StreamObject testee(stream);
+    afl::async::Controller ctl;
+    a.checkEqual("01. getName", testee.getName(), "name");
+
+    // Write
+    afl::async::SendOperation tx(afl::string::toBytes("hello, world"));
+    a.check("11. send", testee.send(ctl, tx));
+    a.checkEqual("12. getNumSentBytes", tx.getNumSentBytes(), 12U);
+    a.checkEqualContent("13. content", stream->getContent(), afl::string::toBytes("hello, world"));
+
+    // Read at end
+    uint8_t buffer[5];
+    afl::async::ReceiveOperation rx(buffer);
+    a.check("21. receive", testee.receive(ctl, rx));
+    a.checkEqual("22. getNumReceivedBytes", rx.getNumReceivedBytes(), 0U);
+
+    // Read
+    stream->setPos(7);
+    rx.setData(buffer);
+    a.check("31. receive", testee.receive(ctl, rx));
+    a.checkEqualContent("32. content", rx.getReceivedBytes(), afl::string::toBytes("world"));
+}
+
+/** Test asynchronous operations.
+    Operations must complete in the order they were started. */
+AFL_TEST("afl.async.StreamObject:async", a)
+{
+    afl::base::Ref<afl::io::ConstMemoryStream> stream = *new afl::io::ConstMemoryStream(afl::string::toBytes("abcdefgh"));
+    afl::async::StreamObject testee(stream);
+    afl::async::Controller ctl;
+
+    uint8_t b1[3], b2[3], b3[3];
+    afl::async::ReceiveOperation rx1(b1), rx2(b2), rx3(b3);
+    testee.receiveAsync(ctl, rx1);
+    testee.receiveAsync(ctl, rx2);
+    testee.receiveAsync(ctl, rx3);
+
+    // Wait for all three; order of reporting is not specified, but data is.
+    for (int i = 0; i < 3; ++i) {
+        afl::async::Operation* op = ctl.wait(10000);
+        a.check("01. wait", op == &rx1 || op == &rx2 || op == &rx3);
+    }
+    a.checkEqualContent("11. rx1", rx1.getReceivedBytes(), afl::string::toBytes("abc"));
+    a.checkEqualContent("12. rx2", rx2.getReceivedBytes(), afl::string::toBytes("def"));
+    a.checkEqualContent("13. rx3", rx3.getReceivedBytes(), afl::string::toBytes("gh"));
+
+    // Write to read-only stream fails
+    afl::async::SendOperation tx(afl::string::toBytes("x"));
+    a.check("21. send", testee.send(ctl, tx));
+    a.checkEqual("22. getNumSentBytes", tx.getNumSentBytes(), 0U);
+}
+
+/** Test cancellation.
+    After cancel, the operation must not be reported. */
+AFL_TEST("afl.async.StreamObject:cancel", a)
+{
+    afl::base::Ref<afl::io::ConstMemoryStream> stream = *new afl::io::ConstMemoryStream(afl::string::toBytes("abcdefgh"));
+    afl::async::StreamObject testee(stream);
+    afl::async::Controller ctl;
+
+    uint8_t b1[3], b2[3];
+    afl::async::ReceiveOperation rx1(b1), rx2(b2);
+    testee.receiveAsync(ctl, rx1);
+    testee.receiveAsync(ctl, rx2);
+    testee.cancel(ctl, rx1);
+
+    a.checkEqual("01. wait", ctl.wait(10000), &rx2);
+    a.checkNull("02. wait", ctl.wait(0));
+    a.checkEqual("03. received", rx2.getNumReceivedBytes(), 3U);
+}
+
+/** Test cancellation while the operation is being reported.
+    cancel() must wait for the notification, and then remove it. */
+AFL_TEST("afl.async.StreamObject:cancel:completing", a)
+{
+    // Notifier that signals the test, and waits before posting the result
+    class SlowNotifier : public afl::async::Notifier {
+     public:
+        SlowNotifier()
+            : m_entered(0)
+            { }
+        virtual void notify(afl::async::Operation& op)
+            {
+                m_entered.post();
+                afl::sys::Thread::sleep(100);
+                afl::async::Notifier::getDefaultInstance().notify(op);
+            }
+        afl::sys::Semaphore m_entered;
+    };
+
+    afl::base::Ref<afl::io::ConstMemoryStream> stream = *new afl::io::ConstMemoryStream(afl::string::toBytes("abcdefgh"));
+    afl::async::StreamObject testee(stream);
+    afl::async::Controller ctl;
+    SlowNotifier notifier;
+
+    uint8_t b1[3];
+    afl::async::ReceiveOperation rx1(b1);
+    rx1.setNotifier(notifier);
+    testee.receiveAsync(ctl, rx1);
+
+    // Operation has been performed and is being reported; cancel it
+    notifier.m_entered.wait();
+    testee.cancel(ctl, rx1);
+
+    // Must not be reported
+    a.checkNull("01. wait", ctl.wait(200));
+    a.checkEqual("02. received", rx1.getNumReceivedBytes(), 3U);
+}
+
+/** Test multiple StreamObject instances sharing a StreamWorker. */
+AFL_TEST("afl.async.StreamObject:shared", a)
+{
+    afl::async::StreamWorker worker(2);
+    afl::base::Ref<afl::io::ConstMemoryStream> s1 = *new afl::io::ConstMemoryStream(afl::string::toBytes("abcdef"));
+    afl::base::Ref<afl::io::ConstMemoryStream> s2 = *new afl::io::ConstMemoryStream(afl::string::toBytes("uvwxyz"));
+    afl::async::StreamObject t1(s1, worker);
+    afl::async::StreamObject t2(s2, worker);
+    afl::async::Controller ctl;
+
+    uint8_t b1[3], b2[3], b3[3], b4[3];
+    afl::async::ReceiveOperation rx1(b1), rx2(b2), rx3(b3), rx4(b4);
+    t1.receiveAsync(ctl, rx1);
+    t2.receiveAsync(ctl, rx3);
+    t1.receiveAsync(ctl, rx2);
+    t2.receiveAsync(ctl, rx4);
+
+    for (int i = 0; i < 4; ++i) {
+        a.checkNonNull("01. wait", ctl.wait(10000));
+    }
+    a.checkEqualContent("11. rx1", rx1.getReceivedBytes(), afl::string::toBytes("abc"));
+    a.checkEqualContent("12. rx2", rx2.getReceivedBytes(), afl::string::toBytes("def"));
+    a.checkEqualContent("13. rx3", rx3.getReceivedBytes(), afl::string::toBytes("uvw"));
+    a.checkEqualContent("14. rx4", rx4.getReceivedBytes(), afl::string::toBytes("xyz"));
+}
+
+/** Test operations on a file.
+    On Linux, these use io_uring if available. */
+AFL_TEST("afl.async.StreamObject:file", a)
+{
+    static const char FILENAME[] = "__test_streamobject.tmp";
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    afl::base::Ref<afl::io::Directory> dir = fs.openDirectory(fs.getWorkingDirectoryName());
+    try {
+        afl::base::Ref<afl::io::Stream> stream = dir->openFile(FILENAME, fs.Create);
+        afl::async::StreamObject testee(stream);
+        afl::async::Controller ctl;
+
+        // Write, asynchronously
+        static uint8_t big[200000];
+        for (size_t i = 0; i < sizeof(big); ++i) {
+            big[i] = uint8_t(i % 251);
+        }
+        afl::async::SendOperation tx1(afl::string::toBytes("abc")), tx2(big), tx3(afl::string::toBytes("xyz"));
+        testee.sendAsync(ctl, tx1);
+        testee.sendAsync(ctl, tx2);
+        testee.sendAsync(ctl, tx3);
+        for (int i = 0; i < 3; ++i) {
+            a.checkNonNull("01. wait", ctl.wait(10000));
+        }
+        a.checkEqual("02. getNumSentBytes", tx2.getNumSentBytes(), sizeof(big));
+        a.checkEqual("03. getPos", stream->getPos(), sizeof(big) + 6);
+
+        // Read back
+        stream->setPos(0);
+        uint8_t b1[3], b2[sizeof(big)], b3[10];
+        afl::async::ReceiveOperation rx1(b1), rx2(b2), rx3(b3);
+        a.check("11. receive", testee.receive(ctl, rx1));
+        a.checkEqualContent("12. rx1", rx1.getReceivedBytes(), afl::string::toBytes("abc"));
+        a.check("13. receive", testee.receive(ctl, rx2));
+        a.checkEqualContent("14. rx2", rx2.getReceivedBytes(), ConstBytes_t(big));
+        a.check("15. receive", testee.receive(ctl, rx3));
+        a.checkEqualContent("16. rx3", rx3.getReceivedBytes(), afl::string::toBytes("xyz"));
+        dir->eraseNT(FILENAME);
+    }
+    catch (...) {
+        dir->eraseNT(FILENAME);
+        throw;
+    }
+}
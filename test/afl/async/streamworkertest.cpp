@@ -0,0 +1,92 @@
+/**
+  *  \file test/afl/async/streamworkertest.cpp
+  *  \brief Test for afl::async::StreamWorker
+  */
+
+#include "afl/async/streamworker.hpp"
+
+#include <vector>
+#include "afl/async/controller.hpp"
+#include "afl/async/sendoperation.hpp"
+#include "afl/async/streamobject.hpp"
+#include "afl/container/ptrvector.hpp"
+#include "afl/io/directory.hpp"
+#include "afl/io/filesystem.hpp"
+#include "afl/io/internalstream.hpp"
+#include "afl/string/format.hpp"
+#include "afl/test/testrunner.hpp"
+
+/** Test lifetime: StreamWorker without users. */
+AFL_TEST_NOARG("afl.async.StreamWorker:empty")
+{
+    afl::async::StreamWorker testee(3);
+}
+
+/** Test many StreamObject instances on a single thread.
+    Each object's operations must be performed in order. */
+AFL_TEST("afl.async.StreamWorker:many", a)
+{
+    const size_t N = 20;
+    afl::async::StreamWorker testee(1);
+    afl::async::Controller ctl;
+    afl::container::PtrVector<afl::async::StreamObject> objs;
+    std::vector<afl::base::Ref<afl::io::InternalStream> > streams;
+    for (size_t i = 0; i < N; ++i) {
+        streams.push_back(*new afl::io::InternalStream());
+        objs.pushBackNew(new afl::async::StreamObject(streams.back(), testee));
+    }
+
+    afl::container::PtrVector<afl::async::SendOperation> ops;
+    for (size_t i = 0; i < N; ++i) {
+        objs[i]->sendAsync(ctl, *ops.pushBackNew(new afl::async::SendOperation(afl::string::toBytes("ab"))));
+        objs[i]->sendAsync(ctl, *ops.pushBackNew(new afl::async::SendOperation(afl::string::toBytes("cd"))));
+    }
+    for (size_t i = 0; i < 2*N; ++i) {
+        a.checkNonNull("01. wait", ctl.wait(10000));
+    }
+    for (size_t i = 0; i < N; ++i) {
+        a.checkEqualContent("11. content", streams[i]->getContent(), afl::string::toBytes("abcd"));
+    }
+}
+
+/** Test many files.
+    With io_uring, this exceeds the ring size; excess operations must be performed by threads. */
+AFL_TEST("afl.async.StreamWorker:files", a)
+{
+    const size_t N = 100;
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    afl::base::Ref<afl::io::Directory> dir = fs.openDirectory(fs.getWorkingDirectoryName());
+    try {
+        afl::async::StreamWorker testee(2);
+        afl::async::Controller ctl;
+        afl::container::PtrVector<afl::async::StreamObject> objs;
+        std::vector<afl::base::Ref<afl::io::Stream> > streams;
+        for (size_t i = 0; i < N; ++i) {
+            streams.push_back(dir->openFile(afl::string::Format("__test_streamworker%d.tmp", i), fs.Create));
+            objs.pushBackNew(new afl::async::StreamObject(streams.back(), testee));
+        }
+
+        afl::container::PtrVector<afl::async::SendOperation> ops;
+        for (size_t i = 0; i < N; ++i) {
+            objs[i]->sendAsync(ctl, *ops.pushBackNew(new afl::async::SendOperation(afl::string::toBytes("ab"))));
+            objs[i]->sendAsync(ctl, *ops.pushBackNew(new afl::async::SendOperation(afl::string::toBytes("cd"))));
+        }
+        for (size_t i = 0; i < 2*N; ++i) {
+            a.checkNonNull("01. wait", ctl.wait(10000));
+        }
+        for (size_t i = 0; i < N; ++i) {
+            uint8_t buffer[10];
+            streams[i]->setPos(0);
+            a.checkEqualContent("11. content", afl::base::ConstBytes_t(buffer).trim(streams[i]->read(buffer)), afl::string::toBytes("abcd"));
+        }
+    }
+    catch (...) {
+        for (size_t i = 0; i < N; ++i) {
+            dir->eraseNT(afl::string::Format("__test_streamworker%d.tmp", i));
+        }
+        throw;
+    }
+    for (size_t i = 0; i < N; ++i) {
+        dir->eraseNT(afl::string::Format("__test_streamworker%d.tmp", i));
+    }
+}
@@ -6,6 +6,32 @@
 #include "afl/charset/base64.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/base/countof.hpp"
+#include "afl/charset/transcoder.hpp"
+#include "afl/string/format.hpp"
+#include "test/afl/charset/transcodertest.hpp"
+
+namespace {
+    const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    /* Straightforward reference encoder */
+    String_t encodeReference(const String_t& in)
+    {
+        String_t result;
+        for (size_t i = 0; i < in.size(); i += 3) {
+            uint32_t value = uint8_t(in[i]) << 16;
+            if (i+1 < in.size()) { value |= uint8_t(in[i+1]) << 8; }
+            if (i+2 < in.size()) { value |= uint8_t(in[i+2]); }
+            result += ALPHABET[(value >> 18) & 63];
+            result += ALPHABET[(value >> 12) & 63];
+            result += (i+1 < in.size() ? ALPHABET[(value >> 6) & 63] : '=');
+            result += (i+2 < in.size() ? ALPHABET[value & 63] : '=');
+        }
+        return result;
+    }
+}
+
 AFL_TEST("afl.charset.Base64:basic", a) {
     afl::charset::Base64 b64;
 
@@ -88,3 +114,63 @@ AFL_TEST("afl.charset.Base64:error", a) {
     a.checkEqual("04", b64.decode(afl::string::toBytes("YQ$")),  String_t("a\0",   2));  // incorrect
     a.checkEqual("05", b64.decode(afl::string::toBytes("YQ$$")), String_t("a\0\0", 3));  // incorrect
 }
+
+/** Test long data, covering bulk conversion. */
+AFL_TEST("afl.charset.Base64:long", a) {
+    afl::charset::Base64 b64;
+    String_t data;
+    for (size_t i = 0; i < 1000; ++i) {
+        data += char((i * 37) ^ (i >> 3));
+        afl::test::Assert me(a(afl::string::Format("length %d", data.size())));
+
+        const String_t encoded = afl::string::fromBytes(b64.encode(afl::string::toMemory(data)));
+        me.checkEqual("encode", encoded, encodeReference(data));
+        me.checkEqual("decode", b64.decode(afl::string::toBytes(encoded)), data);
+    }
+}
+
+/** Test decoding of invalid characters. These count as 0, and do not disturb the surrounding data. */
+AFL_TEST("afl.charset.Base64:decode:invalid", a) {
+    afl::charset::Base64 b64;
+    String_t data;
+    for (size_t i = 0; i < 300; ++i) {
+        data += char(i);
+    }
+    const String_t encoded = encodeReference(data);
+    for (size_t i = 0; i < encoded.size(); i += 7) {
+        String_t modified = encoded;
+        modified[i] = (i % 2 == 0 ? '*' : 'A');
+        const size_t byte = i / 4 * 3;
+        const String_t decoded = b64.decode(afl::string::toBytes(modified));
+        afl::test::Assert me(a(afl::string::Format("position %d", i)));
+        me.checkEqual("size", decoded.size(), data.size());
+        me.checkEqual("prefix", decoded.substr(0, byte), data.substr(0, byte));
+        me.checkEqual("suffix", decoded.substr(byte + 3), data.substr(byte + 3));
+    }
+
+    // '=' in the middle counts as 0
+    a.checkEqual("mid =", b64.decode(afl::string::toBytes("YQ==YWFh")), String_t("a\0\0aaa", 6));
+}
+
+/** Test streaming, using different buffer sizes. */
+AFL_TEST("afl.charset.Base64:stream", a) {
+    afl::charset::Base64 b64;
+    String_t data;
+    for (size_t i = 0; i < 500; ++i) {
+        data += char((i * 37) ^ (i >> 3));
+    }
+
+    std::auto_ptr<afl::charset::Transcoder> enc(b64.createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(b64.createDecoder());
+    for (size_t len = 0; len < 6; ++len) {
+        const String_t piece = data.substr(0, len);
+        checkTranscoder(a(afl::string::Format("encode short %d", len)), *enc, afl::string::toBytes(piece), encodeReference(piece));
+    }
+    checkTranscoder(a("encode"), *enc, afl::string::toBytes(data), encodeReference(data));
+
+    static const char*const DECODE_CASES[] = { "", "Y", "YQ", "YQ=", "YQ==", "YWE", "YWFh", "YQ==YWFh", "Y=Q=", "*WFh", "YWFh===" };
+    for (size_t c = 0; c < countof(DECODE_CASES); ++c) {
+        checkTranscoder(a("decode short")(DECODE_CASES[c]), *dec, afl::string::toBytes(DECODE_CASES[c]), b64.decode(afl::string::toBytes(DECODE_CASES[c])));
+    }
+    checkTranscoder(a("decode"), *dec, afl::string::toBytes(encodeReference(data)), data);
+}
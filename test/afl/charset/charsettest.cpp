@@ -6,6 +6,10 @@
 #include "afl/charset/charset.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/charset/transcoder.hpp"
+#include "afl/string/string.hpp"
+
 AFL_TEST("afl.charset.Charset:types", a)
 {
     afl::charset::Charset* cs = 0;
@@ -26,3 +30,55 @@ AFL_TEST_NOARG("afl.charset.Charset:interface")
     };
     Tester t;
 }
+
+/** Test default implementation of createEncoder(), createDecoder(). */
+AFL_TEST("afl.charset.Charset:stream", a)
+{
+    // Charset that upper-cases on encode, lower-cases on decode
+    class Tester : public afl::charset::Charset {
+     public:
+        virtual afl::base::GrowableBytes_t encode(afl::string::ConstStringMemory_t in)
+            {
+                afl::base::GrowableBytes_t result;
+                result.append(afl::string::toBytes(afl::string::strUCase(afl::string::fromMemory(in))));
+                return result;
+            }
+        virtual String_t decode(afl::base::ConstBytes_t in)
+            { return afl::string::strLCase(afl::string::fromBytes(in)); }
+        Tester* clone() const
+            { return new Tester(); }
+    };
+    std::auto_ptr<afl::charset::Transcoder> enc(Tester().createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(Tester().createDecoder());
+    uint8_t buffer[3];
+
+    // Encoder collects input until flush
+    afl::base::ConstBytes_t in = afl::string::toBytes("hello");
+    afl::base::Bytes_t out(buffer);
+    enc->transcode(in, out);
+    a.checkEqual("01. in", in.size(), 0U);
+    a.checkEqual("02. out", out.size(), 0U);
+
+    enc->flush();
+    out = buffer;
+    enc->transcode(in, out);
+    a.checkEqual("11. out", afl::string::fromBytes(out), "HEL");
+    out = buffer;
+    enc->transcode(in, out);
+    a.checkEqual("12. out", afl::string::fromBytes(out), "LO");
+    out = buffer;
+    enc->transcode(in, out);
+    a.checkEqual("13. out", out.size(), 0U);
+
+    // Decoder
+    in = afl::string::toBytes("WoRlD");
+    out = buffer;
+    dec->transcode(in, out);
+    dec->flush();
+    out = buffer;
+    dec->transcode(in, out);
+    a.checkEqual("21. out", afl::string::fromBytes(out), "wor");
+    out = buffer;
+    dec->transcode(in, out);
+    a.checkEqual("22. out", afl::string::fromBytes(out), "ld");
+}
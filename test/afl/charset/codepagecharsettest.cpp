@@ -6,7 +6,13 @@
 #include "afl/charset/codepagecharset.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/base/countof.hpp"
 #include "afl/charset/codepage.hpp"
+#include "afl/charset/transcoder.hpp"
+#include "afl/charset/utf8.hpp"
+#include "afl/string/format.hpp"
+#include "test/afl/charset/transcodertest.hpp"
 
 /** Simple test. */
 AFL_TEST("afl.charset.CodepageCharset:encode+decode", a)
@@ -58,3 +64,104 @@ AFL_TEST("afl.charset.CodepageCharset:clone", a)
     a.checkEqual("13", testee.decode(afl::string::toBytes("\xFF")), "\xC2\xA0");   // U+00A0, nbsp
     a.checkEqual("14", result->decode(afl::string::toBytes("\xFF")), "\xC2\xA0");   // U+00A0, nbsp
 }
+
+/** Test all codepages against a straightforward implementation. */
+AFL_TEST("afl.charset.CodepageCharset:all", a)
+{
+    static const afl::charset::Codepage*const CODEPAGES[] = {
+        &afl::charset::g_codepage1250,
+        &afl::charset::g_codepage1251,
+        &afl::charset::g_codepage1252,
+        &afl::charset::g_codepage437,
+        &afl::charset::g_codepage850,
+        &afl::charset::g_codepage852,
+        &afl::charset::g_codepage866,
+        &afl::charset::g_codepageKOI8R,
+        &afl::charset::g_codepageLatin1,
+        &afl::charset::g_codepageLatin2,
+    };
+    for (size_t cp = 0; cp < countof(CODEPAGES); ++cp) {
+        afl::test::Assert me(a(afl::string::Format("codepage %d", cp)));
+        afl::charset::CodepageCharset testee(*CODEPAGES[cp]);
+
+        // Decode: all bytes, with and without ASCII runs
+        String_t bytes, expectText;
+        afl::charset::Utf8 u8(0);
+        for (size_t i = 0; i < 256; ++i) {
+            const afl::charset::Unichar_t ch = (i < 0x80 ? afl::charset::Unichar_t(i) : CODEPAGES[cp]->m_characters[i - 0x80]);
+            bytes += char(i);
+            u8.append(expectText, ch);
+            if (i % 3 == 0) {
+                bytes += "0123456789";
+                expectText += "0123456789";
+            }
+        }
+        me.checkEqual("decode", testee.decode(afl::string::toBytes(bytes)), expectText);
+
+        // Encode: BMP characters up to U+2FFF and some invalid sequences
+        String_t text, expectBytes;
+        for (afl::charset::Unichar_t ch = 1; ch < 0x3000; ++ch) {
+            u8.append(text, ch);
+            if (ch < 0x80) {
+                expectBytes += char(ch);
+            } else {
+                for (size_t i = 0; i < 128; ++i) {
+                    if (CODEPAGES[cp]->m_characters[i] == ch) {
+                        expectBytes += char(0x80 + i);
+                        break;
+                    }
+                }
+            }
+        }
+        text += "\x80x\xC3";
+        expectBytes += "x";
+        me.checkEqual("encode", afl::string::fromBytes(testee.encode(afl::string::toMemory(text))), expectBytes);
+    }
+}
+
+/** Test streaming encoder/decoder against encode()/decode(), using different buffer sizes. */
+AFL_TEST("afl.charset.CodepageCharset:stream", a)
+{
+    afl::charset::CodepageCharset testee(afl::charset::g_codepage437);
+
+    // Text: valid and invalid UTF-8, including split and truncated sequences
+    String_t text;
+    afl::charset::Utf8 u8(0);
+    for (afl::charset::Unichar_t ch = 0x20; ch < 0x2600; ++ch) {
+        u8.append(text, ch);
+        if (ch % 50 == 0) {
+            text += "\xE2\x94";         // truncated 3-byte sequence
+        }
+        if (ch % 110 == 0) {
+            text += "\xF4\x80\x80\x80"; // 4-byte sequence
+        }
+        if (ch % 130 == 0) {
+            text += "\xC3";             // truncated 2-byte sequence
+        }
+    }
+    text += "\xE2\x94";
+    const String_t expectBytes = afl::string::fromBytes(testee.encode(afl::string::toMemory(text)));
+    const String_t expectText = testee.decode(afl::string::toBytes(expectBytes));
+    a.check("encoded", expectBytes.size() > 200);
+
+    std::auto_ptr<afl::charset::Transcoder> enc(testee.createEncoder());
+    checkTranscoder(a("encode"), *enc, afl::string::toBytes(text), expectBytes);
+
+    std::auto_ptr<afl::charset::Transcoder> dec(testee.createDecoder());
+    checkTranscoder(a("decode"), *dec, afl::string::toBytes(expectBytes), expectText);
+
+    checkTranscoder(a("encode partial"), *enc, afl::string::toBytes("\xC3\x87x\xC3"), "\x80x");
+    checkTranscoder(a("decode short"), *dec, afl::string::toBytes("\x80x"), "\xC3\x87x");
+}
+
+/** Test that transcoders survive their charset. */
+AFL_TEST("afl.charset.CodepageCharset:stream:lifetime", a)
+{
+    std::auto_ptr<afl::charset::CodepageCharset> cs(new afl::charset::CodepageCharset(afl::charset::g_codepage437));
+    std::auto_ptr<afl::charset::Transcoder> enc(cs->createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(cs->createDecoder());
+    cs.reset();
+
+    a.checkEqual("encode", runTranscoder(*enc, afl::string::toBytes("a\xC3\x87z"), 100, 100), "a\x80z");
+    a.checkEqual("decode", runTranscoder(*dec, afl::string::toBytes("a\x80z"), 100, 100), "a\xC3\x87z");
+}
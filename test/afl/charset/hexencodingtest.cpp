@@ -6,7 +6,11 @@
 #include "afl/charset/hexencoding.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/base/countof.hpp"
+#include "afl/charset/transcoder.hpp"
 #include "afl/string/hex.hpp"
+#include "test/afl/charset/transcodertest.hpp"
 
 // Standard constructor
 AFL_TEST("afl.charset.HexEncoding:default", a)
@@ -38,3 +42,24 @@ AFL_TEST("afl.charset.HexEncoding:specific", a)
     a.checkEqual("12", afl::string::fromBytes(clone->encode(afl::string::toMemory("aB?"))), "61423f");
     a.checkEqual("13", clone->decode(afl::string::toBytes("61423f")), "aB?");
 }
+
+/** Test streaming, using different buffer sizes. */
+AFL_TEST("afl.charset.HexEncoding:stream", a)
+{
+    afl::charset::HexEncoding testee;
+    String_t data;
+    for (size_t i = 0; i < 500; ++i) {
+        data += char((i * 37) ^ (i >> 3));
+    }
+    const String_t encoded = afl::string::fromBytes(testee.encode(afl::string::toMemory(data)));
+
+    std::auto_ptr<afl::charset::Transcoder> enc(testee.createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(testee.createDecoder());
+    checkTranscoder(a("encode"), *enc, afl::string::toBytes(data), encoded);
+    checkTranscoder(a("decode"), *dec, afl::string::toBytes(encoded), data);
+
+    static const char*const DECODE_CASES[] = { "", "6", "61", "614", "61 42 3f", "6x42", "x6142", "61423" };
+    for (size_t c = 0; c < countof(DECODE_CASES); ++c) {
+        checkTranscoder(a("decode short")(DECODE_CASES[c]), *dec, afl::string::toBytes(DECODE_CASES[c]), testee.decode(afl::string::toBytes(DECODE_CASES[c])));
+    }
+}
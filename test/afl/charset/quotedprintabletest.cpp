@@ -6,6 +6,11 @@
 #include "afl/charset/quotedprintable.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/base/countof.hpp"
+#include "afl/charset/transcoder.hpp"
+#include "test/afl/charset/transcodertest.hpp"
+
 AFL_TEST("afl.charset.QuotedPrintable:encode+decode", a)
 {
     afl::charset::QuotedPrintable qp;
@@ -53,3 +58,24 @@ AFL_TEST("afl.charset.QuotedPrintable:clone", a)
     a.checkNonNull("result", result.get());
     a.checkNonNull("type", dynamic_cast<afl::charset::QuotedPrintable*>(result.get()));
 }
+
+/** Test streaming, using different buffer sizes. */
+AFL_TEST("afl.charset.QuotedPrintable:stream", a)
+{
+    afl::charset::QuotedPrintable testee;
+    String_t data;
+    for (size_t i = 0; i < 500; ++i) {
+        data += char((i * 37) ^ (i >> 3));
+    }
+    const String_t encoded = afl::string::fromBytes(testee.encode(afl::string::toMemory(data)));
+
+    std::auto_ptr<afl::charset::Transcoder> enc(testee.createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(testee.createDecoder());
+    checkTranscoder(a("encode"), *enc, afl::string::toBytes(data), encoded);
+    checkTranscoder(a("decode"), *dec, afl::string::toBytes(encoded), data);
+
+    static const char*const DECODE_CASES[] = { "", "=", "=1", "=3D", "a=3", "=XY", "=3X", "==33", "====33", "a=AA=BBx", "x=" };
+    for (size_t c = 0; c < countof(DECODE_CASES); ++c) {
+        checkTranscoder(a("decode short")(DECODE_CASES[c]), *dec, afl::string::toBytes(DECODE_CASES[c]), testee.decode(afl::string::toBytes(DECODE_CASES[c])));
+    }
+}
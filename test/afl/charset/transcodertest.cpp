@@ -0,0 +1,60 @@
+/**
+  *  \file test/afl/charset/transcodertest.cpp
+  *  \brief Test for afl::charset::Transcoder
+  */
+
+#include "afl/charset/transcoder.hpp"
+#include "test/afl/charset/transcodertest.hpp"
+#include "afl/test/testrunner.hpp"
+
+#include "afl/base/countof.hpp"
+#include "afl/string/format.hpp"
+
+String_t
+runTranscoder(afl::charset::Transcoder& tc, afl::base::ConstBytes_t in, size_t inSize, size_t outSize)
+{
+    String_t result;
+    uint8_t buffer[256];
+    bool flushed = false;
+    afl::base::ConstBytes_t piece;
+    while (1) {
+        if (piece.empty() && !flushed) {
+            piece = in.split(inSize);
+            if (piece.empty()) {
+                tc.flush();
+                flushed = true;
+            }
+        }
+        afl::base::Bytes_t out(buffer);
+        out.trim(outSize);
+        tc.transcode(piece, out);
+        result.append(reinterpret_cast<const char*>(out.unsafeData()), out.size());
+        if (flushed && out.empty()) {
+            break;
+        }
+    }
+    return result;
+}
+
+void
+checkTranscoder(afl::test::Assert a, afl::charset::Transcoder& tc, afl::base::ConstBytes_t in, const String_t& expected)
+{
+    static const size_t SIZES[] = { 1, 2, 3, 4, 5, 7, 64, 100, 256 };
+    for (size_t i = 0; i < countof(SIZES); ++i) {
+        for (size_t o = 0; o < countof(SIZES); ++o) {
+            a(afl::string::Format("in %d, out %d", SIZES[i], SIZES[o])).checkEqual("result", runTranscoder(tc, in, SIZES[i], SIZES[o]), expected);
+        }
+    }
+}
+
+AFL_TEST_NOARG("afl.charset.Transcoder:interface")
+{
+    class Tester : public afl::charset::Transcoder {
+     public:
+        virtual void transcode(afl::base::ConstBytes_t& /*in*/, afl::base::Bytes_t& /*out*/)
+            { }
+        virtual void flush()
+            { }
+    };
+    Tester t;
+}
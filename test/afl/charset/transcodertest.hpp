@@ -0,0 +1,31 @@
+/**
+  *  \file test/afl/charset/transcodertest.hpp
+  *  \brief Test helpers for afl::charset::Transcoder
+  */
+#ifndef AFL_TEST_AFL_CHARSET_TRANSCODERTEST_HPP
+#define AFL_TEST_AFL_CHARSET_TRANSCODERTEST_HPP
+
+#include "afl/base/memory.hpp"
+#include "afl/charset/transcoder.hpp"
+#include "afl/string/string.hpp"
+#include "afl/test/assert.hpp"
+
+/** Run a Transcoder on the given input.
+    Feeds it input in pieces of inSize bytes, retrieves output in pieces of outSize bytes, and finally flushes it.
+    \param tc      Transcoder
+    \param in      Input
+    \param inSize  Input piece size (nonzero)
+    \param outSize Output piece size (nonzero, at most 256)
+    \return output */
+String_t runTranscoder(afl::charset::Transcoder& tc, afl::base::ConstBytes_t in, size_t inSize, size_t outSize);
+
+/** Check a Transcoder using different buffer sizes.
+    Runs the transcoder on the given input using all combinations of input and output piece sizes,
+    re-using it after each flush, and verifies that it always produces the expected result.
+    \param a        Asserter
+    \param tc       Transcoder
+    \param in       Input
+    \param expected Expected output */
+void checkTranscoder(afl::test::Assert a, afl::charset::Transcoder& tc, afl::base::ConstBytes_t in, const String_t& expected);
+
+#endif
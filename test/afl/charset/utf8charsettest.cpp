@@ -6,6 +6,9 @@
 #include "afl/charset/utf8charset.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include <memory>
+#include "afl/charset/transcoder.hpp"
+
 AFL_TEST("afl.charset.Utf8Charset:decode+encode", a)
 {
     afl::charset::Utf8Charset u8cs;
@@ -24,3 +27,29 @@ AFL_TEST("afl.charset.Utf8Charset:clone", a)
     a.checkNonNull("result", result.get());
     a.checkNonNull("type", dynamic_cast<afl::charset::Utf8Charset*>(result.get()));
 }
+
+AFL_TEST("afl.charset.Utf8Charset:stream", a)
+{
+    afl::charset::Utf8Charset testee;
+    std::auto_ptr<afl::charset::Transcoder> enc(testee.createEncoder());
+    std::auto_ptr<afl::charset::Transcoder> dec(testee.createDecoder());
+
+    // Data is copied unchanged, as far as buffer space permits
+    uint8_t buffer[4];
+    afl::base::ConstBytes_t in = afl::string::toBytes("f\xc2\x90xyz");
+    afl::base::Bytes_t out(buffer);
+    enc->transcode(in, out);
+    a.checkEqual("01. in", in.size(), 2U);
+    a.checkEqual("02. out", afl::string::fromBytes(out), "f\xc2\x90x");
+
+    out = buffer;
+    dec->transcode(in, out);
+    a.checkEqual("11. in", in.size(), 0U);
+    a.checkEqual("12. out", afl::string::fromBytes(out), "yz");
+
+    // Nothing pending after flush
+    enc->flush();
+    out = buffer;
+    enc->transcode(in, out);
+    a.checkEqual("21. out", out.size(), 0U);
+}
@@ -5,7 +5,9 @@
 
 #include "afl/charset/utf8.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <vector>
 #include "afl/charset/unicode.hpp"
 #include "afl/charset/utf8reader.hpp"
 #include "afl/string/string.hpp"
@@ -332,3 +334,130 @@ AFL_TEST("afl.charset.Utf8:surrogate", a)
         a.checkEqual("22", u8s.charAt("\xED\xAF\xBF\xED\xBF\xBF", 0), 0x10FFFFU);
     }
 }
+
+/** Test isValid(). Each sequence is tested at different positions to exercise block boundaries. */
+AFL_TEST("afl.charset.Utf8:isValid", a)
+{
+    static const char*const VALID[] = {
+        "a", "\xC2\x80", "\xC3\xA9", "\xDF\xBF", "\xE0\xA0\x80", "\xE2\x82\xAC", "\xED\x9F\xBF", "\xEE\x80\x80",
+        "\xEF\xBF\xBF", "\xF0\x90\x80\x80", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF",
+    };
+    static const char*const INVALID[] = {
+        "\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF",
+        "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF8\x88\x80\x80\x80", "\xFE", "\xFF",
+        "\xC3", "\xE2\x82", "\xF0\x9F\x98", "\xC3\xA9\x80", "\xE2\x82\xAC\xAC", "\xC3" "a",
+    };
+    for (size_t pad = 0; pad < 70; ++pad) {
+        for (size_t i = 0; i < sizeof(VALID)/sizeof(VALID[0]); ++i) {
+            String_t s = String_t(pad, 'x') + VALID[i];
+            a(VALID[i]).check("valid", Utf8::isValid(afl::string::toBytes(s)));
+            a(VALID[i]).check("valid 2", Utf8::isValid(afl::string::toBytes(s + "\xC3\xA9" + s)));
+        }
+        for (size_t i = 0; i < sizeof(INVALID)/sizeof(INVALID[0]); ++i) {
+            String_t s = String_t(pad, 'x') + INVALID[i];
+            a(INVALID[i]).check("invalid", !Utf8::isValid(afl::string::toBytes(s)));
+            a(INVALID[i]).check("invalid 2", !Utf8::isValid(afl::string::toBytes(s + String_t(pad, 'x'))));
+        }
+    }
+    a.check("empty", Utf8::isValid(afl::base::ConstBytes_t()));
+}
+
+/** Test findNonAscii(). */
+AFL_TEST("afl.charset.Utf8:findNonAscii", a)
+{
+    for (size_t pos = 0; pos < 100; ++pos) {
+        String_t s(100, 'x');
+        a.checkEqual("none", Utf8::findNonAscii(afl::string::toBytes(s.substr(0, pos))), pos);
+        s[pos] = '\x80';
+        a.checkEqual("found", Utf8::findNonAscii(afl::string::toBytes(s)), pos);
+        s[99] = '\xFF';
+        a.checkEqual("found 2", Utf8::findNonAscii(afl::string::toBytes(s)), pos);
+    }
+}
+
+/** Test bulk functions against Utf8Reader, using all flag combinations and text that mixes valid and invalid runes. */
+AFL_TEST("afl.charset.Utf8:bulk", a)
+{
+    static const char*const FRAGMENTS[] = {
+        "hello, world ", "\xC3\xA4\xC3\xB6\xC3\xBC", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+        "\xED\xA0\x80\xED\xB0\x80",             // surrogate pair (CESU-8)
+        "\xED\xB0\x80",                         // low surrogate
+        "\xEF\xBF\xBE", "\xF0\x9F\xBF\xBF",     // non-characters
+        "\xEE\xBE\x80",                         // error character
+        "\xC0\x80", "\xE0\x80\x80",             // overlong
+        "\x80\xBF", "\xC3", "\xFF", "\xF8\x88\x80\x80\x80",
+    };
+    static const uint32_t FLAGS[] = {
+        0, Utf8::AllowEncodedZero, Utf8::AllowSurrogates, Utf8::AllowNonMinimal, Utf8::AllowNonCharacters, Utf8::AllowErrorEscapes,
+        Utf8::AllowSurrogates | Utf8::AllowNonCharacters,
+        Utf8::AllowEncodedZero | Utf8::AllowSurrogates | Utf8::AllowNonMinimal | Utf8::AllowNonCharacters | Utf8::AllowErrorEscapes,
+    };
+
+    uint32_t seed = 1;
+    for (size_t iter = 0; iter < 200; ++iter) {
+        // Build text. Mostly valid with long stretches, so that chunks are processed both ways.
+        String_t text;
+        size_t numFragments = iter % 50 + 1;
+        for (size_t i = 0; i < numFragments; ++i) {
+            seed = seed * 1103515245 + 12345;
+            size_t k = (seed >> 16) % 40;
+            text += FRAGMENTS[k < sizeof(FRAGMENTS)/sizeof(FRAGMENTS[0]) ? k : k % 4];
+        }
+
+        for (size_t f = 0; f < sizeof(FLAGS)/sizeof(FLAGS[0]); ++f) {
+            afl::test::Assert me(a(text));
+            Utf8 u8(FLAGS[f]);
+
+            // Reference
+            std::vector<Unichar_t> runes;
+            std::vector<size_t> pos;
+            Utf8Reader rdr(afl::string::toBytes(text), FLAGS[f]);
+            while (rdr.hasMore()) {
+                pos.push_back(text.size() - rdr.getRemainder().size());
+                runes.push_back(rdr.eat());
+            }
+            pos.push_back(text.size());
+
+            // length
+            me.checkEqual("length", u8.length(text), runes.size());
+
+            // decodeUtf32
+            afl::base::GrowableMemory<Unichar_t> u32;
+            u32.append(99);
+            u8.decodeUtf32(afl::string::toBytes(text), u32);
+            me.checkEqual("decodeUtf32 size", u32.size(), runes.size() + 1);
+            for (size_t i = 0; i < runes.size() && i+1 < u32.size(); ++i) {
+                me.checkEqual("decodeUtf32", *u32.at(i+1), runes[i]);
+            }
+
+            // decodeUtf16
+            afl::base::GrowableMemory<uint16_t> u16;
+            u8.decodeUtf16(afl::string::toBytes(text), u16);
+            size_t n16 = 0;
+            for (size_t i = 0; i < runes.size(); ++i) {
+                Unichar_t ch = runes[i];
+                if (ch > afl::charset::UNICODE_MAX) {
+                    ch = 0xFFFD;
+                }
+                if (ch > 0xFFFF) {
+                    me.checkEqual("decodeUtf16 high", *u16.at(n16++), 0xD800 + ((ch - 0x10000) >> 10));
+                    me.checkEqual("decodeUtf16 low", *u16.at(n16++), 0xDC00 + (ch & 0x3FF));
+                } else {
+                    me.checkEqual("decodeUtf16", *u16.at(n16++), ch);
+                }
+            }
+            me.checkEqual("decodeUtf16 size", u16.size(), n16);
+
+            // Position conversions, charAt
+            for (size_t i = 0; i < runes.size(); i += 7) {
+                me.checkEqual("charToBytePos", u8.charToBytePos(text, i), pos[i]);
+                me.checkEqual("charAt", u8.charAt(text, i), runes[i]);
+                me.checkEqual("byteToCharPos", u8.byteToCharPos(text, pos[i]), i);
+                if (pos[i+1] > pos[i] + 1) {
+                    me.checkEqual("byteToCharPos mid", u8.byteToCharPos(text, pos[i] + 1), i+1);
+                }
+                me.checkEqual("substr", u8.substr(text, i, 5), text.substr(pos[i], pos[std::min(i+5, runes.size())] - pos[i]));
+            }
+        }
+    }
+}
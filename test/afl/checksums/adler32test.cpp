@@ -38,6 +38,27 @@ AFL_TEST("afl.checksums.Adler32", a)
     }
 }
 
+/** Test larger blocks, verified against zlib. */
+AFL_TEST("afl.checksums.Adler32:large", a)
+{
+    typedef afl::checksums::Checksum::Memory_t Memory_t;
+    afl::checksums::Adler32 t;
+
+    // Worst case for overflow: all 0xFF, with maximum start value
+    static uint8_t ones[100000];
+    for (size_t i = 0; i < sizeof(ones); ++i) {
+        ones[i] = 0xFF;
+    }
+    a.checkEqual("ones", t.add(Memory_t(ones), 0xFFF0FFF0), 0x072C302AU);
+
+    // Pattern
+    static uint8_t pattern[100000];
+    for (size_t i = 0; i < sizeof(pattern); ++i) {
+        pattern[i] = uint8_t(i*7 + (i >> 8));
+    }
+    a.checkEqual("pattern", t.add(Memory_t(pattern), 1), 0xD43B9AEFU);
+}
+
 /** Test using the interface. */
 AFL_TEST("afl.checksums.Adler32:interface", a)
 {
@@ -54,3 +75,29 @@ AFL_TEST("afl.checksums.Adler32:interface", a)
     // Inquiry
     a.checkEqual("bits", t->bits(), 32U);
 }
+
+/** Test all sizes up to a few chunks, comparing against a bytewise reference implementation.
+    This exercises the transitions between the vectorized and the portable path. */
+AFL_TEST("afl.checksums.Adler32:sizes", a)
+{
+    typedef afl::checksums::Checksum::Memory_t Memory_t;
+    afl::checksums::Adler32 t;
+
+    uint8_t bytes[300];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = uint8_t(255 - ((i * 37) & 15));
+    }
+
+    for (size_t start = 0; start < 3; ++start) {
+        uint32_t s1 = 65000, s2 = 65500;
+        for (size_t len = 0; start + len <= sizeof(bytes); ++len) {
+            a.checkEqual("adler", t.add(Memory_t(bytes).subrange(start, len), 0xFFDCFDE8), (s2 << 16) | s1);
+
+            // Advance reference by one byte
+            if (start + len < sizeof(bytes)) {
+                s1 = (s1 + bytes[start + len]) % 65521;
+                s2 = (s2 + s1) % 65521;
+            }
+        }
+    }
+}
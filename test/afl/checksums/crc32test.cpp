@@ -58,3 +58,94 @@ AFL_TEST("afl.checksums.CRC32:interface", a)
     // Inquiry
     a.checkEqual("bits", t->bits(), 32U);
 }
+
+/** Test larger data, exercising the multi-byte path with all alignments. */
+AFL_TEST("afl.checksums.CRC32:large", a)
+{
+    typedef afl::checksums::Checksum::Memory_t Memory_t;
+    const afl::checksums::CRC32& t = afl::checksums::CRC32::getDefaultInstance();
+
+    uint8_t bytes[1000];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = uint8_t(i * 7 + (i >> 8));
+    }
+
+    // Value verified against zlib
+    a.checkEqual("whole", t.add(Memory_t(bytes), 0), 0x668F073DU);
+
+    // Byte-by-byte
+    uint32_t crc = 0;
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        crc = t.add(Memory_t(bytes).subrange(i, 1), crc);
+    }
+    a.checkEqual("bytewise", crc, 0x668F073DU);
+
+    // Unaligned
+    for (size_t i = 1; i < 8; ++i) {
+        a.checkEqual("unaligned", t.add(Memory_t(bytes).subrange(i), t.add(Memory_t(bytes).subrange(0, i), 0)), 0x668F073DU);
+    }
+}
+
+/** Test all sizes up to a few blocks, comparing against a bitwise reference implementation.
+    This exercises the transitions between the accelerated and the table-driven path. */
+AFL_TEST("afl.checksums.CRC32:sizes", a)
+{
+    typedef afl::checksums::Checksum::Memory_t Memory_t;
+    const afl::checksums::CRC32& t = afl::checksums::CRC32::getDefaultInstance();
+
+    uint8_t bytes[400];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = uint8_t((i * 131) ^ (i >> 3));
+    }
+
+    for (size_t start = 0; start < 3; ++start) {
+        uint32_t reference = 0xFFFFFFFF;
+        for (size_t len = 0; start + len <= sizeof(bytes); ++len) {
+            a.checkEqual("crc", t.add(Memory_t(bytes).subrange(start, len), 0), ~reference);
+
+            // Advance reference by one byte
+            if (start + len < sizeof(bytes)) {
+                reference ^= bytes[start + len];
+                for (int bit = 0; bit < 8; ++bit) {
+                    reference = (reference & 1) ? 0xEDB88320 ^ (reference >> 1) : (reference >> 1);
+                }
+            }
+        }
+    }
+}
+
+/** Test combine(). */
+AFL_TEST("afl.checksums.CRC32:combine", a)
+{
+    typedef afl::checksums::Checksum::Memory_t Memory_t;
+
+    uint8_t bytes[300];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = uint8_t(i ^ 0x55);
+    }
+
+    // Default polynomial and a different one (CRC-32C)
+    afl::checksums::CRC32 castagnoli(0x82F63B78);
+    const afl::checksums::CRC32* polys[] = { &afl::checksums::CRC32::getDefaultInstance(), &castagnoli };
+    for (size_t p = 0; p < sizeof(polys)/sizeof(polys[0]); ++p) {
+        const afl::checksums::CRC32& t = *polys[p];
+        const uint32_t whole = t.add(Memory_t(bytes), 0);
+        for (size_t i = 0; i <= sizeof(bytes); ++i) {
+            Memory_t secondHalf(bytes);
+            Memory_t firstHalf(secondHalf.split(i));
+            a.checkEqual("combine", t.combine(t.add(firstHalf, 0), t.add(secondHalf, 0), secondHalf.size()), whole);
+        }
+    }
+
+    // Appending many zero bytes
+    const afl::checksums::CRC32& t = afl::checksums::CRC32::getDefaultInstance();
+    uint8_t hi[2] = { 'h', 'i' };
+    const uint32_t hiCrc = t.add(Memory_t(hi), 0);
+    static uint8_t zeroes[100000];
+    a.checkEqual("zeroes", t.combine(hiCrc, t.add(Memory_t(zeroes), 0), sizeof(zeroes)), t.add(Memory_t(zeroes), hiCrc));
+    a.checkEqual("zero length", t.combine(hiCrc, 0, 0), hiCrc);
+
+    // Lengths beyond 32 bits are consistent
+    const uint64_t half = uint64_t(1) << 31;
+    a.checkEqual("long", t.combine(t.combine(hiCrc, 0, half), 0, half), t.combine(hiCrc, 0, 2*half));
+}
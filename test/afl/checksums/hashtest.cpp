@@ -4,10 +4,42 @@
   */
 
 #include "afl/checksums/hash.hpp"
+#include "test/afl/checksums/hashtest.hpp"
+#include "afl/except/unsupportedexception.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include "afl/base/countof.hpp"
 #include "afl/string/string.hpp"
 
+void
+checkHashChunks(afl::test::Assert a, afl::checksums::Hash& h, const char* expected)
+{
+    // Buffer, offset by one byte so data is not aligned
+    uint8_t buffer[100001];
+    for (size_t i = 0; i < 100000; ++i) {
+        buffer[i+1] = uint8_t((i*31) ^ (i >> 9));
+    }
+    const afl::base::ConstBytes_t data = afl::base::ConstBytes_t(buffer).subrange(1);
+
+    // Whole
+    h.clear();
+    h.add(data);
+    a.checkEqual("whole", h.getHashAsHexString(), expected);
+
+    // Chunks
+    static const size_t SIZES[] = { 1, 63, 64, 65, 200, 1000, 4096 };
+    for (size_t i = 0; i < countof(SIZES); ++i) {
+        h.clear();
+        afl::base::ConstBytes_t remaining = data;
+        size_t n = 0;
+        while (!remaining.empty()) {
+            h.add(remaining.split(SIZES[(i + n) % countof(SIZES)]));
+            ++n;
+        }
+        a.checkEqual("chunks", h.getHashAsHexString(), expected);
+    }
+}
+
 AFL_TEST("afl.checksums.Hash", a)
 {
     /* This is an interface, so we instantiate it and check whether it works the way it's intented.
@@ -67,4 +99,21 @@ AFL_TEST("afl.checksums.Hash", a)
     //   therefore outer hash = 0x5D+0x5E+62*0x5C + 0x86 = 0x89
     expected[0] = 0x89;
     a.check("getHash 3", tt.getHash(data).equalContent(expected));
+
+    // clone() and assign() are not implemented
+    AFL_CHECK_THROWS(a("clone"), tt.clone(), afl::except::UnsupportedException);
+    AFL_CHECK_THROWS(a("assign"), tt.assign(Tester()), afl::except::UnsupportedException);
+
+    // PBKDF2 nevertheless works: two iterations are HMAC(key, salt + INT(1)) ^ HMAC(key, HMAC(key, salt + INT(1)))
+    uint8_t pbkdf2[1];
+    tt.computePBKDF2(pbkdf2, key, value, 2);
+
+    const uint8_t saltAndIndex[] = {3,4,0,0,0,1};
+    uint8_t u1[1], u2[1];
+    tt.computeHMAC(key, saltAndIndex);
+    tt.getHash(u1);
+    tt.computeHMAC(key, u1);
+    tt.getHash(u2);
+    expected[0] = uint8_t(u1[0] ^ u2[0]);
+    a.check("computePBKDF2", afl::base::ConstBytes_t(pbkdf2).equalContent(expected));
 }
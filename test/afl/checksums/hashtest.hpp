@@ -0,0 +1,19 @@
+/**
+  *  \file test/afl/checksums/hashtest.hpp
+  *  \brief Test helpers for afl::checksums::Hash
+  */
+#ifndef AFL_TEST_AFL_CHECKSUMS_HASHTEST_HPP
+#define AFL_TEST_AFL_CHECKSUMS_HASHTEST_HPP
+
+#include "afl/checksums/hash.hpp"
+#include "afl/test/assert.hpp"
+
+/** Test hashing a large, unaligned buffer in chunks of varying size.
+    Hashes 100000 bytes of generated data, starting at an odd address, as a whole and in chunks.
+    This exercises partial blocks, whole blocks processed directly from the input, and the accelerated code path if available.
+    \param a        Asserter
+    \param h        Hash. Will be cleared.
+    \param expected Expected hash, as hex string */
+void checkHashChunks(afl::test::Assert a, afl::checksums::Hash& h, const char* expected);
+
+#endif
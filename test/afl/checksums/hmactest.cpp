@@ -0,0 +1,82 @@
+/**
+  *  \file test/afl/checksums/hmactest.cpp
+  *  \brief Test for afl::checksums::HMAC
+  */
+
+#include "afl/checksums/hmac.hpp"
+
+#include "afl/checksums/sha1.hpp"
+#include "afl/checksums/sha256.hpp"
+#include "afl/except/unsupportedexception.hpp"
+#include "afl/string/hex.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::checksums::HMAC;
+using afl::checksums::SHA256;
+
+namespace {
+    String_t toHex(afl::base::ConstBytes_t data)
+    {
+        String_t result;
+        while (const uint8_t* p = data.eat()) {
+            afl::string::putHexByte(result, *p, afl::string::HEX_DIGITS_LOWER);
+        }
+        return result;
+    }
+}
+
+/** Test HMAC-SHA256 with examples from RFC 4231. */
+AFL_TEST("afl.checksums.HMAC:sha256", a)
+{
+    uint8_t out[SHA256::HASH_SIZE];
+
+    // Key can be used multiple times
+    HMAC testee(SHA256(), afl::string::toBytes("Jefe"));
+    a.checkEqual("getHashSize", testee.getHashSize(), SHA256::HASH_SIZE);
+    a.checkEqual("case 2", toHex(testee.compute(afl::string::toBytes("what do ya want for nothing?"), out)),
+                 "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    a.checkEqual("empty", toHex(testee.compute(afl::base::Nothing, out)),
+                 "923598ca6d64af2a5dba79dcd021a8a0fe5c5f557519adaaf0ad532d4506dd30");
+    a.checkEqual("case 2 again", toHex(testee.compute(afl::string::toBytes("what do ya want for nothing?"), out)),
+                 "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+    // Key larger than block size
+    uint8_t key[131];
+    afl::base::Bytes_t(key).fill(0xAA);
+    HMAC longKey(SHA256(), key);
+    a.checkEqual("case 6", toHex(longKey.compute(afl::string::toBytes("Test Using Larger Than Block-Size Key - Hash Key First"), out)),
+                 "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+/** Test that the hash's state does not matter. */
+AFL_TEST("afl.checksums.HMAC:hash-state", a)
+{
+    SHA256 hash;
+    hash.add(afl::string::toBytes("garbage"));
+    const String_t before = hash.getHashAsHexString();
+
+    uint8_t out[SHA256::HASH_SIZE];
+    HMAC testee(hash, afl::string::toBytes("Jefe"));
+    a.checkEqual("result", toHex(testee.compute(afl::string::toBytes("what do ya want for nothing?"), out)),
+                 "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    a.checkEqual("hash unchanged", hash.getHashAsHexString(), before);
+}
+
+/** Test compute() with working hash. */
+AFL_TEST("afl.checksums.HMAC:work", a)
+{
+    uint8_t out[SHA256::HASH_SIZE];
+    HMAC testee(SHA256(), afl::string::toBytes("Jefe"));
+    std::auto_ptr<afl::checksums::Hash> work(testee.createWorkHash());
+
+    // Working hash can be used repeatedly; its state does not matter
+    work->add(afl::string::toBytes("garbage"));
+    a.checkEqual("case 2", toHex(testee.compute(afl::string::toBytes("what do ya want for nothing?"), out, *work)),
+                 "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    a.checkEqual("empty", toHex(testee.compute(afl::base::Nothing, out, *work)),
+                 "923598ca6d64af2a5dba79dcd021a8a0fe5c5f557519adaaf0ad532d4506dd30");
+
+    // Working hash of wrong type is rejected
+    afl::checksums::SHA1 other;
+    AFL_CHECK_THROWS(a("wrong type"), testee.compute(afl::base::Nothing, out, other), afl::except::UnsupportedException);
+}
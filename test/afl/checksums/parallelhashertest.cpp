@@ -0,0 +1,205 @@
+/**
+  *  \file test/afl/checksums/parallelhashertest.cpp
+  *  \brief Test for afl::checksums::ParallelHasher
+  */
+
+#include "afl/checksums/parallelhasher.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include "afl/base/growablememory.hpp"
+#include "afl/checksums/sha256.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/filemapping.hpp"
+#include "afl/io/multiplexablestream.hpp"
+#include "afl/string/format.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+using afl::base::GrowableBytes_t;
+using afl::checksums::ParallelHasher;
+using afl::checksums::SHA256;
+using afl::io::ConstMemoryStream;
+
+namespace {
+    /* Generate test data */
+    void makeData(GrowableBytes_t& data, size_t n)
+    {
+        uint32_t seed = 1;
+        for (size_t i = 0; i < n; ++i) {
+            seed = seed * 1103515245 + 12345;
+            data.append(uint8_t(seed >> 16));
+        }
+    }
+
+    /* Non-seekable stream, delivering data in small pieces */
+    class PipeStream : public afl::io::MultiplexableStream {
+     public:
+        PipeStream(ConstBytes_t data)
+            : m_data(data)
+            { }
+        virtual size_t read(Bytes_t m)
+            { return m.copyFrom(m_data.split(std::min(m.size(), size_t(7)))).size(); }
+        virtual size_t write(ConstBytes_t /*m*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual void flush()
+            { }
+        virtual void setPos(FileSize_t /*pos*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual FileSize_t getPos()
+            { return 0; }
+        virtual FileSize_t getSize()
+            { return FileSize_t(-1); }
+        virtual uint32_t getCapabilities()
+            { return CanRead; }
+        virtual String_t getName()
+            { return "<pipe>"; }
+        virtual afl::base::Ptr<afl::io::FileMapping> createFileMapping(FileSize_t /*limit*/)
+            { return 0; }
+     private:
+        ConstBytes_t m_data;
+    };
+
+    /* Compute tree hash the straightforward way (RFC 6962 2.1) */
+    String_t treeHash(ConstBytes_t data, size_t chunkSize)
+    {
+        SHA256 h;
+        uint8_t digest[SHA256::HASH_SIZE];
+        if (data.size() <= chunkSize) {
+            static const uint8_t LEAF[] = { 0 };
+            h.add(LEAF);
+            h.add(data);
+        } else {
+            size_t k = chunkSize;
+            while (2*k < data.size()) {
+                k *= 2;
+            }
+            static const uint8_t NODE[] = { 1 };
+            h.add(NODE);
+            String_t left = treeHash(data.subrange(0, k), chunkSize);
+            String_t right = treeHash(data.subrange(k), chunkSize);
+            h.add(afl::string::toBytes(left));
+            h.add(afl::string::toBytes(right));
+        }
+        return afl::string::fromBytes(h.getHash(digest));
+    }
+
+    String_t toString(afl::base::Bytes_t data)
+    {
+        return afl::string::fromBytes(data);
+    }
+}
+
+/** Test computeHash(): result must be the same as hashing directly, for all thread counts and stream types. */
+AFL_TEST("afl.checksums.ParallelHasher:computeHash", a)
+{
+    GrowableBytes_t data;
+    makeData(data, 100000);
+
+    SHA256 expect;
+    expect.add(data);
+
+    static const size_t NUM_THREADS[] = { 0, 1, 3 };
+    for (size_t i = 0; i < sizeof(NUM_THREADS)/sizeof(NUM_THREADS[0]); ++i) {
+        ParallelHasher testee(NUM_THREADS[i], 4096);
+        SHA256 h;
+        h.add(afl::string::toBytes("garbage"));
+
+        ConstMemoryStream ms(data);
+        testee.computeHash(h, ms);
+        a.checkEqual("seekable", h.getHashAsHexString(), expect.getHashAsHexString());
+
+        PipeStream ps(data);
+        testee.computeHash(h, ps);
+        a.checkEqual("pipe", h.getHashAsHexString(), expect.getHashAsHexString());
+    }
+}
+
+/** Test computeHash() on a stream that is not at its beginning. */
+AFL_TEST("afl.checksums.ParallelHasher:computeHash:offset", a)
+{
+    GrowableBytes_t data;
+    makeData(data, 10000);
+
+    SHA256 expect;
+    expect.add(ConstBytes_t(data).subrange(1000));
+
+    ConstMemoryStream ms(data);
+    ms.setPos(1000);
+    SHA256 h;
+    ParallelHasher(2, 1000).computeHash(h, ms);
+    a.checkEqual("result", h.getHashAsHexString(), expect.getHashAsHexString());
+}
+
+/** Test computeTreeHash() against a straightforward implementation. */
+AFL_TEST("afl.checksums.ParallelHasher:computeTreeHash", a)
+{
+    GrowableBytes_t data;
+    makeData(data, 10000);
+
+    // Sizes covering single leaf, complete and incomplete trees
+    static const size_t SIZES[] = { 1, 99, 100, 101, 300, 400, 700, 10000 };
+    for (size_t i = 0; i < sizeof(SIZES)/sizeof(SIZES[0]); ++i) {
+        afl::test::Assert me(a(afl::string::Format("size %d", SIZES[i])));
+        ConstBytes_t content = ConstBytes_t(data).subrange(0, SIZES[i]);
+        const String_t expect = treeHash(content, 100);
+
+        uint8_t out[SHA256::HASH_SIZE];
+        ConstMemoryStream ms(content);
+        me.checkEqual("0 threads", toString(ParallelHasher(0, 100).computeTreeHash(SHA256(), ms, out)), expect);
+
+        ConstMemoryStream ms2(content);
+        me.checkEqual("3 threads", toString(ParallelHasher(3, 100).computeTreeHash(SHA256(), ms2, out)), expect);
+
+        PipeStream ps(content);
+        me.checkEqual("pipe", toString(ParallelHasher(2, 100).computeTreeHash(SHA256(), ps, out)), expect);
+    }
+
+    // Empty
+    uint8_t out[SHA256::HASH_SIZE];
+    ConstMemoryStream empty((ConstBytes_t()));
+    a.checkEqual("empty", toString(ParallelHasher(2, 100).computeTreeHash(SHA256(), empty, out)),
+                 afl::string::fromBytes(SHA256().getHash(out)));
+}
+
+/** Test computeCRC32(). */
+AFL_TEST("afl.checksums.ParallelHasher:computeCRC32", a)
+{
+    GrowableBytes_t data;
+    makeData(data, 100000);
+
+    const afl::checksums::CRC32& crc = afl::checksums::CRC32::getDefaultInstance();
+    const uint32_t expect = crc.add(data, 0);
+
+    static const size_t NUM_THREADS[] = { 0, 1, 3 };
+    for (size_t i = 0; i < sizeof(NUM_THREADS)/sizeof(NUM_THREADS[0]); ++i) {
+        ConstMemoryStream ms(data);
+        a.checkEqual("seekable", ParallelHasher(NUM_THREADS[i], 3000).computeCRC32(crc, ms), expect);
+
+        PipeStream ps(data);
+        a.checkEqual("pipe", ParallelHasher(NUM_THREADS[i], 3000).computeCRC32(crc, ps), expect);
+    }
+
+    // Previous value
+    ConstMemoryStream ms(ConstBytes_t(data).subrange(500));
+    a.checkEqual("prev", ParallelHasher(2, 3000).computeCRC32(crc, ms, crc.add(ConstBytes_t(data).subrange(0, 500), 0)), expect);
+}
+
+/** Test error handling. */
+AFL_TEST("afl.checksums.ParallelHasher:error", a)
+{
+    class ErrorStream : public PipeStream {
+     public:
+        ErrorStream()
+            : PipeStream(ConstBytes_t())
+            { }
+        virtual size_t read(Bytes_t /*m*/)
+            { throw std::runtime_error("boom"); }
+    };
+
+    ErrorStream s;
+    SHA256 h;
+    AFL_CHECK_THROWS(a("0 threads"), ParallelHasher(0).computeHash(h, s), afl::except::FileProblemException);
+    AFL_CHECK_THROWS(a("2 threads"), ParallelHasher(2).computeHash(h, s), afl::except::FileProblemException);
+}
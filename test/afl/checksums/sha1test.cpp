@@ -7,6 +7,7 @@
 #include "afl/test/testrunner.hpp"
 #include "afl/string/string.hpp"
 #include "afl/base/countof.hpp"
+#include "test/afl/checksums/hashtest.hpp"
 
 using afl::base::ConstBytes_t;
 
@@ -191,6 +192,36 @@ AFL_TEST("afl.checksums.SHA1:computePBKDF2:rfc6070", a)
     }
 }
 
+/** Test computePBKDF2 using multiple threads.
+    Output of RFC 6070 case 5 consists of two blocks, which can be computed in parallel. */
+AFL_TEST("afl.checksums.SHA1:computePBKDF2:threads", a)
+{
+    static const uint8_t expect[25] = {
+        0x3d, 0x2e, 0xec, 0x4f, 0xe4, 0x1c, 0x84, 0x9b,
+        0x80, 0xc8, 0xd8, 0x36, 0x62, 0xc0, 0xe4, 0x4a,
+        0x8b, 0x29, 0x1a, 0x96, 0x4c, 0xf2, 0xf0, 0x70,
+        0x38,
+    };
+    static const size_t NUM_THREADS[] = { 0, 2, 5 };
+    for (size_t i = 0; i < countof(NUM_THREADS); ++i) {
+        afl::checksums::SHA1 cc;
+        uint8_t out[25];
+        cc.computePBKDF2(out,
+                         afl::string::toBytes("passwordPASSWORDpassword"),
+                         afl::string::toBytes("saltSALTsaltSALTsaltSALTsaltSALTsalt"),
+                         4096,
+                         NUM_THREADS[i]);
+        a.checkEqualContent("result", ConstBytes_t(out), ConstBytes_t(expect));
+    }
+
+    // Many blocks
+    afl::checksums::SHA1 cc;
+    uint8_t serial[200], parallel[200];
+    cc.computePBKDF2(serial,   afl::string::toBytes("pw"), afl::string::toBytes("salt"), 10, 1);
+    cc.computePBKDF2(parallel, afl::string::toBytes("pw"), afl::string::toBytes("salt"), 10, 3);
+    a.checkEqualContent("many blocks", ConstBytes_t(parallel), ConstBytes_t(serial));
+}
+
 /** Hash tests from RFC 6234. */
 AFL_TEST("afl.checksums.SHA1:rfc6232", a)
 {
@@ -256,3 +287,11 @@ AFL_TEST("afl.checksums.SHA1:computeHMAC:rfc6234", a)
                                         "\xcd\xcd\xcd\xcd\xcd"));
     a.checkEqual("case 4", cc.getHashAsHexString(), "4c9007f4026250c6bc8414f9bf50c86c2d7235da");
 }
+
+/** Test hashing a large, unaligned buffer in chunks of varying size. */
+AFL_TEST("afl.checksums.SHA1:chunks", a)
+{
+    afl::checksums::SHA1 cc;
+    // Expected result computed with Python's hashlib
+    checkHashChunks(a, cc, "76d83757c629ffd410243614f9ab4a458049a3db");
+}
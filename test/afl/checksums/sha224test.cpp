@@ -7,6 +7,7 @@
 #include "afl/test/testrunner.hpp"
 
 #include "afl/base/countof.hpp"
+#include "test/afl/checksums/hashtest.hpp"
 
 namespace {
     struct TestCase {
@@ -123,3 +124,11 @@ AFL_TEST("afl.checksums.SHA224:computeHMAC:rfc6234", a)
                                         "\xcd\xcd\xcd\xcd\xcd"));
     a.checkEqual("case 4", cc.getHashAsHexString(), "6c11506874013cac6a2abc1bb382627cec6a90d86efc012de7afec5a");
 }
+
+/** Test hashing a large, unaligned buffer in chunks of varying size. */
+AFL_TEST("afl.checksums.SHA224:chunks", a)
+{
+    afl::checksums::SHA224 cc;
+    // Expected result computed with Python's hashlib
+    checkHashChunks(a, cc, "dac42b6e5648aa7a3bbc50a9280bc1000f86b6ca5e62dc26e4957140");
+}
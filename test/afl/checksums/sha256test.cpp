@@ -7,6 +7,7 @@
 #include "afl/test/testrunner.hpp"
 
 #include "afl/base/countof.hpp"
+#include "test/afl/checksums/hashtest.hpp"
 
 using afl::base::ConstBytes_t;
 
@@ -129,3 +130,48 @@ AFL_TEST("afl.checksums.SHA256:computeHMAC:rfc6234", a)
                                         "\xcd\xcd\xcd\xcd\xcd"));
     a.checkEqual("case 4", cc.getHashAsHexString(), "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
 }
+
+/** Test hashing a large, unaligned buffer in chunks of varying size. */
+AFL_TEST("afl.checksums.SHA256:chunks", a)
+{
+    afl::checksums::SHA256 cc;
+    // Expected result computed with Python's hashlib
+    checkHashChunks(a, cc, "4bcc49a849c68d9df89416b22afccf2826fc7444db4d2c2c40b5ded4b01d63b8");
+}
+
+/** Test addMultiple().
+    Must produce the same result as hashing each message individually,
+    for more messages than processed at once, different sizes, and partial blocks before and after. */
+AFL_TEST("afl.checksums.SHA256:addMultiple", a)
+{
+    const size_t N = 11;
+    uint8_t data[5000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = uint8_t(i * 7 + (i >> 8));
+    }
+
+    afl::checksums::SHA256 multi[N];
+    afl::checksums::SHA256* ptrs[N];
+    ConstBytes_t parts[N];
+    for (size_t i = 0; i < N; ++i) {
+        // Some hashes start with a partial block
+        if (i % 3 == 1) {
+            multi[i].add(ConstBytes_t(data).trim(i));
+        }
+        ptrs[i] = &multi[i];
+        parts[i] = ConstBytes_t(data).subrange(i, i < 8 ? 4096 : 4096 + 100*i);
+    }
+
+    afl::checksums::SHA256::addMultiple(ptrs, parts);
+    afl::checksums::SHA256::addMultiple(ptrs, parts);
+
+    for (size_t i = 0; i < N; ++i) {
+        afl::checksums::SHA256 single;
+        if (i % 3 == 1) {
+            single.add(ConstBytes_t(data).trim(i));
+        }
+        single.add(parts[i]);
+        single.add(parts[i]);
+        a.checkEqual("hash", multi[i].getHashAsHexString(), single.getHashAsHexString());
+    }
+}
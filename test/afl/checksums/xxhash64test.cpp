@@ -0,0 +1,116 @@
+/**
+  *  \file test/afl/checksums/xxhash64test.cpp
+  *  \brief Test for afl::checksums::XXHash64
+  */
+
+#include "afl/checksums/xxhash64.hpp"
+
+#include <memory>
+#include "afl/base/countof.hpp"
+#include "afl/base/growablememory.hpp"
+#include "afl/string/format.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+using afl::checksums::XXHash64;
+using afl::string::toBytes;
+
+namespace {
+    struct LengthCase {
+        size_t length;
+        uint64_t expect;
+    };
+
+    /* Generate test data */
+    void makeData(afl::base::GrowableBytes_t& data, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            data.append(uint8_t((i*31) ^ (i>>9)));
+        }
+    }
+}
+
+/** Test strings (reference values from the xxHash library). */
+AFL_TEST("afl.checksums.XXHash64:strings", a)
+{
+    a.checkEqual("01", XXHash64::compute(ConstBytes_t()),                                         0xEF46DB3751D8E999ULL);
+    a.checkEqual("02", XXHash64::compute(toBytes("a")),                                           0xD24EC4F1A98C6E5BULL);
+    a.checkEqual("03", XXHash64::compute(toBytes("abc")),                                         0x44BC2CF5AD770999ULL);
+    a.checkEqual("04", XXHash64::compute(toBytes("Nobody inspects the spammish repetition")),     0xFBCEA83C8A378BF1ULL);
+
+    // Seeds
+    a.checkEqual("11", XXHash64::compute(ConstBytes_t(), 1),                                      0xD5AFBA1336A3BE4BULL);
+    a.checkEqual("12", XXHash64::compute(toBytes("abc"), 0x123456789ABCDEF0ULL),                  0x628E181B1C6C4783ULL);
+}
+
+/** Test different lengths, covering all code paths; one-shot and streaming. */
+AFL_TEST("afl.checksums.XXHash64:lengths", a)
+{
+    static const LengthCase CASES[] = {
+        { 3,      0xE5D2BE4AE4B3469AULL },
+        { 4,      0x3B4D7F7C6BD1AE90ULL },
+        { 7,      0xF952F1901A5AFC9BULL },
+        { 8,      0x506834122CB7B4D0ULL },
+        { 9,      0xBA2F457C2914D838ULL },
+        { 31,     0xF9C815C599CBB32DULL },
+        { 32,     0xBA7BAFD4734262DDULL },
+        { 33,     0x791CBE857E7FA007ULL },
+        { 63,     0xCC8B2A542E4A451EULL },
+        { 64,     0xD14BF0119FD250A1ULL },
+        { 65,     0xF514ECCCAEDA9B5FULL },
+        { 100,    0x2BDDAAD0EE8A2178ULL },
+        { 100000, 0x1E48D37CC494630FULL },
+    };
+
+    afl::base::GrowableBytes_t data;
+    makeData(data, 100000);
+
+    for (size_t i = 0; i < countof(CASES); ++i) {
+        afl::test::Assert me(a(afl::string::Format("length %d", CASES[i].length)));
+        ConstBytes_t content = ConstBytes_t(data).subrange(0, CASES[i].length);
+
+        // One-shot
+        me.checkEqual("compute", XXHash64::compute(content), CASES[i].expect);
+
+        // Streaming in odd-sized pieces
+        XXHash64 h;
+        ConstBytes_t in = content;
+        size_t n = 1;
+        while (!in.empty()) {
+            h.add(in.split(n));
+            n = (n * 3 + 1) % 77;
+        }
+        me.checkEqual("add", h.getValue(), CASES[i].expect);
+    }
+
+    // Seeded
+    a.checkEqual("seed", XXHash64::compute(data, 42), 0x5EB0C3743500EF08ULL);
+}
+
+/** Test Hash interface. */
+AFL_TEST("afl.checksums.XXHash64:Hash", a)
+{
+    XXHash64 h;
+    a.checkEqual("getHashSize", h.getHashSize(), 8U);
+    a.checkEqual("getBlockSize", h.getBlockSize(), 32U);
+    a.checkEqual("empty", h.getHashAsHexString(), "ef46db3751d8e999");
+
+    // Getting the hash does not modify the state
+    h.add(toBytes("a"));
+    a.checkEqual("a", h.getHashAsHexString(), "d24ec4f1a98c6e5b");
+    h.add(toBytes("bc"));
+    a.checkEqual("abc", h.getHashAsHexString(), "44bc2cf5ad770999");
+
+    // Clone continues independently
+    std::auto_ptr<XXHash64> c(h.clone());
+    c->clear();
+    a.checkEqual("clone", c->getValue(), 0xEF46DB3751D8E999ULL);
+    a.checkEqual("orig", h.getValue(), 0x44BC2CF5AD770999ULL);
+
+    // Clear keeps the seed
+    XXHash64 s(0x123456789ABCDEF0ULL);
+    s.add(toBytes("xyz"));
+    s.clear();
+    s.add(toBytes("abc"));
+    a.checkEqual("seed", s.getValue(), 0x628E181B1C6C4783ULL);
+}
@@ -88,6 +88,31 @@ namespace afl { namespace data {
         a.check("attr b", dynamic_cast<StringValue*>(hv->get("b")) != 0);
     }
 
+    AFL_TEST("afl.data.DefaultValueFactory:createHash:shared", a)
+    {
+        DefaultValueFactory f;
+
+        // Keys
+        NameMap* keys = new NameMap();
+        keys->add("a");
+        afl::base::Ref<const NameMap> sharedKeys(*keys);
+
+        // Values
+        Segment values;
+        values.pushBackNew(f.createInteger(1));
+
+        // Make a hash
+        std::auto_ptr<Value> v(f.createHash(sharedKeys, values));
+
+        // Check it
+        a.check("result", v.get() != 0);
+        a.check("type", dynamic_cast<HashValue*>(v.get()) != 0);
+
+        afl::base::Ref<Hash> hv(dynamic_cast<HashValue*>(v.get())->getValue());
+        a.check("keys", &hv->getKeys() == keys);
+        a.check("attr a", dynamic_cast<IntegerValue*>(hv->get("a")) != 0);
+    }
+
     AFL_TEST("afl.data.DefaultValueFactory:createVector", a)
     {
         DefaultValueFactory f;
@@ -70,3 +70,38 @@ AFL_TEST("afl.data.Hash", a)
     // Nonexistant
     a.check("91. getIndexByKey", !p->getIndexByKey("yyy", x));
 }
+
+/* Shared keys */
+AFL_TEST("afl.data.Hash:shared-keys", a)
+{
+    // Make a hash
+    afl::base::Ref<afl::data::Hash> p = afl::data::Hash::create();
+    p->setNew("a", new afl::data::IntegerValue(1));
+    p->setNew("b", new afl::data::IntegerValue(2));
+
+    // Make another hash with the same keys
+    afl::data::Segment values;
+    values.pushBackNew(new afl::data::IntegerValue(3));
+    values.pushBackNew(new afl::data::IntegerValue(4));
+    afl::base::Ref<afl::data::Hash> q = afl::data::Hash::create(p->getSharedKeys(), values);
+    a.checkEqual("01. getKeys", &p->getKeys(), &q->getKeys());
+    a.checkEqual("02. size", values.size(), 0U);
+
+    afl::data::Hash::Index_t x;
+    a.check("11. getIndexByKey", p->getIndexByKey("b", x));
+    a.checkEqual("12. getValue", dynamic_cast<afl::data::IntegerValue*>(p->getValueByIndex(x))->getValue(), 2);
+    a.checkEqual("13. getValue", dynamic_cast<afl::data::IntegerValue*>(q->getValueByIndex(x))->getValue(), 4);
+
+    // Modifying an existing key keeps the keys shared
+    q->setNew("a", new afl::data::IntegerValue(5));
+    a.checkEqual("21. getKeys", &p->getKeys(), &q->getKeys());
+
+    // Adding a key unshares them
+    q->setNew("c", new afl::data::IntegerValue(6));
+    a.check("31. getKeys", &p->getKeys() != &q->getKeys());
+    a.checkEqual("32. getNumNames", p->getKeys().getNumNames(), 2U);
+    a.checkEqual("33. getNumNames", q->getKeys().getNumNames(), 3U);
+    a.checkNull("34. get", p->get("c"));
+    a.checkEqual("35. get", dynamic_cast<afl::data::IntegerValue*>(q->get("a"))->getValue(), 5);
+    a.checkEqual("36. get", dynamic_cast<afl::data::IntegerValue*>(p->get("a"))->getValue(), 1);
+}
@@ -4,6 +4,7 @@
   */
 
 #include "afl/data/namemap.hpp"
+#include "afl/string/format.hpp"
 #include "afl/test/testrunner.hpp"
 
 AFL_TEST("afl.data.NameMap", a)
@@ -34,3 +35,32 @@ AFL_TEST("afl.data.NameMap", a)
     a.checkEqual("44. getNameByIndex", names.getNameByIndex(3), "a");
     a.checkEqual("45. getNameByIndex", names.getNameByIndex(0), "a");
 }
+
+/** Test large map; the hash table must grow and keep lookups correct. */
+AFL_TEST("afl.data.NameMap:large", a)
+{
+    afl::data::NameMap names;
+    for (size_t i = 0; i < 5000; ++i) {
+        a.checkEqual("01. add", names.add(afl::string::Format("NAME%d", i)), i);
+    }
+
+    // Duplicate added late must shadow the original, also after further growth
+    a.checkEqual("11. add", names.add("NAME17"), 5000U);
+    for (size_t i = 0; i < 5000; ++i) {
+        names.add(afl::string::Format("OTHER%d", i));
+    }
+
+    a.checkEqual("21. getIndexByName", names.getIndexByName("NAME0"), 0U);
+    a.checkEqual("22. getIndexByName", names.getIndexByName("NAME4999"), 4999U);
+    a.checkEqual("23. getIndexByName", names.getIndexByName("NAME17"), 5000U);
+    a.checkEqual("24. getIndexByName", names.getIndexByName("OTHER0"), 5001U);
+    a.checkEqual("25. getIndexByName", names.getIndexByName("NAME5000"), names.nil);
+    a.checkEqual("26. getNameByIndex", names.getNameByIndex(17), "NAME17");
+
+    // Swap
+    afl::data::NameMap other;
+    other.swap(names);
+    a.checkEqual("31. getNumNames", names.getNumNames(), 0U);
+    a.checkEqual("32. getIndexByName", names.getIndexByName("NAME0"), names.nil);
+    a.checkEqual("33. getIndexByName", other.getIndexByName("NAME4999"), 4999U);
+}
@@ -31,3 +31,20 @@ AFL_TEST("afl.data.NameQuery", a)
     a.check("43", q.before("hello world"));
     a.check("44", q.before("hf"));
 }
+
+/** Test hash codes. */
+AFL_TEST("afl.data.NameQuery:hash", a)
+{
+    afl::data::NameQuery q("hello world");
+
+    // Same string, same hash, no matter how constructed
+    a.checkEqual("01", q.getFullHashCode(), afl::data::NameQuery(String_t("hello world")).getFullHashCode());
+    a.checkEqual("02", afl::data::NameQuery(q, 6).getFullHashCode(), afl::data::NameQuery("world").getFullHashCode());
+
+    // Short hash code is in range and derived from full hash code
+    a.check("11", q.getHashCode() < afl::data::NameQuery::HASH_MAX);
+    a.checkEqual("12", q.getHashCode(), q.getFullHashCode() % afl::data::NameQuery::HASH_MAX);
+
+    // Names that differ only in the middle (the previous hash only looked at the first and last characters)
+    a.check("21", afl::data::NameQuery("prefix_a_suffix").getFullHashCode() != afl::data::NameQuery("prefix_b_suffix").getFullHashCode());
+}
@@ -14,3 +14,13 @@ AFL_TEST("afl.data.StringValue", a)
     const afl::data::StringValue sv2("xyz");
     a.checkEqual("nonempty value", sv2.getValue(), "xyz");
 }
+
+AFL_TEST("afl.data.StringValue:setValue", a)
+{
+    afl::data::StringValue sv("abc");
+    sv.setValue(afl::string::toMemory("hello"));
+    a.checkEqual("set value", sv.getValue(), "hello");
+
+    sv.setValue(afl::string::ConstStringMemory_t());
+    a.checkEqual("set empty", sv.getValue(), "");
+}
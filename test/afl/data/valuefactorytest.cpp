@@ -6,7 +6,58 @@
 #include "afl/data/valuefactory.hpp"
 #include "afl/test/testrunner.hpp"
 
+#include "afl/data/namemap.hpp"
+#include "afl/data/segment.hpp"
+
 /** Simple test.
     This is an interface, so we only test that the header file compiles. */
 AFL_TEST_NOARG("afl.data.ValueFactory")
 { }
+
+/** Test default implementation of createHash() with shared keys.
+    It must call the other createHash(), with a copy of the keys. */
+AFL_TEST("afl.data.ValueFactory:createHash:shared", a)
+{
+    class Tester : public afl::data::ValueFactory {
+     public:
+        Tester()
+            : m_keys()
+            { }
+        virtual afl::data::Value* createString(const String_t& /*sv*/)
+            { return 0; }
+        virtual afl::data::Value* createInteger(int32_t /*iv*/)
+            { return 0; }
+        virtual afl::data::Value* createFloat(double /*fv*/)
+            { return 0; }
+        virtual afl::data::Value* createBoolean(bool /*bv*/)
+            { return 0; }
+        virtual afl::data::Value* createHash(afl::data::NameMap& keys, afl::data::Segment& /*values*/)
+            { m_keys.swap(keys); return 0; }
+        virtual afl::data::Value* createVector(afl::data::Segment& /*values*/)
+            { return 0; }
+        virtual afl::data::Value* createError(const String_t& /*source*/, const String_t& /*str*/)
+            { return 0; }
+        virtual afl::data::Value* createNull()
+            { return 0; }
+
+        afl::data::NameMap m_keys;
+    };
+
+    afl::data::NameMap* keys = new afl::data::NameMap();
+    keys->add("a");
+    keys->add("b");
+    afl::base::Ref<const afl::data::NameMap> sharedKeys(*keys);
+
+    // Call through base class; Tester's createHash() hides the inherited overload
+    Tester t;
+    afl::data::ValueFactory& f = t;
+    afl::data::Segment values;
+    f.createHash(sharedKeys, values);
+
+    // Callee received a copy
+    a.checkEqual("01. getNumNames", t.m_keys.getNumNames(), 2U);
+    a.checkEqual("02. getNameByIndex", t.m_keys.getNameByIndex(1), "b");
+
+    // Shared keys unchanged
+    a.checkEqual("11. getNumNames", keys->getNumNames(), 2U);
+}
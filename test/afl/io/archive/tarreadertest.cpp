@@ -8,6 +8,7 @@
 #include "afl/except/fileproblemexception.hpp"
 #include "afl/io/constmemorystream.hpp"
 #include "afl/io/directoryentry.hpp"
+#include "afl/io/inflatestream.hpp"
 #include "afl/io/inflatetransform.hpp"
 #include "afl/io/stream.hpp"
 #include "afl/io/transformreaderstream.hpp"
@@ -397,3 +398,21 @@ AFL_TEST("afl.io.archive.TarReader:getDirectoryEntryByName:compressed", a)
     a.checkEqual("01. getTitle", e->getTitle(), "c.sh");
     a.checkEqual("02. getFileSize", e->getFileSize(), 8U);
 }
+
+/** Test random access to a compressed file, using InflateStream.
+    Members can be read in any order. */
+AFL_TEST("afl.io.archive.TarReader:random-access-compressed", a)
+{
+    Ref<afl::io::archive::TarReader> testee = afl::io::archive::TarReader::open(*new afl::io::InflateStream(*new afl::io::ConstMemoryStream(COMPRESSED_FILE), afl::io::InflateStream::Gzip), 0);
+
+    // Read last member first, then first member
+    Ref<afl::io::Stream> s1(testee->getDirectoryEntryByName("c.sh")->openFile(afl::io::FileSystem::OpenRead));
+    Ref<afl::io::Stream> s2(testee->getDirectoryEntryByName("a.txt")->openFile(afl::io::FileSystem::OpenRead));
+    uint8_t bytes[100];
+    a.checkEqual("read a.txt", s2->read(bytes), 3U);
+    a.checkEqual("read c.sh", s1->read(bytes), 8U);
+
+    // Re-read
+    s2->setPos(0);
+    a.checkEqual("re-read a.txt", s2->read(bytes), 3U);
+}
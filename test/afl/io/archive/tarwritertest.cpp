@@ -0,0 +1,98 @@
+/**
+  *  \file test/afl/io/archive/tarwritertest.cpp
+  *  \brief Test for afl::io::archive::TarWriter
+  */
+
+#include "afl/io/archive/tarwriter.hpp"
+
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/except/filetooshortexception.hpp"
+#include "afl/io/archive/tarreader.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/directoryentry.hpp"
+#include "afl/io/inflatetransform.hpp"
+#include "afl/io/internalstream.hpp"
+#include "afl/io/transformreaderstream.hpp"
+#include "afl/string/string.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::Ref;
+using afl::io::InternalStream;
+using afl::io::archive::TarReader;
+using afl::io::archive::TarWriter;
+
+namespace {
+    /* Read a member from a TAR file */
+    String_t readMember(TarReader& tar, const String_t& name)
+    {
+        Ref<afl::io::Stream> s = tar.openFile(name, afl::io::FileSystem::OpenRead);
+        String_t result;
+        uint8_t buffer[1000];
+        while (size_t n = s->read(buffer)) {
+            result.append(reinterpret_cast<const char*>(buffer), n);
+        }
+        return result;
+    }
+}
+
+/** Test uncompressed file.
+    The result must be readable by TarReader and have the proper block structure. */
+AFL_TEST("afl.io.archive.TarWriter:uncompressed", a)
+{
+    const String_t longName = String_t(120, 'd') + "/" + String_t(90, 'f');
+
+    Ref<InternalStream> file = *new InternalStream();
+    {
+        TarWriter testee(*file, 0);
+        testee.addData("a.txt", afl::string::toBytes("Hello"), afl::sys::Time::fromUnixTime(1500000000));
+        testee.addData("b/empty", afl::base::ConstBytes_t());
+        testee.addData(longName, afl::string::toBytes("long"));
+        testee.finish();
+    }
+    // 3 headers, 2 data blocks, 2 end blocks
+    a.checkEqual("01. getSize", file->getSize(), 7*512U);
+
+    file->setPos(0);
+    Ref<TarReader> reader = TarReader::open(file, TarReader::KeepPaths);
+    a.checkEqual("11. a", readMember(*reader, "a.txt"), "Hello");
+    a.checkEqual("12. b", readMember(*reader, "b/empty"), "");
+    a.checkEqual("13. long", readMember(*reader, longName), "long");
+}
+
+/** Test compressed file. */
+AFL_TEST("afl.io.archive.TarWriter:compressed", a)
+{
+    if (!afl::io::DeflateTransform::isAvailable() || !afl::io::InflateTransform::isAvailable()) {
+        return;
+    }
+
+    const String_t data(100000, 'x');
+    InternalStream file;
+    {
+        afl::io::ConstMemoryStream in(afl::string::toBytes(data));
+        TarWriter testee(file, TarWriter::Gzip);
+        testee.addStream("x", in);
+        testee.addData("y", afl::string::toBytes("yy"));
+        testee.finish();
+    }
+    a.check("01. compressed", file.getSize() < 10000);
+
+    file.setPos(0);
+    afl::io::InflateTransform tx(afl::io::InflateTransform::Gzip);
+    Ref<TarReader> reader = TarReader::open(*new afl::io::TransformReaderStream(file, tx), 0);
+    a.checkEqual("11. x", readMember(*reader, "x"), data);
+    a.checkEqual("12. y", readMember(*reader, "y"), "yy");
+}
+
+/** Test error cases. */
+AFL_TEST("afl.io.archive.TarWriter:errors", a)
+{
+    InternalStream file;
+    TarWriter testee(file, 0);
+
+    // Names that cannot be represented
+    AFL_CHECK_THROWS(a("01. empty"), testee.addData("", afl::string::toBytes("x")), afl::except::FileProblemException);
+    AFL_CHECK_THROWS(a("02. long"), testee.addData(String_t(150, 'x'), afl::string::toBytes("x")), afl::except::FileProblemException);
+    AFL_CHECK_THROWS(a("03. long prefix"), testee.addData(String_t(200, 'x') + "/a", afl::string::toBytes("x")), afl::except::FileProblemException);
+}
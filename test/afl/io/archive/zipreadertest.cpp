@@ -12,6 +12,7 @@
 #include "afl/io/filemapping.hpp"
 #include "afl/io/inflatetransform.hpp"
 #include "afl/io/internalstream.hpp"
+#include "afl/string/format.hpp"
 #include "afl/test/testrunner.hpp"
 
 namespace {
@@ -230,6 +231,27 @@ AFL_TEST("afl.io.archive.ZipReader:read-members", a)
     AFL_CHECK_THROWS(a("cannot create"), testee->openFile("hello.txt", afl::io::FileSystem::Create), afl::except::FileProblemException);
 }
 
+/** Test seeking in a compressed member, with and without RandomAccess option. */
+AFL_TEST("afl.io.archive.ZipReader:compressed-member:seek", a)
+{
+    static const int OPTIONS[] = { 0, afl::io::archive::ZipReader::RandomAccess };
+    for (size_t i = 0; i < sizeof(OPTIONS)/sizeof(OPTIONS[0]); ++i) {
+        afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(*new afl::io::ConstMemoryStream(SAMPLE_ZIP), OPTIONS[i]));
+        afl::base::Ref<afl::io::Stream> in(testee->openFile("test.log", afl::io::FileSystem::OpenRead));
+        a.check("getCapabilities", (in->getCapabilities() & afl::io::Stream::CanSeek) != 0);
+
+        uint8_t buffer[20];
+        in->setPos(200);
+        a.checkEqual("read 1", in->read(buffer), sizeof(buffer));
+        a.checkEqualContent("content 1", afl::base::ConstBytes_t(buffer), afl::base::ConstBytes_t(TEST_LOG).subrange(200, sizeof(buffer)));
+
+        in->setPos(10);
+        a.checkEqual("read 2", in->read(buffer), sizeof(buffer));
+        a.checkEqualContent("content 2", afl::base::ConstBytes_t(buffer), afl::base::ConstBytes_t(TEST_LOG).subrange(10, sizeof(buffer)));
+        a.checkEqual("getPos", in->getPos(), 30U);
+    }
+}
+
 /** Test bad operations. */
 AFL_TEST("afl.io.archive.ZipReader:bad-operation:modify", a)
 {
@@ -363,3 +385,297 @@ AFL_TEST("afl.io.archive.ZipReader:unsupported:compression", a)
     afl::base::Ptr<afl::io::DirectoryEntry> entry;
     a.check("getNextElement", !content->getNextElement(entry));
 }
+
+/*
+ *  Tests using generated ZIP files
+ */
+
+namespace {
+    /* Minimal ZIP file generator. Produces stored members only. */
+    class ZipBuilder {
+     public:
+        ZipBuilder(bool zip64)
+            : m_zip64(zip64), m_prefix(), m_data(), m_directory(), m_numEntries(0)
+            { }
+
+        void addPrefix(const char* text)
+            { m_prefix.append(afl::string::toBytes(text)); }
+
+        void addMember(const String_t& name, const String_t& content, uint16_t flags)
+            {
+                const afl::base::ConstBytes_t nameBytes = afl::string::toBytes(name);
+                const afl::base::ConstBytes_t contentBytes = afl::string::toBytes(content);
+                const uint32_t size = uint32_t(contentBytes.size());
+                const uint32_t offset = uint32_t(m_data.size());
+                const bool descriptor = (flags & 8) != 0;
+
+                // Local header
+                put32(m_data, 0x04034B50);
+                put16(m_data, 10);
+                put16(m_data, flags);
+                put16(m_data, 0);                     // method
+                put32(m_data, 0);                     // time
+                put32(m_data, 0);                     // CRC (not checked)
+                put32(m_data, descriptor ? 0 : size);
+                put32(m_data, descriptor ? 0 : size);
+                put16(m_data, uint16_t(nameBytes.size()));
+                put16(m_data, 0);
+                m_data.append(nameBytes);
+                m_data.append(contentBytes);
+                if (descriptor) {
+                    put32(m_data, 0x08074B50);
+                    put32(m_data, 0);
+                    put32(m_data, size);
+                    put32(m_data, size);
+                }
+
+                // Central header
+                put32(m_directory, 0x02014B50);
+                put16(m_directory, 0x031E);
+                put16(m_directory, 10);
+                put16(m_directory, flags);
+                put16(m_directory, 0);
+                put32(m_directory, 0);
+                put32(m_directory, 0);
+                put32(m_directory, m_zip64 ? 0xFFFFFFFF : size);
+                put32(m_directory, m_zip64 ? 0xFFFFFFFF : size);
+                put16(m_directory, uint16_t(nameBytes.size()));
+                put16(m_directory, m_zip64 ? 28 : 0);
+                put16(m_directory, 0);
+                put16(m_directory, 0);
+                put16(m_directory, 0);
+                put32(m_directory, 0);
+                put32(m_directory, m_zip64 ? 0xFFFFFFFF : offset);
+                m_directory.append(nameBytes);
+                if (m_zip64) {
+                    put16(m_directory, 1);
+                    put16(m_directory, 24);
+                    put64(m_directory, size);
+                    put64(m_directory, size);
+                    put64(m_directory, offset);
+                }
+                ++m_numEntries;
+            }
+
+        afl::base::Ref<afl::io::Stream> finish()
+            {
+                afl::base::Ref<afl::io::InternalStream> result = *new afl::io::InternalStream();
+                result->fullWrite(m_prefix);
+                result->fullWrite(m_data);
+                result->fullWrite(m_directory);
+
+                afl::base::GrowableBytes_t end;
+                const uint32_t dirOffset = uint32_t(m_data.size());
+                const uint32_t dirSize = uint32_t(m_directory.size());
+                if (m_zip64) {
+                    // ZIP64 end record
+                    put32(end, 0x06064B50);
+                    put64(end, 44);
+                    put16(end, 0x031E);
+                    put16(end, 45);
+                    put32(end, 0);
+                    put32(end, 0);
+                    put64(end, m_numEntries);
+                    put64(end, m_numEntries);
+                    put64(end, dirSize);
+                    put64(end, dirOffset);
+
+                    // ZIP64 locator
+                    put32(end, 0x07064B50);
+                    put32(end, 0);
+                    put64(end, dirOffset + dirSize);
+                    put32(end, 1);
+                }
+                put32(end, 0x06054B50);
+                put16(end, 0);
+                put16(end, 0);
+                put16(end, m_zip64 ? 0xFFFF : uint16_t(m_numEntries));
+                put16(end, m_zip64 ? 0xFFFF : uint16_t(m_numEntries));
+                put32(end, m_zip64 ? 0xFFFFFFFF : dirSize);
+                put32(end, m_zip64 ? 0xFFFFFFFF : dirOffset);
+                put16(end, 7);
+                end.append(afl::string::toBytes("comment"));
+                result->fullWrite(end);
+                result->setPos(0);
+                return result;
+            }
+
+     private:
+        bool m_zip64;
+        afl::base::GrowableBytes_t m_prefix;
+        afl::base::GrowableBytes_t m_data;
+        afl::base::GrowableBytes_t m_directory;
+        uint32_t m_numEntries;
+
+        static void put16(afl::base::GrowableBytes_t& out, uint16_t value)
+            {
+                out.append(uint8_t(value));
+                out.append(uint8_t(value >> 8));
+            }
+        static void put32(afl::base::GrowableBytes_t& out, uint32_t value)
+            {
+                put16(out, uint16_t(value));
+                put16(out, uint16_t(value >> 16));
+            }
+        static void put64(afl::base::GrowableBytes_t& out, uint64_t value)
+            {
+                put32(out, uint32_t(value));
+                put32(out, uint32_t(value >> 32));
+            }
+    };
+
+    String_t readMember(afl::io::archive::ZipReader& zip, const String_t& name)
+    {
+        afl::base::Ref<afl::io::Stream> in(zip.openFile(name, afl::io::FileSystem::OpenRead));
+        afl::io::InternalStream out;
+        out.copyFrom(*in);
+        return afl::string::fromBytes(out.getContent());
+    }
+}
+
+/** Test member with data descriptor.
+    The local header does not contain the sizes; this can only be read using the central directory. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:data-descriptor", a)
+{
+    ZipBuilder b(false);
+    b.addMember("a.txt", "first", 8);
+    b.addMember("b.txt", "second", 8);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), 0));
+
+    a.checkEqual("01. b.txt", readMember(*testee, "b.txt"), "second");
+    a.checkEqual("02. a.txt", readMember(*testee, "a.txt"), "first");
+    a.checkEqual("03. getFileSize", testee->getDirectoryEntryByName("b.txt")->getFileSize(), 6U);
+}
+
+/** Test ZIP64 file. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:zip64", a)
+{
+    ZipBuilder b(true);
+    b.addMember("a.txt", "first", 0);
+    b.addMember("dir/b.txt", "second", 0);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), 0));
+
+    a.checkEqual("01. b.txt", readMember(*testee, "b.txt"), "second");
+    a.checkEqual("02. a.txt", readMember(*testee, "a.txt"), "first");
+    AFL_CHECK_THROWS(a("03. dir/b.txt"), testee->openFile("dir/b.txt", afl::io::FileSystem::OpenRead), afl::except::FileProblemException);
+}
+
+/** Test file with data prepended (self-extractor). */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:prefix", a)
+{
+    ZipBuilder b(false);
+    b.addPrefix("MZ this would be a self-extractor");
+    b.addMember("a.txt", "first", 0);
+    b.addMember("b.txt", "second", 0);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), afl::io::archive::ZipReader::KeepPaths));
+
+    a.checkEqual("01. b.txt", readMember(*testee, "b.txt"), "second");
+    a.checkEqual("02. a.txt", readMember(*testee, "a.txt"), "first");
+}
+
+/** Test ZIP64 file with data prepended.
+    The locator's position of the ZIP64 end record must be corrected like all other offsets. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:zip64:prefix", a)
+{
+    ZipBuilder b(true);
+    b.addPrefix("MZ this would be a self-extractor");
+    b.addMember("a.txt", "first", 0);
+    b.addMember("b.txt", "second", 8);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), 0));
+
+    a.checkEqual("01. b.txt", readMember(*testee, "b.txt"), "second");
+    a.checkEqual("02. a.txt", readMember(*testee, "a.txt"), "first");
+    a.check("03. hasUnsupportedFeature", !testee->hasUnsupportedFeature());
+}
+
+/** Test truncated ZIP64 file: end record announces ZIP64, but the file is too short for locator and ZIP64 end record. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:zip64:truncated", a)
+{
+    static const uint8_t DATA[] = {
+        // ZIP64 locator, pointing at offset 0
+        0x50, 0x4B, 0x06, 0x07, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+        // End record, saturated
+        0x50, 0x4B, 0x05, 0x06, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0,
+    };
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(*new afl::io::ConstMemoryStream(DATA), 0));
+
+    afl::base::Ref<afl::base::Enumerator<afl::base::Ptr<afl::io::DirectoryEntry> > > content = testee->getDirectoryEntries();
+    afl::base::Ptr<afl::io::DirectoryEntry> entry;
+    a.check("01. getNextElement", !content->getNextElement(entry));
+    a.check("02. hasUnsupportedFeature", testee->hasUnsupportedFeature());
+}
+
+/** Test member with unsupported flags in central directory.
+    Member is ignored, but this is reported. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:unsupported-flags", a)
+{
+    ZipBuilder b(false);
+    b.addMember("a.txt", "first", 0);
+    b.addMember("b.txt", "second", 0x40);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), 0));
+
+    a.checkEqual("01. a.txt", readMember(*testee, "a.txt"), "first");
+    AFL_CHECK_THROWS(a("02. b.txt"), testee->openFile("b.txt", afl::io::FileSystem::OpenRead), afl::except::FileProblemException);
+    a.check("03. hasUnsupportedFeature", testee->hasUnsupportedFeature());
+}
+
+/** Test many members, duplicates. */
+AFL_TEST("afl.io.archive.ZipReader:central-directory:many", a)
+{
+    const int N = 1000;
+    ZipBuilder b(false);
+    for (int i = 0; i < N; ++i) {
+        b.addMember(afl::string::Format("d%d/f%d", i % 7, i), afl::string::Format("content %d", i), 0);
+    }
+    b.addMember("d1/f1", "duplicate", 0);
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(b.finish(), afl::io::archive::ZipReader::KeepPaths));
+
+    // Lookup in reverse order
+    for (int i = N-1; i >= 0; --i) {
+        String_t name = afl::string::Format("d%d/f%d", i % 7, i);
+        a.checkEqual(name.c_str(), readMember(*testee, name), String_t(afl::string::Format("content %d", i)));
+    }
+
+    // Enumeration returns each member once, in file order
+    afl::base::Ref<afl::base::Enumerator<afl::base::Ptr<afl::io::DirectoryEntry> > > content = testee->getDirectoryEntries();
+    afl::base::Ptr<afl::io::DirectoryEntry> entry;
+    int count = 0;
+    while (content->getNextElement(entry)) {
+        if (count == 0) {
+            a.checkEqual("11. first", entry->getTitle(), "d0/f0");
+        }
+        ++count;
+    }
+    a.checkEqual("12. count", count, N);
+}
+
+/** Test checksum verification for a compressed member.
+    Reading the complete member must fail if the CRC does not match. */
+AFL_TEST("afl.io.archive.ZipReader:compressed-member:bad-crc", a)
+{
+    // Corrupt the CRC of "test.log" (in local header and central directory)
+    afl::base::GrowableBytes_t data;
+    data.append(SAMPLE_ZIP);
+    static const uint8_t CRC[] = { 0xe0, 0x42, 0x28, 0x88 };
+    int numPatched = 0;
+    for (size_t i = 0; i + sizeof(CRC) <= data.size(); ++i) {
+        if (data.subrange(i, sizeof(CRC)).equalContent(CRC)) {
+            *data.at(i) ^= 1;
+            ++numPatched;
+        }
+    }
+    a.checkGreaterEqual("01. patched", numPatched, 1);
+
+    afl::base::Ref<afl::io::archive::ZipReader> testee(afl::io::archive::ZipReader::open(*new afl::io::ConstMemoryStream(data), 0));
+    AFL_CHECK_THROWS(a("11. read"), readMember(*testee, "test.log"), afl::except::FileFormatException);
+
+    // Partial reads do not verify the checksum
+    afl::base::Ref<afl::io::Stream> in(testee->openFile("test.log", afl::io::FileSystem::OpenRead));
+    uint8_t buffer[20];
+    a.checkEqual("21. read", in->read(buffer), sizeof(buffer));
+    a.checkEqualContent("22. content", afl::base::ConstBytes_t(buffer), afl::base::ConstBytes_t(TEST_LOG).subrange(0, sizeof(buffer)));
+
+    // Unmodified file is read correctly
+    afl::base::Ref<afl::io::archive::ZipReader> good(afl::io::archive::ZipReader::open(*new afl::io::ConstMemoryStream(SAMPLE_ZIP), 0));
+    a.checkEqual("31. read", readMember(*good, "test.log"), afl::string::fromBytes(TEST_LOG));
+}
@@ -0,0 +1,189 @@
+/**
+  *  \file test/afl/io/archive/zipwritertest.cpp
+  *  \brief Test for afl::io::archive::ZipWriter
+  */
+
+#include "afl/io/archive/zipwriter.hpp"
+
+#include "afl/base/growablememory.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/io/archive/zipreader.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/directoryentry.hpp"
+#include "afl/io/inflatetransform.hpp"
+#include "afl/io/internalsink.hpp"
+#include "afl/io/internalstream.hpp"
+#include "afl/string/string.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::Ref;
+using afl::io::InternalStream;
+using afl::io::archive::ZipReader;
+using afl::io::archive::ZipWriter;
+
+namespace {
+    /* Read a member from a ZIP file */
+    String_t readMember(ZipReader& zip, const String_t& name)
+    {
+        Ref<afl::io::Stream> s = zip.openFile(name, afl::io::FileSystem::OpenRead);
+        String_t result;
+        uint8_t buffer[1000];
+        while (size_t n = s->read(buffer)) {
+            result.append(reinterpret_cast<const char*>(buffer), n);
+        }
+        return result;
+    }
+
+    /* Create some compressible data */
+    String_t makeData(size_t n)
+    {
+        String_t result;
+        for (size_t i = 0; i < n; ++i) {
+            result += char('a' + (i*i % 17));
+        }
+        return result;
+    }
+}
+
+/** Test stored members.
+    The result must be readable by ZipReader. */
+AFL_TEST("afl.io.archive.ZipWriter:store", a)
+{
+    Ref<InternalStream> file = *new InternalStream();
+    {
+        ZipWriter testee(*file);
+        testee.addData("hello.txt", afl::string::toBytes("Hello, world"), ZipWriter::Store);
+        testee.addData("empty", afl::base::ConstBytes_t(), ZipWriter::Store);
+        testee.addData("sub/dir.txt", afl::string::toBytes("xyz"), ZipWriter::Store);
+        testee.finish();
+    }
+
+    file->setPos(0);
+    Ref<ZipReader> reader = ZipReader::open(file, ZipReader::KeepPaths);
+    a.checkEqual("01. hello", readMember(*reader, "hello.txt"), "Hello, world");
+    a.checkEqual("02. empty", readMember(*reader, "empty"), "");
+    a.checkEqual("03. sub",   readMember(*reader, "sub/dir.txt"), "xyz");
+    a.checkEqual("04. size",  reader->getDirectoryEntryByName("hello.txt")->getFileSize(), 12U);
+    AFL_CHECK_THROWS(a("05. missing"), reader->openFile("other", afl::io::FileSystem::OpenRead), afl::except::FileProblemException);
+}
+
+/** Test deflated members, given as stream. */
+AFL_TEST("afl.io.archive.ZipWriter:deflate", a)
+{
+    if (!afl::io::DeflateTransform::isAvailable() || !afl::io::InflateTransform::isAvailable()) {
+        return;
+    }
+
+    const String_t data = makeData(100000);
+    InternalStream content;
+    content.fullWrite(afl::string::toBytes(data));
+    content.setPos(0);
+
+    Ref<InternalStream> file = *new InternalStream();
+    {
+        ZipWriter testee(*file);
+        testee.addStream("a.txt", content, ZipWriter::Deflate);
+        testee.addData("b.txt", afl::string::toBytes("bbb"), ZipWriter::Deflate);
+        testee.finish();
+    }
+    a.check("01. compressed", file->getSize() < 50000);
+
+    file->setPos(0);
+    Ref<ZipReader> reader = ZipReader::open(file, 0);
+    a.checkEqual("11. a", readMember(*reader, "a.txt"), data);
+    a.checkEqual("12. b", readMember(*reader, "b.txt"), "bbb");
+}
+
+/** Test pre-compressed members. */
+AFL_TEST("afl.io.archive.ZipWriter:Member", a)
+{
+    const ZipWriter::Method method = afl::io::DeflateTransform::isAvailable() ? ZipWriter::Deflate : ZipWriter::Store;
+    if (!afl::io::InflateTransform::isAvailable() && method == ZipWriter::Deflate) {
+        return;
+    }
+
+    const String_t data = makeData(30000);
+    ZipWriter::Member m1("one", method, *new InternalStream());
+    ZipWriter::Member m2("two", ZipWriter::Store, *new InternalStream());
+    m1.handleFullData(afl::string::toBytes(data.substr(0, 10000)));
+    m2.handleFullData(afl::string::toBytes("second"));
+    m1.handleFullData(afl::string::toBytes(data.substr(10000)));
+    m2.finish();
+
+    Ref<InternalStream> file = *new InternalStream();
+    {
+        ZipWriter testee(*file);
+        testee.addMember(m2);
+        testee.addData("three", afl::string::toBytes("third"), ZipWriter::Store);
+        testee.addMember(m1);
+        testee.finish();
+    }
+
+    file->setPos(0);
+    Ref<ZipReader> reader = ZipReader::open(file, 0);
+    a.checkEqual("01. one",   readMember(*reader, "one"), data);
+    a.checkEqual("02. two",   readMember(*reader, "two"), "second");
+    a.checkEqual("03. three", readMember(*reader, "three"), "third");
+}
+
+/** Test writing into a non-seekable sink.
+    Output must be identical to that produced into a stream. */
+AFL_TEST("afl.io.archive.ZipWriter:sink", a)
+{
+    afl::io::InternalSink sink;
+    InternalStream stream;
+    {
+        ZipWriter w1(sink);
+        ZipWriter w2(stream);
+        w1.addData("x", afl::string::toBytes("content"), ZipWriter::Store, afl::sys::Time::fromUnixTime(1500000000));
+        w2.addData("x", afl::string::toBytes("content"), ZipWriter::Store, afl::sys::Time::fromUnixTime(1500000000));
+        w1.finish();
+        w2.finish();
+    }
+    a.checkEqualContent<uint8_t>("01. content", sink.getContent(), stream.getContent());
+}
+
+/** Test local header of a streamed member.
+    Sizes are not known in advance, so the header must announce ZIP64 and an 8-byte data descriptor. */
+AFL_TEST("afl.io.archive.ZipWriter:local-header:zip64", a)
+{
+    Ref<InternalStream> file = *new InternalStream();
+    {
+        ZipWriter testee(*file);
+        testee.addData("x", afl::string::toBytes("content"), ZipWriter::Store, afl::sys::Time::fromUnixTime(1500000000));
+        testee.finish();
+    }
+
+    afl::base::ConstBytes_t content = file->getContent();
+    static const uint8_t EXPECTED_HEADER[] = {
+        0x50, 0x4B, 0x03, 0x04,                         // signature
+        45, 0,                                          // version needed
+        0x08, 0x08,                                     // flags: data descriptor, UTF-8
+        0, 0,                                           // method: stored
+    };
+    static const uint8_t EXPECTED_SIZES[] = {
+        0, 0, 0, 0,                                     // CRC
+        0xFF, 0xFF, 0xFF, 0xFF,                         // compressed size: see ZIP64
+        0xFF, 0xFF, 0xFF, 0xFF,                         // uncompressed size: see ZIP64
+        1, 0,                                           // name length
+        20, 0,                                          // extra length
+        'x',
+        1, 0, 16, 0,                                    // ZIP64 extra field
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        'c', 'o', 'n', 't', 'e', 'n', 't',
+        0x50, 0x4B, 0x07, 0x08,                         // data descriptor
+    };
+    static const uint8_t EXPECTED_DESCRIPTOR_SIZES[] = {
+        7, 0, 0, 0, 0, 0, 0, 0,
+        7, 0, 0, 0, 0, 0, 0, 0,
+    };
+    a.checkEqualContent<uint8_t>("01. header", content.subrange(0, sizeof(EXPECTED_HEADER)), EXPECTED_HEADER);
+    a.checkEqualContent<uint8_t>("02. sizes", content.subrange(14, sizeof(EXPECTED_SIZES)), EXPECTED_SIZES);
+    a.checkEqualContent<uint8_t>("03. descriptor", content.subrange(14 + sizeof(EXPECTED_SIZES) + 4, sizeof(EXPECTED_DESCRIPTOR_SIZES)), EXPECTED_DESCRIPTOR_SIZES);
+
+    // Must still be readable
+    file->setPos(0);
+    Ref<ZipReader> reader = ZipReader::open(file, 0);
+    a.checkEqual("11. content", readMember(*reader, "x"), "content");
+}
@@ -6,6 +6,7 @@
 #include "afl/io/bufferedsink.hpp"
 
 #include "afl/io/internalsink.hpp"
+#include "afl/string/string.hpp"
 #include "afl/test/testrunner.hpp"
 
 namespace {
@@ -126,3 +127,28 @@ AFL_TEST_NOARG("afl.io.BufferedSink:backend-failure:implicit")
 
     // At this point, the BrokenSink must be in a state that it can be successfully destroyed.
 }
+
+/** Test with a small buffer. */
+AFL_TEST("afl.io.BufferedSink:small-buffer", a)
+{
+    afl::io::InternalSink internal;
+    afl::io::BufferedSink buffered(internal, 4);
+
+    // Small write: goes to buffer
+    afl::base::ConstBytes_t desc(afl::string::toBytes("abc"));
+    buffered.handleData(desc);
+    a.checkEqual("01. size", internal.getContent().size(), 0U);
+
+    // Larger write: fills buffer, remainder is written directly
+    desc = afl::string::toBytes("defghijk");
+    buffered.handleData(desc);
+    a.checkEqual("11. size", internal.getContent().size(), 11U);
+
+    // Small write again
+    desc = afl::string::toBytes("l");
+    buffered.handleData(desc);
+    a.checkEqual("21. size", internal.getContent().size(), 11U);
+
+    buffered.flush();
+    a.checkEqualContent("31. content", internal.getContent(), afl::string::toBytes("abcdefghijkl"));
+}
@@ -139,3 +139,30 @@ AFL_TEST("afl.io.BufferedStream:mixed-io", a)
     bs.flush();
     a.checkEqualContent("99. mem", ConstBytes_t(mem).trim(7), ConstBytes_t(afl::string::toBytes("abCDefg")));
 }
+
+/** Test reading with a small buffer.
+    Large reads bypass the buffer; they must still produce the correct data and position. */
+AFL_TEST("afl.io.BufferedStream:small-buffer", a)
+{
+    afl::io::ConstMemoryStream ms(afl::string::toBytes("abcdefghijklmnopqrstuvwxyz"));
+    afl::io::BufferedStream bs(ms, 4);
+
+    uint8_t tmp[10];
+    a.checkEqual("01. read", bs.read(afl::base::Bytes_t(tmp).trim(2)), 2U);
+    a.checkEqual("02. getPos", bs.getPos(), 2U);
+    a.checkEqual("03. underlying getPos", ms.getPos(), 4U);
+
+    a.checkEqual("11. read", bs.read(tmp), 10U);
+    a.checkEqualContent("12. content", ConstBytes_t(tmp), ConstBytes_t(afl::string::toBytes("cdefghijkl")));
+    a.checkEqual("13. getPos", bs.getPos(), 12U);
+
+    const uint8_t* pc = bs.readByte();
+    a.checkNonNull("21. readByte", pc);
+    a.checkEqual("22. value", *pc, 'm');
+
+    a.checkEqual("31. read", bs.read(tmp), 10U);
+    a.checkEqualContent("32. content", ConstBytes_t(tmp), ConstBytes_t(afl::string::toBytes("nopqrstuvw")));
+    a.checkEqual("33. read", bs.read(tmp), 3U);
+    a.checkEqual("34. read", bs.read(tmp), 0U);
+    a.checkEqual("35. getPos", bs.getPos(), 26U);
+}
@@ -0,0 +1,47 @@
+/**
+  *  \file test/afl/io/charsettransformtest.cpp
+  *  \brief Test for afl::io::CharsetTransform
+  */
+
+#include "afl/io/charsettransform.hpp"
+
+#include "afl/charset/codepage.hpp"
+#include "afl/charset/codepagecharset.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/internalsink.hpp"
+#include "afl/io/transformdatasink.hpp"
+#include "afl/io/transformreaderstream.hpp"
+#include "afl/test/testrunner.hpp"
+
+/** Test decoding with TransformReaderStream. */
+AFL_TEST("afl.io.CharsetTransform:decode", a)
+{
+    afl::io::CharsetTransform testee(afl::charset::CodepageCharset(afl::charset::g_codepageLatin1), afl::io::CharsetTransform::Decode);
+    afl::io::ConstMemoryStream in(afl::string::toBytes("a\xE4\xF6\xFCz"));
+    afl::io::TransformReaderStream rdr(in, testee);
+
+    // Read in small pieces, splitting characters
+    uint8_t buffer[3];
+    String_t result;
+    while (size_t n = rdr.read(buffer)) {
+        result.append(reinterpret_cast<const char*>(buffer), n);
+    }
+    a.checkEqual("result", result, "a\xC3\xA4\xC3\xB6\xC3\xBCz");
+}
+
+/** Test encoding with TransformDataSink. */
+AFL_TEST("afl.io.CharsetTransform:encode", a)
+{
+    afl::io::InternalSink out;
+    afl::io::TransformDataSink sink(out);
+    sink.setNewTransform(new afl::io::CharsetTransform(afl::charset::CodepageCharset(afl::charset::g_codepageLatin1), afl::io::CharsetTransform::Encode));
+
+    // Feed in small pieces, splitting characters
+    afl::base::ConstBytes_t in = afl::string::toBytes("a\xC3\xA4\xC3\xB6\xC3\xBCz");
+    while (!in.empty()) {
+        afl::base::ConstBytes_t piece = in.split(3);
+        sink.handleData(piece);
+    }
+    sink.flush();
+    a.checkEqual("result", afl::string::fromBytes(out.getContent()), "a\xE4\xF6\xFCz");
+}
@@ -21,12 +21,14 @@ namespace {
         Tests that data compresses and decompresses to the same data again.
         \param pers1,pers2 [in] Personalities to use
         \param header     [out] Initial part of compressed data will be produced here
-        \param loops       [in] Number of iterations */
+        \param loops       [in] Number of iterations
+        \param numThreads  [in] Number of compression threads */
     bool testZipRoundtrip(afl::test::Assert a,
                           afl::io::DeflateTransform::Personality pers1,
                           afl::io::InflateTransform::Personality pers2,
                           afl::base::Bytes_t header,
-                          int32_t loops)
+                          int32_t loops,
+                          size_t numThreads = 0)
     {
         if (!afl::io::DeflateTransform::isAvailable() || !afl::io::InflateTransform::isAvailable()) {
             // Test how it refuses being constructed.
@@ -36,7 +38,7 @@ namespace {
         }
 
         // Make a deflater and an inflater
-        afl::io::DeflateTransform testee(pers1);
+        afl::io::DeflateTransform testee(pers1, numThreads);
         afl::io::InflateTransform helper(pers2);
 
         // Make two checksummers. We'll be checksumming input and output data
@@ -194,3 +196,43 @@ AFL_TEST("afl.io.DeflateTransform:zlib:large", a)
         a.checkEqual("header[0]", header[0] & 15, 8);
     }
 }
+
+/*
+ *  Test parallel deflation
+ */
+
+AFL_TEST("afl.io.DeflateTransform:parallel:gzip", a)
+{
+    uint8_t header[] = { 0, 0 };
+    if (testZipRoundtrip(a, afl::io::DeflateTransform::Gzip, afl::io::InflateTransform::Gzip, header, 100000, 4)) {
+        a.checkEqual("header[0]", header[0], 0x1F);
+        a.checkEqual("header[1]", header[1], 0x8B);
+    }
+}
+
+AFL_TEST("afl.io.DeflateTransform:parallel:raw", a)
+{
+    // Variety of data sizes
+    testZipRoundtrip(a("0"),      afl::io::DeflateTransform::Raw, afl::io::InflateTransform::Raw, afl::base::Bytes_t(), 0,      3);
+    testZipRoundtrip(a("1"),      afl::io::DeflateTransform::Raw, afl::io::InflateTransform::Raw, afl::base::Bytes_t(), 1,      3);
+    testZipRoundtrip(a("1000"),   afl::io::DeflateTransform::Raw, afl::io::InflateTransform::Raw, afl::base::Bytes_t(), 1000,   3);
+    testZipRoundtrip(a("100000"), afl::io::DeflateTransform::Raw, afl::io::InflateTransform::Raw, afl::base::Bytes_t(), 100000, 3);
+    testZipRoundtrip(a("300000"), afl::io::DeflateTransform::Raw, afl::io::InflateTransform::Raw, afl::base::Bytes_t(), 300000, 2);
+}
+
+AFL_TEST("afl.io.DeflateTransform:parallel:zlib", a)
+{
+    uint8_t header[] = { 0, 0 };
+    if (testZipRoundtrip(a, afl::io::DeflateTransform::Zlib, afl::io::InflateTransform::Zlib, header, 100000, 4)) {
+        a.checkEqual("header[0]", header[0] & 15, 8);
+    }
+}
+
+AFL_TEST("afl.io.DeflateTransform:parallel:no-data", a)
+{
+    uint8_t header[] = { 0, 0 };
+    if (testZipRoundtrip(a, afl::io::DeflateTransform::Gzip, afl::io::InflateTransform::Gzip, header, 0, 2)) {
+        a.checkEqual("header[0]", header[0], 0x1F);
+        a.checkEqual("header[1]", header[1], 0x8B);
+    }
+}
@@ -123,3 +123,150 @@ AFL_TEST("afl.io.FileMapping", a)
         throw;
     }
 }
+
+/** Test mapping in windows, with access pattern hints. */
+AFL_TEST("afl.io.FileMapping:windows", a)
+{
+    using afl::base::Ref;
+    using afl::io::FileMapping;
+
+    static const char FILENAME[] = "__test.tmp";
+    static const size_t PAGE = 4096;
+    static const size_t WINDOW = 3*PAGE + 100;
+
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    Ref<afl::io::Directory> dir = fs.openDirectory(fs.getWorkingDirectoryName());
+    try {
+        {
+            // Create a file
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.Create);
+            for (int i = 1; i <= 10; ++i) {
+                uint8_t buffer[PAGE];
+                afl::base::Bytes_t(buffer).fill(uint8_t(i));
+                s->fullWrite(buffer);
+            }
+        }
+
+        // Map the file in (unaligned) windows
+        Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenRead);
+        size_t total = 0;
+        while (1) {
+            Ref<FileMapping> map = s->createVirtualMapping(WINDOW);
+            map->advise(FileMapping::SequentialAccess);
+            map->advise(FileMapping::WillNeed);
+            map->advise(FileMapping::HugePages);
+
+            afl::base::ConstBytes_t content = map->get();
+            if (content.empty()) {
+                break;
+            }
+            a.check("01. size", content.size() <= WINDOW);
+            while (const uint8_t* p = content.eat()) {
+                a.checkEqual("02. content", *p, uint8_t(total / PAGE + 1));
+                ++total;
+            }
+            map->advise(FileMapping::DontNeed);
+            a.checkEqual("03. getPos", s->getPos(), total);
+        }
+        a.checkEqual("11. total", total, 10*PAGE);
+        dir->eraseNT(FILENAME);
+    }
+    catch (...) {
+        dir->eraseNT(FILENAME);
+        throw;
+    }
+}
+
+/** Test default implementation of advise().
+    A FileMapping that implements only get() must work, and ignore hints. */
+AFL_TEST("afl.io.FileMapping:advise:default", a)
+{
+    class Tester : public afl::io::FileMapping {
+     public:
+        virtual afl::base::ConstBytes_t get() const
+            { return afl::string::toBytes("xyz"); }
+    };
+    Tester t;
+    t.advise(afl::io::FileMapping::SequentialAccess);
+    t.advise(afl::io::FileMapping::HugePages);
+    a.checkEqual("get", t.get().size(), 3U);
+    a.checkEqual("getWritable", t.getWritable().size(), 0U);
+}
+
+/** Test writable file mappings. */
+AFL_TEST("afl.io.FileMapping:writable", a)
+{
+    using afl::base::Ptr;
+    using afl::base::Ref;
+    using afl::io::FileMapping;
+
+    static const char FILENAME[] = "__test.tmp";
+    static const size_t PAGE = 4096;
+
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    Ref<afl::io::Directory> dir = fs.openDirectory(fs.getWorkingDirectoryName());
+    try {
+        {
+            // Create a file
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.Create);
+            for (int i = 1; i <= 3; ++i) {
+                uint8_t buffer[PAGE];
+                afl::base::Bytes_t(buffer).fill(uint8_t(i));
+                s->fullWrite(buffer);
+            }
+        }
+        {
+            // Private mapping of read-only file: can be modified, but file does not change
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenRead);
+            s->setPos(100);
+            Ptr<FileMapping> map = s->createWritableFileMapping(PAGE, false);
+            a.check("01. createWritableFileMapping", map.get() != 0);
+            afl::base::Bytes_t content = map->getWritable();
+            a.checkEqual("02. size", content.size(), PAGE);
+            a.checkEqual("03. get", map->get().unsafeData(), content.unsafeData());
+            a.checkEqual("04. getPos", s->getPos(), 100 + PAGE);
+            content.fill(0xAA);
+
+            // Shared mapping of read-only file fails
+            s->setPos(0);
+            a.check("11. shared", s->createWritableFileMapping(PAGE, true).get() == 0);
+        }
+        {
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenRead);
+            uint8_t buffer[PAGE];
+            s->fullRead(buffer);
+            a.checkEqual("21. file unchanged", buffer[PAGE-1], 1);
+        }
+        {
+            // Shared mapping: modifications go to the file; mapping does not extend the file
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenWrite);
+            s->setPos(PAGE + 10);
+            Ptr<FileMapping> map = s->createWritableFileMapping(10*PAGE, true);
+            a.check("31. createWritableFileMapping", map.get() != 0);
+            afl::base::Bytes_t content = map->getWritable();
+            a.checkEqual("32. size", content.size(), 2*PAGE - 10);
+            content.fill(0x55);
+        }
+        {
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenRead);
+            uint8_t buffer[3*PAGE];
+            s->fullRead(buffer);
+            a.checkEqual("41. file", buffer[PAGE + 9], 2);
+            a.checkEqual("42. file", buffer[PAGE + 10], 0x55);
+            a.checkEqual("43. file", buffer[3*PAGE - 1], 0x55);
+            a.checkEqual("44. size", s->getSize(), 3*PAGE);
+        }
+        {
+            // Read-only mapping is not writable
+            Ref<afl::io::Stream> s = dir->openFile(FILENAME, fs.OpenWrite);
+            Ptr<FileMapping> map = s->createFileMapping(PAGE);
+            a.check("51. createFileMapping", map.get() != 0);
+            a.checkEqual("52. getWritable", map->getWritable().size(), 0U);
+        }
+        dir->eraseNT(FILENAME);
+    }
+    catch (...) {
+        dir->eraseNT(FILENAME);
+        throw;
+    }
+}
@@ -0,0 +1,431 @@
+/**
+  *  \file test/afl/io/inflatertest.cpp
+  *  \brief Test for afl::io::Inflater
+  */
+
+#include "afl/io/inflater.hpp"
+
+#include "afl/base/growablememory.hpp"
+#include "afl/except/invaliddataexception.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/string/format.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+using afl::io::Inflater;
+
+namespace {
+    /* Stored block: "hello" */
+    const uint8_t STORED[] = { 0x01, 0x05, 0x00, 0xfa, 0xff, 'h', 'e', 'l', 'l', 'o' };
+
+    /* Fixed-code block: "hello, hello, hello, world" */
+    const uint8_t FIXED[] = {
+        0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0xca, 0xf3, 0x8b, 0x72, 0x52, 0x00
+    };
+
+    /* Fixed-code block: "A", followed by a match of length 3, distance 1 */
+    const uint8_t FIXED_MATCH[] = { 0x73, 0x04, 0x02, 0x00 };
+
+    /* Dynamic-code block: getDynamicText() */
+    const uint8_t DYNAMIC[] = {
+        0x95, 0xd5, 0x59, 0x4e, 0xc3, 0x30, 0x14, 0x46, 0xe1, 0x77, 0x56, 0x71, 0x97, 0x50, 0xdf, 0x1b,
+        0x3b, 0x36, 0x6b, 0xe8, 0x26, 0x28, 0x84, 0x92, 0x96, 0x36, 0xd0, 0x81, 0x69, 0xf5, 0x88, 0x4a,
+        0x48, 0xfe, 0x1f, 0xcf, 0x73, 0x74, 0x14, 0x0f, 0x9f, 0xed, 0xf5, 0x7c, 0x9c, 0x6c, 0x75, 0x6f,
+        0x97, 0x97, 0xc9, 0xde, 0xaf, 0xf3, 0xe3, 0xde, 0x36, 0xa7, 0xe5, 0xf3, 0x68, 0xcf, 0xcb, 0x97,
+        0xed, 0xae, 0x87, 0xb7, 0xb3, 0x2d, 0x1f, 0xd3, 0xe9, 0xf6, 0xf9, 0xf5, 0xe1, 0xe7, 0xdb, 0x9e,
+        0x96, 0xad, 0xad, 0xec, 0x32, 0x1f, 0xa6, 0xf3, 0xdd, 0xfa, 0xaf, 0x4d, 0xac, 0x4d, 0x7d, 0xeb,
+        0xac, 0x1d, 0xfa, 0x36, 0x58, 0xdb, 0xfa, 0x76, 0x80, 0x63, 0x2e, 0x7d, 0x9c, 0x59, 0xec, 0xb9,
+        0x8f, 0x0b, 0x8b, 0x43, 0xfe, 0x3c, 0xc2, 0xe5, 0x92, 0x39, 0x57, 0x16, 0x17, 0x59, 0xec, 0xc6,
+        0xe2, 0x2a, 0xbb, 0x9c, 0x20, 0xaf, 0x90, 0x18, 0xfa, 0x72, 0x19, 0x77, 0xa2, 0xc2, 0x46, 0xa9,
+        0xa1, 0xb1, 0xd1, 0xa5, 0x86, 0xca, 0x34, 0x86, 0xca, 0x42, 0x57, 0x1c, 0x32, 0x2b, 0xfa, 0x6f,
+        0xe8, 0xac, 0x89, 0xf0, 0x04, 0xa1, 0x85, 0x6e, 0x37, 0x94, 0x36, 0xca, 0x5d, 0xe4, 0x50, 0x5a,
+        0x92, 0x79, 0x3b, 0xa4, 0x96, 0x65, 0xe4, 0x0e, 0xa9, 0x35, 0x39, 0xda, 0x0e, 0xa9, 0x0d, 0xc2,
+        0xdc, 0x21, 0xb5, 0xa6, 0xb7, 0x30, 0xb4, 0x36, 0xe8, 0xbc, 0xa1, 0xb5, 0xa6, 0x23, 0x87, 0xd6,
+        0xb2, 0xee, 0x37, 0xb4, 0x56, 0x25, 0x86, 0xd4, 0x8a, 0x30, 0x0f, 0x48, 0xcd, 0xe5, 0x66, 0x09,
+        0x48, 0xad, 0xca, 0xc8, 0x03, 0x52, 0xcb, 0xfa, 0x70, 0x42, 0x6a, 0x2e, 0x87, 0x24, 0x20, 0xb5,
+        0x2a, 0x8f, 0x50, 0x40, 0x6a, 0x45, 0xa0, 0x06, 0x7d, 0x3d, 0x75, 0xc7, 0x20, 0xb5, 0xa4, 0xff,
+        0xa6, 0xd4, 0xe4, 0x78, 0x07, 0xb5, 0xf6, 0x5f, 0xff, 0x02
+    };
+
+    String_t getDynamicText()
+    {
+        String_t result;
+        for (int i = 0; i < 40; ++i) {
+            result += afl::string::Format("Line %d: the quick brown fox jumps over the lazy dog %d times\n", i, i*i%97);
+        }
+        return result;
+    }
+
+    /* Decode a stream in chunks.
+       \param a         Asserter
+       \param in        [in/out] Compressed data; returns unprocessed remainder
+       \param inChunk   Maximum input chunk size
+       \param outChunk  Maximum output chunk size
+       \return decoded data */
+    String_t decodeStream(afl::test::Assert a, ConstBytes_t& in, size_t inChunk, size_t outChunk)
+    {
+        Inflater testee;
+        String_t result;
+        bool finished = false;
+        while (!finished) {
+            ConstBytes_t inPart = in.subrange(0, inChunk);
+            const size_t inSize = inPart.size();
+            uint8_t buffer[4096];
+            afl::base::Bytes_t outPart = afl::base::Bytes_t(buffer).trim(outChunk);
+            finished = testee.inflate(inPart, outPart);
+            in.split(inSize - inPart.size());
+            result.append(reinterpret_cast<const char*>(outPart.unsafeData()), outPart.size());
+
+            // Must make progress
+            if (!finished && outPart.empty() && inSize == inPart.size()) {
+                a.fail("no progress");
+                break;
+            }
+        }
+        return result;
+    }
+
+    /* Bit stream writer */
+    class BitWriter {
+     public:
+        BitWriter()
+            : m_data(), m_bits(0), m_numBits(0)
+            { }
+
+        /* Add a value, least significant bit first */
+        void put(uint32_t value, int n)
+            {
+                for (int i = 0; i < n; ++i) {
+                    putBit((value >> i) & 1);
+                }
+            }
+
+        /* Add a Huffman code, most significant bit first */
+        void putCode(uint32_t code, int n)
+            {
+                for (int i = n; i > 0; --i) {
+                    putBit((code >> (i-1)) & 1);
+                }
+            }
+
+        ConstBytes_t finish()
+            {
+                while (m_numBits != 0) {
+                    putBit(0);
+                }
+                return m_data;
+            }
+
+     private:
+        afl::base::GrowableBytes_t m_data;
+        uint32_t m_bits;
+        int m_numBits;
+
+        void putBit(uint32_t bit)
+            {
+                m_bits |= bit << m_numBits;
+                if (++m_numBits == 8) {
+                    m_data.append(uint8_t(m_bits));
+                    m_bits = 0;
+                    m_numBits = 0;
+                }
+            }
+    };
+
+    /* Create a dynamic-code block encoding "A", with the given code lengths.
+       The code length code has symbols 0, 1, 2 (length 2 each) and 18 (repeatLength).
+       The literal code has symbol 0 (zeroLength), 'A' (literalLength) and end-of-block (eobLength);
+       the distance code has one symbol (distanceLength). */
+    void makeDynamicBlock(BitWriter& out, int repeatLength, uint8_t zeroLength, uint8_t literalLength, uint8_t eobLength, uint8_t distanceLength)
+    {
+        // Header: final, dynamic, 257 literals, 1 distance, 18 code length codes
+        out.put(1, 1);
+        out.put(2, 2);
+        out.put(0, 5);
+        out.put(0, 5);
+        out.put(14, 4);
+
+        // Code length code lengths, in order 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1
+        static const uint8_t ORDER[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1 };
+        for (size_t i = 0; i < sizeof(ORDER); ++i) {
+            switch (ORDER[i]) {
+             case 0:
+             case 1:
+             case 2:  out.put(2, 3); break;
+             case 18: out.put(uint32_t(repeatLength), 3); break;
+             default: out.put(0, 3); break;
+            }
+        }
+
+        // Code lengths: symbol n < 3 has code n, 18 has code 3 (length 2) or 6 (length 3)
+        out.putCode(zeroLength, 2);
+        out.putCode(repeatLength == 2 ? 3 : 6, repeatLength); out.put(64-11, 7);       // 1..64
+        out.putCode(literalLength, 2);                                                    // 65
+        out.putCode(repeatLength == 2 ? 3 : 6, repeatLength); out.put(138-11, 7);      // 66..203
+        out.putCode(repeatLength == 2 ? 3 : 6, repeatLength); out.put(52-11, 7);       // 204..255
+        out.putCode(eobLength, 2);                                                        // 256
+        out.putCode(distanceLength, 2);
+
+        // Data: 'A' (code 0), end (code 1)
+        out.putCode(0, 1);
+        out.putCode(1, 1);
+    }
+
+    /* Decode a dynamic-code block created by makeDynamicBlock(). */
+    String_t decodeDynamicBlock(afl::test::Assert a, int repeatLength, uint8_t zeroLength, uint8_t literalLength, uint8_t eobLength, uint8_t distanceLength)
+    {
+        BitWriter w;
+        makeDynamicBlock(w, repeatLength, zeroLength, literalLength, eobLength, distanceLength);
+        ConstBytes_t in = w.finish();
+        return decodeStream(a, in, 100, 100);
+    }
+
+    /* Decode data in chunks. */
+    String_t decode(afl::test::Assert a, ConstBytes_t in, size_t inChunk, size_t outChunk)
+    {
+        return decodeStream(a, in, inChunk, outChunk);
+    }
+}
+
+/** Test stored block. */
+AFL_TEST("afl.io.Inflater:stored", a)
+{
+    a.checkEqual("full",   decode(a, ConstBytes_t(STORED), 1000, 1000), "hello");
+    a.checkEqual("single", decode(a, ConstBytes_t(STORED), 1, 1), "hello");
+
+    // Header only, followed by empty input (no data pointer)
+    Inflater testee;
+    ConstBytes_t in = ConstBytes_t(STORED).subrange(0, 5);
+    uint8_t buffer[100];
+    afl::base::Bytes_t out(buffer);
+    a.check("header: not finished", !testee.inflate(in, out));
+    a.check("header: all consumed", in.empty());
+
+    ConstBytes_t empty;
+    afl::base::Bytes_t out2(buffer);
+    a.check("empty: not finished", !testee.inflate(empty, out2));
+    a.check("empty: no output", out2.empty());
+}
+
+/** Test fixed-code block. */
+AFL_TEST("afl.io.Inflater:fixed", a)
+{
+    a.checkEqual("full",   decode(a, ConstBytes_t(FIXED), 1000, 1000), "hello, hello, hello, world");
+    a.checkEqual("single", decode(a, ConstBytes_t(FIXED), 1, 1), "hello, hello, hello, world");
+    a.checkEqual("match",  decode(a, ConstBytes_t(FIXED_MATCH), 1000, 1000), "AAAA");
+}
+
+/** Test dynamic-code block, with different chunk sizes. */
+AFL_TEST("afl.io.Inflater:dynamic", a)
+{
+    const String_t expect = getDynamicText();
+    a.checkEqual("full",   decode(a, ConstBytes_t(DYNAMIC), 1000, 4096), expect);
+    a.checkEqual("in1",    decode(a, ConstBytes_t(DYNAMIC), 1, 4096), expect);
+    a.checkEqual("out1",   decode(a, ConstBytes_t(DYNAMIC), 1000, 1), expect);
+    a.checkEqual("in7",    decode(a, ConstBytes_t(DYNAMIC), 7, 13), expect);
+    a.checkEqual("in17",   decode(a, ConstBytes_t(DYNAMIC), 17, 100), expect);
+}
+
+/** Test that data following the stream is not consumed. */
+AFL_TEST("afl.io.Inflater:trailing-data", a)
+{
+    afl::base::GrowableBytes_t data;
+    data.append(ConstBytes_t(DYNAMIC));
+    data.append(afl::string::toBytes("12345678"));
+
+    ConstBytes_t in(data);
+    a.checkEqual("full content", decodeStream(a, in, 10000, 4096), getDynamicText());
+    a.checkEqualContent("full remainder", in, afl::string::toBytes("12345678"));
+
+    ConstBytes_t in2(data);
+    a.checkEqual("piecewise content", decodeStream(a, in2, 5, 4096), getDynamicText());
+    a.checkEqualContent("piecewise remainder", in2, afl::string::toBytes("12345678"));
+
+    afl::base::GrowableBytes_t data3;
+    data3.append(ConstBytes_t(STORED));
+    data3.append(afl::string::toBytes("xy"));
+    ConstBytes_t in3(data3);
+    a.checkEqual("stored content", decodeStream(a, in3, 10000, 4096), "hello");
+    a.checkEqualContent("stored remainder", in3, afl::string::toBytes("xy"));
+}
+
+/** Test truncated data. */
+AFL_TEST("afl.io.Inflater:truncated", a)
+{
+    Inflater testee;
+    ConstBytes_t in = ConstBytes_t(DYNAMIC).subrange(0, 100);
+    uint8_t buffer[10000];
+    afl::base::Bytes_t out(buffer);
+    a.check("not finished", !testee.inflate(in, out));
+    a.check("all consumed", in.empty());
+
+    afl::base::Bytes_t out2(buffer);
+    a.check("still not finished", !testee.inflate(in, out2));
+    a.check("no more output", out2.empty());
+}
+
+/** Test invalid data. */
+AFL_TEST("afl.io.Inflater:invalid", a)
+{
+    // Block type 3
+    static const uint8_t BAD_TYPE[] = { 0x07 };
+    AFL_CHECK_THROWS(a("bad type"), decode(a, ConstBytes_t(BAD_TYPE), 100, 100), afl::except::InvalidDataException);
+
+    // Stored block with bad length check
+    static const uint8_t BAD_LENGTH[] = { 0x01, 0x05, 0x00, 0x00, 0x00, 'h', 'e', 'l', 'l', 'o' };
+    AFL_CHECK_THROWS(a("bad length"), decode(a, ConstBytes_t(BAD_LENGTH), 100, 100), afl::except::InvalidDataException);
+
+    // Match at beginning
+    static const uint8_t BAD_DISTANCE[] = { 0x03, 0x02, 0x00 };
+    AFL_CHECK_THROWS(a("bad distance"), decode(a, ConstBytes_t(BAD_DISTANCE), 100, 100), afl::except::InvalidDataException);
+
+    // Length code 286
+    static const uint8_t BAD_CODE[] = { 0x1b, 0x03, 0x00 };
+    AFL_CHECK_THROWS(a("bad code"), decode(a, ConstBytes_t(BAD_CODE), 100, 100), afl::except::InvalidDataException);
+}
+
+/** Test round-trip with large data, exercising window sliding. */
+AFL_TEST("afl.io.Inflater:roundtrip", a)
+{
+    if (!afl::io::DeflateTransform::isAvailable()) {
+        return;
+    }
+
+    // Generate data: text with varying repetitiveness, and some incompressible parts
+    afl::base::GrowableBytes_t data;
+    uint32_t seed = 1;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        if (i % 1000 < 100) {
+            data.append(uint8_t(seed >> 16));
+        } else {
+            data.append(afl::string::toBytes(afl::string::Format("item %d, value %d\n", i % 300, (seed >> 16) % 50)));
+        }
+    }
+
+    // Compress
+    afl::io::DeflateTransform tx(afl::io::DeflateTransform::Raw);
+    afl::base::GrowableBytes_t compressed;
+    ConstBytes_t in(data);
+    tx.flush();
+    while (1) {
+        uint8_t buffer[4096];
+        afl::base::Bytes_t out(buffer);
+        tx.transform(in, out);
+        if (out.empty() && in.empty()) {
+            break;
+        }
+        compressed.append(out);
+    }
+
+    // Decompress
+    String_t result = decode(a, ConstBytes_t(compressed), 3000, 1000);
+    a.checkEqual("size", result.size(), data.size());
+    a.checkEqualContent("content", afl::string::toBytes(result), ConstBytes_t(data));
+}
+
+/** Test checkpoints: resuming at a checkpoint produces the remaining data. */
+AFL_TEST("afl.io.Inflater:checkpoints", a)
+{
+    if (!afl::io::DeflateTransform::isAvailable()) {
+        return;
+    }
+
+    // Generate and compress data
+    afl::base::GrowableBytes_t data;
+    for (int i = 0; i < 20000; ++i) {
+        data.append(afl::string::toBytes(afl::string::Format("line %d, value %d\n", i, i*i % 1000)));
+    }
+    afl::io::DeflateTransform tx(afl::io::DeflateTransform::Raw);
+    afl::base::GrowableBytes_t compressed;
+    ConstBytes_t in(data);
+    tx.flush();
+    while (1) {
+        uint8_t buffer[4096];
+        afl::base::Bytes_t out(buffer);
+        tx.transform(in, out);
+        if (out.empty() && in.empty()) {
+            break;
+        }
+        compressed.append(out);
+    }
+
+    // Decode with checkpoints
+    Inflater testee;
+    testee.setCheckpointSpacing(50000);
+    a.checkNull("no checkpoint before start", testee.findCheckpoint(0));
+    {
+        ConstBytes_t cin(compressed);
+        uint8_t buffer[4096];
+        afl::base::Bytes_t out(buffer);
+        while (!testee.inflate(cin, out)) {
+            out = buffer;
+        }
+    }
+
+    // First checkpoint is at start
+    const Inflater::Checkpoint& cp0 = a.checkNonNull("first", testee.findCheckpoint(1000));
+    a.checkEqual("first input", cp0.inputPosition, 0U);
+    a.checkEqual("first output", cp0.outputPosition, 0U);
+
+    // Resume at last checkpoint
+    const Inflater::Checkpoint& cp = a.checkNonNull("last", testee.findCheckpoint(data.size()));
+    a.checkGreaterEqual("last output", cp.outputPosition, 50000U);
+    a.checkEqual("last window", cp.window.size(), 32768U);
+
+    const size_t outputPosition = size_t(cp.outputPosition);
+    testee.resume(cp);
+    ConstBytes_t rest = ConstBytes_t(compressed).subrange(size_t(cp.inputPosition));
+    String_t tail;
+    while (1) {
+        uint8_t buffer[4096];
+        afl::base::Bytes_t out(buffer);
+        bool finished = testee.inflate(rest, out);
+        tail.append(reinterpret_cast<const char*>(out.unsafeData()), out.size());
+        if (finished) {
+            break;
+        }
+        a.check("progress", !out.empty());
+    }
+    a.checkEqualContent("content", afl::string::toBytes(tail), ConstBytes_t(data).subrange(outputPosition));
+
+    // Resume at first checkpoint, which has an empty window
+    testee.resume(cp0);
+    ConstBytes_t all(compressed);
+    String_t full;
+    while (1) {
+        uint8_t buffer[4096];
+        afl::base::Bytes_t out(buffer);
+        bool finished = testee.inflate(all, out);
+        full.append(reinterpret_cast<const char*>(out.unsafeData()), out.size());
+        if (finished) {
+            break;
+        }
+        a.check("progress from start", !out.empty());
+    }
+    a.checkEqualContent("full content", afl::string::toBytes(full), ConstBytes_t(data));
+}
+
+/** Test dynamic-code block headers with invalid code sets.
+    Over-subscribed and incomplete codes must be rejected;
+    like zlib, we accept a single distance code of length 1, and no distance code at all. */
+AFL_TEST("afl.io.Inflater:invalid:dynamic-header", a)
+{
+    // Valid: 'A' and end-of-block have length 1, single distance code of length 1
+    a.checkEqual("valid", decodeDynamicBlock(a, 2, 0, 1, 1, 1), "A");
+
+    // Valid: no distance code
+    a.checkEqual("no distance", decodeDynamicBlock(a, 2, 0, 1, 1, 0), "A");
+
+    // Incomplete code length code (symbol 18 has length 3)
+    AFL_CHECK_THROWS(a("incomplete code lengths"), decodeDynamicBlock(a, 3, 0, 1, 1, 1), afl::except::InvalidDataException);
+
+    // Incomplete literal code ('A' has length 2)
+    AFL_CHECK_THROWS(a("incomplete literals"), decodeDynamicBlock(a, 2, 0, 2, 1, 1), afl::except::InvalidDataException);
+
+    // Over-subscribed literal code (three codes of length 1)
+    AFL_CHECK_THROWS(a("over-subscribed literals"), decodeDynamicBlock(a, 2, 1, 1, 1, 1), afl::except::InvalidDataException);
+
+    // Incomplete distance code (single code, but length 2)
+    AFL_CHECK_THROWS(a("incomplete distances"), decodeDynamicBlock(a, 2, 0, 1, 1, 2), afl::except::InvalidDataException);
+}
@@ -0,0 +1,195 @@
+/**
+  *  \file test/afl/io/inflatestreamtest.cpp
+  *  \brief Test for afl::io::InflateStream
+  */
+
+#include "afl/io/inflatestream.hpp"
+
+#include "afl/base/growablememory.hpp"
+#include "afl/except/fileproblemexception.hpp"
+#include "afl/except/filetooshortexception.hpp"
+#include "afl/except/invaliddataexception.hpp"
+#include "afl/io/constmemorystream.hpp"
+#include "afl/io/deflatetransform.hpp"
+#include "afl/io/internalstream.hpp"
+#include "afl/string/format.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+using afl::base::GrowableBytes_t;
+using afl::base::Ref;
+using afl::io::ConstMemoryStream;
+using afl::io::InflateStream;
+
+namespace {
+    /* Fixed-code block: "hello, hello, hello, world" */
+    const uint8_t FIXED[] = {
+        0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0xca, 0xf3, 0x8b, 0x72, 0x52, 0x00
+    };
+
+    /* Same, as gzip file with file name, and trailer */
+    const uint8_t FIXED_GZ[] = {
+        0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 'x', '.', 't', 'x', 't', 0x00,
+        0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0xca, 0xf3, 0x8b, 0x72, 0x52, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00
+    };
+
+    /* Same, as zlib stream (Adler-32 not verified) */
+    const uint8_t FIXED_ZLIB[] = {
+        0x78, 0x9c,
+        0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0xca, 0xf3, 0x8b, 0x72, 0x52, 0x00,
+        0x00, 0x00, 0x00, 0x00
+    };
+
+    /* Read n bytes from stream into a string */
+    String_t readString(afl::io::Stream& s, size_t n)
+    {
+        GrowableBytes_t buffer;
+        buffer.resize(n);
+        buffer.trim(s.read(buffer));
+        return afl::string::fromBytes(buffer);
+    }
+
+    /* Generate test data: text with varying repetitiveness, and some incompressible parts */
+    void makeData(GrowableBytes_t& data)
+    {
+        uint32_t seed = 1;
+        for (int i = 0; i < 30000; ++i) {
+            seed = seed * 1103515245 + 12345;
+            if (i % 1000 < 100) {
+                data.append(uint8_t(seed >> 16));
+            } else {
+                data.append(afl::string::toBytes(afl::string::Format("item %d, value %d\n", i % 300, (seed >> 16) % 50)));
+            }
+        }
+    }
+
+    /* Compress data */
+    void compress(GrowableBytes_t& out, ConstBytes_t in, afl::io::DeflateTransform::Personality pers)
+    {
+        afl::io::DeflateTransform tx(pers);
+        tx.flush();
+        while (1) {
+            uint8_t buffer[4096];
+            afl::base::Bytes_t part(buffer);
+            tx.transform(in, part);
+            if (part.empty() && in.empty()) {
+                break;
+            }
+            out.append(part);
+        }
+    }
+
+    /* Verify random access on a stream containing the given data */
+    void verifyRandomAccess(afl::test::Assert a, afl::io::Stream& s, ConstBytes_t data)
+    {
+        static const size_t POSITIONS[] = { 300000, 10, 150000, 150001, 149000, 0, 400000, 5000, 200000 };
+        for (size_t i = 0; i < sizeof(POSITIONS)/sizeof(POSITIONS[0]); ++i) {
+            const size_t pos = POSITIONS[i] % data.size();
+            afl::test::Assert me(a(afl::string::Format("pos %d", pos)));
+            s.setPos(pos);
+            me.checkEqual("getPos", s.getPos(), pos);
+
+            uint8_t buffer[1000];
+            afl::base::Bytes_t b(buffer);
+            b.trim(s.read(b));
+            me.checkEqualContent("content", ConstBytes_t(b), data.subrange(pos, sizeof(buffer)));
+        }
+    }
+}
+
+/** Test basic operation with a raw stream. */
+AFL_TEST("afl.io.InflateStream:raw", a)
+{
+    InflateStream testee(*new ConstMemoryStream(FIXED), InflateStream::Raw);
+    a.checkEqual("getCapabilities", testee.getCapabilities(), afl::io::Stream::CanRead | afl::io::Stream::CanSeek);
+    a.checkEqual("getSize 1", testee.getSize(), afl::io::Stream::FileSize_t(-1));
+    a.checkEqual("read 1", readString(testee, 5), "hello");
+    a.checkEqual("getPos", testee.getPos(), 5U);
+
+    // Skip forward
+    testee.setPos(14);
+    a.checkEqual("read 2", readString(testee, 100), "hello, world");
+    a.checkEqual("getSize 2", testee.getSize(), 26U);
+
+    // Go back
+    testee.setPos(7);
+    a.checkEqual("read 3", readString(testee, 5), "hello");
+
+    // Beyond end
+    testee.setPos(1000);
+    a.checkEqual("getPos end", testee.getPos(), 26U);
+    a.checkEqual("read end", readString(testee, 100), "");
+
+    // Cannot write
+    AFL_CHECK_THROWS(a("write"), testee.write(afl::string::toBytes("x")), afl::except::FileProblemException);
+}
+
+/** Test gzip and zlib headers. */
+AFL_TEST("afl.io.InflateStream:headers", a)
+{
+    InflateStream gz(*new ConstMemoryStream(FIXED_GZ), InflateStream::Gzip);
+    a.checkEqual("gzip", readString(gz, 100), "hello, hello, hello, world");
+    gz.setPos(21);
+    a.checkEqual("gzip seek", readString(gz, 100), "world");
+
+    InflateStream zl(*new ConstMemoryStream(FIXED_ZLIB), InflateStream::Zlib, 0);
+    zl.setPos(7);
+    a.checkEqual("zlib seek", readString(zl, 5), "hello");
+    zl.setPos(0);
+    a.checkEqual("zlib", readString(zl, 100), "hello, hello, hello, world");
+
+    // Errors
+    InflateStream bad(*new ConstMemoryStream(FIXED), InflateStream::Gzip);
+    AFL_CHECK_THROWS(a("bad header"), readString(bad, 100), afl::except::InvalidDataException);
+    InflateStream shortFile(*new ConstMemoryStream(ConstBytes_t(FIXED_GZ).subrange(0, 12)), InflateStream::Gzip);
+    AFL_CHECK_THROWS(a("short file"), readString(shortFile, 100), afl::except::FileTooShortException);
+}
+
+/** Test random access using checkpoints on large data. */
+AFL_TEST("afl.io.InflateStream:checkpoints", a)
+{
+    if (!afl::io::DeflateTransform::isAvailable()) {
+        return;
+    }
+
+    GrowableBytes_t data;
+    makeData(data);
+    GrowableBytes_t compressed;
+    compress(compressed, data, afl::io::DeflateTransform::Gzip);
+
+    // Random access before reading sequentially
+    {
+        InflateStream testee(*new ConstMemoryStream(compressed), InflateStream::Gzip, 20000);
+        verifyRandomAccess(a("fresh"), testee, data);
+    }
+
+    // Sequential read, then random access
+    {
+        InflateStream testee(*new ConstMemoryStream(compressed), InflateStream::Gzip, 20000);
+        afl::io::InternalStream out;
+        out.copyFrom(testee);
+        a.checkEqual("size", testee.getSize(), data.size());
+        a.checkEqualContent("content", out.getContent(), ConstBytes_t(data));
+        verifyRandomAccess(a("sequential"), testee, data);
+    }
+
+    // Checkpoints disabled
+    {
+        InflateStream testee(*new ConstMemoryStream(compressed), InflateStream::Gzip, 0);
+        verifyRandomAccess(a("disabled"), testee, data);
+    }
+}
+
+/** Test access through child streams. */
+AFL_TEST("afl.io.InflateStream:child", a)
+{
+    Ref<InflateStream> testee = *new InflateStream(*new ConstMemoryStream(FIXED), InflateStream::Raw);
+    Ref<afl::io::Stream> c1 = testee->createChild();
+    Ref<afl::io::Stream> c2 = testee->createChild();
+    a.checkEqual("read 1", readString(*c1, 7), "hello, ");
+    a.checkEqual("read 2", readString(*c2, 5), "hello");
+    a.checkEqual("read 1 again", readString(*c1, 5), "hello");
+    a.checkEqual("getPos", c2->getPos(), 5U);
+    a.checkEqual("getName", c1->getName(), testee->getName());
+}
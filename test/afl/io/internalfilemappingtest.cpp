@@ -46,3 +46,16 @@ AFL_TEST("afl.io.InternalFileMapping:from-memory", a)
         a.checkEqual("content", *out.at(i-1), i);
     }
 }
+
+/** Test advise(). Must not change the content. */
+AFL_TEST("afl.io.InternalFileMapping:advise", a)
+{
+    afl::base::GrowableBytes_t in;
+    in.append(42);
+
+    afl::io::InternalFileMapping testee(in);
+    testee.advise(afl::io::FileMapping::RandomAccess);
+    testee.advise(afl::io::FileMapping::DontNeed);
+    a.checkEqual("size", testee.get().size(), 1U);
+    a.checkEqual("content", *testee.get().at(0), 42);
+}
@@ -412,3 +412,56 @@ AFL_TEST("afl.io.json.Parser:hash:dup-null", a) {
     a.checkEqual("num names", hash.getKeys().getNumNames(), 1U);
     a.checkNull("check value", hash.get("qa"));
 }
+
+/*
+ *  Shared keys
+ */
+
+// Records with identical keys share their keys
+AFL_TEST("afl.io.json.Parser:hash:shared-keys", a) {
+    std::auto_ptr<afl::data::Value> result(parseString("[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"b\"},{\"id\":3,\"name\":\"c\"}]"));
+    Vector& vec = *a.checkNonNull("must be VectorValue", dynamic_cast<VectorValue*>(result.get())).getValue();
+    a.checkEqual("num elements", vec.size(), 3U);
+
+    Hash& h0 = *a.checkNonNull("must be HashValue 0", dynamic_cast<HashValue*>(vec[0])).getValue();
+    Hash& h1 = *a.checkNonNull("must be HashValue 1", dynamic_cast<HashValue*>(vec[1])).getValue();
+    Hash& h2 = *a.checkNonNull("must be HashValue 2", dynamic_cast<HashValue*>(vec[2])).getValue();
+    a.checkEqual("shared 1", &h0.getKeys(), &h1.getKeys());
+    a.checkEqual("shared 2", &h0.getKeys(), &h2.getKeys());
+
+    a.checkEqual("value 0", a.checkNonNull("type 0", dynamic_cast<IntegerValue*>(h0.get("id"))).getValue(), 1);
+    a.checkEqual("value 2", a.checkNonNull("type 2", dynamic_cast<StringValue*>(h2.get("name"))).getValue(), "c");
+
+    // Modifying one hash does not affect the others
+    h1.setNew("extra", new IntegerValue(9));
+    a.check("unshared", &h0.getKeys() != &h1.getKeys());
+    a.checkEqual("num names 0", h0.getKeys().getNumNames(), 2U);
+    a.checkEqual("num names 1", h1.getKeys().getNumNames(), 3U);
+    a.checkNull("extra 0", h0.get("extra"));
+    a.checkNonNull("extra 1", h1.get("extra"));
+}
+
+// Records with different keys, or keys in different order, do not share keys
+AFL_TEST("afl.io.json.Parser:hash:different-keys", a) {
+    std::auto_ptr<afl::data::Value> result(parseString("[{\"id\":1,\"name\":\"a\"},{\"id\":2},{\"id\":3,\"name\":\"c\",\"x\":4},{\"name\":\"d\",\"id\":5},{\"id\":6,\"id\":7}]"));
+    Vector& vec = *a.checkNonNull("must be VectorValue", dynamic_cast<VectorValue*>(result.get())).getValue();
+    a.checkEqual("num elements", vec.size(), 5U);
+
+    Hash& h0 = *a.checkNonNull("must be HashValue 0", dynamic_cast<HashValue*>(vec[0])).getValue();
+    Hash& h1 = *a.checkNonNull("must be HashValue 1", dynamic_cast<HashValue*>(vec[1])).getValue();
+    Hash& h2 = *a.checkNonNull("must be HashValue 2", dynamic_cast<HashValue*>(vec[2])).getValue();
+    Hash& h3 = *a.checkNonNull("must be HashValue 3", dynamic_cast<HashValue*>(vec[3])).getValue();
+    Hash& h4 = *a.checkNonNull("must be HashValue 4", dynamic_cast<HashValue*>(vec[4])).getValue();
+
+    a.checkEqual("num names 0", h0.getKeys().getNumNames(), 2U);
+    a.checkEqual("num names 1", h1.getKeys().getNumNames(), 1U);
+    a.checkEqual("num names 2", h2.getKeys().getNumNames(), 3U);
+    a.checkEqual("num names 3", h3.getKeys().getNumNames(), 2U);
+    a.checkEqual("num names 4", h4.getKeys().getNumNames(), 1U);
+
+    a.checkEqual("value 1", a.checkNonNull("type 1", dynamic_cast<IntegerValue*>(h1.get("id"))).getValue(), 2);
+    a.checkNull("name 1", h1.get("name"));
+    a.checkEqual("value 2", a.checkNonNull("type 2", dynamic_cast<IntegerValue*>(h2.get("x"))).getValue(), 4);
+    a.checkEqual("value 3", a.checkNonNull("type 3", dynamic_cast<IntegerValue*>(h3.get("id"))).getValue(), 5);
+    a.checkEqual("value 4", a.checkNonNull("type 4", dynamic_cast<IntegerValue*>(h4.get("id"))).getValue(), 7);
+}
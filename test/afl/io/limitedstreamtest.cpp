@@ -50,3 +50,39 @@ AFL_TEST("afl.io.LimitedStream", a)
     a.check("32. getCapabilities", (cap & afl::io::Stream::CanWrite) != 0);
     a.check("33. getCapabilities", (cap & afl::io::Stream::CanSeek) != 0);
 }
+
+/** Test that reading does not depend on the parent's position. */
+AFL_TEST("afl.io.LimitedStream:shared-parent", a)
+{
+    afl::io::InternalStream is;
+    for (uint8_t i = 0; i < 100; ++i) {
+        is.write(afl::base::fromObject(i));
+    }
+
+    // Two views on the same parent
+    afl::io::LimitedStream one(is.createChild(), 20, 10);
+    afl::io::LimitedStream two(is.createChild(), 50, 10);
+    afl::base::Ref<afl::io::Stream> parent = is.createChild();
+
+    uint8_t byte[1];
+    a.checkEqual("01. read", one.read(byte), 1U);
+    a.checkEqual("02. data", byte[0], 20U);
+    a.checkEqual("03. read", two.read(byte), 1U);
+    a.checkEqual("04. data", byte[0], 50U);
+
+    parent->setPos(90);
+    a.checkEqual("11. read", one.read(byte), 1U);
+    a.checkEqual("12. data", byte[0], 21U);
+    a.checkEqual("13. read", two.read(byte), 1U);
+    a.checkEqual("14. data", byte[0], 51U);
+
+    // Write goes to correct place
+    uint8_t value = 77;
+    a.checkEqual("21. write", one.write(afl::base::fromObject(value)), 1U);
+    a.checkEqual("22. read", one.read(byte), 1U);
+    a.checkEqual("23. data", byte[0], 23U);
+
+    parent->setPos(22);
+    a.checkEqual("31. read", parent->read(byte), 1U);
+    a.checkEqual("32. data", byte[0], 77U);
+}
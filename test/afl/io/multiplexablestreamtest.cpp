@@ -7,6 +7,8 @@
 
 #include <stdexcept>
 #include "afl/io/memorystream.hpp"
+#include "afl/sys/semaphore.hpp"
+#include "afl/sys/thread.hpp"
 #include "afl/test/testrunner.hpp"
 
 // We'll be using a MemoryStream as sample implementation.
@@ -124,3 +126,167 @@ AFL_TEST("afl.io.MultiplexableStream:setPos", a)
     afl::base::Ref<afl::io::Stream> child(t.createChild());
     child->setPos(23);
 }
+
+// Test concurrent positional reads.
+// If the master supports it, children read using readAt() and never touch the master's position.
+AFL_TEST("afl.io.MultiplexableStream:readAt", a)
+{
+    class Tester : public afl::io::MultiplexableStream {
+     public:
+        virtual size_t read(Bytes_t /*m*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual size_t write(ConstBytes_t /*m*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual void flush()
+            { throw std::runtime_error("unexpected"); }
+        virtual void setPos(FileSize_t /*pos*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual FileSize_t getPos()
+            { throw std::runtime_error("unexpected"); }
+        virtual FileSize_t getSize()
+            { return 10; }
+        virtual uint32_t getCapabilities()
+            { return CanRead | CanSeek; }
+        virtual String_t getName()
+            { return "<name>"; }
+        virtual afl::base::Ptr<afl::io::FileMapping> createFileMapping(FileSize_t /*limit*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual size_t readAt(FileSize_t pos, Bytes_t m)
+            {
+                // Produce bytes 0..9
+                size_t n = 0;
+                while (n < m.size() && pos + n < 10) {
+                    *m.at(n) = uint8_t(pos + n);
+                    ++n;
+                }
+                return n;
+            }
+     protected:
+        virtual bool hasConcurrentReadAt()
+            { return true; }
+    };
+    Tester t;
+    afl::base::Ref<afl::io::Stream> one(t.createChild());
+    afl::base::Ref<afl::io::Stream> two(t.createChild());
+
+    uint8_t tmp[4];
+    a.checkEqual("01. read", one->read(tmp), 4U);
+    a.checkEqual("02. data", tmp[3], 3U);
+    a.checkEqual("03. read", two->read(tmp), 4U);
+    a.checkEqual("04. data", tmp[3], 3U);
+    a.checkEqual("05. read", one->read(tmp), 4U);
+    a.checkEqual("06. data", tmp[3], 7U);
+    a.checkEqual("07. read", one->read(tmp), 2U);
+    a.checkEqual("08. data", tmp[1], 9U);
+    a.checkEqual("09. read", one->read(tmp), 0U);
+
+    a.checkEqual("11. readAt", two->readAt(8, tmp), 2U);
+    a.checkEqual("12. data", tmp[0], 8U);
+    a.checkEqual("13. read", two->read(tmp), 4U);
+    a.checkEqual("14. data", tmp[0], 4U);
+}
+
+// Test destruction of the master while a child performs a concurrent positional read.
+// Destruction must wait for the read to finish; afterwards, the child is a zombie.
+AFL_TEST("afl.io.MultiplexableStream:readAt:destroy", a)
+{
+    class Tester : public afl::io::MultiplexableStream {
+     public:
+        Tester()
+            : m_entered(0), m_release(0)
+            { }
+        ~Tester()
+            { detachChildren(); }
+        virtual size_t read(Bytes_t /*m*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual size_t write(ConstBytes_t /*m*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual void flush()
+            { throw std::runtime_error("unexpected"); }
+        virtual void setPos(FileSize_t /*pos*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual FileSize_t getPos()
+            { throw std::runtime_error("unexpected"); }
+        virtual FileSize_t getSize()
+            { return 10; }
+        virtual uint32_t getCapabilities()
+            { return CanRead | CanSeek; }
+        virtual String_t getName()
+            { return "<name>"; }
+        virtual afl::base::Ptr<afl::io::FileMapping> createFileMapping(FileSize_t /*limit*/)
+            { throw std::runtime_error("unexpected"); }
+        virtual size_t readAt(FileSize_t /*pos*/, Bytes_t m)
+            {
+                m_entered.post();
+                m_release.wait();
+                m.fill(7);
+                return m.size();
+            }
+
+        afl::sys::Semaphore m_entered;
+        afl::sys::Semaphore m_release;
+     protected:
+        virtual bool hasConcurrentReadAt()
+            { return true; }
+    };
+
+    class Reader : public afl::base::Stoppable {
+     public:
+        Reader(afl::io::Stream& s)
+            : m_stream(s), m_result(0)
+            { }
+        virtual void run()
+            {
+                uint8_t tmp[4];
+                m_result = m_stream.read(tmp);
+            }
+        virtual void stop()
+            { }
+        afl::io::Stream& m_stream;
+        size_t m_result;
+    };
+
+    class Destroyer : public afl::base::Stoppable {
+     public:
+        Destroyer(Tester* t)
+            : m_tester(t), m_done(0)
+            { }
+        virtual void run()
+            {
+                delete m_tester;
+                m_done.post();
+            }
+        virtual void stop()
+            { }
+        Tester* m_tester;
+        afl::sys::Semaphore m_done;
+    };
+
+    Tester* t = new Tester();
+    afl::base::Ref<afl::io::Stream> child(t->createChild());
+
+    // Start reading
+    Reader reader(*child);
+    afl::sys::Thread readerThread("reader", reader);
+    readerThread.start();
+    t->m_entered.wait();
+
+    // Start destroying; must wait for the read
+    afl::sys::Semaphore& release = t->m_release;
+    Destroyer destroyer(t);
+    afl::sys::Thread destroyerThread("destroyer", destroyer);
+    destroyerThread.start();
+    a.check("01. blocked", !destroyer.m_done.wait(100));
+
+    // Finish reading
+    release.post();
+    destroyer.m_done.wait();
+    readerThread.join();
+    destroyerThread.join();
+    a.checkEqual("11. read", reader.m_result, 4U);
+
+    // Child is a zombie
+    uint8_t tmp[4];
+    a.checkEqual("21. read", child->read(tmp), 0U);
+    a.checkEqual("22. readAt", child->readAt(0, tmp), 0U);
+}
@@ -0,0 +1,106 @@
+/**
+  *  \file test/afl/io/resp/commandparsertest.cpp
+  *  \brief Test for afl::io::resp::CommandParser
+  */
+
+#include "afl/io/resp/commandparser.hpp"
+
+#include "afl/data/access.hpp"
+#include "afl/data/integervalue.hpp"
+#include "afl/data/stringvalue.hpp"
+#include "afl/string/string.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::ConstBytes_t;
+using afl::io::resp::CommandParser;
+using afl::string::toBytes;
+
+/** Test parsing a complete command. */
+AFL_TEST("afl.io.resp.CommandParser:complete", a)
+{
+    CommandParser testee;
+    ConstBytes_t bytes(toBytes("*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$0\r\n\r\nrest"));
+    a.check("parse", testee.parse(bytes));
+    a.checkEqual("getNumArguments", testee.getNumArguments(), 3U);
+    a.checkEqualContent("arg 0", testee.getArgument(0), toBytes("SET"));
+    a.checkEqualContent("arg 1", testee.getArgument(1), toBytes("k"));
+    a.checkEqual("arg 2", testee.getArgument(2).size(), 0U);
+    a.checkEqual("arg 3", testee.getArgument(3).size(), 0U);
+    a.checkEqualContent("remainder", bytes, toBytes("rest"));
+}
+
+/** Test parsing a command containing binary data. */
+AFL_TEST("afl.io.resp.CommandParser:binary", a)
+{
+    static const uint8_t DATA[] = { '*','1','\r','\n','$','4','\r','\n', '\r','\n',0,'$', '\r','\n' };
+    static const uint8_t EXPECT[] = { '\r','\n',0,'$' };
+    CommandParser testee;
+    ConstBytes_t bytes(DATA);
+    a.check("parse", testee.parse(bytes));
+    a.checkEqual("getNumArguments", testee.getNumArguments(), 1U);
+    a.checkEqualContent("arg 0", testee.getArgument(0), ConstBytes_t(EXPECT));
+    a.check("empty", bytes.empty());
+}
+
+/** Test parsing an empty command. */
+AFL_TEST("afl.io.resp.CommandParser:empty", a)
+{
+    CommandParser testee;
+    ConstBytes_t bytes(toBytes("*0\r\n"));
+    a.check("parse", testee.parse(bytes));
+    a.checkEqual("getNumArguments", testee.getNumArguments(), 0U);
+    a.check("empty", bytes.empty());
+}
+
+/** Test rejected input. Data must remain unconsumed. */
+AFL_TEST("afl.io.resp.CommandParser:reject", a)
+{
+    static const char*const CASES[] = {
+        "",                                      // empty
+        "*",                                     // incomplete
+        "*2\r\n$3\r\nfoo\r\n",                   // incomplete
+        "*1\r\n$3\r\nfoo\r",                     // incomplete
+        "*1\r\n$3\r\nfo",                        // incomplete
+        "*1\n$3\nfoo\n",                         // LF only
+        "*1\r\n:3\r\n",                          // integer element
+        "*1\r\n$-1\r\n",                         // null element
+        "*-1\r\n",                               // null array
+        "*1\r\n$3\r\nfooXY",                     // bad terminator
+        "*1\r\n$99999999999\r\nfoo\r\n",         // overflow
+        "*99999\r\n$3\r\nfoo\r\n",               // count too large
+        "GET foo\r\n",                           // short form
+        "$3\r\nfoo\r\n",                         // not an array
+    };
+    for (size_t i = 0; i < sizeof(CASES)/sizeof(CASES[0]); ++i) {
+        CommandParser testee;
+        ConstBytes_t bytes(toBytes(CASES[i]));
+        a(CASES[i]).check("parse", !testee.parse(bytes));
+        a(CASES[i]).checkEqual("size", bytes.size(), toBytes(CASES[i]).size());
+        a(CASES[i]).checkEqual("getNumArguments", testee.getNumArguments(), 0U);
+    }
+}
+
+/** Test storeArguments(). */
+AFL_TEST("afl.io.resp.CommandParser:storeArguments", a)
+{
+    afl::data::Segment seg;
+    seg.pushBackNew(new afl::data::IntegerValue(42));
+
+    // Store 3 arguments; replaces the integer
+    CommandParser testee;
+    ConstBytes_t bytes(toBytes("*3\r\n$1\r\na\r\n$2\r\nbc\r\n$3\r\ndef\r\n*1\r\n$4\r\nwxyz\r\n"));
+    a.check("parse 1", testee.parse(bytes));
+    testee.storeArguments(seg);
+    a.checkEqual("size 1", seg.size(), 3U);
+    a.checkEqual("arg 1.0", afl::data::Access(seg[0]).toString(), "a");
+    a.checkEqual("arg 1.1", afl::data::Access(seg[1]).toString(), "bc");
+    a.checkEqual("arg 1.2", afl::data::Access(seg[2]).toString(), "def");
+
+    // Store 1 argument; re-uses the value
+    afl::data::Value* first = seg[0];
+    a.check("parse 2", testee.parse(bytes));
+    testee.storeArguments(seg);
+    a.checkEqual("size 2", seg.size(), 1U);
+    a.checkEqual("arg 2.0", afl::data::Access(seg[0]).toString(), "wxyz");
+    a.checkEqual("same value", seg[0], first);
+}
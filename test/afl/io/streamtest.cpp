@@ -156,3 +156,149 @@ AFL_TEST("afl.io.Stream:copyFrom", a)
 
     a.check("31. content", out.getContent().equalContent(afl::string::toBytes("lo world")));
 }
+
+/** Test createWritableFileMapping() on a stream that does not support it. */
+AFL_TEST("afl.io.Stream:createWritableFileMapping:default", a)
+{
+    afl::io::InternalStream in;
+    in.write(afl::string::toBytes("hello world"));
+    in.setPos(0);
+    a.check("private", in.createWritableFileMapping(5, false).get() == 0);
+    a.check("shared",  in.createWritableFileMapping(5, true).get() == 0);
+    a.checkEqual("getPos", in.getPos(), 0U);
+}
+
+/** Test copyFrom, larger than internal buffer. */
+AFL_TEST("afl.io.Stream:copyFrom:large", a)
+{
+    afl::io::InternalStream in;
+    for (size_t i = 0; i < 200000; ++i) {
+        uint8_t byte = uint8_t(i % 251);
+        in.write(afl::base::ConstBytes_t::fromSingleObject(byte));
+    }
+    in.setPos(0);
+
+    afl::io::InternalStream out;
+    out.copyFrom(in, 150000);
+    out.copyFrom(in);
+    a.checkEqual("01. getSize", out.getSize(), 200000U);
+    a.check("02. content", out.getContent().equalContent(in.getContent()));
+
+    // Source exhausted
+    AFL_CHECK_THROWS(a("11. copyFrom"), out.copyFrom(in, 1), afl::except::FileTooShortException);
+}
+
+/** Test copyFrom between files.
+    On POSIX, this will exercise the operating-system supported (sendfile) path. */
+AFL_TEST("afl.io.Stream:copyFrom:file", a)
+{
+    static const char INFILE[] = "__test1.tmp";
+    static const char OUTFILE[] = "__test2.tmp";
+    static const size_t SIZE = 100000;
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    try {
+        // Create source file
+        {
+            afl::base::Ref<afl::io::Stream> s = fs.openFile(INFILE, fs.Create);
+            for (size_t i = 0; i < SIZE; ++i) {
+                uint8_t byte = uint8_t(i % 251);
+                s->fullWrite(afl::base::ConstBytes_t::fromSingleObject(byte));
+            }
+        }
+
+        // Copy
+        {
+            afl::base::Ref<afl::io::Stream> in = fs.openFile(INFILE, fs.OpenRead);
+            afl::base::Ref<afl::io::Stream> out = fs.openFile(OUTFILE, fs.Create);
+            in->setPos(1000);
+            out->copyFrom(*in, 2000);
+            a.checkEqual("01. getPos", in->getPos(), 3000U);
+            a.checkEqual("02. getPos", out->getPos(), 2000U);
+
+            out->copyFrom(*in);
+            a.checkEqual("11. getPos", in->getPos(), SIZE);
+            a.checkEqual("12. getPos", out->getPos(), SIZE - 1000);
+
+            AFL_CHECK_THROWS(a("21. copyFrom"), out->copyFrom(*in, 1), afl::except::FileTooShortException);
+        }
+
+        // Verify
+        {
+            afl::base::Ref<afl::io::Stream> s = fs.openFile(OUTFILE, fs.OpenRead);
+            a.checkEqual("31. getSize", s->getSize(), SIZE - 1000);
+            for (size_t i = 1000; i < SIZE; ++i) {
+                uint8_t byte = 0;
+                s->fullRead(afl::base::Bytes_t::fromSingleObject(byte));
+                if (byte != uint8_t(i % 251)) {
+                    a.fail("32. content");
+                    break;
+                }
+            }
+        }
+        std::remove(INFILE);
+        std::remove(OUTFILE);
+    }
+    catch (...) {
+        std::remove(INFILE);
+        std::remove(OUTFILE);
+        throw;
+    }
+}
+
+/** Test readAt(), default implementation. */
+AFL_TEST("afl.io.Stream:readAt", a)
+{
+    afl::io::InternalStream in;
+    in.write(afl::string::toBytes("hello world"));
+
+    uint8_t tmp[3];
+    a.checkEqual("01. readAt", in.readAt(6, tmp), 3U);
+    a.checkEqualContent<uint8_t>("02. content", tmp, afl::string::toBytes("wor"));
+    a.checkEqual("03. readAt", in.readAt(9, tmp), 2U);
+    a.checkEqualContent<uint8_t>("04. content", afl::base::Bytes_t(tmp).trim(2), afl::string::toBytes("ld"));
+    a.checkEqual("05. readAt", in.readAt(20, tmp), 0U);
+}
+
+/** Test readAt() on files, and reading through multiple children of a file.
+    On POSIX, this will exercise the pread() path. */
+AFL_TEST("afl.io.Stream:readAt:file", a)
+{
+    static const char FILENAME[] = "__test.tmp";
+    afl::io::FileSystem& fs = afl::io::FileSystem::getInstance();
+    try {
+        {
+            afl::base::Ref<afl::io::Stream> s = fs.openFile(FILENAME, fs.Create);
+            s->fullWrite(afl::string::toBytes("0123456789"));
+        }
+
+        afl::base::Ref<afl::io::Stream> file = fs.openFile(FILENAME, fs.OpenRead);
+        uint8_t tmp[4];
+        a.checkEqual("01. readAt", file->readAt(3, tmp), 4U);
+        a.checkEqualContent<uint8_t>("02. content", tmp, afl::string::toBytes("3456"));
+        a.checkEqual("03. readAt", file->readAt(8, tmp), 2U);
+        a.checkEqual("04. readAt", file->readAt(10, tmp), 0U);
+
+        // Children have independent positions
+        afl::base::Ref<afl::io::Stream> one = file->createChild();
+        afl::base::Ref<afl::io::Stream> two = file->createChild();
+        two->setPos(5);
+        one->fullRead(afl::base::Bytes_t(tmp).trim(2));
+        a.checkEqualContent<uint8_t>("11. content", afl::base::Bytes_t(tmp).trim(2), afl::string::toBytes("01"));
+        two->fullRead(afl::base::Bytes_t(tmp).trim(2));
+        a.checkEqualContent<uint8_t>("12. content", afl::base::Bytes_t(tmp).trim(2), afl::string::toBytes("56"));
+        one->fullRead(afl::base::Bytes_t(tmp).trim(2));
+        a.checkEqualContent<uint8_t>("13. content", afl::base::Bytes_t(tmp).trim(2), afl::string::toBytes("23"));
+        a.checkEqual("14. getPos", one->getPos(), 4U);
+        a.checkEqual("15. getPos", two->getPos(), 7U);
+        two->fullRead(afl::base::Bytes_t(tmp).trim(2));
+        a.checkEqualContent<uint8_t>("16. content", afl::base::Bytes_t(tmp).trim(2), afl::string::toBytes("78"));
+
+        a.checkEqual("21. readAt", one->readAt(1, tmp), 4U);
+        a.checkEqualContent<uint8_t>("22. content", tmp, afl::string::toBytes("1234"));
+    }
+    catch (...) {
+        std::remove(FILENAME);
+        throw;
+    }
+    std::remove(FILENAME);
+}
@@ -280,3 +280,24 @@ AFL_TEST("afl.io.TextFile:write:big", a)
     a.checkEqual("content text", result.substr(0, 2), "hi");
     a.check("content newline", result[2] == '\r' || result[2] == '\n');
 }
+
+AFL_TEST("afl.io.TextFile:long-line", a)
+{
+    // Test writing and reading a line that needs to be converted in multiple pieces
+    String_t line;
+    for (int i = 0; i < 3000; ++i) {
+        line += "a\xC3\xA4";
+    }
+
+    afl::io::InternalStream ms;
+    afl::io::TextFile tf(ms);
+    tf.writeLine(line);
+    tf.flush();
+    a.check("expected file size", ms.getSize() == 6001 || ms.getSize() == 6002);
+
+    ms.setPos(0);
+    afl::io::TextFile tf2(ms);
+    String_t result;
+    a.check("read", tf2.readLine(result));
+    a.checkEqual("content", result, line);
+}
@@ -5,6 +5,7 @@
 
 #include "afl/io/transformdatasink.hpp"
 
+#include "afl/except/fileproblemexception.hpp"
 #include "afl/io/datasink.hpp"
 #include "afl/io/transform.hpp"
 #include "afl/string/string.hpp"
@@ -28,6 +29,46 @@ namespace {
         String_t& m_text;
     };
 
+    // A test sink that accepts a limited amount of data, and reports completion when that is reached
+    class LimitedSink : public afl::io::DataSink {
+     public:
+        LimitedSink(String_t& text, size_t limit)
+            : m_text(text),
+              m_limit(limit)
+            { }
+        virtual bool handleData(afl::base::ConstBytes_t& data)
+            {
+                afl::base::ConstBytes_t now = data.split(m_limit - m_text.size());
+                m_text.append(reinterpret_cast<const char*>(now.unsafeData()), now.size());
+                return m_text.size() >= m_limit;
+            }
+
+     private:
+        String_t& m_text;
+        size_t m_limit;
+    };
+
+    // A transformation that passes data through, and produces an end marker after flush()
+    class FlushTransform : public afl::io::Transform {
+     public:
+        FlushTransform()
+            : m_trailer()
+            { }
+        virtual void transform(afl::base::ConstBytes_t& in, afl::base::Bytes_t& out)
+            {
+                if (in.empty()) {
+                    out.trim(out.copyFrom(m_trailer.split(1)).size());
+                } else {
+                    out.trim(out.copyFrom(in).size());
+                    in.split(out.size());
+                }
+            }
+        virtual void flush()
+            { m_trailer = afl::string::toBytes("<end>"); }
+     private:
+        afl::base::ConstBytes_t m_trailer;
+    };
+
     // A test transformation that replicates each input byte five times
     class TestTransform : public afl::io::Transform {
      public:
@@ -133,3 +174,31 @@ AFL_TEST("afl.io.TransformDataSink:large", a)
         }
     }
 }
+
+/** Test flush(). */
+AFL_TEST("afl.io.TransformDataSink:flush", a)
+{
+    String_t text;
+    TestSink tester(text);
+    afl::io::TransformDataSink sink(tester);
+    sink.setNewTransform(new FlushTransform());
+    sink.handleFullData(afl::string::toBytes("abc"));
+    a.checkEqual("01. before flush", text, "abc");
+
+    sink.flush();
+    a.checkEqual("02. after flush", text, "abc<end>");
+}
+
+/** Test flush() into a sink that does not accept all data. */
+AFL_TEST("afl.io.TransformDataSink:flush:partial", a)
+{
+    String_t text;
+    LimitedSink tester(text, 5);
+    afl::io::TransformDataSink sink(tester);
+    sink.setNewTransform(new FlushTransform());
+    sink.handleFullData(afl::string::toBytes("abc"));
+    a.checkEqual("01. before flush", text, "abc");
+
+    AFL_CHECK_THROWS(a("02. flush"), sink.flush(), afl::except::FileProblemException);
+    a.checkEqual("03. after flush", text, "abc<e");
+}
@@ -67,3 +67,64 @@ AFL_TEST("afl.io.xml.Parser", a)
         a.checkEqual("42. text", t21->get(), "World");
     }
 }
+
+/** Test parseMatching(). */
+AFL_TEST("afl.io.xml.Parser:parseMatching", a)
+{
+    // Data to test
+    afl::io::ConstMemoryStream in(afl::string::toBytes("<?xml version=\"1.0\"?>"
+                                                       "<feed><title>t</title>"
+                                                       "<entry id=\"1\">one<entry id=\"nested\"/></entry>"
+                                                       "<other><entry id=\"x\"/></other>"
+                                                       "<entry id=\"2\">two</entry>"
+                                                       "</feed>"
+                                                       "<feed><entry id=\"3\"/></feed>"));
+
+    // Parser infrastructure
+    afl::charset::DefaultCharsetFactory csFactory;
+    afl::io::xml::DefaultEntityHandler eh;
+    afl::io::xml::Reader rdr(in, eh, csFactory);
+    afl::io::xml::Parser testee(rdr);
+
+    // Collect results
+    class Handler : public afl::io::xml::Parser::SubtreeHandler {
+     public:
+        virtual void handleSubtree(const afl::io::xml::TagNode& node)
+            { m_result += node.getName() + ":" + node.getAttributeByName("id") + ":" + node.getTextContent() + ","; }
+        String_t m_result;
+    };
+    Handler h;
+    testee.parseMatching("/feed/entry", h);
+    a.checkEqual("01. result", h.m_result, "entry:1:one,entry:2:two,entry:3:,");
+
+    // Parser is at end
+    std::auto_ptr<afl::io::xml::Node> n(testee.parse());
+    a.checkNull("11. eof", n.get());
+}
+
+/** Test parseMatching(), wildcards and path syntax. */
+AFL_TEST("afl.io.xml.Parser:parseMatching:wildcard", a)
+{
+    afl::io::ConstMemoryStream in(afl::string::toBytes("<a><b><c>1</c></b><d><c>2</c><e>3</e></d></a><x/>"));
+    afl::charset::DefaultCharsetFactory csFactory;
+    afl::io::xml::DefaultEntityHandler eh;
+    afl::io::xml::Reader rdr(in, eh, csFactory);
+    afl::io::xml::Parser testee(rdr);
+
+    class Handler : public afl::io::xml::Parser::SubtreeHandler {
+     public:
+        virtual void handleSubtree(const afl::io::xml::TagNode& node)
+            { m_result += node.getName() + node.getTextContent(); }
+        String_t m_result;
+    };
+
+    // Empty path matches nothing and consumes nothing
+    Handler h1;
+    testee.parseMatching("/", h1);
+    a.checkEqual("01. result", h1.m_result, "");
+
+    // Wildcard; missing leading slash, extra trailing slash
+    Handler h2;
+    testee.parseMatching("a/*/c/", h2);
+    a.checkEqual("11. result", h2.m_result, "c1c2");
+}
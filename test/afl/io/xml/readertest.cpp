@@ -368,6 +368,53 @@ AFL_TEST("afl.io.xml.Reader:text", a)
                  "\xc2\xa0\n");
 }
 
+/** Test long text and attributes, exceeding the buffer size.
+    Exercises the bulk-copy path across buffer boundaries and non-ASCII characters. */
+AFL_TEST("afl.io.xml.Reader:long", a)
+{
+    // Build document
+    String_t text, attr;
+    for (int i = 0; i < 500; ++i) {
+        text += "ab \xc3\xa4 &amp; ";
+        attr += "x'y ";
+    }
+    String_t doc = "<doc a=\"" + attr + "\" b=c>" + text + "</doc><e/>";
+
+    // Expected text
+    String_t expect;
+    for (int i = 0; i < 500; ++i) {
+        expect += "ab \xc3\xa4 & ";
+    }
+
+    afl::io::ConstMemoryStream ms(afl::string::toBytes(doc));
+    afl::charset::DefaultCharsetFactory cf;
+    afl::io::xml::Reader xr(ms, DefaultEntityHandler::getInstance(), cf);
+
+    a.check("01. start", xr.readNext() == xr.TagStart);
+    a.checkEqual("01. tag", xr.getTag(), "doc");
+
+    a.check("02. attr", xr.readNext() == xr.TagAttribute);
+    a.checkEqual("02. name", xr.getName(), "a");
+    a.checkEqual("02. value", xr.getValue(), attr);
+
+    a.check("03. attr", xr.readNext() == xr.TagAttribute);
+    a.checkEqual("03. name", xr.getName(), "b");
+    a.checkEqual("03. value", xr.getValue(), "c");
+
+    a.check("04. text", xr.readNext() == xr.Text);
+    a.checkEqual("04. value", xr.getValue(), expect);
+
+    a.check("05. end", xr.readNext() == xr.TagEnd);
+    a.checkEqual("05. tag", xr.getTag(), "doc");
+
+    a.check("06. start", xr.readNext() == xr.TagStart);
+    a.checkEqual("06. tag", xr.getTag(), "e");
+    a.checkEqual("06. pos", xr.getPos(), doc.size() - 4);
+
+    a.check("07. end", xr.readNext() == xr.TagEnd);
+    a.check("08. eof", xr.readNext() == xr.Eof);
+}
+
 /** Test quote handling. */
 AFL_TEST("afl.io.xml.Reader:quote", a)
 {
@@ -393,6 +440,53 @@ AFL_TEST("afl.io.xml.Reader:quote", a)
     a.check("04. eof", t == xr.Eof);
 }
 
+/** Test runs of varying length.
+    Places the characters that end a run at all positions relative to the blocks scanned by the vectorized path. */
+AFL_TEST("afl.io.xml.Reader:runs", a)
+{
+    static const char NAME_CHARS[] = "n-:_.";
+    static const char VALUE_CHARS[] = "v-!?[=<";
+    static const char TEXT_CHARS[] = "x\t>=/?!-[\"' ";
+    for (size_t k = 0; k < 40; ++k) {
+        String_t name = "t", value, text = "x";
+        for (size_t i = 0; i < k; ++i) {
+            name += NAME_CHARS[i % (sizeof(NAME_CHARS) - 1)];
+            value += VALUE_CHARS[i % (sizeof(VALUE_CHARS) - 1)];
+            text += TEXT_CHARS[i % (sizeof(TEXT_CHARS) - 1)];
+        }
+        text += ".";
+        String_t doc = "<" + name + " a=\"" + value + "\" b=" + value + "\t/><" + name + ">" + text + "</" + name + ">";
+
+        afl::io::ConstMemoryStream ms(afl::string::toBytes(doc));
+        afl::charset::DefaultCharsetFactory cf;
+        afl::io::xml::Reader xr(ms, DefaultEntityHandler::getInstance(), cf);
+
+        a.check("01. start", xr.readNext() == xr.TagStart);
+        a.checkEqual("01. tag", xr.getTag(), name);
+
+        a.check("02. attr", xr.readNext() == xr.TagAttribute);
+        a.checkEqual("02. name", xr.getName(), "a");
+        a.checkEqual("02. value", xr.getValue(), value);
+
+        a.check("03. attr", xr.readNext() == xr.TagAttribute);
+        a.checkEqual("03. name", xr.getName(), "b");
+        a.checkEqual("03. value", xr.getValue(), value);
+
+        a.check("04. end", xr.readNext() == xr.TagEnd);
+        a.checkEqual("04. tag", xr.getTag(), name);
+
+        a.check("05. start", xr.readNext() == xr.TagStart);
+        a.checkEqual("05. tag", xr.getTag(), name);
+
+        a.check("06. text", xr.readNext() == xr.Text);
+        a.checkEqual("06. value", xr.getValue(), text);
+
+        a.check("07. end", xr.readNext() == xr.TagEnd);
+        a.checkEqual("07. tag", xr.getTag(), name);
+        a.check("08. eof", xr.readNext() == xr.Eof);
+    }
+}
+
 /** Test seeking.
     Tests that parsing can properly be resumed. */
 AFL_TEST("afl.io.xml.Reader:setPos", a)
@@ -8,6 +8,7 @@
 #include "afl/data/errorvalue.hpp"
 #include "afl/except/invaliddataexception.hpp"
 #include "afl/except/remoteerrorexception.hpp"
+#include "afl/net/resp/replywriter.hpp"
 #include "afl/test/testrunner.hpp"
 
 /** Test for callInt() and callString() methods. */
@@ -44,3 +45,22 @@ AFL_TEST("afl.net.CommandHandler", a)
     AFL_CHECK_THROWS(a("09. err>int"), t.callInt(Segment().pushBackNew(new afl::data::ErrorValue("src", "x"))), afl::except::RemoteErrorException);
     AFL_CHECK_THROWS(a("10. err>str"), t.callString(Segment().pushBackNew(new afl::data::ErrorValue("src", "x"))), afl::except::RemoteErrorException);
 }
+
+/** Test default implementation of callDirect(). */
+AFL_TEST("afl.net.CommandHandler:callDirect", a)
+{
+    class Tester : public afl::net::CommandHandler {
+     public:
+        virtual void callVoid(const Segment_t&)
+            { }
+        virtual Value_t* call(const Segment_t& a)
+            { return Value_t::cloneOf(a[0]); }
+    };
+    Tester t;
+
+    afl::base::GrowableBytes_t out;
+    afl::net::resp::ReplyWriter writer(out);
+    t.callDirect(afl::data::Segment().pushBackString("x"), writer);
+    t.callDirect(afl::data::Segment(), writer);
+    a.checkEqualContent<uint8_t>("result", out, afl::string::toBytes("$1\r\nx\r\n$-1\r\n"));
+}
@@ -81,6 +81,39 @@ AFL_TEST("afl.net.MimeBuilder:addBase64", a)
     a.checkEqual("content", afl::string::fromBytes(sink.getContent()), RESULT);
 }
 
+/** Large base64 data, added in one piece and in small pieces, must produce the same result. */
+AFL_TEST("afl.net.MimeBuilder:addBase64:large", a)
+{
+    uint8_t data[1000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = uint8_t(i * 7);
+    }
+
+    afl::net::MimeBuilder one("");
+    one.addHeader("Section", "one");
+    one.addBase64(afl::base::ConstBytes_t(data).subrange(0, 10));
+    one.addBase64(afl::base::ConstBytes_t(data).subrange(10));
+    one.addBoundary();
+    one.finish();
+
+    afl::net::MimeBuilder many("");
+    many.addHeader("Section", "one");
+    for (size_t i = 0; i < sizeof(data); i += 3) {
+        many.addBase64(afl::base::ConstBytes_t(data).subrange(i, 3));
+    }
+    many.addBoundary();
+    many.finish();
+
+    afl::io::InternalSink oneSink, manySink;
+    one.write(oneSink, false);
+    many.write(manySink, false);
+    a.checkEqual("getTotalSize()", one.getTotalSize(), many.getTotalSize());
+    a.checkEqual("content", afl::string::fromBytes(oneSink.getContent()), afl::string::fromBytes(manySink.getContent()));
+
+    // Header (16) + 17 lines of 57 bytes (76 characters) + 31 bytes (44 characters) + boundary (9)
+    a.checkEqual("size", oneSink.getContent().size(), 16U + 17*78 + 44 + 2 + 9);
+}
+
 /** Text contains potential boundary. */
 AFL_TEST("afl.net.MimeBuilder:boundary-conflict", a)
 {
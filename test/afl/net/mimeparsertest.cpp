@@ -208,6 +208,55 @@ AFL_TEST("afl.net.MimeParser:getBodyAsString:base64", a)
     a.checkEqual("", testee.getBodyAsString(), "poof-, a harsh method of error correction!\r\n\r\nSo it is");
 }
 
+/** Test base64 body with line lengths that are not a multiple of 4, and CRLF line ends.
+    The line breaks must be ignored. */
+AFL_TEST("afl.net.MimeParser:getBodyAsString:base64:odd-lines", a)
+{
+    afl::net::MimeParser testee;
+
+    testee.handleFullData(afl::string::toBytes("Content-Transfer-Encoding: base64\r\n"
+                                               "\r\n"
+                                               "SGVsb\r\n"
+                                               "G8sIHd\r\n"
+                                               "vcmxkIQ==\r\n"));
+    testee.finish();
+    a.checkEqual("", testee.getBodyAsString(), "Hello, world!");
+}
+
+/** Test base64 body with each line padded separately. */
+AFL_TEST("afl.net.MimeParser:getBodyAsString:base64:padded-lines", a)
+{
+    afl::net::MimeParser testee;
+
+    testee.handleFullData(afl::string::toBytes("Content-Transfer-Encoding: base64\n"
+                                               "\n"
+                                               "SGk=\n"
+                                               "SGk=\n"
+                                               "SGk\n"));
+    testee.finish();
+    a.checkEqual("", testee.getBodyAsString(), "HiHiHi");
+}
+
+/** Test quoted-printable body, given byte by byte.
+    Soft line breaks and escapes can be split across calls. */
+AFL_TEST("afl.net.MimeParser:getBodyAsString:qp:bytewise", a)
+{
+    afl::net::MimeParser testee;
+
+    afl::base::ConstBytes_t data = afl::string::toBytes("Content-Transfer-Encoding: quoted-printable\r\n"
+                                                        "\r\n"
+                                                        "Ich w=FCrde gerne =\r\n"
+                                                        "die=20\r\n"
+                                                        "=3D=\n"
+                                                        "=3\n"
+                                                        "x=");
+    while (!data.empty()) {
+        testee.handleFullData(data.split(1));
+    }
+    testee.finish();
+    a.checkEqual("", testee.getBodyAsString(), "Ich w\xFCrde gerne die \n==3\nx=");
+}
+
 /** Test base64 body, body decoding disabled. */
 AFL_TEST("afl.net.MimeParser:getBodyAsString:base64:disabled", a)
 {
@@ -8,6 +8,10 @@
 #include <memory>
 #include "afl/data/access.hpp"
 #include "afl/data/segment.hpp"
+#include "afl/except/remoteerrorexception.hpp"
+#include "afl/io/internalsink.hpp"
+#include "afl/io/resp/writer.hpp"
+#include "afl/net/resp/replywriter.hpp"
 #include "afl/test/testrunner.hpp"
 
 using afl::data::Access;
@@ -40,6 +44,20 @@ namespace {
     {
         as.checkEqual("result", computeBits(as, a), expectation);
     }
+
+    // Verify that callDirect() produces the same output as serializing call()'s result.
+    void checkDirect(afl::test::Assert a, InternalDatabase& db, const Segment& cmd)
+    {
+        std::auto_ptr<Value> value(db.call(cmd));
+        afl::io::InternalSink expect;
+        afl::io::resp::Writer(expect).visit(value.get());
+
+        afl::base::GrowableBytes_t result;
+        afl::net::resp::ReplyWriter writer(result);
+        db.callDirect(cmd, writer);
+
+        a.checkEqualContent<uint8_t>("callDirect", result, expect.getContent());
+    }
 }
 
 StringSegment::StringSegment(const char* str)
@@ -805,3 +823,46 @@ AFL_TEST("afl.net.redis.InternalDatabase:sort:external", a)
     a.check("88. sort value", !Access(result)[5].isNull());
     a.checkEqual("89. sort value", Access(result)[5].toString(), "");
 }
+
+/** Test callDirect(). */
+AFL_TEST("afl.net.redis.InternalDatabase:callDirect", a)
+{
+    InternalDatabase db;
+    db.callVoid(StringSegment("rpush l a b c d e").self());
+    db.callVoid(StringSegment("hmset h one 1 two 2 three 3").self());
+    db.callVoid(StringSegment("sadd s1 a b c").self());
+    db.callVoid(StringSegment("sadd s2 b c d").self());
+    db.callVoid(StringSegment("set k value").self());
+
+    // Directly-implemented commands
+    static const int32_t RANGES[][2] = {
+        {0,-1}, {1,2}, {-2,-1}, {3,10}, {5,10}, {-100,100}, {2,1}, {0,0}, {-1,-1},
+    };
+    for (size_t i = 0; i < sizeof(RANGES)/sizeof(RANGES[0]); ++i) {
+        checkDirect(a("lrange"), db, StringSegment("lrange l").self().pushBackInteger(RANGES[i][0]).pushBackInteger(RANGES[i][1]));
+    }
+    checkDirect(a("lrange missing"), db, StringSegment("lrange x").self().pushBackInteger(0).pushBackInteger(-1));
+    checkDirect(a("get"),            db, StringSegment("get k").self());
+    checkDirect(a("get missing"),    db, StringSegment("get x").self());
+    checkDirect(a("hgetall"),        db, StringSegment("hgetall h").self());
+    checkDirect(a("hgetall missing"),db, StringSegment("hgetall x").self());
+    checkDirect(a("hkeys"),          db, StringSegment("hkeys h").self());
+    checkDirect(a("smembers"),       db, StringSegment("smembers s1").self());
+    checkDirect(a("smembers missing"), db, StringSegment("smembers x").self());
+    checkDirect(a("sinter"),         db, StringSegment("sinter s1 s2").self());
+    checkDirect(a("sunion"),         db, StringSegment("sunion s1 s2").self());
+    checkDirect(a("sdiff"),          db, StringSegment("sdiff s1 s2").self());
+
+    // Commands implemented using fallback
+    checkDirect(a("hlen"),           db, StringSegment("hlen h").self());
+    checkDirect(a("type"),           db, StringSegment("type l").self());
+    checkDirect(a("ping"),           db, StringSegment("ping").self());
+
+    // Errors
+    afl::base::GrowableBytes_t result;
+    afl::net::resp::ReplyWriter writer(result);
+    AFL_CHECK_THROWS(a("error type"),  db.callDirect(StringSegment("smembers l").self(), writer), std::runtime_error);
+    AFL_CHECK_THROWS(a("error count"), db.callDirect(StringSegment("get").self(), writer), std::runtime_error);
+    AFL_CHECK_THROWS(a("error verb"),  db.callDirect(StringSegment("").self(), writer), afl::except::RemoteErrorException);
+    a.checkEqual("no output", result.size(), 0U);
+}
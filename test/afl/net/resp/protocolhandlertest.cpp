@@ -5,6 +5,7 @@
 
 #include "afl/net/resp/protocolhandler.hpp"
 
+#include "afl/data/access.hpp"
 #include "afl/data/defaultvaluefactory.hpp"
 #include "afl/string/string.hpp"
 #include "afl/sys/types.hpp"
@@ -59,3 +60,79 @@ AFL_TEST("afl.net.resp.ProtocolHandler", a)
     a.checkDifferent("42. dataToSend", op.m_dataToSend.size(), 0U);
     a.checkEqual("43. dataToSend", *op.m_dataToSend.at(0), '-');
 }
+
+/** Test multi-bulk commands, complete and fragmented. */
+AFL_TEST("afl.net.resp.ProtocolHandler:multi-bulk", a)
+{
+    // A CommandHandler that joins its arguments
+    class Tester : public afl::net::CommandHandler {
+     public:
+        virtual Value_t* call(const Segment_t& command)
+            {
+                String_t result;
+                for (size_t i = 0; i < command.size(); ++i) {
+                    result += afl::data::Access(command[i]).toString();
+                    result += "|";
+                }
+                return afl::data::DefaultValueFactory().createString(result);
+            }
+        virtual void callVoid(const Segment_t& command)
+            { delete call(command); }
+    };
+    Tester t;
+    afl::net::resp::ProtocolHandler testee(t);
+    afl::net::ProtocolHandler::Operation op;
+
+    // Two complete commands in one buffer; replies are sent together
+    testee.handleData(afl::string::toBytes("*2\r\n$1\r\na\r\n$2\r\nbc\r\n*1\r\n$3\r\ndef\r\n"));
+    testee.getOperation(op);
+    a.checkEqualContent("01. dataToSend", op.m_dataToSend, afl::string::toBytes("$5\r\na|bc|\r\n$4\r\ndef|\r\n"));
+    testee.getOperation(op);
+    a.checkEqual("02. dataToSend", op.m_dataToSend.size(), 0U);
+
+    // Fragmented command followed by a complete one
+    testee.handleData(afl::string::toBytes("*2\r\n$3\r\nxy"));
+    testee.getOperation(op);
+    a.checkEqual("11. dataToSend", op.m_dataToSend.size(), 0U);
+    testee.handleData(afl::string::toBytes("z\r\n$1\r\nw\r\n*1\r\n$1\r\nq\r\n"));
+    testee.getOperation(op);
+    a.checkEqualContent("12. dataToSend", op.m_dataToSend, afl::string::toBytes("$6\r\nxyz|w|\r\n$2\r\nq|\r\n"));
+
+    // Command arriving while sending is collected and sent after acknowledgement
+    testee.handleData(afl::string::toBytes("*1\r\n$1\r\nr\r\n"));
+    a.checkEqualContent("13. dataToSend", op.m_dataToSend, afl::string::toBytes("$6\r\nxyz|w|\r\n$2\r\nq|\r\n"));
+    testee.getOperation(op);
+    a.checkEqualContent("14. dataToSend", op.m_dataToSend, afl::string::toBytes("$2\r\nr|\r\n"));
+    a.check("15. close", !op.m_close);
+}
+
+/** Test direct replies, including a failing command. */
+AFL_TEST("afl.net.resp.ProtocolHandler:callDirect", a)
+{
+    // A CommandHandler that produces output directly, failing on request
+    class Tester : public afl::net::CommandHandler {
+     public:
+        virtual Value_t* call(const Segment_t& /*command*/)
+            { return 0; }
+        virtual void callVoid(const Segment_t& /*command*/)
+            { }
+        virtual void callDirect(const Segment_t& command, afl::net::ReplyBuilder& reply)
+            {
+                String_t verb = afl::data::Access(command[0]).toString();
+                reply.addArray(2);
+                reply.addString(afl::string::toMemory(verb));
+                if (verb == "fail") {
+                    throw std::runtime_error("failed");
+                }
+                reply.addInteger(int32_t(command.size()));
+            }
+    };
+    Tester t;
+    afl::net::resp::ProtocolHandler testee(t);
+    afl::net::ProtocolHandler::Operation op;
+
+    testee.handleData(afl::string::toBytes("*2\r\n$2\r\nok\r\n$1\r\nx\r\n*1\r\n$4\r\nfail\r\n"));
+    testee.getOperation(op);
+    a.checkEqualContent("01. dataToSend", op.m_dataToSend, afl::string::toBytes("*2\r\n$2\r\nok\r\n$1\r\n2\r\n-failed\r\n"));
+    a.check("02. close", !op.m_close);
+}
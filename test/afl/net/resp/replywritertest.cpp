@@ -0,0 +1,54 @@
+/**
+  *  \file test/afl/net/resp/replywritertest.cpp
+  *  \brief Test for afl::net::resp::ReplyWriter
+  */
+
+#include "afl/net/resp/replywriter.hpp"
+
+#include <memory>
+#include "afl/data/defaultvaluefactory.hpp"
+#include "afl/string/string.hpp"
+#include "afl/test/testrunner.hpp"
+
+using afl::base::GrowableBytes_t;
+using afl::net::resp::ReplyWriter;
+using afl::string::toBytes;
+using afl::string::toMemory;
+
+/** Test scalars. */
+AFL_TEST("afl.net.resp.ReplyWriter:scalars", a)
+{
+    GrowableBytes_t out;
+    ReplyWriter testee(out);
+    testee.addNull();
+    testee.addInteger(-42);
+    testee.addString(toMemory("hello"));
+    testee.addString(toMemory(""));
+    a.checkEqualContent<uint8_t>("result", out, toBytes("$-1\r\n$3\r\n-42\r\n$5\r\nhello\r\n$0\r\n\r\n"));
+}
+
+/** Test arrays. */
+AFL_TEST("afl.net.resp.ReplyWriter:array", a)
+{
+    GrowableBytes_t out;
+    ReplyWriter testee(out);
+    testee.addArray(2);
+    testee.addString(toMemory("a"));
+    testee.addArray(0);
+    testee.addArray(1234567890);
+    a.checkEqualContent<uint8_t>("result", out, toBytes("*2\r\n$1\r\na\r\n*0\r\n*1234567890\r\n"));
+}
+
+/** Test values and errors. */
+AFL_TEST("afl.net.resp.ReplyWriter:value", a)
+{
+    GrowableBytes_t out;
+    out.append(toBytes("x"));
+
+    ReplyWriter testee(out);
+    std::auto_ptr<afl::data::Value> v(afl::data::DefaultValueFactory().createInteger(7));
+    testee.addValue(v.get());
+    testee.addValue(0);
+    testee.sendError("boom\nignored");
+    a.checkEqualContent<uint8_t>("result", out, toBytes("x$1\r\n7\r\n$-1\r\n-boom\r\n"));
+}